@@ -140,13 +140,13 @@ static bg_error eval_%s_(bg_node_t *node) {
 
 index = 0
 for i in cfg["inputs"]:
-    s += "  p_data->inputs.%s = node->input_ports[%d]->value;\n" %(i["name"].replace("/", "_"), index)
+    s += "  p_data->inputs.%s = bg_PORT_VALUE(node->input_ports[%d]);\n" %(i["name"].replace("/", "_"), index)
     index += 1
 
 s += "\n  err = evaluate_%s(node, (%s_private_data*)node->_priv_data);\n\n" % (cfg["name"], cfg["name"])
 index = 0
 for i in cfg["outputs"]:
-    s += "  node->output_ports[%d]->value = p_data->outputs.%s;\n" %(index, i["name"].replace("/", "_"))
+    s += "  bg_PORT_VALUE(node->output_ports[%d]) = p_data->outputs.%s;\n" %(index, i["name"].replace("/", "_"))
     index += 1
 
 s += "\n  return err;\n}\n"
@@ -20,6 +20,8 @@
  * call to bg_error_clear(). Virtually all functions return a
  * \link bg_error \endlink so that
  * you can either check after every call or collectivly via bg_error_occurred().
+ * With THREAD_SUPPORT every thread has its own error state, so graphs can be
+ * used from several threads without one thread seeing the errors of another.
  *
  * \section documentation Documentation
  *
@@ -73,6 +75,11 @@ extern "C" {
 
 typedef struct bg_graph_t bg_graph_t;
 typedef struct bg_edge_t bg_edge_t;
+typedef struct bg_input_port_t bg_input_port_t;
+typedef struct bg_output_port_t bg_output_port_t;
+typedef struct bg_definition_t bg_definition_t;
+typedef struct bg_instance_t bg_instance_t;
+typedef struct bg_pool_t bg_pool_t;
 
 typedef unsigned long bg_node_id_t;
 typedef unsigned long bg_edge_id_t;
@@ -181,6 +188,9 @@ bg_error getExternNodes(const char* path);
 /**
  * \brief Indicates if the library is in an error state.
  *
+ * The error state belongs to the calling thread if the library was compiled
+ * with THREAD_SUPPORT.
+ *
  * \return True if the internal error state is set
  * \return False if everthing is fine
  */
@@ -307,8 +317,8 @@ bg_error bg_graph_create_node(bg_graph_t *graph, const char *name,
  *   If the port indices are out of range.
  * \returns \link bg_ERR_INVALID_CONNECTION \endlink
  *   If you try to specify a graph input as sink or a graph output as source.
- * \returns \link bg_ERR_PORT_FULL \endlink
- *   If either the input_port or output_port has to many connections.
+ * \returns \link bg_ERR_NO_MEMORY \endlink
+ *   If the edge or the edge arrays of the ports could not be allocated.
  */
 bg_error bg_graph_create_edge(bg_graph_t *graph,
                               bg_node_id_t source_node_id,
@@ -390,6 +400,148 @@ bg_error bg_graph_disconnect_node(bg_graph_t *graph, bg_node_id_t node_id);
  */
 bg_error bg_graph_evaluate(bg_graph_t *graph);
 
+/**
+ * \brief Compiles the graph into a flat execution plan.
+ *
+ * The plan is a contiguous array of instructions that address one dense
+ * value buffer. Once a graph is compiled bg_graph_evaluate() runs the plan
+ * instead of walking the node lists. Only nodes whose inputs changed since
+ * the last evaluation are evaluated again; sub-graph and extern nodes are
+ * always evaluated. The plan is rebuilt automatically when the graph is
+ * modified. Sub-graphs are compiled as well.
+ *
+ * \param *graph The graph to compile.
+ * \return \link bg_SUCCESS \endlink or error state.
+ */
+bg_error bg_graph_compile(bg_graph_t *graph);
+
+/**
+ * \brief Inlines sub-graphs into the compiled plan of the graph.
+ *
+ * The nodes of all sub-graphs become part of the plan of this graph instead
+ * of evaluating each sub-graph through a recursive call, and the input and
+ * output nodes are reduced to the merge of their input. The sub-graphs can
+ * still be inspected and modified through their own handles.
+ *
+ * \param *graph The graph.
+ * \param inline_subgraphs Whether to inline the sub-graphs.
+ * \return \link bg_SUCCESS \endlink or error state.
+ */
+bg_error bg_graph_set_inline_subgraphs(bg_graph_t *graph,
+                                       bool inline_subgraphs);
+
+/**
+ * \brief Drops the names of all nodes and ports of the graph.
+ *
+ * Deployed graphs that are only evaluated do not need their names. In strip
+ * mode every node and port name of the graph and its sub-graphs is replaced
+ * by the empty string, including names set later on, so looking up nodes or
+ * ports by name fails. Disabling the mode does not restore dropped names.
+ * Clones keep the mode of their source.
+ *
+ * \param *graph The graph.
+ * \param strip Whether to drop the names.
+ * \return \link bg_SUCCESS \endlink or error state.
+ */
+bg_error bg_graph_set_strip_names(bg_graph_t *graph, bool strip);
+
+/**
+ * \brief Lets the edges read the output values of their sources.
+ *
+ * By default the evaluation of a node copies each output value to all
+ * outgoing edges. With direct edges the merges read the output port of the
+ * source instead, which saves the stores for nodes with a high fan-out. The
+ * results are the same. Values given to edges with bg_edge_set_value() are
+ * used until the source node is evaluated again, and edges without a source
+ * keep their own value. Applies to the current sub-graphs as well; clones
+ * keep the setting.
+ *
+ * \param *graph The graph.
+ * \param direct Whether the edges read their sources directly.
+ * \return \link bg_SUCCESS \endlink or error state.
+ */
+bg_error bg_graph_set_direct_edges(bg_graph_t *graph, bool direct);
+
+/**
+ * \brief Enables level-parallel evaluation of the graph.
+ *
+ * The nodes of the compiled graph are partitioned into levels of nodes that
+ * do not depend on each other. bg_graph_evaluate() then evaluates each level
+ * with at least \a min_width nodes on a persistent pool of \a thread_cnt
+ * threads owned by the graph. Narrower levels are evaluated serially. The
+ * results are identical to the serial evaluation. A \a thread_cnt of 0 or 1
+ * switches back to serial evaluation.
+ *
+ * \param *graph The graph.
+ * \param thread_cnt The number of threads including the calling one.
+ * \param min_width The minimal number of nodes of a parallel level.
+ * \return \link bg_SUCCESS \endlink or error state.
+ * \returns \link bg_ERR_NOT_IMPLEMENTED \endlink if the library was
+ * compiled without THREAD_SUPPORT.
+ */
+bg_error bg_graph_set_parallel(bg_graph_t *graph, size_t thread_cnt,
+                               size_t min_width);
+
+/**
+ * \brief Evaluates independent sub-graph nodes concurrently.
+ *
+ * Sub-graph nodes of the same level of the compiled graph, i.e. nodes that
+ * do not depend on each other, are evaluated on a persistent pool of
+ * \a thread_cnt threads owned by the graph. All other nodes are evaluated
+ * on the calling thread, and the consumers of a sub-graph node are
+ * evaluated after it finished. The results are identical to the serial
+ * evaluation as long as extern nodes in different sub-graphs don't share
+ * state. Inlined sub-graphs are not affected. A \a thread_cnt of 0 or 1
+ * switches back to serial evaluation, bg_graph_set_parallel() replaces this
+ * mode.
+ *
+ * \param *graph The graph.
+ * \param thread_cnt The number of threads including the calling one.
+ * \return \link bg_SUCCESS \endlink or error state.
+ * \returns \link bg_ERR_NOT_IMPLEMENTED \endlink if the library was
+ * compiled without THREAD_SUPPORT.
+ */
+bg_error bg_graph_set_parallel_subgraphs(bg_graph_t *graph,
+                                         size_t thread_cnt);
+
+/**
+ * \brief Evaluates the graph for a batch of input vectors.
+ *
+ * Sample \a s sets the i-th graph input to
+ * <tt>inputs[s * input_cnt + i]</tt>, which replaces the merged value of
+ * the input port, and writes the i-th graph output to
+ * <tt>outputs[s * output_cnt + i]</tt>. The samples are evaluated
+ * independently of each other, starting from the current state of the
+ * graph. The values returned by bg_graph_get_output() are not updated. The
+ * graph is compiled if necessary.
+ *
+ * \param *graph The graph to evaluate.
+ * \param *inputs \a sample_cnt input vectors.
+ * \param *outputs Receives \a sample_cnt output vectors.
+ * \param sample_cnt The number of samples.
+ * \return \link bg_SUCCESS \endlink or error state.
+ * \returns \link bg_ERR_WRONG_TYPE \endlink if the graph contains extern
+ *          nodes.
+ */
+bg_error bg_graph_evaluate_batch(bg_graph_t *graph, const bg_real *inputs,
+                                 bg_real *outputs, size_t sample_cnt);
+
+/**
+ * \brief Simplifies the structure of a graph without changing its outputs.
+ *
+ * Builtin nodes without input edges are folded into the bias of the ports
+ * they feed, PIPE nodes that only forward a weighted sum are replaced by
+ * direct edges, and hidden nodes that do not contribute to an output or an
+ * extern node are removed. Removed nodes take their edges with them. New
+ * edges get ids above the largest edge id of the graph. Outputs may differ
+ * in the last bits because sums are evaluated in a different order.
+ *
+ * \param *graph The graph to optimize.
+ * \param recursive Whether to optimize the sub-graphs as well.
+ * \return \link bg_SUCCESS \endlink or error state.
+ */
+bg_error bg_graph_optimize(bg_graph_t *graph, bool recursive);
+
 /* introspection */
 bg_error bg_graph_get_output(const bg_graph_t *graph, size_t output_port_idx,
                              bg_real *value);
@@ -402,14 +554,89 @@ bg_error bg_graph_get_input_nodes(const bg_graph_t *graph,
 bg_error bg_graph_get_output_nodes(const bg_graph_t *graph,
                                    bg_node_id_t *output_ids,
                                    size_t *output_cnt);
+/* The hidden and output nodes in the order they are evaluated, sorts the
+ * graph if it was changed. Nodes without a relation between them may come
+ * in another order after edits than after loading the same graph. */
+bg_error bg_graph_get_evaluation_order(bg_graph_t *graph,
+                                       bg_node_id_t *node_ids,
+                                       size_t *node_cnt);
 bg_error bg_graph_get_subgraph(bg_graph_t *graph, const char* name,
                                bg_graph_t **subgraph);
 bg_error bg_graph_get_subgraph_list(bg_graph_t *graph, char **path,
                                     char **graph_name, size_t *subgraph_cnt,
                                     bool recursive);
+/**
+ * \brief Look up a node or port by its hierarchical name.
+ *
+ * The path consists of the names of nested sub-graph nodes separated by
+ * '/', the name of a node and optionally ':' followed by a port name, e.g.
+ * "arm/left/joint3:in1". Input port names take precedence over output port
+ * names. Without a port name the path refers to the first output of the
+ * node. The lookup takes time linear in the length of the path. Like the
+ * other name lookups it does not set the error state.
+ *
+ * \param[out] node_graph The (sub-)graph containing the node.
+ * \param[out] node_id The ID of the node in node_graph.
+ * \param[out] is_input Whether the path refers to an input port.
+ * \param[out] port_idx The index of the port.
+ * \returns \link bg_ERR_NODE_NOT_FOUND \endlink
+ *   If a sub-graph or the node does not exist.
+ * \returns \link bg_ERR_OUT_OF_RANGE \endlink
+ *   If the node has no port of the given name.
+ */
+bg_error bg_graph_resolve_path(bg_graph_t *graph, const char *path,
+                               bg_graph_t **node_graph, bg_node_id_t *node_id,
+                               bool *is_input, size_t *port_idx);
 bg_error bg_graph_has_node(bg_graph_t *graph, bg_node_id_t node_id,
                            bool *has_node);
 
+/* direct access */
+/**
+ * \brief Get a pointer to an input port of the graph.
+ *
+ * Values written with bg_input_set_value_p() go to the edges with source
+ * ID 0 that feed the input, as if they were set with bg_edge_set_value().
+ * An input without such an edge can't take a value. The pointer stays valid
+ * until the input node is removed.
+ *
+ * \returns \link bg_ERR_OUT_OF_RANGE \endlink
+ *   If the graph has no input with the given index.
+ */
+bg_error bg_graph_get_input_pointer(bg_graph_t *graph, size_t input_port_idx,
+                                    bg_input_port_t **input_port);
+/**
+ * \brief Get a pointer to an output port of the graph.
+ *
+ * The value can be read with bg_output_get_value_p(). The pointer stays
+ * valid until the output node is removed.
+ *
+ * \returns \link bg_ERR_OUT_OF_RANGE \endlink
+ *   If the graph has no output with the given index.
+ */
+bg_error bg_graph_get_output_pointer(bg_graph_t *graph,
+                                     size_t output_port_idx,
+                                     bg_output_port_t **output_port);
+/**
+ * \brief Set all inputs of the graph at once.
+ *
+ * Equivalent to calling bg_input_set_value_p() for every input port.
+ * Does not touch the error state.
+ *
+ * \param *values One value per graph input, in the order of the inputs.
+ * \returns \link bg_ERR_EDGE_NOT_FOUND \endlink
+ *   If an input has no edge with source ID 0. The other inputs are set.
+ */
+bg_error bg_graph_set_inputs(bg_graph_t *graph, const bg_real *values);
+/**
+ * \brief Get all outputs of the graph at once.
+ *
+ * Equivalent to calling bg_graph_get_output() for every output port.
+ * Does not touch the error state.
+ *
+ * \param *values Receives one value per graph output.
+ */
+bg_error bg_graph_get_outputs(const bg_graph_t *graph, bg_real *values);
+
 /* YAML support */
 /**
  * \returns \link bg_ERR_NOT_IMPLEMENTED \endlink if the library was
@@ -429,6 +656,35 @@ bg_error bg_graph_to_yaml_string(unsigned char *buffer, size_t buffer_size,
                                  const bg_graph_t *g, size_t *bytes_written);
 /*bg_error bg_graph_from_parser(yaml_parser_t *parser, bg_graph_t *g);*/
 
+/* C code generation */
+/**
+ * \brief Writes the graph as a self-contained C source file.
+ *
+ * Every node and merge becomes straight-line code with the weights, biases
+ * and defaults as literals; sub-graphs are inlined. The file defines
+ * \code
+ * size_t <prefix>_state_size(void);
+ * void <prefix>_init(bg_real *state);
+ * void <prefix>_evaluate(bg_real *state, const bg_real *inputs,
+ *                        bg_real *outputs);
+ * \endcode
+ * where \c state holds the <prefix>_state_size() values that carry over
+ * from one evaluation to the next, and <prefix>_init() sets them to the
+ * current state of the graph. Like in bg_graph_evaluate_batch() the inputs
+ * replace the merged values of the input ports. Edges without source node
+ * into hidden nodes keep their current values.
+ *
+ * \param *filename The file to write.
+ * \param *prefix The prefix of the generated functions. It has to be a
+ *        valid C identifier.
+ * \param *g The graph to translate.
+ * \return \link bg_SUCCESS \endlink or error state.
+ * \returns \link bg_ERR_WRONG_TYPE \endlink if the graph contains extern
+ *          nodes.
+ */
+bg_error bg_graph_to_c(const char *filename, const char *prefix,
+                       bg_graph_t *g);
+
 
 
 
@@ -502,6 +758,34 @@ bg_error bg_node_get_output_idx(bg_graph_t *graph, bg_node_id_t node_id,
 bg_error bg_node_get_input_idx(bg_graph_t *graph, bg_node_id_t node_id,
                                const char *name, size_t *idx);
 
+/* direct access */
+/**
+ * \brief Get a pointer to an output port of a node.
+ *
+ * The value can be read with bg_output_get_value_p(). The pointer stays
+ * valid until the node is removed.
+ */
+bg_error bg_node_get_output_pointer(bg_graph_t *graph, bg_node_id_t node_id,
+                                    size_t output_port_idx,
+                                    bg_output_port_t **output_port);
+/**
+ * \brief Set the value of a graph input without any lookup.
+ *
+ * Does not touch the error state.
+ * \returns \link bg_ERR_EDGE_NOT_FOUND \endlink
+ *   If the input has no edge with source ID 0 to take the value.
+ * \see bg_graph_get_input_pointer()
+ */
+bg_error bg_input_set_value_p(bg_input_port_t *input_port, bg_real value);
+/**
+ * \brief Get the value of an output port without any lookup.
+ *
+ * Does not touch the error state.
+ * \see bg_graph_get_output_pointer(), bg_node_get_output_pointer()
+ */
+bg_error bg_output_get_value_p(const bg_output_port_t *output_port,
+                               bg_real *value);
+
 
 /**
  * @}
@@ -532,6 +816,142 @@ bg_error bg_edge_get_pointer(bg_graph_t *graph, bg_edge_id_t edge_id,
  */
 
 
+/***********************************//**
+ * \defgroup instance_api Instance API
+ * @{
+ * A definition is an immutable snapshot of the structure of a graph:
+ * nodes, merges, biases, defaults and weights with sub-graphs inlined. An
+ * instance holds nothing but the values of one evaluation state. Many
+ * instances can evaluate against the same definition, also from different
+ * threads at the same time as long as every instance is used by one thread
+ * at a time. Definitions and instances do not refer back to the graph, so
+ * the graph may be changed or freed afterwards.
+ ***************************************/
+
+/**
+ * \brief Creates a definition from the current structure of a graph.
+ *
+ * The current values of the graph become the initial state of new
+ * instances. Edges without source node into hidden nodes keep their
+ * current values. The graph is only read, its compiled plan stays valid.
+ * Like an evaluation, this may sort the graph, so the graph must not be
+ * used by another thread at the same time.
+ *
+ * \param *graph The graph to take the structure from.
+ * \param **definition Receives the new definition.
+ * \return \link bg_SUCCESS \endlink or error state.
+ * \returns \link bg_ERR_WRONG_TYPE \endlink if the graph contains extern
+ *          nodes.
+ */
+bg_error bg_definition_create(bg_graph_t *graph,
+                              bg_definition_t **definition);
+
+/**
+ * \brief Frees a definition. Its instances have to be freed before.
+ */
+bg_error bg_definition_free(bg_definition_t *definition);
+
+/**
+ * \brief Creates an instance in the initial state of a definition.
+ *
+ * \param *definition The definition to evaluate.
+ * \param **instance Receives the new instance.
+ * \return \link bg_SUCCESS \endlink or error state.
+ */
+bg_error bg_instance_create(const bg_definition_t *definition,
+                            bg_instance_t **instance);
+bg_error bg_instance_free(bg_instance_t *instance);
+
+/**
+ * \brief Sets an instance back to the initial state of its definition.
+ */
+bg_error bg_instance_reset(bg_instance_t *instance);
+
+/**
+ * \brief Sets the inputs of an instance.
+ *
+ * Like in bg_graph_evaluate_batch() the values replace the merged values
+ * of the input ports.
+ *
+ * \param *instance The instance.
+ * \param *values One value per graph input.
+ * \return \link bg_SUCCESS \endlink or error state.
+ */
+bg_error bg_instance_set_inputs(bg_instance_t *instance,
+                                const bg_real *values);
+bg_error bg_instance_set_input(bg_instance_t *instance,
+                               size_t input_port_idx, bg_real value);
+
+/**
+ * \brief Evaluates an instance and calculates its new state.
+ */
+bg_error bg_instance_evaluate(bg_instance_t *instance);
+
+/**
+ * \brief Reads the outputs of an instance.
+ *
+ * \param *instance The instance.
+ * \param *values Receives one value per graph output.
+ * \return \link bg_SUCCESS \endlink or error state.
+ */
+bg_error bg_instance_get_outputs(const bg_instance_t *instance,
+                                 bg_real *values);
+bg_error bg_instance_get_output(const bg_instance_t *instance,
+                                size_t output_port_idx, bg_real *value);
+/**
+ * @}
+ */
+
+
+/***********************************//**
+ * \defgroup pool_api Pool API
+ * @{
+ * A pool evaluates many independent graphs, e.g. a population, on a fixed
+ * set of threads. Every thread starts with an equal share of the graphs
+ * and takes over half of the graphs left to another thread when it runs
+ * out of work, so graphs of uneven cost keep all threads busy. The threads
+ * are kept for later calls. bg_pool_alloc() returns
+ * \link bg_ERR_NOT_IMPLEMENTED \endlink if the library was compiled
+ * without THREAD_SUPPORT.
+ ***************************************/
+
+/**
+ * \brief Creates a pool of worker threads.
+ *
+ * \param **pool Receives the new pool.
+ * \param thread_cnt The number of threads including the calling one.
+ * \return \link bg_SUCCESS \endlink or error state.
+ */
+bg_error bg_pool_alloc(bg_pool_t **pool, size_t thread_cnt);
+bg_error bg_pool_free(bg_pool_t *pool);
+
+/**
+ * \brief Evaluates each graph once on the threads of the pool.
+ *
+ * Returns when all graphs are evaluated. The graphs must be distinct and
+ * must not be used otherwise until then. Every evaluation starts from a
+ * clear error state, the error states of the threads are the same before
+ * and after.
+ *
+ * A pool runs one call at a time. Calls from several threads on the same
+ * pool must be serialized by the caller, e.g. with a mutex, or use a pool
+ * per thread. Different pools can evaluate at the same time.
+ *
+ * \param *pool The pool.
+ * \param **graphs The graphs to evaluate.
+ * \param graph_cnt The number of graphs.
+ * \param *errors Receives the result of each evaluation, may be NULL.
+ * \return The error of the first graph whose evaluation failed, which is
+ *         also set in the error state of the calling thread, or
+ *         \link bg_SUCCESS \endlink.
+ */
+bg_error bg_pool_evaluate(bg_pool_t *pool, bg_graph_t **graphs,
+                          size_t graph_cnt, bg_error *errors);
+/**
+ * @}
+ */
+
+
 /**********************************//**
  * \defgroup interval_api Interval API
  * @{
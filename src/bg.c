@@ -14,8 +14,13 @@
 # include <stdint.h>
 #endif
 
+#ifdef THREAD_SUPPORT
+#  include <pthread.h>
+#endif
+
 node_type_t *node_types[bg_NUM_OF_NODE_TYPES];
 merge_type_t *merge_types[bg_NUM_OF_MERGE_TYPES];
+merge_intv_scratch_t merge_intv_scratch[bg_NUM_OF_MERGE_TYPES];
 
 node_type_t **extern_node_types;
 int num_extern_node_types;
@@ -52,8 +57,43 @@ extern void bg_register_basic_merges(void);
 
 
 static int is_initialized = 0;
+
+#ifdef THREAD_SUPPORT
+/* Every thread has its own error state. The slot holds the error plus one so
+ * that an empty slot can be told apart from bg_SUCCESS. */
+static pthread_key_t bg_err_key;
+static pthread_once_t bg_err_once = PTHREAD_ONCE_INIT;
+
+static void bg_err_create_key(void) {
+  pthread_key_create(&bg_err_key, NULL);
+}
+
+static bg_error bg_err_load(void) {
+  void *slot;
+  pthread_once(&bg_err_once, bg_err_create_key);
+  slot = pthread_getspecific(bg_err_key);
+  if(!slot) {
+    return is_initialized ? bg_SUCCESS : bg_ERR_NOT_INITIALIZED;
+  }
+  return (bg_error)((size_t)slot - 1);
+}
+
+static void bg_err_store(bg_error err) {
+  pthread_once(&bg_err_once, bg_err_create_key);
+  pthread_setspecific(bg_err_key, (void*)((size_t)err + 1));
+}
+#else
 static bg_error bg_err = bg_ERR_NOT_INITIALIZED;
 
+static bg_error bg_err_load(void) {
+  return bg_err;
+}
+
+static void bg_err_store(bg_error err) {
+  bg_err = err;
+}
+#endif
+
 
 bool bg_is_initialized(void) {
   return is_initialized;
@@ -80,22 +120,22 @@ void bg_terminate(void) {
 }
 
 bool bg_error_occurred(void) {
-  return bg_err != bg_SUCCESS;
+  return bg_err_load() != bg_SUCCESS;
 }
 
 void bg_error_clear(void) {
-  bg_err = bg_SUCCESS;
+  bg_err_store(bg_SUCCESS);
 }
 
 bg_error bg_error_set(bg_error err) {
-  if((err != bg_SUCCESS) && (bg_err == bg_SUCCESS)) {
-    bg_err = err;
+  if((err != bg_SUCCESS) && (bg_err_load() == bg_SUCCESS)) {
+    bg_err_store(err);
   }
   return err;
 }
 
 bg_error bg_error_get(void) {
-  return bg_err;
+  return bg_err_load();
 }
 
 void bg_error_message_get( bg_error err, char error_message[bg_MAX_STRING_LENGTH] ) {
@@ -143,10 +183,16 @@ void bg_merge_type_register(merge_type_t *types) {
   while(type->merge) {
     /*printf("register merge type \"%s\" with ID: %d\n", type->name, type->id);*/
     merge_types[type->id] = type;
+    merge_intv_scratch[type->id] = NULL;
     ++type;
   }
 }
 
+void bg_merge_type_register_intv_scratch(bg_merge_type id,
+                                         merge_intv_scratch_t merge) {
+  merge_intv_scratch[id] = merge;
+}
+
 int bg_min(int a, int b) {
   return (a <= b ? a : b);
 }
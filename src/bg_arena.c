@@ -0,0 +1,173 @@
+#include "bg_arena.h"
+
+#include <string.h>
+
+#ifdef ARENA_SUPPORT
+
+/* allocations are rounded up to multiples of ARENA_ALIGN bytes; larger ones
+ * than ARENA_MAX_SMALL get their own malloc() */
+#define ARENA_ALIGN 16
+#define ARENA_CLASS_CNT 32
+#define ARENA_MAX_SMALL (ARENA_ALIGN * ARENA_CLASS_CNT)
+#define ARENA_BLOCK_SIZE 16384
+
+typedef union arena_header_t {
+  struct {
+    union arena_header_t *prev;
+    union arena_header_t *next;
+  } link;
+  /* keep the payload aligned */
+  char align[ARENA_ALIGN];
+} arena_header_t;
+
+typedef struct arena_free_t {
+  struct arena_free_t *next;
+} arena_free_t;
+
+struct bg_arena_t {
+  /* blocks and large allocations, each preceded by a header */
+  arena_header_t *blocks;
+  arena_header_t *large;
+  char *top;
+  char *end;
+  arena_free_t *free_lists[ARENA_CLASS_CNT];
+};
+
+void bg_arena_init(bg_arena_t **arena) {
+  *arena = (bg_arena_t*)calloc(1, sizeof(bg_arena_t));
+}
+
+void bg_arena_deinit(bg_arena_t *arena) {
+  arena_header_t *header, *next;
+  if(!arena) {
+    return;
+  }
+  for(header = arena->blocks; header; header = next) {
+    next = header->link.next;
+    free(header);
+  }
+  for(header = arena->large; header; header = next) {
+    next = header->link.next;
+    free(header);
+  }
+  free(arena);
+}
+
+void* bg_arena_alloc(bg_arena_t *arena, size_t size) {
+  size_t cls;
+  void *ptr;
+  arena_header_t *header;
+  if(!arena) {
+    return calloc(1, size ? size : 1);
+  }
+  if(size == 0) {
+    size = 1;
+  }
+  if(size > ARENA_MAX_SMALL) {
+    header = (arena_header_t*)calloc(1, sizeof(arena_header_t) + size);
+    if(!header) {
+      return NULL;
+    }
+    header->link.prev = NULL;
+    header->link.next = arena->large;
+    if(arena->large) {
+      arena->large->link.prev = header;
+    }
+    arena->large = header;
+    return header + 1;
+  }
+  cls = (size - 1) / ARENA_ALIGN;
+  size = (cls + 1) * ARENA_ALIGN;
+  if(arena->free_lists[cls]) {
+    ptr = arena->free_lists[cls];
+    arena->free_lists[cls] = arena->free_lists[cls]->next;
+    memset(ptr, 0, size);
+    return ptr;
+  }
+  if((size_t)(arena->end - arena->top) < size) {
+    header = (arena_header_t*)malloc(sizeof(arena_header_t) +
+                                     ARENA_BLOCK_SIZE);
+    if(!header) {
+      return NULL;
+    }
+    header->link.next = arena->blocks;
+    arena->blocks = header;
+    arena->top = (char*)(header + 1);
+    arena->end = arena->top + ARENA_BLOCK_SIZE;
+  }
+  ptr = arena->top;
+  arena->top += size;
+  memset(ptr, 0, size);
+  return ptr;
+}
+
+void bg_arena_free(bg_arena_t *arena, void *ptr, size_t size) {
+  size_t cls;
+  arena_header_t *header;
+  arena_free_t *item;
+  if(!arena) {
+    free(ptr);
+    return;
+  }
+  if(!ptr) {
+    return;
+  }
+  if(size == 0) {
+    size = 1;
+  }
+  if(size > ARENA_MAX_SMALL) {
+    header = (arena_header_t*)ptr - 1;
+    if(header->link.prev) {
+      header->link.prev->link.next = header->link.next;
+    } else {
+      arena->large = header->link.next;
+    }
+    if(header->link.next) {
+      header->link.next->link.prev = header->link.prev;
+    }
+    free(header);
+    return;
+  }
+  cls = (size - 1) / ARENA_ALIGN;
+  item = (arena_free_t*)ptr;
+  item->next = arena->free_lists[cls];
+  arena->free_lists[cls] = item;
+}
+
+#else /* ARENA_SUPPORT */
+
+void bg_arena_init(bg_arena_t **arena) {
+  *arena = NULL;
+}
+
+void bg_arena_deinit(bg_arena_t *arena) {
+  (void)arena;
+}
+
+void* bg_arena_alloc(bg_arena_t *arena, size_t size) {
+  return calloc(1, size ? size : 1);
+  (void)arena;
+}
+
+void bg_arena_free(bg_arena_t *arena, void *ptr, size_t size) {
+  free(ptr);
+  (void)arena;
+  (void)size;
+}
+
+#endif /* ARENA_SUPPORT */
+
+char* bg_arena_strdup(bg_arena_t *arena, const char *str) {
+  size_t len = strlen(str) + 1;
+  char *copy = (char*)bg_arena_alloc(arena, len);
+  if(copy) {
+    memcpy(copy, str, len);
+  }
+  return copy;
+}
+
+void bg_arena_free_str(bg_arena_t *arena, const char *str) {
+  if(str) {
+    bg_arena_free(arena, (void*)str, strlen(str) + 1);
+  }
+}
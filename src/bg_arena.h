@@ -0,0 +1,30 @@
+#ifndef C_BAGEL_ARENA_H
+#define C_BAGEL_ARENA_H
+
+#include <stdlib.h>
+
+/**
+ * @file
+ * @brief Memory owned by one graph.
+ *
+ * Nodes, ports, edges and names of a graph are carved out of large blocks.
+ * Freed objects go to a free list per size class and are reused by later
+ * allocations of the same size. bg_arena_deinit() returns all blocks at
+ * once. Without ARENA_SUPPORT every call maps to calloc() and free(), which
+ * keeps tools like valgrind useful.
+ *
+ * A \c NULL arena is valid and also maps to calloc() and free().
+ */
+
+typedef struct bg_arena_t bg_arena_t;
+
+void bg_arena_init(bg_arena_t **arena);
+void bg_arena_deinit(bg_arena_t *arena);
+/* returns zeroed memory or NULL */
+void* bg_arena_alloc(bg_arena_t *arena, size_t size);
+/* size has to be the size the memory was allocated with */
+void bg_arena_free(bg_arena_t *arena, void *ptr, size_t size);
+char* bg_arena_strdup(bg_arena_t *arena, const char *str);
+void bg_arena_free_str(bg_arena_t *arena, const char *str);
+
+#endif /* C_BAGEL_ARENA_H */
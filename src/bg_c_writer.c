@@ -0,0 +1,591 @@
+#include "bg_impl.h"
+#include "bg_plan.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+/**
+ * @file
+ * @brief Ahead-of-time translation of a graph into C source code.
+ *
+ * The graph is compiled into a plan with inlined sub-graphs, and every
+ * instruction of the plan becomes straight-line code with the weights,
+ * biases and defaults as literals. Value slots become local variables.
+ * Slots that are read before they are written (feedback edges and edges
+ * without source node) carry over from one evaluation to the next in a
+ * state array owned by the caller. Instructions whose results are never
+ * used are left out.
+ */
+
+typedef struct cw_t {
+  FILE *fp;
+  const char *prefix;
+  const bg_plan_t *plan;
+  const char *real;
+  const char *suffix;
+  /* index into the state array per value slot (bg_PLAN_NONE if local) */
+  size_t *state_idx;
+  size_t state_cnt;
+  /* value slots and instructions that contribute to an output */
+  unsigned char *needed;
+  unsigned char *emitted;
+  /* the value slots of the graph inputs, set from the inputs array */
+  unsigned char *is_input;
+  bool uses_median;
+} cw_t;
+
+static void cw_literal(cw_t *cw, bg_real x) {
+  char buf[64];
+  size_t i;
+  bool is_integer = true;
+  if(x != x) {
+    fprintf(cw->fp, "(HUGE_VAL - HUGE_VAL)");
+    return;
+  } else if(x > 0 && x * 0.5 == x) {
+    fprintf(cw->fp, "HUGE_VAL");
+    return;
+  } else if(x < 0 && x * 0.5 == x) {
+    fprintf(cw->fp, "(-HUGE_VAL)");
+    return;
+  }
+  /* enough digits to read back the same value */
+  sprintf(buf, (sizeof(bg_real) == sizeof(float)) ? "%.9g" : "%.17g",
+          (double)x);
+  for(i = 0; buf[i]; ++i) {
+    if(buf[i] != '-' && (buf[i] < '0' || buf[i] > '9')) {
+      is_integer = false;
+    }
+  }
+  fprintf(cw->fp, "%s%s%s", buf, is_integer ? ".0" : "", cw->suffix);
+}
+
+/* operand i of a merge: the value of its source times its weight */
+static void cw_operand(cw_t *cw, const plan_operand_t *operand) {
+  fprintf(cw->fp, "v%lu * ", (unsigned long)operand->src);
+  cw_literal(cw, operand->weight);
+}
+
+static void cw_merge(cw_t *cw, const plan_op_t *op) {
+  size_t i;
+  unsigned long dst = (unsigned long)op->dst;
+  const plan_operand_t *operands = cw->plan->operands + op->src;
+  bg_real sum_weights = 0.0;
+  FILE *fp = cw->fp;
+
+  switch(op->type) {
+  case bg_MERGE_TYPE_SUM:
+  case bg_MERGE_TYPE_PRODUCT:
+    fprintf(fp, "  v%lu = ", dst);
+    cw_literal(cw, op->bias);
+    fprintf(fp, ";\n");
+    if(op->cnt == 0) {
+      fprintf(fp, "  v%lu %s= ", dst,
+              op->type == bg_MERGE_TYPE_SUM ? "+" : "*");
+      cw_literal(cw, op->default_value);
+      fprintf(fp, ";\n");
+    }
+    for(i = 0; i < op->cnt; ++i) {
+      fprintf(fp, "  v%lu %s= ", dst,
+              op->type == bg_MERGE_TYPE_SUM ? "+" : "*");
+      cw_operand(cw, operands + i);
+      fprintf(fp, ";\n");
+    }
+    break;
+  case bg_MERGE_TYPE_WEIGHTED_SUM:
+  case bg_MERGE_TYPE_MEAN:
+    fprintf(fp, "  v%lu = 0.0;\n", dst);
+    if(op->cnt == 0) {
+      fprintf(fp, "  v%lu += ", dst);
+      cw_literal(cw, op->default_value);
+      fprintf(fp, ";\n");
+      sum_weights = 1.0;
+    }
+    for(i = 0; i < op->cnt; ++i) {
+      fprintf(fp, "  v%lu += ", dst);
+      cw_operand(cw, operands + i);
+      fprintf(fp, ";\n");
+      sum_weights += fabs(operands[i].weight);
+    }
+    if(op->type == bg_MERGE_TYPE_MEAN) {
+      sum_weights = (bg_real)(op->cnt ? op->cnt : 1);
+    } else if(!(sum_weights > bg_EPSILON)) {
+      fprintf(fp, "  v%lu = ", dst);
+      cw_literal(cw, op->bias);
+      fprintf(fp, ";\n");
+      break;
+    }
+    fprintf(fp, "  v%lu = (v%lu / ", dst, dst);
+    cw_literal(cw, sum_weights);
+    fprintf(fp, ") + ");
+    cw_literal(cw, op->bias);
+    fprintf(fp, ";\n");
+    break;
+  case bg_MERGE_TYPE_MIN:
+  case bg_MERGE_TYPE_MAX:
+    fprintf(fp, "  v%lu = ", dst);
+    cw_literal(cw, op->bias);
+    fprintf(fp, ";\n");
+    if(op->cnt == 0) {
+      fprintf(fp, "  if(");
+      cw_literal(cw, op->default_value);
+      fprintf(fp, " %s v%lu) v%lu = ",
+              op->type == bg_MERGE_TYPE_MIN ? "<" : ">", dst, dst);
+      cw_literal(cw, op->default_value);
+      fprintf(fp, ";\n");
+    }
+    for(i = 0; i < op->cnt; ++i) {
+      fprintf(fp, "  t = ");
+      cw_operand(cw, operands + i);
+      fprintf(fp, ";\n  if(t %s v%lu) v%lu = t;\n",
+              op->type == bg_MERGE_TYPE_MIN ? "<" : ">", dst, dst);
+    }
+    break;
+  case bg_MERGE_TYPE_MEDIAN:
+    cw->uses_median = true;
+    fprintf(fp, "  {\n    %s m[%lu];\n", cw->real,
+            (unsigned long)(op->cnt ? op->cnt : 1));
+    if(op->cnt == 0) {
+      fprintf(fp, "    m[0] = ");
+      cw_literal(cw, op->default_value);
+      fprintf(fp, ";\n");
+    }
+    for(i = 0; i < op->cnt; ++i) {
+      fprintf(fp, "    m[%lu] = ", (unsigned long)i);
+      cw_operand(cw, operands + i);
+      fprintf(fp, ";\n");
+    }
+    fprintf(fp, "    v%lu = %s_median(m, %lu) + ", dst, cw->prefix,
+            (unsigned long)(op->cnt ? op->cnt : 1));
+    cw_literal(cw, op->bias);
+    fprintf(fp, ";\n  }\n");
+    break;
+  case bg_MERGE_TYPE_NORM:
+    fprintf(fp, "  v%lu = ", dst);
+    cw_literal(cw, op->bias * op->bias);
+    fprintf(fp, ";\n");
+    if(op->cnt == 0) {
+      fprintf(fp, "  t = ");
+      cw_literal(cw, op->default_value);
+      fprintf(fp, ";\n  v%lu += t * t;\n", dst);
+    }
+    for(i = 0; i < op->cnt; ++i) {
+      fprintf(fp, "  t = ");
+      cw_operand(cw, operands + i);
+      fprintf(fp, ";\n  v%lu += t * t;\n", dst);
+    }
+    fprintf(fp, "  v%lu = sqrt(v%lu);\n", dst, dst);
+    break;
+  default:
+    fprintf(fp, "  v%lu = 0.0;\n", dst);
+    break;
+  }
+}
+
+static void cw_eval(cw_t *cw, const plan_op_t *op) {
+  unsigned long in = (unsigned long)op->src;
+  FILE *fp = cw->fp;
+  fprintf(fp, "  v%lu = ", (unsigned long)op->dst);
+  switch(op->type) {
+  case bg_NODE_TYPE_PIPE:
+    fprintf(fp, "v%lu", in);
+    break;
+  case bg_NODE_TYPE_DIVIDE:
+    fprintf(fp, "1. / v%lu", in);
+    break;
+  case bg_NODE_TYPE_SIN:
+    fprintf(fp, "sin(v%lu)", in);
+    break;
+  case bg_NODE_TYPE_ASIN:
+    fprintf(fp, "asin(v%lu)", in);
+    break;
+  case bg_NODE_TYPE_COS:
+    fprintf(fp, "cos(v%lu)", in);
+    break;
+  case bg_NODE_TYPE_TAN:
+    fprintf(fp, "tan(v%lu)", in);
+    break;
+  case bg_NODE_TYPE_ACOS:
+    fprintf(fp, "acos(v%lu)", in);
+    break;
+  case bg_NODE_TYPE_ATAN2:
+    fprintf(fp, "atan2(v%lu, v%lu)", in, in + 1);
+    break;
+  case bg_NODE_TYPE_POW:
+    fprintf(fp, "pow(v%lu, v%lu)", in, in + 1);
+    break;
+  case bg_NODE_TYPE_MOD:
+    fprintf(fp, "fmod(v%lu, v%lu)", in, in + 1);
+    break;
+  case bg_NODE_TYPE_ABS:
+    fprintf(fp, "fabs(v%lu)", in);
+    break;
+  case bg_NODE_TYPE_SQRT:
+    fprintf(fp, "sqrt(v%lu)", in);
+    break;
+  case bg_NODE_TYPE_FSIGMOID:
+    fprintf(fp, "(1./(1+(exp(-(");
+    cw_literal(cw, (bg_real)4.924273);
+    fprintf(fp, "*v%lu)))))", in);
+    break;
+  case bg_NODE_TYPE_GREATER_THAN_0:
+    fprintf(fp, "(v%lu > 0.0 ? v%lu : v%lu)", in, in + 1, in + 2);
+    break;
+  case bg_NODE_TYPE_EQUAL_TO_0:
+    fprintf(fp, "(fabs(v%lu) < ", in);
+    cw_literal(cw, bg_EPSILON);
+    fprintf(fp, " ? v%lu : v%lu)", in + 1, in + 2);
+    break;
+  case bg_NODE_TYPE_TANH:
+    fprintf(fp, "tanh(v%lu)", in);
+    break;
+  default:
+    fprintf(fp, "0.0");
+    break;
+  }
+  fprintf(fp, ";\n");
+}
+
+static size_t cw_read_cnt(const plan_op_t *op) {
+  if(op->kind == bg_PLAN_OP_MERGE) {
+    return op->cnt;
+  }
+  return node_types[op->type]->input_port_cnt;
+}
+
+/* the i-th value slot read by an instruction */
+static size_t cw_read_slot(const cw_t *cw, const plan_op_t *op, size_t i) {
+  if(op->kind == bg_PLAN_OP_MERGE) {
+    return cw->plan->operands[op->src + i].src;
+  }
+  return op->src + i;
+}
+
+/* Whether the instruction is replaced by reading the inputs array. */
+static bool cw_is_input_op(const cw_t *cw, size_t op_idx) {
+  return (op_idx < cw->plan->input_op_cnt &&
+          cw->is_input[cw->plan->ops[op_idx].dst]);
+}
+
+/* Decides which instructions are emitted and which slots are state. */
+static bg_error cw_analyze(cw_t *cw) {
+  size_t i, j, slot;
+  bool changed = true;
+  const bg_plan_t *plan = cw->plan;
+  const plan_op_t *op;
+  size_t *writer;
+
+  writer = (size_t*)malloc(sizeof(size_t) * (plan->value_cnt + 1));
+  cw->needed = (unsigned char*)calloc(plan->value_cnt + 1, 1);
+  cw->is_input = (unsigned char*)calloc(plan->value_cnt + 1, 1);
+  cw->emitted = (unsigned char*)calloc(plan->op_cnt + 1, 1);
+  cw->state_idx = (size_t*)calloc(plan->value_cnt + 1, sizeof(size_t));
+  if(!writer || !cw->needed || !cw->is_input || !cw->emitted ||
+     !cw->state_idx) {
+    free(writer);
+    return bg_error_set(bg_ERR_NO_MEMORY);
+  }
+  for(i = 0; i < plan->input_cnt; ++i) {
+    if(plan->input_slots[i] != bg_PLAN_NONE) {
+      cw->is_input[plan->input_slots[i]] = 1;
+    }
+  }
+  for(slot = 0; slot < plan->value_cnt; ++slot) {
+    writer[slot] = bg_PLAN_NONE;
+    cw->state_idx[slot] = bg_PLAN_NONE;
+  }
+  for(i = 0; i < plan->op_cnt; ++i) {
+    if(plan->ops[i].kind == bg_PLAN_OP_CALL) {
+      /* extern nodes have no source code to emit */
+      free(writer);
+      return bg_error_set(bg_ERR_WRONG_TYPE);
+    }
+    if(!cw_is_input_op(cw, i)) {
+      writer[plan->ops[i].dst] = i;
+    }
+  }
+  for(i = 0; i < plan->output_cnt; ++i) {
+    if(plan->output_slots[i] != bg_PLAN_NONE) {
+      cw->needed[plan->output_slots[i]] = 1;
+    }
+  }
+  /* A value read from a later instruction is the one of the previous
+   * evaluation, so the later instruction is needed as well. */
+  while(changed) {
+    changed = false;
+    for(i = plan->op_cnt; i > 0; --i) {
+      op = plan->ops + i - 1;
+      if(cw->emitted[i - 1] || !cw->needed[op->dst] ||
+         cw_is_input_op(cw, i - 1)) {
+        continue;
+      }
+      cw->emitted[i - 1] = 1;
+      for(j = 0; j < cw_read_cnt(op); ++j) {
+        slot = cw_read_slot(cw, op, j);
+        cw->needed[slot] = 1;
+        if(!cw->is_input[slot] &&
+           (writer[slot] == bg_PLAN_NONE || writer[slot] >= i - 1)) {
+          if(cw->state_idx[slot] == bg_PLAN_NONE) {
+            cw->state_idx[slot] = 0;
+          }
+          if(writer[slot] != bg_PLAN_NONE && !cw->emitted[writer[slot]]) {
+            changed = true;
+          }
+        }
+      }
+    }
+  }
+  cw->state_cnt = 0;
+  for(slot = 0; slot < plan->value_cnt; ++slot) {
+    if(cw->state_idx[slot] != bg_PLAN_NONE) {
+      cw->state_idx[slot] = cw->state_cnt++;
+    }
+  }
+  free(writer);
+  return bg_SUCCESS;
+}
+
+/* the compare-exchange steps of the selection networks in bg_merge_median(),
+ * indexed by fan-in */
+static const char *const cw_median_networks[10] = {
+  NULL, "", "0 1",
+  "0 1 1 2 0 1",
+  "0 1 2 3 0 2 1 3 1 2",
+  "0 1 3 4 0 3 1 4 1 2 2 3 1 2",
+  NULL,
+  "0 5 0 3 1 6 2 4 0 1 3 5 2 6 2 3 3 6 4 5 1 4 1 3 3 4",
+  NULL,
+  "1 2 4 5 7 8 0 1 3 4 6 7 1 2 4 5 7 8 0 3 5 8 4 7 3 6 1 4 2 5 4 7 4 2 "
+  "6 4 4 2"
+};
+
+static void cw_write_median(cw_t *cw) {
+  const char *steps;
+  int n, i, j, offset;
+  fprintf(cw->fp,
+          "/* N. Wirth's selection, as used by the MEDIAN merge */\n"
+          "static %s %s_kth_smallest(%s *a, int n, int k) {\n"
+          "  int i, j, l, m;\n"
+          "  %s x, tmp;\n"
+          "  l = 0;\n"
+          "  m = n - 1;\n"
+          "  while(l<m) {\n"
+          "    x = a[k];\n"
+          "    i = l;\n"
+          "    j = m;\n"
+          "    do {\n"
+          "      while(a[i] < x) ++i;\n"
+          "      while(x < a[j]) --j;\n"
+          "      if(i <= j) {\n"
+          "        tmp = a[i];\n"
+          "        a[i] = a[j];\n"
+          "        a[j] = tmp;\n"
+          "        ++i;\n"
+          "        --j;\n"
+          "      }\n"
+          "    } while(i <= j);\n"
+          "    if(j < k) l = i;\n"
+          "    if(k < i) m = j;\n"
+          "  }\n"
+          "  return a[k];\n"
+          "}\n\n",
+          cw->real, cw->prefix, cw->real, cw->real);
+  fprintf(cw->fp,
+          "static void %s_sort2(%s *a, int i, int j) {\n"
+          "  %s tmp;\n"
+          "  if(a[i] > a[j]) {\n"
+          "    tmp = a[i];\n"
+          "    a[i] = a[j];\n"
+          "    a[j] = tmp;\n"
+          "  }\n"
+          "}\n\n",
+          cw->prefix, cw->real, cw->real);
+  fprintf(cw->fp,
+          "/* the selection networks of the MEDIAN merge, which leaves NaNs\n"
+          " * and zeros to %s_kth_smallest */\n"
+          "static %s %s_median(%s *a, int n) {\n"
+          "  %s value;\n"
+          "  int i, ordered = 1;\n"
+          "  for(i = 0; i < n; ++i) {\n"
+          "    if(a[i] != a[i] || a[i] == 0.) ordered = 0;\n"
+          "  }\n"
+          "  switch(ordered ? n : 0) {\n",
+          cw->prefix, cw->real, cw->prefix, cw->real, cw->real);
+  for(n = 1; n < 10; ++n) {
+    steps = cw_median_networks[n];
+    if(!steps) {
+      continue;
+    }
+    fprintf(cw->fp, "  case %d:\n", n);
+    while(sscanf(steps, "%d %d%n", &i, &j, &offset) == 2) {
+      fprintf(cw->fp, "    %s_sort2(a, %d, %d);\n", cw->prefix, i, j);
+      steps += offset;
+    }
+    if(n & 1) {
+      fprintf(cw->fp, "    return a[%d];\n", n / 2);
+    } else {
+      fprintf(cw->fp, "    return (a[%d] + a[%d]) / 2.;\n", n / 2, n / 2 - 1);
+    }
+  }
+  fprintf(cw->fp,
+          "  default:\n"
+          "    value = %s_kth_smallest(a, n, n / 2);\n"
+          "    if(!(n & 1)) {\n"
+          "      value += %s_kth_smallest(a, n, (n / 2) - 1);\n"
+          "      value /= 2.;\n"
+          "    }\n"
+          "    return value;\n"
+          "  }\n"
+          "}\n\n",
+          cw->prefix, cw->prefix);
+}
+
+static void cw_write(cw_t *cw, const bg_graph_t *graph) {
+  size_t i, slot;
+  bool uses_temp = false;
+  const bg_plan_t *plan = cw->plan;
+  const plan_op_t *op;
+  FILE *fp = cw->fp;
+  bg_real value;
+
+  for(i = 0; i < plan->op_cnt; ++i) {
+    op = plan->ops + i;
+    if(cw->emitted[i] && op->kind == bg_PLAN_OP_MERGE) {
+      uses_temp |= (op->type == bg_MERGE_TYPE_MIN ||
+                    op->type == bg_MERGE_TYPE_MAX ||
+                    op->type == bg_MERGE_TYPE_NORM);
+      cw->uses_median |= (op->type == bg_MERGE_TYPE_MEDIAN);
+    }
+  }
+
+  fprintf(fp, "/* Generated by bg_graph_to_c() from the graph \"%s\". */\n\n"
+          "#include <math.h>\n#include <stddef.h>\n\n",
+          graph->name ? graph->name : "");
+  fprintf(fp, "size_t %s_state_size(void);\n", cw->prefix);
+  fprintf(fp, "void %s_init(%s *state);\n", cw->prefix, cw->real);
+  fprintf(fp, "void %s_evaluate(%s *state, const %s *inputs, "
+          "%s *outputs);\n\n", cw->prefix, cw->real, cw->real, cw->real);
+  if(cw->uses_median) {
+    cw_write_median(cw);
+  }
+
+  fprintf(fp, "size_t %s_state_size(void) {\n  return %lu;\n}\n\n",
+          cw->prefix, (unsigned long)cw->state_cnt);
+
+  /* the state starts with the current values of the graph */
+  fprintf(fp, "void %s_init(%s *state) {\n", cw->prefix, cw->real);
+  if(cw->state_cnt == 0) {
+    fprintf(fp, "  (void)state;\n");
+  }
+  for(slot = 0; slot < plan->value_cnt; ++slot) {
+    if(cw->state_idx[slot] == bg_PLAN_NONE) {
+      continue;
+    }
+    value = plan->values[slot];
+    /* edges without source node keep the value set from outside */
+    for(i = 0; i < plan->extern_cnt; ++i) {
+      if(plan->operands[plan->extern_operands[i]].src == slot) {
+        value = bg_EDGE_VALUE(plan->extern_edges[i]);
+        break;
+      }
+    }
+    fprintf(fp, "  state[%lu] = ", (unsigned long)cw->state_idx[slot]);
+    cw_literal(cw, value);
+    fprintf(fp, ";\n");
+  }
+  fprintf(fp, "}\n\n");
+
+  fprintf(fp, "void %s_evaluate(%s *state, const %s *inputs, "
+          "%s *outputs) {\n", cw->prefix, cw->real, cw->real, cw->real);
+  for(slot = 0; slot < plan->value_cnt; ++slot) {
+    if(cw->needed[slot]) {
+      fprintf(fp, "  %s v%lu;\n", cw->real, (unsigned long)slot);
+    }
+  }
+  if(uses_temp) {
+    fprintf(fp, "  %s t;\n", cw->real);
+  }
+  if(cw->state_cnt == 0) {
+    fprintf(fp, "  (void)state;\n");
+  }
+  if(plan->input_cnt == 0) {
+    fprintf(fp, "  (void)inputs;\n");
+  }
+  for(slot = 0; slot < plan->value_cnt; ++slot) {
+    if(cw->state_idx[slot] != bg_PLAN_NONE) {
+      fprintf(fp, "  v%lu = state[%lu];\n", (unsigned long)slot,
+              (unsigned long)cw->state_idx[slot]);
+    }
+  }
+  for(i = 0; i < plan->input_cnt; ++i) {
+    slot = plan->input_slots[i];
+    if(slot != bg_PLAN_NONE && cw->needed[slot]) {
+      fprintf(fp, "  v%lu = inputs[%lu];\n", (unsigned long)slot,
+              (unsigned long)i);
+    }
+  }
+  for(i = 0; i < plan->op_cnt; ++i) {
+    if(!cw->emitted[i]) {
+      continue;
+    }
+    op = plan->ops + i;
+    if(op->kind == bg_PLAN_OP_MERGE) {
+      cw_merge(cw, op);
+    } else {
+      cw_eval(cw, op);
+    }
+  }
+  for(i = 0; i < plan->output_cnt; ++i) {
+    slot = plan->output_slots[i];
+    if(slot != bg_PLAN_NONE) {
+      fprintf(fp, "  outputs[%lu] = v%lu;\n", (unsigned long)i,
+              (unsigned long)slot);
+    } else {
+      fprintf(fp, "  outputs[%lu] = 0.0;\n", (unsigned long)i);
+    }
+  }
+  for(slot = 0; slot < plan->value_cnt; ++slot) {
+    if(cw->state_idx[slot] != bg_PLAN_NONE) {
+      fprintf(fp, "  state[%lu] = v%lu;\n",
+              (unsigned long)cw->state_idx[slot], (unsigned long)slot);
+    }
+  }
+  fprintf(fp, "}\n");
+}
+
+bg_error bg_graph_to_c(const char *filename, const char *prefix,
+                       bg_graph_t *g) {
+  bg_error err;
+  bg_plan_t *plan = NULL;
+  cw_t cw;
+
+  memset(&cw, 0, sizeof(cw));
+  cw.prefix = prefix;
+  cw.real = (sizeof(bg_real) == sizeof(float)) ? "float" : "double";
+  cw.suffix = (sizeof(bg_real) == sizeof(float)) ? "f" : "";
+  err = bg_plan_build_detached(g, &plan);
+  if(err != bg_SUCCESS) {
+    return err;
+  }
+  cw.plan = plan;
+  err = cw_analyze(&cw);
+  if(err == bg_SUCCESS) {
+    cw.fp = fopen(filename, "w");
+    if(!cw.fp) {
+      err = bg_error_set(bg_ERR_UNKNOWN);
+    }
+  }
+  if(err == bg_SUCCESS) {
+    cw_write(&cw, g);
+    if(fclose(cw.fp) != 0) {
+      err = bg_error_set(bg_ERR_UNKNOWN);
+    }
+  }
+  free(cw.state_idx);
+  free(cw.needed);
+  free(cw.emitted);
+  free(cw.is_input);
+  bg_plan_free(plan);
+  return err;
+}
@@ -1,13 +1,20 @@
 #include "bg_edge.h"
 #include "bg_graph.h"
+#include "bg_plan.h"
 
 bg_error bg_edge_set_weight(bg_graph_t *graph, bg_edge_id_t edge_id,
                             bg_real weight) {
   bg_edge_t *edge = NULL;
+  bg_graph_t *owner = graph->inlined_into ? graph->inlined_into : graph;
   bg_error err = bg_graph_find_edge((bg_graph_t*)graph, edge_id, &edge);
   if(err == bg_SUCCESS) {
     if(edge) {
-      edge->weight = weight;
+      bg_EDGE_WEIGHT(edge) = weight;
+      /* patch the compiled plan instead of rebuilding it */
+      if(owner->plan && !owner->plan_is_dirty &&
+         !owner->eval_order_is_dirty) {
+        bg_plan_set_weight(owner->plan, edge, weight);
+      }
     } else {
       err = bg_error_set(bg_ERR_EDGE_NOT_FOUND);
     }
@@ -21,7 +28,7 @@ bg_error bg_edge_set_value(bg_graph_t *graph, bg_edge_id_t edge_id,
   bg_error err = bg_graph_find_edge((bg_graph_t*)graph, edge_id, &edge);
   if(err == bg_SUCCESS) {
     if(edge) {
-      edge->value = value;
+      err = bg_edge_set_value_p(edge, value);
     } else {
       err = bg_error_set(bg_ERR_EDGE_NOT_FOUND);
     }
@@ -30,7 +37,21 @@ bg_error bg_edge_set_value(bg_graph_t *graph, bg_edge_id_t edge_id,
 }
 
 bg_error bg_edge_set_value_p(bg_edge_t *edge, bg_real value) {
-  edge->value = value;
+  bg_graph_t *owner;
+  bg_edge_detach(edge);
+  bg_EDGE_VALUE(edge) = value;
+  if(!edge->source_node) {
+    return bg_SUCCESS;
+  }
+  /* the plan reads the source; a plan that is built later finds the
+   * detached edge itself */
+  owner = edge->source_node->_parent_graph;
+  if(owner->inlined_into) {
+    owner = owner->inlined_into;
+  }
+  if(owner->plan && !owner->plan_is_dirty && !owner->eval_order_is_dirty) {
+    return bg_plan_set_value(owner->plan, edge, value);
+  }
   return bg_SUCCESS;
 }
 
@@ -55,7 +76,7 @@ bg_error bg_edge_get_weight(const bg_graph_t *graph, bg_edge_id_t edge_id,
   bg_error err = bg_graph_find_edge((bg_graph_t*)graph, edge_id, &edge);
   if(err == bg_SUCCESS) {
     if(edge) {
-      *weight = edge->weight;
+      *weight = bg_EDGE_WEIGHT(edge);
     } else {
       err = bg_error_set(bg_ERR_EDGE_NOT_FOUND);
     }
@@ -69,7 +90,13 @@ bg_error bg_edge_get_value(const bg_graph_t *graph, bg_edge_id_t edge_id,
   bg_error err = bg_graph_find_edge((bg_graph_t*)graph, edge_id, &edge);
   if(err == bg_SUCCESS) {
     if(edge) {
-      *value = edge->value;
+      /* a compiled graph does not copy output values to connected edges */
+      if((graph->plan || graph->inlined_into) && edge->source_node &&
+         !edge->detached) {
+        *value = bg_PORT_VALUE(edge->source_node->output_ports[edge->source_port_idx]);
+      } else {
+        *value = bg_EDGE_INPUT(edge);
+      }
     } else {
       err = bg_error_set(bg_ERR_EDGE_NOT_FOUND);
     }
@@ -114,17 +141,32 @@ bg_error bg_edge_get_nodes(const bg_graph_t *graph, bg_edge_id_t edge_id,
 
 
 
-bg_error bg_edge_init(bg_edge_t *edge,
+bg_error bg_edge_init(bg_edge_t *edge, bg_value_store_t *store,
                       bg_node_t *sourceNode, size_t sourcePortIdx,
                       bg_node_t *sinkNode, size_t sinkPortIdx,
                       bg_real weight) {
+  bg_error err;
+  edge->store = store;
+  err = bg_value_store_alloc_value(store, &edge->value_idx);
+  if(err != bg_SUCCESS) {
+    return err;
+  }
+  err = bg_value_store_alloc_weight(store, &edge->weight_idx);
+  if(err != bg_SUCCESS) {
+    bg_value_store_free_value(store, edge->value_idx);
+    return err;
+  }
   edge->source_node = sourceNode;
   edge->source_port_idx = sourcePortIdx;
   edge->sink_node = sinkNode;
   edge->sink_port_idx = sinkPortIdx;
-  edge->weight = weight;
-  edge->value = 0.;
+  bg_EDGE_WEIGHT(edge) = weight;
+  edge->read_store = store;
+  edge->read_idx = edge->value_idx;
+  edge->direct = false;
+  edge->detached = false;
   edge->ignore_for_sort = 0;
+  edge->plan_idx = bg_PLAN_NONE;
 #ifdef INTERVAL_SUPPORT
   mpfi_init_set_d(edge->value_intv, 0.);
 #endif
@@ -135,6 +177,36 @@ bg_error bg_edge_deinit(bg_edge_t *edge) {
 #ifdef INTERVAL_SUPPORT
   mpfi_clear(edge->value_intv);
 #endif
+  bg_value_store_free_value(edge->store, edge->value_idx);
+  bg_value_store_free_weight(edge->store, edge->weight_idx);
   return bg_SUCCESS;
-  (void)edge;
+}
+
+void bg_edge_set_direct(bg_edge_t *edge, bool direct) {
+  output_port_t *port;
+  edge->direct = direct;
+  if(direct && edge->source_node && !edge->detached) {
+    port = edge->source_node->output_ports[edge->source_port_idx];
+    edge->read_store = port->store;
+    edge->read_idx = port->value_idx;
+  } else {
+    edge->read_store = edge->store;
+    edge->read_idx = edge->value_idx;
+  }
+}
+
+void bg_edge_detach(bg_edge_t *edge) {
+  if(!edge->source_node || edge->detached) {
+    return;
+  }
+  /* the source attaches the edge again when it writes its next value */
+  edge->source_node->output_ports[edge->source_port_idx]->detached_cnt++;
+  edge->detached = true;
+  edge->read_store = edge->store;
+  edge->read_idx = edge->value_idx;
+}
+
+void bg_edge_attach(bg_edge_t *edge) {
+  edge->detached = false;
+  bg_edge_set_direct(edge, edge->direct);
 }
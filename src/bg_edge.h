@@ -3,11 +3,20 @@
 
 #include "bg_impl.h"
 
-bg_error bg_edge_init(bg_edge_t *edge,
+/* value and weight of the edge are allocated from store */
+bg_error bg_edge_init(bg_edge_t *edge, bg_value_store_t *store,
                       bg_node_t *sourceNode, size_t sourcePortIdx,
                       bg_node_t *sinkNode, size_t sinkPortIdx,
                       bg_real weight);
 
 bg_error bg_edge_deinit(bg_edge_t *edge);
 
+/* A direct edge with a source node reads the value of the source output port
+ * instead of its own copy; the source then does not write to the edge. */
+void bg_edge_set_direct(bg_edge_t *edge, bool direct);
+/* lets an edge read its own value until the source is evaluated */
+void bg_edge_detach(bg_edge_t *edge);
+/* undoes bg_edge_detach() once the source wrote a new value */
+void bg_edge_attach(bg_edge_t *edge);
+
 #endif /* C_BAGEL_EDGE_H */
@@ -3,6 +3,8 @@
 #include "bg_impl.h"
 #include "bg_node.h"
 #include "bg_edge.h"
+#include "bg_plan.h"
+#include "bg_thread_pool.h"
 #include "tsort/tsort.h"
 #include "node_types/bg_node_subgraph.h"
 
@@ -10,99 +12,591 @@
 #include <assert.h>
 #include <string.h>
 
-#include "node_list.h"
+#include "node_vector.h"
 #include "edge_list.h"
+#include "id_map.h"
+#include "name_map.h"
+#include "bg_arena.h"
+#include "string_table.h"
 
 char bg_graph_error_message[bg_MAX_STRING_LENGTH];
 
 bg_error bg_graph_find_node(bg_graph_t *graph, bg_node_id_t node_id,
                             bg_node_t **node) {
-  bg_node_list_t *node_list;
-  bg_node_list_iterator_t it;
-  bg_node_t *current_node;
-  node_list = graph->input_nodes;
-  for(current_node = bg_node_list_first(node_list, &it);
-      current_node; current_node = bg_node_list_next(&it)) {
-    if(current_node->id == node_id) {
-      *node = current_node;
-      return bg_SUCCESS;
-    }
+  *node = (bg_node_t*)bg_id_map_find(graph->node_map, node_id);
+  return bg_SUCCESS;
+}
+
+/* Nodes with the same name are looked up in the order inputs, hidden nodes,
+ * outputs and within these by age, like a scan of the node lists would. */
+static int graph_name_rank(const bg_node_t *node) {
+  switch(node->type->id) {
+  case bg_NODE_TYPE_INPUT:
+    return 0;
+  case bg_NODE_TYPE_OUTPUT:
+    return 2;
+  default:
+    return 1;
   }
-  node_list = graph->hidden_nodes;
-  for(current_node = bg_node_list_first(node_list, &it);
-      current_node; current_node = bg_node_list_next(&it)) {
-    if(current_node->id == node_id) {
-      *node = current_node;
-      return bg_SUCCESS;
+}
+
+static bg_error graph_index_node(bg_graph_t *graph, bg_node_t *node) {
+  bg_node_t *other;
+  if(!bg_id_map_insert(graph->node_map, node->id, node)) {
+    return bg_error_set(bg_ERR_NO_MEMORY);
+  }
+  /* stripped names cannot be looked up */
+  if(bg_string_table_get_strip(graph->names)) {
+    return bg_SUCCESS;
+  }
+  other = (bg_node_t*)bg_name_map_find(graph->name_map, node->name);
+  if(!other || graph_name_rank(node) < graph_name_rank(other)) {
+    if(!bg_name_map_insert(graph->name_map, node->name, node)) {
+      bg_id_map_erase(graph->node_map, node->id);
+      return bg_error_set(bg_ERR_NO_MEMORY);
     }
   }
-  node_list = graph->output_nodes;
-  for(current_node = bg_node_list_first(node_list, &it);
-      current_node; current_node = bg_node_list_next(&it)) {
-    if(current_node->id == node_id) {
-      *node = current_node;
-      return bg_SUCCESS;
+  return bg_SUCCESS;
+}
+
+static bg_error graph_unindex_node(bg_graph_t *graph, bg_node_t *node) {
+  size_t i;
+  bg_node_vector_t *node_lists[3];
+  bg_node_vector_iterator_t it;
+  bg_node_t *other;
+  bg_id_map_erase(graph->node_map, node->id);
+  if(bg_name_map_find(graph->name_map, node->name) != node) {
+    return bg_SUCCESS;
+  }
+  bg_name_map_erase(graph->name_map, node->name);
+  /* index the next node sharing the name, if any */
+  node_lists[0] = graph->input_nodes;
+  node_lists[1] = graph->hidden_nodes;
+  node_lists[2] = graph->output_nodes;
+  for(i = 0; i < 3; ++i) {
+    for(other = bg_node_vector_first(node_lists[i], &it);
+        other; other = bg_node_vector_next(&it)) {
+      /* interned names are equal only if they are the same */
+      if(other != node && other->name == node->name) {
+        if(!bg_name_map_insert(graph->name_map, other->name, other)) {
+          return bg_error_set(bg_ERR_NO_MEMORY);
+        }
+        return bg_SUCCESS;
+      }
     }
   }
-  *node = NULL;
   return bg_SUCCESS;
 }
 
-bg_error bg_graph_get_subgraph(bg_graph_t *graph, const char* name,
-                               bg_graph_t **subgraph) {
-  bg_node_list_t *node_list;
-  bg_node_list_iterator_t it;
-  bg_node_t *current_node;
-  node_list = graph->hidden_nodes;
-  fprintf(stderr, "search for: %s\n", name);
-  for(current_node = bg_node_list_first(node_list, &it);
-      current_node; current_node = bg_node_list_next(&it)) {
-    fprintf(stderr, "  compare: %s\n", current_node->name);
-    if(strcmp(current_node->name, name) == 0) {
-      fprintf(stderr, "found name ");
-    }
-    if(strcmp(current_node->name, name) == 0 &&
-       current_node->type->id == bg_NODE_TYPE_SUBGRAPH) {
-      fprintf(stderr, "...found\n");
-      *subgraph = ((subgraph_data_t*)current_node->_priv_data)->subgraph;
-      return bg_SUCCESS;
+/* makes room for one more graph input port */
+static bg_error graph_grow_input_ports(bg_graph_t *graph) {
+  size_t new_capacity;
+  input_port_t **new_ports;
+  if(graph->input_port_cnt < graph->input_port_capacity) {
+    return bg_SUCCESS;
+  }
+  new_capacity = graph->input_port_capacity ? graph->input_port_capacity*2 : 4;
+  new_ports = (input_port_t**)bg_arena_alloc(graph->arena,
+                                             new_capacity*sizeof(input_port_t*));
+  if(!new_ports) {
+    return bg_error_set(bg_ERR_NO_MEMORY);
+  }
+  if(graph->input_port_capacity) {
+    memcpy(new_ports, graph->input_ports,
+           graph->input_port_cnt*sizeof(input_port_t*));
+    bg_arena_free(graph->arena, graph->input_ports,
+                  graph->input_port_capacity*sizeof(input_port_t*));
+  }
+  graph->input_ports = new_ports;
+  graph->input_port_capacity = new_capacity;
+  return bg_SUCCESS;
+}
+
+/* makes room for one more graph output port */
+static bg_error graph_grow_output_ports(bg_graph_t *graph) {
+  size_t new_capacity;
+  output_port_t **new_ports;
+  if(graph->output_port_cnt < graph->output_port_capacity) {
+    return bg_SUCCESS;
+  }
+  new_capacity = graph->output_port_capacity ? graph->output_port_capacity*2 : 4;
+  new_ports = (output_port_t**)bg_arena_alloc(graph->arena,
+                                              new_capacity*sizeof(output_port_t*));
+  if(!new_ports) {
+    return bg_error_set(bg_ERR_NO_MEMORY);
+  }
+  if(graph->output_port_capacity) {
+    memcpy(new_ports, graph->output_ports,
+           graph->output_port_cnt*sizeof(output_port_t*));
+    bg_arena_free(graph->arena, graph->output_ports,
+                  graph->output_port_capacity*sizeof(output_port_t*));
+  }
+  graph->output_ports = new_ports;
+  graph->output_port_capacity = new_capacity;
+  return bg_SUCCESS;
+}
+
+/* the sub-graph node shares the port tables of its graph */
+static void graph_update_subgraph_node(bg_graph_t *graph) {
+  bg_node_t *node = graph->subgraph_node;
+  if(!node) {
+    return;
+  }
+  node->input_port_cnt = graph->input_port_cnt;
+  node->output_port_cnt = graph->output_port_cnt;
+  node->input_ports = graph->input_ports;
+  node->output_ports = graph->output_ports;
+  if(node->_parent_graph) {
+    node->_parent_graph->plan_is_dirty = true;
+  }
+}
+
+/* whether the edge orders its source before its sink */
+static bool graph_edge_is_relation(const bg_edge_t *edge) {
+  return edge->source_node && edge->sink_node && !edge->ignore_for_sort &&
+    edge->source_node != edge->sink_node;
+}
+
+/* whether the node is part of a relation passed to tsort */
+static bool graph_node_has_relation(const bg_node_t *node) {
+  size_t i, k;
+  for(i = 0; i < node->input_port_cnt; ++i) {
+    for(k = 0; k < node->input_ports[i]->num_edges; ++k) {
+      if(graph_edge_is_relation(node->input_ports[i]->edges[k])) {
+        return true;
+      }
+    }
+  }
+  for(i = 0; i < node->output_port_cnt; ++i) {
+    for(k = 0; k < node->output_ports[i]->num_edges; ++k) {
+      if(graph_edge_is_relation(node->output_ports[i]->edges[k])) {
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+/* Edits of a graph whose order had no loops update the order in place of a
+ * new sort. The hidden nodes with relations come first in topological order,
+ * followed by the outputs without relations. Removed nodes leave a hole, so
+ * an edit only renumbers the positions it moves. The holes are closed by
+ * bg_graph_update_evaluation_order() before the order is read.
+ *
+ * Edits that close a loop leave the order to the next sort, which decides
+ * which relations to drop. Nodes without a relation between them may end up
+ * in another order than a new sort would give them. This doesn't change any
+ * results as long as every edge between two nodes is a relation, so graphs
+ * with edges that are ignored for sorting are sorted anew after each edit. */
+static bool graph_order_is_maintained(const bg_graph_t *graph) {
+  return graph->eval_order_is_maintained && !graph->eval_order_is_dirty;
+}
+
+/* updates the positions from idx to the end of the order */
+static void graph_order_renumber(bg_graph_t *graph, size_t idx) {
+  size_t cnt = bg_node_vector_size(graph->evaluation_order);
+  bg_node_t *node;
+  for(; idx < cnt; ++idx) {
+    node = bg_node_vector_get(graph->evaluation_order, idx);
+    if(node) {
+      node->order_idx = idx;
+    }
+  }
+}
+
+/* only moves the nodes behind idx, which are the unconnected outputs if idx
+ * is the end of the sorted nodes */
+static bool graph_order_insert(bg_graph_t *graph, bg_node_t *node,
+                               size_t idx) {
+  bg_node_vector_iterator_t it;
+  size_t cnt = bg_node_vector_size(graph->evaluation_order);
+  it.vector = graph->evaluation_order;
+  it.idx = idx;
+  bg_node_vector_insert(&it, node);
+  if(bg_node_vector_size(graph->evaluation_order) == cnt) {
+    return false;
+  }
+  graph_order_renumber(graph, idx);
+  return true;
+}
+
+static void graph_order_erase(bg_graph_t *graph, bg_node_t *node) {
+  bg_node_vector_set(graph->evaluation_order, node->order_idx, NULL);
+  node->order_idx = (size_t)-1;
+  graph->eval_order_hole_cnt++;
+}
+
+/* closes the holes of removed nodes */
+static void graph_order_compact(bg_graph_t *graph) {
+  size_t i, cnt = bg_node_vector_size(graph->evaluation_order), kept = 0;
+  size_t sorted_cnt = 0;
+  bg_node_t *node;
+  for(i = 0; i < cnt; ++i) {
+    node = bg_node_vector_get(graph->evaluation_order, i);
+    if(!node) {
+      continue;
     }
+    if(i < graph->eval_order_sorted_cnt) {
+      ++sorted_cnt;
+    }
+    node->order_idx = kept;
+    bg_node_vector_set(graph->evaluation_order, kept++, node);
+  }
+  bg_node_vector_truncate(graph->evaluation_order, kept);
+  graph->eval_order_sorted_cnt = sorted_cnt;
+  graph->eval_order_hole_cnt = 0;
+}
+
+void bg_graph_update_evaluation_order(bg_graph_t *graph) {
+  if(graph->eval_order_is_dirty) {
+    determine_evaluation_order(graph);
+    graph->eval_order_is_dirty = false;
+  } else if(graph->eval_order_hole_cnt) {
+    graph_order_compact(graph);
+  }
+}
+
+/* the node takes part in a relation */
+static bool graph_order_enter(bg_graph_t *graph, bg_node_t *node) {
+  if(node->type->id == bg_NODE_TYPE_INPUT) {
+    return true;
+  }
+  if(node->type->id == bg_NODE_TYPE_OUTPUT) {
+    if(node->order_idx != (size_t)-1) {
+      graph_order_erase(graph, node);
+    }
+    return true;
+  }
+  if(node->order_idx == (size_t)-1) {
+    if(!graph_order_insert(graph, node, graph->eval_order_sorted_cnt)) {
+      return false;
+    }
+    graph->eval_order_sorted_cnt++;
+  }
+  return true;
+}
+
+/* the node may have lost its last relation */
+static bool graph_order_leave(bg_graph_t *graph, bg_node_t *node) {
+  if(node->type->id == bg_NODE_TYPE_INPUT ||
+     graph_node_has_relation(node)) {
+    return true;
+  }
+  if(node->type->id == bg_NODE_TYPE_OUTPUT) {
+    if(node->order_idx == (size_t)-1) {
+      return graph_order_insert(graph, node,
+                                bg_node_vector_size(graph->evaluation_order));
+    }
+    return true;
+  }
+  if(node->order_idx != (size_t)-1) {
+    graph_order_erase(graph, node);
+  }
+  return true;
+}
+
+static bool graph_order_reserve(bg_graph_t *graph, size_t cnt) {
+  size_t capacity;
+  bg_node_t **nodes;
+  size_t *slots;
+  if(cnt <= graph->order_capacity) {
+    return true;
+  }
+  capacity = graph->order_capacity ? graph->order_capacity * 2 : 16;
+  while(capacity < cnt) {
+    capacity *= 2;
+  }
+  nodes = (bg_node_t**)realloc(graph->order_nodes,
+                               capacity * sizeof(bg_node_t*));
+  if(!nodes) {
+    return false;
+  }
+  graph->order_nodes = nodes;
+  slots = (size_t*)realloc(graph->order_slots, capacity * sizeof(size_t));
+  if(!slots) {
+    return false;
+  }
+  graph->order_slots = slots;
+  graph->order_capacity = capacity;
+  return true;
+}
+
+/* Appends start and the nodes it reaches through relations whose positions
+ * lie between lower and upper, following the output edges if forward and
+ * the input edges otherwise. Fails if stop is reached. */
+static bool graph_order_collect(bg_graph_t *graph, bg_node_t *start,
+                                size_t *cnt, size_t lower, size_t upper,
+                                bool forward, const bg_node_t *stop) {
+  size_t i, j, k, port_cnt, edge_cnt;
+  bg_node_t *node, *next;
+  bg_edge_t *edge;
+  if(!graph_order_reserve(graph, *cnt + 1)) {
+    return false;
+  }
+  start->order_mark = true;
+  graph->order_nodes[(*cnt)++] = start;
+  /* the collected nodes double as the queue of the search */
+  for(i = *cnt - 1; i < *cnt; ++i) {
+    node = graph->order_nodes[i];
+    port_cnt = forward ? node->output_port_cnt : node->input_port_cnt;
+    for(j = 0; j < port_cnt; ++j) {
+      edge_cnt = forward ? node->output_ports[j]->num_edges :
+        node->input_ports[j]->num_edges;
+      for(k = 0; k < edge_cnt; ++k) {
+        edge = forward ? node->output_ports[j]->edges[k] :
+          node->input_ports[j]->edges[k];
+        if(!graph_edge_is_relation(edge)) {
+          continue;
+        }
+        next = forward ? edge->sink_node : edge->source_node;
+        if(next == stop) {
+          return false;
+        }
+        if(next->order_mark || next->order_idx <= lower ||
+           next->order_idx >= upper) {
+          continue;
+        }
+        if(!graph_order_reserve(graph, *cnt + 1)) {
+          return false;
+        }
+        next->order_mark = true;
+        graph->order_nodes[(*cnt)++] = next;
+      }
+    }
+  }
+  return true;
+}
+
+static int graph_order_compare_nodes(const void *a, const void *b) {
+  size_t x = (*(bg_node_t* const*)a)->order_idx;
+  size_t y = (*(bg_node_t* const*)b)->order_idx;
+  return x < y ? -1 : x > y;
+}
+
+static int graph_order_compare_slots(const void *a, const void *b) {
+  size_t x = *(const size_t*)a, y = *(const size_t*)b;
+  return x < y ? -1 : x > y;
+}
+
+/* Moves source in front of sink as by Pearce and Kelly: the nodes between
+ * both that sink leads to and the nodes that lead to source swap their
+ * positions, keeping their order within each group. Fails if the relation
+ * closes a loop. */
+static bool graph_order_reorder(bg_graph_t *graph, bg_node_t *source,
+                                bg_node_t *sink) {
+  size_t i, cnt = 0, forward_cnt;
+  size_t lower = sink->order_idx, upper = source->order_idx;
+  bg_node_t *node, **nodes;
+  bool ok;
+  ok = graph_order_collect(graph, sink, &cnt, lower, upper, true, source);
+  forward_cnt = cnt;
+  if(ok) {
+    ok = graph_order_collect(graph, source, &cnt, lower, upper, false, NULL);
+  }
+  nodes = graph->order_nodes;
+  for(i = 0; i < cnt; ++i) {
+    nodes[i]->order_mark = false;
+  }
+  if(!ok) {
+    return false;
+  }
+  qsort(nodes, forward_cnt, sizeof(bg_node_t*), graph_order_compare_nodes);
+  qsort(nodes + forward_cnt, cnt - forward_cnt, sizeof(bg_node_t*),
+        graph_order_compare_nodes);
+  for(i = 0; i < cnt; ++i) {
+    graph->order_slots[i] = nodes[i]->order_idx;
+  }
+  qsort(graph->order_slots, cnt, sizeof(size_t), graph_order_compare_slots);
+  /* the nodes that lead to source go first */
+  for(i = 0; i < cnt; ++i) {
+    node = i < cnt - forward_cnt ? nodes[forward_cnt + i] :
+      nodes[i - (cnt - forward_cnt)];
+    node->order_idx = graph->order_slots[i];
+    bg_node_vector_set(graph->evaluation_order, node->order_idx, node);
+  }
+  return true;
+}
+
+/* the ports of a sub-graph node belong to the sub-graph, whose plan reads
+ * their edges */
+static void graph_invalidate_edge_plans(bg_graph_t *graph, bg_edge_t *edge) {
+  graph->plan_is_dirty = true;
+  if(edge->source_node) {
+    bg_node_invalidate_plan(edge->source_node);
+  }
+  if(edge->sink_node) {
+    bg_node_invalidate_plan(edge->sink_node);
+  }
+}
+
+static void graph_order_add_edge(bg_graph_t *graph, bg_edge_t *edge) {
+  bg_node_t *source = edge->source_node, *sink = edge->sink_node;
+  graph_invalidate_edge_plans(graph, edge);
+  if(!graph_order_is_maintained(graph)) {
+    graph->eval_order_is_dirty = true;
+    return;
+  }
+  if(!graph_edge_is_relation(edge)) {
+    return;
+  }
+  if(!graph_order_enter(graph, source) || !graph_order_enter(graph, sink)) {
+    graph->eval_order_is_dirty = true;
+    return;
+  }
+  /* relations with inputs and outputs don't constrain the order */
+  if(source->type->id != bg_NODE_TYPE_INPUT &&
+     sink->type->id != bg_NODE_TYPE_OUTPUT &&
+     source->order_idx > sink->order_idx &&
+     !graph_order_reorder(graph, source, sink)) {
+    graph->eval_order_is_dirty = true;
+  }
+}
+
+/* called after the edge was taken out of its ports */
+static void graph_order_remove_edge(bg_graph_t *graph, bg_edge_t *edge) {
+  graph_invalidate_edge_plans(graph, edge);
+  if(!graph_order_is_maintained(graph)) {
+    graph->eval_order_is_dirty = true;
+    return;
+  }
+  if(graph_edge_is_relation(edge) &&
+     (!graph_order_leave(graph, edge->source_node) ||
+      !graph_order_leave(graph, edge->sink_node))) {
+    graph->eval_order_is_dirty = true;
+  }
+}
+
+/* a new node has no relations, unconnected outputs are evaluated last */
+static void graph_order_add_node(bg_graph_t *graph, bg_node_t *node) {
+  graph->plan_is_dirty = true;
+  if(!graph_order_is_maintained(graph) ||
+     (node->type->id == bg_NODE_TYPE_OUTPUT &&
+      !graph_order_leave(graph, node))) {
+    graph->eval_order_is_dirty = true;
+  }
+}
+
+/* called before the unconnected node is freed */
+static void graph_order_remove_node(bg_graph_t *graph, bg_node_t *node) {
+  graph->plan_is_dirty = true;
+  if(!graph_order_is_maintained(graph)) {
+    graph->eval_order_is_dirty = true;
+  }
+  else if(node->order_idx != (size_t)-1) {
+    graph_order_erase(graph, node);
   }
-  *subgraph = NULL;
+}
+
+bg_error bg_graph_find_node_by_name(bg_graph_t *graph, const char *name,
+                                    size_t len, bg_node_t **node) {
+  *node = (bg_node_t*)bg_name_map_find_n(graph->name_map, name, len);
   return bg_SUCCESS;
 }
 
+static bg_graph_t *graph_find_subgraph(bg_graph_t *graph, const char *name,
+                                       size_t len) {
+  bg_node_vector_iterator_t it;
+  bg_node_t *node;
+  bg_graph_find_node_by_name(graph, name, len, &node);
+  if(node && node->type->id != bg_NODE_TYPE_SUBGRAPH) {
+    /* the name is shared with a node of another type */
+    for(node = bg_node_vector_first(graph->hidden_nodes, &it);
+        node; node = bg_node_vector_next(&it)) {
+      if(node->type->id == bg_NODE_TYPE_SUBGRAPH &&
+         strncmp(node->name, name, len) == 0 && node->name[len] == '\0') {
+        break;
+      }
+    }
+  }
+  if(!node || node->type->id != bg_NODE_TYPE_SUBGRAPH) {
+    return NULL;
+  }
+  return ((subgraph_data_t*)node->_priv_data)->subgraph;
+}
 
-bg_error bg_graph_find_edge(bg_graph_t *graph, bg_edge_id_t edge_id,
-                            bg_edge_t **edge) {
-  bg_edge_list_t *edge_list;
-  bg_edge_list_iterator_t it;
-  bg_edge_t *current_edge;
+bg_error bg_graph_get_subgraph(bg_graph_t *graph, const char* name,
+                               bg_graph_t **subgraph) {
+  *subgraph = graph_find_subgraph(graph, name, strlen(name));
+  return bg_SUCCESS;
+}
 
-  edge_list = graph->edge_list;
-  for(current_edge = bg_edge_list_first(edge_list, &it);
-      current_edge; current_edge = bg_edge_list_next(&it)) {
-    if(current_edge->id == edge_id) {
-      *edge = current_edge;
+bg_error bg_graph_resolve_path(bg_graph_t *graph, const char *path,
+                               bg_graph_t **node_graph, bg_node_id_t *node_id,
+                               bool *is_input, size_t *port_idx) {
+  const char *name = path, *end;
+  bg_node_t *node;
+  size_t i;
+  /* descend into the sub-graphs */
+  while((end = strchr(name, '/')) != NULL) {
+    graph = graph_find_subgraph(graph, name, end-name);
+    if(!graph) {
+      return bg_ERR_NODE_NOT_FOUND;
+    }
+    name = end+1;
+  }
+  end = strchr(name, ':');
+  bg_graph_find_node_by_name(graph, name, end ? (size_t)(end-name) : strlen(name),
+                             &node);
+  if(!node) {
+    return bg_ERR_NODE_NOT_FOUND;
+  }
+  *node_graph = graph;
+  *node_id = node->id;
+  *is_input = false;
+  *port_idx = 0;
+  if(!end) {
+    return bg_SUCCESS;
+  }
+  for(i = 0; i < node->input_port_cnt; ++i) {
+    if(node->input_ports[i]->name &&
+       strcmp(node->input_ports[i]->name, end+1) == 0) {
+      *is_input = true;
+      *port_idx = i;
+      return bg_SUCCESS;
+    }
+  }
+  for(i = 0; i < node->output_port_cnt; ++i) {
+    if(node->output_ports[i]->name &&
+       strcmp(node->output_ports[i]->name, end+1) == 0) {
+      *port_idx = i;
       return bg_SUCCESS;
     }
   }
-  *edge = NULL;
+  return bg_ERR_OUT_OF_RANGE;
+}
+
+bg_error bg_graph_find_edge(bg_graph_t *graph, bg_edge_id_t edge_id,
+                            bg_edge_t **edge) {
+  *edge = (bg_edge_t*)bg_id_map_find(graph->edge_map, edge_id);
   return bg_SUCCESS;
 }
 
 bg_error bg_graph_evaluate(bg_graph_t *graph) {
   bg_error err = bg_SUCCESS;
   bg_node_t *current_node;
-  bg_node_list_t *node_list = graph->evaluation_order;
-  bg_node_list_iterator_t it;
-  if(graph->eval_order_is_dirty) {
-    determine_evaluation_order(graph);
-    graph->eval_order_is_dirty = false;
+  bg_node_vector_t *node_list = graph->evaluation_order;
+  bg_node_vector_iterator_t it;
+  if(graph->plan || graph->thread_pool || graph->inline_subgraphs) {
+    if(!graph->plan || graph->plan_is_dirty || graph->eval_order_is_dirty ||
+       bg_plan_is_stale(graph->plan)) {
+      err = bg_plan_compile(graph);
+      if(err != bg_SUCCESS) {
+        return err;
+      }
+    }
+    if(graph->thread_pool && graph->parallel_subgraphs) {
+      return bg_plan_execute_subgraphs(graph->plan, graph->thread_pool);
+    }
+    if(graph->thread_pool) {
+      return bg_plan_execute_parallel(graph->plan, graph->thread_pool,
+                                      graph->parallel_min_width);
+    }
+    return bg_plan_execute(graph->plan);
   }
+  bg_graph_update_evaluation_order(graph);
   /* first process input nodes, then hidden nodes, and last output nodes */
-  for(current_node = bg_node_list_first(graph->input_nodes, &it);
-      current_node; current_node = bg_node_list_next(&it)) {
+  for(current_node = bg_node_vector_first(graph->input_nodes, &it);
+      current_node; current_node = bg_node_vector_next(&it)) {
     /*printf("eval \"%s\"\n", current_node->name);*/
     err = bg_node_evaluate(current_node);
     if(err != bg_SUCCESS) {
@@ -110,8 +604,8 @@ bg_error bg_graph_evaluate(bg_graph_t *graph) {
     }
   }
 
-  for(current_node = bg_node_list_first(node_list, &it);
-      current_node; current_node = bg_node_list_next(&it)) {
+  for(current_node = bg_node_vector_first(node_list, &it);
+      current_node; current_node = bg_node_vector_next(&it)) {
     /*printf("eval \"%s\"\n", current_node->name);*/
     err = bg_node_evaluate(current_node);
     if(err != bg_SUCCESS) {
@@ -119,8 +613,8 @@ bg_error bg_graph_evaluate(bg_graph_t *graph) {
     }
   }
 
-  for(current_node = bg_node_list_first(graph->output_nodes, &it);
-      current_node; current_node = bg_node_list_next(&it)) {
+  for(current_node = bg_node_vector_first(graph->output_nodes, &it);
+      current_node; current_node = bg_node_vector_next(&it)) {
     /*printf("eval \"%s\"\n", current_node->name);*/
     err = bg_node_evaluate(current_node);
     if(err != bg_SUCCESS) {
@@ -130,6 +624,144 @@ bg_error bg_graph_evaluate(bg_graph_t *graph) {
   return err;
 }
 
+bg_error bg_graph_set_inline_subgraphs(bg_graph_t *graph,
+                                       bool inline_subgraphs) {
+  graph->inline_subgraphs = inline_subgraphs;
+  graph->plan_is_dirty = true;
+  return bg_SUCCESS;
+}
+
+/* replaces a name by the empty string of the same table */
+static const char *graph_strip_name(bg_graph_t *graph, const char *name) {
+  const char *stripped;
+  if(!name) {
+    return NULL;
+  }
+  stripped = bg_string_table_intern(graph->names, "");
+  if(stripped) {
+    bg_string_table_release(graph->names, name);
+    return stripped;
+  }
+  return name;
+}
+
+bg_error bg_graph_set_strip_names(bg_graph_t *graph, bool strip) {
+  size_t i, j;
+  bg_error err;
+  bg_node_t *node;
+  bg_graph_t *subgraph;
+  bg_node_vector_t *node_lists[3];
+  bg_node_vector_iterator_t it;
+  bg_string_table_set_strip(graph->names, strip);
+  if(!strip) {
+    return bg_SUCCESS;
+  }
+  bg_name_map_deinit(graph->name_map);
+  bg_name_map_init(&graph->name_map);
+  node_lists[0] = graph->input_nodes;
+  node_lists[1] = graph->hidden_nodes;
+  node_lists[2] = graph->output_nodes;
+  for(i = 0; i < 3; ++i) {
+    for(node = bg_node_vector_first(node_lists[i], &it);
+        node; node = bg_node_vector_next(&it)) {
+      node->name = graph_strip_name(graph, node->name);
+      if(node->type->id == bg_NODE_TYPE_SUBGRAPH) {
+        /* the ports belong to the sub-graph */
+        subgraph = ((subgraph_data_t*)node->_priv_data)->subgraph;
+        if(subgraph) {
+          err = bg_graph_set_strip_names(subgraph, strip);
+          if(err != bg_SUCCESS) {
+            return err;
+          }
+        }
+        continue;
+      }
+      for(j = 0; j < node->input_port_cnt; ++j) {
+        node->input_ports[j]->name =
+          graph_strip_name(graph, node->input_ports[j]->name);
+      }
+      for(j = 0; j < node->output_port_cnt; ++j) {
+        node->output_ports[j]->name =
+          graph_strip_name(graph, node->output_ports[j]->name);
+      }
+    }
+  }
+  return bg_SUCCESS;
+}
+
+/* points the direct edges leaving node to its current output ports */
+static void graph_update_direct_edges(bg_node_t *node) {
+  size_t i, j;
+  bg_edge_t *edge;
+  for(i = 0; i < node->output_port_cnt; ++i) {
+    for(j = 0; j < node->output_ports[i]->num_edges; ++j) {
+      edge = node->output_ports[i]->edges[j];
+      bg_edge_set_direct(edge, edge->direct);
+    }
+  }
+}
+
+bg_error bg_graph_set_direct_edges(bg_graph_t *graph, bool direct) {
+  bg_error err;
+  bg_edge_t *edge;
+  bg_node_t *node;
+  bg_graph_t *subgraph;
+  bg_edge_list_iterator_t edge_it;
+  bg_node_vector_iterator_t node_it;
+  graph->direct_edges = direct;
+  for(edge = bg_edge_list_first(graph->edge_list, &edge_it);
+      edge; edge = bg_edge_list_next(&edge_it)) {
+    /* copies read from now on have to be current */
+    if(!direct && edge->source_node) {
+      bg_EDGE_VALUE(edge) = bg_EDGE_INPUT(edge);
+    }
+    bg_edge_set_direct(edge, direct);
+  }
+  for(node = bg_node_vector_first(graph->hidden_nodes, &node_it);
+      node; node = bg_node_vector_next(&node_it)) {
+    if(node->type->id == bg_NODE_TYPE_SUBGRAPH) {
+      subgraph = ((subgraph_data_t*)node->_priv_data)->subgraph;
+      if(subgraph) {
+        err = bg_graph_set_direct_edges(subgraph, direct);
+        if(err != bg_SUCCESS) {
+          return err;
+        }
+      }
+    }
+  }
+  return bg_SUCCESS;
+}
+
+bg_error bg_graph_set_parallel(bg_graph_t *graph, size_t thread_cnt,
+                               size_t min_width) {
+  bg_error err;
+  bg_thread_pool_t *pool = NULL;
+  if(thread_cnt > 1) {
+    err = bg_thread_pool_create(&pool, thread_cnt);
+    if(err != bg_SUCCESS) {
+      return err;
+    }
+  }
+  bg_thread_pool_free(graph->thread_pool);
+  graph->thread_pool = pool;
+  graph->parallel_min_width = min_width;
+  graph->parallel_subgraphs = false;
+  /* the parallel evaluation does not track which nodes changed */
+  graph->plan_is_dirty = true;
+  return bg_SUCCESS;
+}
+
+bg_error bg_graph_set_parallel_subgraphs(bg_graph_t *graph,
+                                         size_t thread_cnt) {
+  bg_error err = bg_graph_set_parallel(graph, thread_cnt, 0);
+  if(err != bg_SUCCESS) {
+    return err;
+  }
+  /* the plan is rebuilt since its levels depend on the mode */
+  graph->parallel_subgraphs = graph->thread_pool != NULL;
+  return bg_SUCCESS;
+}
+
 
 bg_error bg_graph_alloc(bg_graph_t **graph, const char *name) {
   char *name_copy = malloc(strlen(name)+1);
@@ -143,11 +775,17 @@ bg_error bg_graph_alloc(bg_graph_t **graph, const char *name) {
 
   g->input_port_cnt = 0;
   g->output_port_cnt = 0;
-  bg_node_list_init(&g->evaluation_order);
-  bg_node_list_init(&g->output_nodes);
-  bg_node_list_init(&g->input_nodes);
-  bg_node_list_init(&g->hidden_nodes);
+  bg_node_vector_init(&g->evaluation_order);
+  bg_node_vector_init(&g->output_nodes);
+  bg_node_vector_init(&g->input_nodes);
+  bg_node_vector_init(&g->hidden_nodes);
   bg_edge_list_init(&g->edge_list);
+  bg_id_map_init(&g->node_map);
+  bg_id_map_init(&g->edge_map);
+  bg_name_map_init(&g->name_map);
+  bg_string_table_init(&g->names);
+  bg_arena_init(&g->arena);
+  bg_value_store_init(&g->store);
   g->eval_order_is_dirty = false;
   g->next_id = 1;
   g->load_path = NULL;
@@ -171,15 +809,163 @@ bg_error bg_graph_set_load_path(bg_graph_t *graph, const char *path) {
   return bg_error_get();
 }
 
+/* Copies one node with its port settings into dest. Sub-graphs are cloned
+ * recursively and share their ports with the new node. */
+static bg_error graph_clone_node(bg_graph_t *dest, const bg_node_t *src_node,
+                                 bg_node_vector_t *node_list) {
+  size_t i;
+  bg_error err;
+  bg_node_t *new_node;
+  input_port_t *src_input;
+  bg_graph_t *subgraph, *src_subgraph;
+  if(bg_id_map_find(dest->node_map, src_node->id)) {
+    return bg_error_set(bg_ERR_DUPLICATE_NODE_ID);
+  }
+  if(src_node->type->id == bg_NODE_TYPE_INPUT) {
+    err = graph_grow_input_ports(dest);
+  }
+  else if(src_node->type->id == bg_NODE_TYPE_OUTPUT) {
+    err = graph_grow_output_ports(dest);
+  }
+  else {
+    err = bg_SUCCESS;
+  }
+  if(err != bg_SUCCESS) {
+    return err;
+  }
+  new_node = (bg_node_t*)bg_arena_alloc(dest->arena, sizeof(bg_node_t));
+  if(!new_node) {
+    return bg_error_set(bg_ERR_NO_MEMORY);
+  }
+  new_node->_parent_graph = dest;
+  err = bg_node_init(new_node, src_node->name, src_node->id,
+                     src_node->type->id);
+  if(err == bg_SUCCESS && src_node->type->id == bg_NODE_TYPE_EXTERN) {
+    /* the registered extern type is shared */
+    new_node->type = src_node->type;
+    err = new_node->type->init(new_node);
+  }
+  if(err == bg_SUCCESS && src_node->type->id == bg_NODE_TYPE_SUBGRAPH) {
+    src_subgraph = ((subgraph_data_t*)src_node->_priv_data)->subgraph;
+    if(src_subgraph) {
+      err = bg_graph_alloc(&subgraph, src_subgraph->name);
+      if(err == bg_SUCCESS) {
+        ((subgraph_data_t*)new_node->_priv_data)->subgraph = subgraph;
+        subgraph->subgraph_node = new_node;
+        err = bg_graph_clone(subgraph, src_subgraph);
+      }
+      if(err == bg_SUCCESS) {
+        new_node->input_port_cnt = subgraph->input_port_cnt;
+        new_node->output_port_cnt = subgraph->output_port_cnt;
+        new_node->input_ports = subgraph->input_ports;
+        new_node->output_ports = subgraph->output_ports;
+      }
+    }
+  }
+  else {
+    /* the ports of a sub-graph node are set up by the sub-graph clone */
+    for(i = 0; err == bg_SUCCESS && i < src_node->input_port_cnt; ++i) {
+      src_input = src_node->input_ports[i];
+      err = bg_node_set_input_intern(new_node, i, src_input->merge->id,
+                                     src_input->defaultValue,
+                                     src_input->bias, src_input->name, true);
+      if(err == bg_SUCCESS) {
+        err = bg_node_reserve_input_edges(new_node, i, src_input->num_edges);
+      }
+    }
+    for(i = 0; err == bg_SUCCESS && i < src_node->output_port_cnt; ++i) {
+      err = bg_node_set_output_intern(new_node, i,
+                                      src_node->output_ports[i]->name, true);
+      if(err == bg_SUCCESS) {
+        err = bg_node_reserve_output_edges(new_node, i,
+                                           src_node->output_ports[i]->num_edges);
+      }
+    }
+  }
+  if(err == bg_SUCCESS) {
+    err = graph_index_node(dest, new_node);
+  }
+  if(err != bg_SUCCESS) {
+    new_node->type->deinit(new_node);
+    bg_string_table_release(dest->names, new_node->name);
+    bg_arena_free(dest->arena, new_node, sizeof(bg_node_t));
+    return err;
+  }
+  if(new_node->type->id == bg_NODE_TYPE_INPUT) {
+    dest->input_ports[dest->input_port_cnt++] = new_node->input_ports[0];
+  }
+  else if(new_node->type->id == bg_NODE_TYPE_OUTPUT) {
+    dest->output_ports[dest->output_port_cnt++] = new_node->output_ports[0];
+  }
+  bg_node_vector_append(node_list, new_node);
+  return bg_SUCCESS;
+}
+
+/* Copies one edge into dest. The nodes are looked up by id, the ports already
+ * have room for all edges of the source graph. */
+static bg_error graph_clone_edge(bg_graph_t *dest, const bg_edge_t *src_edge) {
+  bg_error err;
+  bg_edge_t *new_edge;
+  bg_node_t *source_node = NULL, *sink_node = NULL;
+  output_port_t *output_port;
+  input_port_t *input_port;
+  if(src_edge->source_node) {
+    source_node = (bg_node_t*)bg_id_map_find(dest->node_map,
+                                             src_edge->source_node->id);
+    err = bg_node_reserve_output_edges(source_node, src_edge->source_port_idx,
+      source_node->output_ports[src_edge->source_port_idx]->num_edges+1);
+    if(err != bg_SUCCESS) {
+      return err;
+    }
+  }
+  if(src_edge->sink_node) {
+    sink_node = (bg_node_t*)bg_id_map_find(dest->node_map,
+                                           src_edge->sink_node->id);
+    err = bg_node_reserve_input_edges(sink_node, src_edge->sink_port_idx,
+      sink_node->input_ports[src_edge->sink_port_idx]->num_edges+1);
+    if(err != bg_SUCCESS) {
+      return err;
+    }
+  }
+  new_edge = (bg_edge_t*)bg_arena_alloc(dest->arena, sizeof(bg_edge_t));
+  if(!new_edge) {
+    return bg_error_set(bg_ERR_NO_MEMORY);
+  }
+  new_edge->id = src_edge->id;
+  err = bg_edge_init(new_edge, &dest->store, source_node,
+                     src_edge->source_port_idx, sink_node,
+                     src_edge->sink_port_idx, bg_EDGE_WEIGHT(src_edge));
+  if(err != bg_SUCCESS) {
+    bg_arena_free(dest->arena, new_edge, sizeof(bg_edge_t));
+    return err;
+  }
+  new_edge->ignore_for_sort = src_edge->ignore_for_sort;
+  bg_edge_set_direct(new_edge, dest->direct_edges);
+  if(!bg_id_map_find(dest->edge_map, new_edge->id) &&
+     !bg_id_map_insert(dest->edge_map, new_edge->id, new_edge)) {
+    bg_edge_deinit(new_edge);
+    bg_arena_free(dest->arena, new_edge, sizeof(bg_edge_t));
+    return bg_error_set(bg_ERR_NO_MEMORY);
+  }
+  if(source_node) {
+    output_port = source_node->output_ports[new_edge->source_port_idx];
+    output_port->edges[output_port->num_edges++] = new_edge;
+  }
+  if(sink_node) {
+    input_port = sink_node->input_ports[new_edge->sink_port_idx];
+    input_port->edges[input_port->num_edges++] = new_edge;
+  }
+  bg_edge_list_append(dest->edge_list, new_edge);
+  return bg_SUCCESS;
+}
+
 bg_error bg_graph_clone(bg_graph_t *dest, const bg_graph_t *src) {
   size_t i;
   bg_error err;
   bg_node_t *current_node;
   bg_edge_t *current_edge;
-  bg_edge_t *e;
-  bg_node_list_t *node_list;
-  bg_edge_list_t *edge_list;
-  bg_node_list_iterator_t node_it;
+  bg_node_vector_t *src_lists[3], *dest_lists[3];
+  bg_node_vector_iterator_t node_it;
   bg_edge_list_iterator_t edge_it;
 
   /* clone load path */
@@ -192,156 +978,68 @@ bg_error bg_graph_clone(bg_graph_t *dest, const bg_graph_t *src) {
     dest->load_path = name_copy;
   }
 
-  /* clone all nodes */
-  node_list = src->input_nodes;
-  for(current_node = bg_node_list_first(node_list, &node_it);
-      current_node; current_node = bg_node_list_next(&node_it)) {
-    err = bg_graph_create_input(dest, current_node->name, current_node->id);
-    if(err != bg_SUCCESS) {
-      bg_error_message_get(err, bg_graph_error_message);
-      printf("error while creating input node: %lu %s\n",
-             (unsigned long) current_node->id, bg_graph_error_message);
-    }
-    for(i = 0; i < current_node->type->input_port_cnt; ++i) {
-      err = bg_node_set_input(dest, current_node->id, i,
-                              current_node->input_ports[i]->merge->id,
-                              current_node->input_ports[i]->defaultValue,
-                              current_node->input_ports[i]->bias,
-                              current_node->input_ports[i]->name);
-      if(err != bg_SUCCESS) {
-        bg_error_message_get(err, bg_graph_error_message);
-        printf("error in merge: %s %lu %s %lu\n", current_node->name,
-               (unsigned long) i,  bg_graph_error_message, (unsigned long) current_node->id);
-      }
-    }
-    for(i = 0; i < current_node->type->output_port_cnt; ++i) {
-      err = bg_node_set_output(dest, current_node->id, i,
-                               current_node->output_ports[i]->name);
-      if(err != bg_SUCCESS) {
-        bg_error_message_get(err, bg_graph_error_message);
-        printf("error in set_output: %s %lu %s %lu\n", current_node->name,
-               (unsigned long) i, bg_graph_error_message, (unsigned long) current_node->id);
-      }
-    }
+  bg_string_table_set_strip(dest->names, bg_string_table_get_strip(src->names));
+  dest->direct_edges = src->direct_edges;
+
+  /* reserve the value store and node tables up front */
+  err = bg_value_store_reserve(&dest->store,
+                               src->store.values.cnt - src->store.values.free_cnt,
+                               src->store.weights.cnt - src->store.weights.free_cnt);
+  if(err != bg_SUCCESS) {
+    return err;
   }
 
-  node_list = src->output_nodes;
-  for(current_node = bg_node_list_first(node_list, &node_it);
-      current_node; current_node = bg_node_list_next(&node_it)) {
-    bg_graph_create_output(dest, current_node->name, current_node->id);
-    for(i = 0; i < current_node->type->input_port_cnt; ++i) {
-      err = bg_node_set_input(dest, current_node->id, i,
-                              current_node->input_ports[i]->merge->id,
-                              current_node->input_ports[i]->defaultValue,
-                              current_node->input_ports[i]->bias,
-                              current_node->input_ports[i]->name);
-      if(err != bg_SUCCESS) {
-        bg_error_message_get(err, bg_graph_error_message);
-        fprintf(stderr, "[bg_graph_clone] error in set_input: %s %lu %s %lu\n",
-                current_node->name,  (unsigned long) i, bg_graph_error_message,
-                (unsigned long) current_node->id);
-      }
-    }
-    for(i = 0; i < current_node->type->output_port_cnt; ++i) {
-      err = bg_node_set_output(dest, current_node->id, i,
-                              current_node->output_ports[i]->name);
-      if(err != bg_SUCCESS) {
-        bg_error_message_get(err, bg_graph_error_message);
-        fprintf(stderr, "[bg_graph_clone]  error in set_output: %s %lu %s %lu\n",
-                current_node->name, (unsigned long) i, bg_graph_error_message,
-                (unsigned long) current_node->id);
-      }
-    }
+  if(!bg_id_map_reserve(dest->node_map, bg_id_map_size(dest->node_map) +
+                         bg_id_map_size(src->node_map)) ||
+     !bg_id_map_reserve(dest->edge_map, bg_id_map_size(dest->edge_map) +
+                        bg_id_map_size(src->edge_map))) {
+    return bg_error_set(bg_ERR_NO_MEMORY);
   }
 
-  node_list = src->hidden_nodes;
-  for(current_node = bg_node_list_first(node_list, &node_it);
-      current_node; current_node = bg_node_list_next(&node_it)) {
-    bg_graph_create_node(dest, current_node->name, current_node->id,
-                         current_node->type->id);
-    if(current_node->type->id == bg_NODE_TYPE_EXTERN) {
-      err = bg_node_set_extern(dest, current_node->id,
-                               current_node->type->name);
-    }
-    if(current_node->type->id == bg_NODE_TYPE_SUBGRAPH) {
-      bg_graph_t *subgraph=0;
-      bg_graph_t *currentSub;
-      currentSub = ((subgraph_data_t*)current_node->_priv_data)->subgraph;
-      err = bg_graph_alloc(&subgraph, currentSub->name);
-      if(err != bg_SUCCESS) {
-        printf("bg_graph_clone: error in alloc subgraph memory\n");
-      }
-      err = bg_graph_clone(subgraph, currentSub);
-      if(err != bg_SUCCESS) {
-        bg_error_message_get(err, bg_graph_error_message);
-        printf("bg_graph_clone: error in clone subgraph: %s\n", bg_graph_error_message);
-      }
-      err = bg_node_set_subgraph(dest, current_node->id, subgraph);
-      if(err != bg_SUCCESS) {
-        bg_error_message_get(err, bg_graph_error_message);
-        printf("bg_graph_clone: error in node set subgraph: %s\n", bg_graph_error_message);
-      }
-    }
-    for(i = 0; i < current_node->type->input_port_cnt; ++i) {
-      err = bg_node_set_input(dest, current_node->id, i,
-                              current_node->input_ports[i]->merge->id,
-                              current_node->input_ports[i]->defaultValue,
-                              current_node->input_ports[i]->bias,
-                              current_node->input_ports[i]->name);
-      if(err != bg_SUCCESS) {
-        bg_error_message_get(err, bg_graph_error_message);
-        printf("error in set_input: %s %lu %s %lu\n", current_node->name,
-               (unsigned long) i, bg_graph_error_message,
-               (unsigned long) current_node->id);
-      }
+  /* clone all nodes in the order of the source graph */
+  src_lists[0] = src->input_nodes;
+  src_lists[1] = src->output_nodes;
+  src_lists[2] = src->hidden_nodes;
+  dest_lists[0] = dest->input_nodes;
+  dest_lists[1] = dest->output_nodes;
+  dest_lists[2] = dest->hidden_nodes;
+  for(i = 0; i < 3; ++i) {
+    if(!bg_node_vector_reserve(dest_lists[i],
+                               bg_node_vector_size(dest_lists[i]) +
+                               bg_node_vector_size(src_lists[i]))) {
+      return bg_error_set(bg_ERR_NO_MEMORY);
     }
-    for(i = 0; i < current_node->type->output_port_cnt; ++i) {
-      err = bg_node_set_output(dest, current_node->id, i,
-                              current_node->output_ports[i]->name);
+    for(current_node = bg_node_vector_first(src_lists[i], &node_it);
+        current_node; current_node = bg_node_vector_next(&node_it)) {
+      err = graph_clone_node(dest, current_node, dest_lists[i]);
       if(err != bg_SUCCESS) {
-        bg_error_message_get(err, bg_graph_error_message);
-        printf("error in set_output: %s %lu %s %lu\n", current_node->name,
-               (unsigned long) i, bg_graph_error_message, (unsigned long) current_node->id);
+        return err;
       }
     }
-    /* todo: need some special handling for subgraph nodes? */
   }
+  graph_update_subgraph_node(dest);
 
   /* clone all edges */
-  edge_list = src->edge_list;
-  for(current_edge = bg_edge_list_first(edge_list, &edge_it);
+  for(current_edge = bg_edge_list_first(src->edge_list, &edge_it);
       current_edge; current_edge = bg_edge_list_next(&edge_it)) {
-
-    if (current_edge->source_node) {
-      err = bg_graph_create_edge(dest, current_edge->source_node->id,
-                                 current_edge->source_port_idx,
-                                 current_edge->sink_node->id,
-                                 current_edge->sink_port_idx,
-                                 current_edge->weight,
-                                 current_edge->id);
-    }
-    else {
-      err = bg_graph_create_edge(dest, 0, 0,
-                                 current_edge->sink_node->id,
-                                 current_edge->sink_port_idx,
-                                 current_edge->weight,
-                                 current_edge->id);
-    }
+    err = graph_clone_edge(dest, current_edge);
     if(err != bg_SUCCESS) {
-      bg_error_message_get(err, bg_graph_error_message);
-      printf("bg_graph_clone: error while creating edge: %s\n", bg_graph_error_message);
       return err;
     }
-    err = bg_graph_find_edge(dest, current_edge->id, &e);
-    if(err != bg_SUCCESS) {
-      fprintf(stderr, "ERROR!, setting sort option for edge: %lu\n", current_edge->id);
-    }
-    else {
-      e->ignore_for_sort = current_edge->ignore_for_sort;
-    }
   }
 
   dest->eval_order_is_dirty = true;
+  dest->inline_subgraphs = src->inline_subgraphs;
+  if(src->plan) {
+    bg_plan_compile(dest);
+  }
+  if(src->thread_pool && src->parallel_subgraphs) {
+    bg_graph_set_parallel_subgraphs(
+      dest, bg_thread_pool_get_thread_cnt(src->thread_pool));
+  } else if(src->thread_pool) {
+    bg_graph_set_parallel(dest, bg_thread_pool_get_thread_cnt(src->thread_pool),
+                          src->parallel_min_width);
+  }
 
   return bg_error_get();
 
@@ -351,16 +1049,16 @@ bg_error bg_graph_free(bg_graph_t *graph) {
   size_t i;
   bg_node_t *current_node;
   bg_edge_t *current_edge;
-  bg_node_list_t *node_list, *node_lists[3];
+  bg_node_vector_t *node_list, *node_lists[3];
   bg_edge_list_t *edge_list;
-  bg_node_list_iterator_t node_it;
+  bg_node_vector_iterator_t node_it;
   bg_edge_list_iterator_t edge_it;
   /* remove all edges */
   edge_list = graph->edge_list;
   for(current_edge = bg_edge_list_first(edge_list, &edge_it);
       current_edge; current_edge = bg_edge_list_next(&edge_it)) {
     bg_edge_deinit(current_edge);
-    free(current_edge);
+    bg_arena_free(graph->arena, current_edge, sizeof(bg_edge_t));
   }
   /* remove all nodes */
   node_lists[0] = graph->input_nodes;
@@ -368,23 +1066,38 @@ bg_error bg_graph_free(bg_graph_t *graph) {
   node_lists[2] = graph->hidden_nodes;
   for(i = 0; i < 3; ++i) {
     node_list = node_lists[i];
-    for(current_node = bg_node_list_first(node_list, &node_it);
-        current_node; current_node = bg_node_list_next(&node_it)) {
+    for(current_node = bg_node_vector_first(node_list, &node_it);
+        current_node; current_node = bg_node_vector_next(&node_it)) {
       current_node->type->deinit(current_node);
-      free((void*)(current_node->name));
-      free(current_node);
+      bg_string_table_release(graph->names, current_node->name);
+      bg_arena_free(graph->arena, current_node, sizeof(bg_node_t));
     }
   }
   /* remove input ports */
+  bg_arena_free(graph->arena, graph->input_ports,
+                graph->input_port_capacity*sizeof(input_port_t*));
   graph->input_port_cnt = 0;
   /* remove output ports */
+  bg_arena_free(graph->arena, graph->output_ports,
+                graph->output_port_capacity*sizeof(output_port_t*));
   graph->output_port_cnt = 0;
   /* free private data */
-  bg_node_list_deinit(graph->evaluation_order);
-  bg_node_list_deinit(graph->output_nodes);
-  bg_node_list_deinit(graph->input_nodes);
-  bg_node_list_deinit(graph->hidden_nodes);
+  bg_plan_free(graph->plan);
+  bg_thread_pool_free(graph->thread_pool);
+  bg_node_vector_deinit(graph->evaluation_order);
+  free(graph->order_nodes);
+  free(graph->order_slots);
+  bg_node_vector_deinit(graph->output_nodes);
+  bg_node_vector_deinit(graph->input_nodes);
+  bg_node_vector_deinit(graph->hidden_nodes);
   bg_edge_list_deinit(graph->edge_list);
+  bg_id_map_deinit(graph->node_map);
+  bg_id_map_deinit(graph->edge_map);
+  bg_name_map_deinit(graph->name_map);
+  bg_string_table_deinit(graph->names);
+  /* releases all nodes, ports, edges and names at once */
+  bg_arena_deinit(graph->arena);
+  bg_value_store_deinit(&graph->store);
   free((char*)graph->name);
   if(graph->load_path) {
     free((char*)graph->load_path);
@@ -419,22 +1132,34 @@ bg_error bg_graph_create_input(bg_graph_t *graph, const char *name,
   } else if(tmp_node != NULL) {
     return bg_error_set(bg_ERR_DUPLICATE_NODE_ID);
   }
-  if(graph->input_port_cnt+1 >= bg_MAX_PORTS) {
-    return bg_error_set(bg_ERR_NUM_PORTS_EXCEEDED);
+  err = graph_grow_input_ports(graph);
+  if(err != bg_SUCCESS) {
+    return err;
   }
-  new_node = (bg_node_t*)calloc(1, sizeof(bg_node_t));
+  new_node = (bg_node_t*)bg_arena_alloc(graph->arena, sizeof(bg_node_t));
   if(!new_node) {
     return bg_error_set(bg_ERR_NO_MEMORY);
   }
+  /* the node allocates its ports from the graph */
+  new_node->_parent_graph = graph;
   err = bg_node_init(new_node, name, input_id, bg_NODE_TYPE_INPUT);
   if(err != bg_SUCCESS) {
+    bg_string_table_release(graph->names, new_node->name);
+    bg_arena_free(graph->arena, new_node, sizeof(bg_node_t));
+    return err;
+  }
+  err = graph_index_node(graph, new_node);
+  if(err != bg_SUCCESS) {
+    new_node->type->deinit(new_node);
+    bg_string_table_release(graph->names, new_node->name);
+    bg_arena_free(graph->arena, new_node, sizeof(bg_node_t));
     return err;
   }
   graph->input_ports[graph->input_port_cnt] = new_node->input_ports[0];
   graph->input_port_cnt++;
-  new_node->_parent_graph = graph;
-  bg_node_list_append(graph->input_nodes, new_node);
-  graph->eval_order_is_dirty = true;
+  graph_update_subgraph_node(graph);
+  bg_node_vector_append(graph->input_nodes, new_node);
+  graph_order_add_node(graph, new_node);
   return bg_SUCCESS;
 }
 
@@ -448,22 +1173,34 @@ bg_error bg_graph_create_output(bg_graph_t *graph, const char *name,
   } else if(tmp_node != NULL) {
     return bg_error_set(bg_ERR_DUPLICATE_NODE_ID);
   }
-  if(graph->output_port_cnt+1 >= bg_MAX_PORTS) {
-    return bg_error_set(bg_ERR_NUM_PORTS_EXCEEDED);
+  err = graph_grow_output_ports(graph);
+  if(err != bg_SUCCESS) {
+    return err;
   }
-  new_node = (bg_node_t*)calloc(1, sizeof(bg_node_t));
+  new_node = (bg_node_t*)bg_arena_alloc(graph->arena, sizeof(bg_node_t));
   if(!new_node) {
     return bg_error_set(bg_ERR_NO_MEMORY);
   }
+  /* the node allocates its ports from the graph */
+  new_node->_parent_graph = graph;
   err = bg_node_init(new_node, name, output_id, bg_NODE_TYPE_OUTPUT);
   if(err != bg_SUCCESS) {
+    bg_string_table_release(graph->names, new_node->name);
+    bg_arena_free(graph->arena, new_node, sizeof(bg_node_t));
+    return err;
+  }
+  err = graph_index_node(graph, new_node);
+  if(err != bg_SUCCESS) {
+    new_node->type->deinit(new_node);
+    bg_string_table_release(graph->names, new_node->name);
+    bg_arena_free(graph->arena, new_node, sizeof(bg_node_t));
     return err;
   }
   graph->output_ports[graph->output_port_cnt] = new_node->output_ports[0];
   graph->output_port_cnt++;
-  new_node->_parent_graph = graph;
-  bg_node_list_append(graph->output_nodes, new_node);
-  graph->eval_order_is_dirty = true;
+  graph_update_subgraph_node(graph);
+  bg_node_vector_append(graph->output_nodes, new_node);
+  graph_order_add_node(graph, new_node);
   return bg_SUCCESS;
 }
 
@@ -477,17 +1214,27 @@ bg_error bg_graph_create_node(bg_graph_t *graph, const char *name,
   } else if(tmp_node != NULL) {
     return bg_error_set(bg_ERR_DUPLICATE_NODE_ID);
   }
-  new_node = (bg_node_t*)calloc(1, sizeof(bg_node_t));
+  new_node = (bg_node_t*)bg_arena_alloc(graph->arena, sizeof(bg_node_t));
   if(!new_node) {
     return bg_error_set(bg_ERR_NO_MEMORY);
   }
+  /* the node allocates its ports from the graph */
+  new_node->_parent_graph = graph;
   err = bg_node_init(new_node, name, node_id, nodeType);
   if(err != bg_SUCCESS) {
+    bg_string_table_release(graph->names, new_node->name);
+    bg_arena_free(graph->arena, new_node, sizeof(bg_node_t));
     return err;
   }
-  new_node->_parent_graph = graph;
-  bg_node_list_append(graph->hidden_nodes, new_node);
-  graph->eval_order_is_dirty = true;
+  err = graph_index_node(graph, new_node);
+  if(err != bg_SUCCESS) {
+    new_node->type->deinit(new_node);
+    bg_string_table_release(graph->names, new_node->name);
+    bg_arena_free(graph->arena, new_node, sizeof(bg_node_t));
+    return err;
+  }
+  bg_node_vector_append(graph->hidden_nodes, new_node);
+  graph_order_add_node(graph, new_node);
   return bg_SUCCESS;
 }
 
@@ -526,41 +1273,89 @@ bg_error bg_graph_create_edge(bg_graph_t *graph,
      (!sourceNode && !sinkNode)) {
     return bg_error_set(bg_ERR_INVALID_CONNECTION);
   }
-
-  if((sourceNode &&
-      (sourceNode->output_ports[source_port_idx]->num_edges >= bg_MAX_EDGES)) ||
-     (sinkNode &&
-      (sinkNode->input_ports[sink_port_idx]->num_edges >= bg_MAX_EDGES))) {
-    return bg_error_set(bg_ERR_PORT_FULL);
+  /* make room in the ports first so that nothing has to be undone later */
+  if(sourceNode) {
+    output_port = sourceNode->output_ports[source_port_idx];
+    err = bg_node_reserve_output_edges(sourceNode, source_port_idx,
+                                       output_port->num_edges+1);
+    if(err != bg_SUCCESS) {
+      return err;
+    }
   }
-  new_edge = (bg_edge_t*)calloc(1, sizeof(bg_edge_t));
-  new_edge->id = edge_id;
+  if(sinkNode) {
+    input_port = sinkNode->input_ports[sink_port_idx];
+    err = bg_node_reserve_input_edges(sinkNode, sink_port_idx,
+                                      input_port->num_edges+1);
+    if(err != bg_SUCCESS) {
+      return err;
+    }
+  }
+  new_edge = (bg_edge_t*)bg_arena_alloc(graph->arena, sizeof(bg_edge_t));
   if(!new_edge) {
     return bg_error_set(bg_ERR_NO_MEMORY);
   }
-  err = bg_edge_init(new_edge, sourceNode, source_port_idx,
+  new_edge->id = edge_id;
+  err = bg_edge_init(new_edge, &graph->store, sourceNode, source_port_idx,
                      sinkNode, sink_port_idx, weight);
   if(err != bg_SUCCESS) {
-    free(new_edge);
+    bg_arena_free(graph->arena, new_edge, sizeof(bg_edge_t));
     return err;
   }
+  bg_edge_set_direct(new_edge, graph->direct_edges);
+  /* edge ids need not be unique; the index refers to the oldest edge */
+  if(!bg_id_map_find(graph->edge_map, edge_id) &&
+     !bg_id_map_insert(graph->edge_map, edge_id, new_edge)) {
+    bg_edge_deinit(new_edge);
+    bg_arena_free(graph->arena, new_edge, sizeof(bg_edge_t));
+    return bg_error_set(bg_ERR_NO_MEMORY);
+  }
   if(sourceNode) {
     output_port = sourceNode->output_ports[source_port_idx];
     output_port->edges[output_port->num_edges++] = new_edge;
+    /* like a copy, the edge reads 0 until its source is evaluated */
+    if(bg_PORT_VALUE(output_port) != 0.) {
+      bg_edge_detach(new_edge);
+    }
   }
   if(sinkNode) {
     input_port = sinkNode->input_ports[sink_port_idx];
     input_port->edges[input_port->num_edges++] = new_edge;
   }
   bg_edge_list_append(graph->edge_list, new_edge);
-  graph->eval_order_is_dirty = true;
+  graph_order_add_edge(graph, new_edge);
   return bg_SUCCESS;
 }
 
+/* The ports of a sub-graph node are the ports of the sub-graph, which also
+ * hold the edges of the sub-graph itself. */
+static bool graph_owns_edge(const bg_graph_t *graph, const bg_edge_t *edge) {
+  return edge->store == &graph->store;
+}
+
+/* Whether an edge of the graph is connected to the node. */
+static bool graph_node_is_connected(const bg_graph_t *graph,
+                                    const bg_node_t *node) {
+  size_t i, j;
+  for(i = 0; i < node->input_port_cnt; ++i) {
+    for(j = 0; j < node->input_ports[i]->num_edges; ++j) {
+      if(graph_owns_edge(graph, node->input_ports[i]->edges[j])) {
+        return true;
+      }
+    }
+  }
+  for(i = 0; i < node->output_port_cnt; ++i) {
+    for(j = 0; j < node->output_ports[i]->num_edges; ++j) {
+      if(graph_owns_edge(graph, node->output_ports[i]->edges[j])) {
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
 bg_error bg_graph_remove_node(bg_graph_t *graph, bg_node_id_t node_id) {
-  bool is_connected;
   bg_error err = bg_SUCCESS;
-  bg_node_list_iterator_t it;
+  bg_node_vector_iterator_t it;
   bg_node_t *node;
   bool found;
   err = bg_graph_find_node(graph, node_id, &node);
@@ -576,20 +1371,23 @@ bg_error bg_graph_remove_node(bg_graph_t *graph, bg_node_id_t node_id) {
   if(node->_parent_graph != graph) {
     return bg_error_set(bg_ERR_DO_NOT_OWN);
   }
-  bg_node_is_connected(node, &is_connected);
-  if(is_connected) {
+  if(graph_node_is_connected(graph, node)) {
     return bg_error_set(bg_ERR_IS_CONNECTED);
   }
-  found = bg_node_list_find(graph->hidden_nodes, node, &it);
+  err = graph_unindex_node(graph, node);
+  if(err != bg_SUCCESS) {
+    return err;
+  }
+  found = bg_node_vector_find(graph->hidden_nodes, node, &it);
   assert(found);
   /* nesseccary since found is not used in release build */
   if(found) {
-    bg_node_list_erase(&it);
+    bg_node_vector_erase(&it);
   }
+  graph_order_remove_node(graph, node);
   node->type->deinit(node);
-  free((char*)node->name);
-  free(node);
-  graph->eval_order_is_dirty = true;
+  bg_string_table_release(graph->names, node->name);
+  bg_arena_free(graph->arena, node, sizeof(bg_node_t));
   return bg_SUCCESS;
 }
 
@@ -597,8 +1395,9 @@ bg_error bg_graph_remove_input(bg_graph_t *graph, bg_node_id_t input_id) {
   bool is_connected;
   bg_error err = bg_SUCCESS;
   bg_node_t *input;
-  bg_node_list_iterator_t it;
+  bg_node_vector_iterator_t it;
   bool found;
+  size_t i;
   err = bg_graph_find_node(graph, input_id, &input);
   if(err != bg_SUCCESS) {
     return err;
@@ -615,15 +1414,30 @@ bg_error bg_graph_remove_input(bg_graph_t *graph, bg_node_id_t input_id) {
   if(is_connected) {
     return bg_error_set(bg_ERR_IS_CONNECTED);
   }
-  found = bg_node_list_find(graph->input_nodes, input, &it);
+  err = graph_unindex_node(graph, input);
+  if(err != bg_SUCCESS) {
+    return err;
+  }
+  found = bg_node_vector_find(graph->input_nodes, input, &it);
   assert(found);
   /* nesseccary since found is not used in release build */
   if(found) {
-    bg_node_list_erase(&it);
+    bg_node_vector_erase(&it);
+  }
+  /* the following ports move up one index */
+  for(i = 0; i < graph->input_port_cnt; ++i) {
+    if(graph->input_ports[i] == input->input_ports[0]) {
+      memmove(graph->input_ports+i, graph->input_ports+i+1,
+              (graph->input_port_cnt-i-1)*sizeof(input_port_t*));
+      graph->input_port_cnt--;
+      break;
+    }
   }
+  graph_update_subgraph_node(graph);
+  graph_order_remove_node(graph, input);
   input->type->deinit(input);
-  free(input);
-  graph->eval_order_is_dirty = true;
+  bg_string_table_release(graph->names, input->name);
+  bg_arena_free(graph->arena, input, sizeof(bg_node_t));
   return bg_SUCCESS;
 }
 
@@ -631,8 +1445,9 @@ bg_error bg_graph_remove_output(bg_graph_t *graph, bg_node_id_t output_id) {
   bool is_connected;
   bg_error err = bg_SUCCESS;
   bg_node_t *output;
-  bg_node_list_iterator_t it;
+  bg_node_vector_iterator_t it;
   bool found;
+  size_t i;
   err = bg_graph_find_node(graph, output_id, &output);
   if(err != bg_SUCCESS) {
     return err;
@@ -649,38 +1464,71 @@ bg_error bg_graph_remove_output(bg_graph_t *graph, bg_node_id_t output_id) {
   if(is_connected) {
     return bg_error_set(bg_ERR_IS_CONNECTED);
   }
-  found = bg_node_list_find(graph->output_nodes, output, &it);
+  err = graph_unindex_node(graph, output);
+  if(err != bg_SUCCESS) {
+    return err;
+  }
+  found = bg_node_vector_find(graph->output_nodes, output, &it);
   assert(found);
   /* nesseccary since found is not used in release build */
   if(found) {
-    bg_node_list_erase(&it);
+    bg_node_vector_erase(&it);
+  }
+  /* the following ports move up one index */
+  for(i = 0; i < graph->output_port_cnt; ++i) {
+    if(graph->output_ports[i] == output->output_ports[0]) {
+      memmove(graph->output_ports+i, graph->output_ports+i+1,
+              (graph->output_port_cnt-i-1)*sizeof(output_port_t*));
+      graph->output_port_cnt--;
+      break;
+    }
   }
+  graph_update_subgraph_node(graph);
+  graph_order_remove_node(graph, output);
   output->type->deinit(output);
-  free(output);
-  graph->eval_order_is_dirty = true;
+  bg_string_table_release(graph->names, output->name);
+  bg_arena_free(graph->arena, output, sizeof(bg_node_t));
   return bg_SUCCESS;
 }
 
 bg_error bg_graph_remove_edge(bg_graph_t *graph, bg_edge_id_t edge_id) {
-  size_t i;
-  bg_edge_list_t *edge_list;
-  input_port_t *input_port;
-  output_port_t *output_port;
   bg_edge_t *edge;
-  bg_edge_list_iterator_t it;
-  bg_error err = bg_SUCCESS;
-  err = bg_graph_find_edge(graph, edge_id, &edge);
+  bg_error err = bg_graph_find_edge(graph, edge_id, &edge);
   if(err != bg_SUCCESS) {
     return err;
   } else if(edge == NULL) {
     return bg_error_set(bg_ERR_EDGE_NOT_FOUND);
   }
+  return bg_graph_remove_edge_p(graph, edge);
+}
+
+bg_error bg_graph_remove_edge_p(bg_graph_t *graph, bg_edge_t *edge) {
+  size_t i;
+  bg_edge_id_t edge_id = edge->id;
+  bg_edge_list_t *edge_list;
+  input_port_t *input_port;
+  output_port_t *output_port;
+  bg_edge_t *other;
+  bg_edge_list_iterator_t it;
   /* remove edge from edge_list */
   edge_list = graph->edge_list;
   if(!bg_edge_list_find(edge_list, edge, &it)) {
     return bg_error_set(bg_ERR_DO_NOT_OWN);
   }
   bg_edge_list_erase(&it);
+  if(bg_id_map_find(graph->edge_map, edge_id) == edge) {
+    bg_id_map_erase(graph->edge_map, edge_id);
+    /* index the next edge sharing the id, if any */
+    for(other = bg_edge_list_first(edge_list, &it);
+        other; other = bg_edge_list_next(&it)) {
+      if(other->id == edge_id) {
+        if(!bg_id_map_insert(graph->edge_map, edge_id, other)) {
+          return bg_error_set(bg_ERR_NO_MEMORY);
+        }
+        break;
+      }
+    }
+  }
   /* remove edge from source_node */
   if(edge->source_node) {
     i = 0;
@@ -711,37 +1559,83 @@ bg_error bg_graph_remove_edge(bg_graph_t *graph, bg_edge_id_t edge_id) {
       return bg_error_set(bg_ERR_UNKNOWN);
     }
   }
+  graph_order_remove_edge(graph, edge);
   /* delete edge */
   bg_edge_deinit(edge);
-  free(edge);
-  graph->eval_order_is_dirty = true;
+  bg_arena_free(graph->arena, edge, sizeof(bg_edge_t));
   return bg_SUCCESS;
 }
 
+/* Removes the edges of the graph from the list, which is reordered. */
+static bg_error graph_remove_port_edges(bg_graph_t *graph, bg_edge_t **edges,
+                                        size_t *num_edges) {
+  size_t i = 0;
+  bg_error err = bg_SUCCESS;
+  while(i < *num_edges && err == bg_SUCCESS) {
+    if(graph_owns_edge(graph, edges[i])) {
+      /* moves the last edge to i */
+      err = bg_graph_remove_edge_p(graph, edges[i]);
+    } else {
+      ++i;
+    }
+  }
+  return err;
+}
+
+bg_error bg_graph_disconnect_node(bg_graph_t *graph, bg_node_id_t node_id) {
+  size_t i;
+  bg_node_t *node;
+  bg_error err = bg_graph_find_node(graph, node_id, &node);
+  if(err != bg_SUCCESS) {
+    return err;
+  } else if(node == NULL) {
+    return bg_error_set(bg_ERR_NODE_NOT_FOUND);
+  }
+  if(node->_parent_graph != graph) {
+    return bg_error_set(bg_ERR_DO_NOT_OWN);
+  }
+  for(i = 0; i < node->input_port_cnt && err == bg_SUCCESS; ++i) {
+    err = graph_remove_port_edges(graph, node->input_ports[i]->edges,
+                                  &node->input_ports[i]->num_edges);
+  }
+  for(i = 0; i < node->output_port_cnt && err == bg_SUCCESS; ++i) {
+    err = graph_remove_port_edges(graph, node->output_ports[i]->edges,
+                                  &node->output_ports[i]->num_edges);
+  }
+  return err;
+}
+
 bg_error bg_graph_reset(bg_graph_t *graph, bool recursive) {
   bg_edge_t *current_edge;
   bg_node_t *current_node;
   bg_edge_list_iterator_t edge_it;
-  bg_node_list_iterator_t node_it;
+  bg_node_vector_iterator_t node_it;
   for(current_edge = bg_edge_list_first(graph->edge_list, &edge_it);
       current_edge; current_edge = bg_edge_list_next(&edge_it)) {
-    current_edge->value = 0.;
+    bg_EDGE_VALUE(current_edge) = 0.;
 #ifdef INTERVAL_SUPPORT
     mpfi_set_ui(current_edge->value_intv, 0);
 #endif
   }
-  for(current_node = bg_node_list_first(graph->input_nodes, &node_it);
-      current_node; current_node = bg_node_list_next(&node_it)) {
+  for(current_node = bg_node_vector_first(graph->input_nodes, &node_it);
+      current_node; current_node = bg_node_vector_next(&node_it)) {
     bg_node_reset(current_node, recursive);
   }
-  for(current_node = bg_node_list_first(graph->hidden_nodes, &node_it);
-      current_node; current_node = bg_node_list_next(&node_it)) {
+  for(current_node = bg_node_vector_first(graph->hidden_nodes, &node_it);
+      current_node; current_node = bg_node_vector_next(&node_it)) {
     bg_node_reset(current_node, recursive);
   }
-  for(current_node = bg_node_list_first(graph->output_nodes, &node_it);
-      current_node; current_node = bg_node_list_next(&node_it)) {
+  for(current_node = bg_node_vector_first(graph->output_nodes, &node_it);
+      current_node; current_node = bg_node_vector_next(&node_it)) {
     bg_node_reset(current_node, recursive);
   }
+  if(graph->plan) {
+    bg_plan_reset(graph->plan);
+  }
+  if(graph->inlined_into) {
+    /* reload the state of the sub-graph */
+    graph->inlined_into->plan_is_dirty = true;
+  }
   return bg_SUCCESS;
 }
 
@@ -751,7 +1645,47 @@ bg_error bg_graph_get_output(const bg_graph_t *graph, size_t output_port_idx,
   if(graph->output_port_cnt <= output_port_idx) {
     return bg_error_set(bg_ERR_OUT_OF_RANGE);
   }
-  *value = graph->output_ports[output_port_idx]->value;
+  *value = bg_PORT_VALUE(graph->output_ports[output_port_idx]);
+  return bg_SUCCESS;
+}
+
+bg_error bg_graph_get_input_pointer(bg_graph_t *graph, size_t input_port_idx,
+                                    bg_input_port_t **input_port) {
+  if(graph->input_port_cnt <= input_port_idx) {
+    return bg_error_set(bg_ERR_OUT_OF_RANGE);
+  }
+  *input_port = (bg_input_port_t*)graph->input_ports[input_port_idx];
+  return bg_SUCCESS;
+}
+
+bg_error bg_graph_get_output_pointer(bg_graph_t *graph,
+                                     size_t output_port_idx,
+                                     bg_output_port_t **output_port) {
+  if(graph->output_port_cnt <= output_port_idx) {
+    return bg_error_set(bg_ERR_OUT_OF_RANGE);
+  }
+  *output_port = (bg_output_port_t*)graph->output_ports[output_port_idx];
+  return bg_SUCCESS;
+}
+
+bg_error bg_graph_set_inputs(bg_graph_t *graph, const bg_real *values) {
+  size_t i;
+  bg_error err, first_err = bg_SUCCESS;
+  for(i = 0; i < graph->input_port_cnt; ++i) {
+    err = bg_input_set_value_p((bg_input_port_t*)graph->input_ports[i],
+                               values[i]);
+    if(first_err == bg_SUCCESS) {
+      first_err = err;
+    }
+  }
+  return first_err;
+}
+
+bg_error bg_graph_get_outputs(const bg_graph_t *graph, bg_real *values) {
+  size_t i;
+  for(i = 0; i < graph->output_port_cnt; ++i) {
+    values[i] = bg_PORT_VALUE(graph->output_ports[i]);
+  }
   return bg_SUCCESS;
 }
 
@@ -760,13 +1694,13 @@ bg_error bg_graph_get_node_cnt(const bg_graph_t *graph, bool recursive,
   size_t cnt = 0, subCnt = 0;
   bg_error err;
   bg_node_t *current_node;
-  bg_node_list_t *node_list;
-  bg_node_list_iterator_t node_it;
+  bg_node_vector_t *node_list;
+  bg_node_vector_iterator_t node_it;
   subgraph_data_t *subgraph_data;
 
   if(recursive) {
     node_list = graph->hidden_nodes;
-    current_node = bg_node_list_first(node_list, &node_it);
+    current_node = bg_node_vector_first(node_list, &node_it);
     while(current_node) {
       if(current_node->type->id == bg_NODE_TYPE_SUBGRAPH) {
         subgraph_data = ((subgraph_data_t*)current_node->_priv_data);
@@ -778,14 +1712,14 @@ bg_error bg_graph_get_node_cnt(const bg_graph_t *graph, bool recursive,
       } else {
         cnt++;
       }
-      current_node = bg_node_list_next(&node_it);
+      current_node = bg_node_vector_next(&node_it);
     }
   } else {
-    cnt += bg_node_list_size(graph->hidden_nodes);
+    cnt += bg_node_vector_size(graph->hidden_nodes);
   }
 
-  cnt += bg_node_list_size(graph->input_nodes);
-  cnt += bg_node_list_size(graph->output_nodes);
+  cnt += bg_node_vector_size(graph->input_nodes);
+  cnt += bg_node_vector_size(graph->output_nodes);
   *node_cnt = cnt;
   return bg_SUCCESS;
 }
@@ -794,12 +1728,12 @@ bg_error bg_graph_get_edge_cnt(const bg_graph_t *graph, bool recursive, size_t *
   size_t cnt = 0, subCnt = 0;
   bg_error err;
   bg_node_t *current_node;
-  bg_node_list_iterator_t node_it;
+  bg_node_vector_iterator_t node_it;
   subgraph_data_t *subgraph_data;
 
   if(recursive) {
-    for(current_node = bg_node_list_first(graph->hidden_nodes, &node_it);
-        current_node; current_node = bg_node_list_next(&node_it)){
+    for(current_node = bg_node_vector_first(graph->hidden_nodes, &node_it);
+        current_node; current_node = bg_node_vector_next(&node_it)){
       if(current_node->type->id == bg_NODE_TYPE_SUBGRAPH) {
         subgraph_data = ((subgraph_data_t*)current_node->_priv_data);
         err = bg_graph_get_edge_cnt(subgraph_data->subgraph, recursive, &subCnt);
@@ -819,16 +1753,16 @@ bg_error bg_graph_get_input_nodes(const bg_graph_t *graph,
                                   bg_node_id_t *input_ids, size_t *input_cnt) {
   int i, cnt;
   bg_node_t *input_node;
-  bg_node_list_t *input_nodes;
-  bg_node_list_iterator_t node_it;
+  bg_node_vector_t *input_nodes;
+  bg_node_vector_iterator_t node_it;
   input_nodes = graph->input_nodes;
-  cnt = bg_node_list_size(input_nodes);
+  cnt = bg_node_vector_size(input_nodes);
   if(!input_ids) {
     *input_cnt = cnt;
   } else {
-    for(i = 0, input_node = bg_node_list_first(input_nodes, &node_it);
+    for(i = 0, input_node = bg_node_vector_first(input_nodes, &node_it);
         i < bg_min(cnt, *input_cnt);
-        ++i, input_node = bg_node_list_next(&node_it)) {
+        ++i, input_node = bg_node_vector_next(&node_it)) {
       input_ids[i] = input_node->id;
     }
   }
@@ -839,22 +1773,44 @@ bg_error bg_graph_get_output_nodes(const bg_graph_t *graph,
                                    bg_node_id_t *output_ids, size_t *output_cnt) {
   int i, cnt;
   bg_node_t *output_node;
-  bg_node_list_t *output_nodes;
-  bg_node_list_iterator_t node_it;
+  bg_node_vector_t *output_nodes;
+  bg_node_vector_iterator_t node_it;
   output_nodes = graph->output_nodes;
-  cnt = bg_node_list_size(output_nodes);
+  cnt = bg_node_vector_size(output_nodes);
   if(!output_ids) {
     *output_cnt = cnt;
   } else {
-    for(i = 0, output_node = bg_node_list_first(output_nodes, &node_it);
+    for(i = 0, output_node = bg_node_vector_first(output_nodes, &node_it);
         i < bg_min(cnt, *output_cnt);
-        ++i, output_node = bg_node_list_next(&node_it)) {
+        ++i, output_node = bg_node_vector_next(&node_it)) {
       output_ids[i] = output_node->id;
     }
   }
   return bg_SUCCESS;
 }
 
+bg_error bg_graph_get_evaluation_order(bg_graph_t *graph,
+                                       bg_node_id_t *node_ids,
+                                       size_t *node_cnt) {
+  int i, cnt;
+  bg_node_t *node;
+  bg_node_vector_t *node_list;
+  bg_node_vector_iterator_t node_it;
+  bg_graph_update_evaluation_order(graph);
+  node_list = graph->evaluation_order;
+  cnt = bg_node_vector_size(node_list);
+  if(!node_ids) {
+    *node_cnt = cnt;
+  } else {
+    for(i = 0, node = bg_node_vector_first(node_list, &node_it);
+        i < bg_min(cnt, *node_cnt);
+        ++i, node = bg_node_vector_next(&node_it)) {
+      node_ids[i] = node->id;
+    }
+  }
+  return bg_SUCCESS;
+}
+
 
 bg_error bg_graph_get_subgraph_list_r(bg_graph_t *graph, char **path,
                                       char **graph_name, size_t *subgraph_cnt,
@@ -862,17 +1818,17 @@ bg_error bg_graph_get_subgraph_list_r(bg_graph_t *graph, char **path,
                                       bool recursive) {
   int i, cnt;
   bg_node_t *node;
-  bg_node_list_t *nodes;
-  bg_node_list_iterator_t node_it;
+  bg_node_vector_t *nodes;
+  bg_node_vector_iterator_t node_it;
   char tmp_str[255];
   subgraph_data_t *subgraph_data;
   bg_error err;
 
   nodes = graph->hidden_nodes;
-  cnt = bg_node_list_size(nodes);
+  cnt = bg_node_vector_size(nodes);
 
-  for(i = 0, node = bg_node_list_first(nodes, &node_it);
-      i < cnt; ++i, node = bg_node_list_next(&node_it)) {
+  for(i = 0, node = bg_node_vector_first(nodes, &node_it);
+      i < cnt; ++i, node = bg_node_vector_next(&node_it)) {
       if(node->type->id == bg_NODE_TYPE_SUBGRAPH) {
         subgraph_data = ((subgraph_data_t*)node->_priv_data);
         if(path && *subgraph_cnt > *index_) {
@@ -925,18 +1881,21 @@ bg_error bg_graph_set_subgraph(bg_graph_t *graph, const char *graph_name,
                                bg_graph_t *subgraph) {
   int i, cnt;
   bg_node_t *node;
-  bg_node_list_t *nodes;
-  bg_node_list_iterator_t node_it;
+  bg_node_vector_t *nodes;
+  bg_node_vector_iterator_t node_it;
   subgraph_data_t *subgraph_data;
   bg_graph_t *old_graph;
+  bg_string_table_t *names;
+  bg_edge_t **port_edges;
+  bg_real *port_scratch;
+  size_t edge_capacity, value_idx;
   bg_error err;
-  char *name_copy;
 
   nodes = graph->hidden_nodes;
-  cnt = bg_node_list_size(nodes);
+  cnt = bg_node_vector_size(nodes);
 
-  for(i = 0, node = bg_node_list_first(nodes, &node_it);
-      i < cnt; ++i, node = bg_node_list_next(&node_it)) {
+  for(i = 0, node = bg_node_vector_first(nodes, &node_it);
+      i < cnt; ++i, node = bg_node_vector_next(&node_it)) {
     if(node->type->id == bg_NODE_TYPE_SUBGRAPH) {
       subgraph_data = ((subgraph_data_t*)node->_priv_data);
       if(!strcmp(subgraph_data->subgraph->name, graph_name)) {
@@ -954,29 +1913,71 @@ bg_error bg_graph_set_subgraph(bg_graph_t *graph, const char *graph_name,
         node->output_port_cnt = subgraph_data->subgraph->output_port_cnt;
         node->input_ports = subgraph_data->subgraph->input_ports;
         node->output_ports = subgraph_data->subgraph->output_ports;
+        subgraph_data->subgraph->subgraph_node = node;
+        graph->plan_is_dirty = true;
 
+        /* the ports belong to the new sub-graph */
+        names = subgraph_data->subgraph->names;
         for(l=0; l<node->input_port_cnt; ++l) {
-          if(node->input_ports[l]->name) {
-            free((void*)node->input_ports[l]->name);
-          }
+          port_edges = node->input_ports[l]->edges;
+          port_scratch = node->input_ports[l]->scratch;
+          edge_capacity = node->input_ports[l]->edge_capacity;
+          value_idx = node->input_ports[l]->value_idx;
+          bg_string_table_release(names, node->input_ports[l]->name);
           *node->input_ports[l] = *old_graph->input_ports[l];
+          node->input_ports[l]->edges = port_edges;
+          node->input_ports[l]->scratch = port_scratch;
+          node->input_ports[l]->edge_capacity = edge_capacity;
+          node->input_ports[l]->store = &subgraph_data->subgraph->store;
+          node->input_ports[l]->value_idx = value_idx;
+          bg_PORT_VALUE(node->input_ports[l]) =
+            bg_PORT_VALUE(old_graph->input_ports[l]);
+          node->input_ports[l]->num_edges = 0;
+          err = bg_node_reserve_input_edges(node, l,
+                                            old_graph->input_ports[l]->num_edges);
+          if(err != bg_SUCCESS) {
+            return err;
+          }
+          if(old_graph->input_ports[l]->num_edges) {
+            memcpy(node->input_ports[l]->edges, old_graph->input_ports[l]->edges,
+                   old_graph->input_ports[l]->num_edges*sizeof(bg_edge_t*));
+          }
+          node->input_ports[l]->num_edges = old_graph->input_ports[l]->num_edges;
           if(old_graph->input_ports[l]->name) {
-            name_copy = malloc(strlen(old_graph->input_ports[l]->name)+1);
-            strcpy(name_copy, old_graph->input_ports[l]->name);
-            node->input_ports[l]->name = name_copy;
+            node->input_ports[l]->name =
+              bg_string_table_intern(names, old_graph->input_ports[l]->name);
           }
         }
         for(l=0; l<node->output_port_cnt; ++l) {
-          if(node->output_ports[l]->name) {
-            free((void*)node->output_ports[l]->name);
-          }
+          port_edges = node->output_ports[l]->edges;
+          edge_capacity = node->output_ports[l]->edge_capacity;
+          value_idx = node->output_ports[l]->value_idx;
+          bg_string_table_release(names, node->output_ports[l]->name);
           *node->output_ports[l] = *old_graph->output_ports[l];
+          node->output_ports[l]->edges = port_edges;
+          node->output_ports[l]->edge_capacity = edge_capacity;
+          node->output_ports[l]->store = &subgraph_data->subgraph->store;
+          node->output_ports[l]->value_idx = value_idx;
+          bg_PORT_VALUE(node->output_ports[l]) =
+            bg_PORT_VALUE(old_graph->output_ports[l]);
+          node->output_ports[l]->num_edges = 0;
+          err = bg_node_reserve_output_edges(node, l,
+                                             old_graph->output_ports[l]->num_edges);
+          if(err != bg_SUCCESS) {
+            return err;
+          }
+          if(old_graph->output_ports[l]->num_edges) {
+            memcpy(node->output_ports[l]->edges, old_graph->output_ports[l]->edges,
+                   old_graph->output_ports[l]->num_edges*sizeof(bg_edge_t*));
+          }
+          node->output_ports[l]->num_edges = old_graph->output_ports[l]->num_edges;
           if(old_graph->output_ports[l]->name) {
-            name_copy = malloc(strlen(old_graph->output_ports[l]->name)+1);
-            strcpy(name_copy, old_graph->output_ports[l]->name);
-            node->output_ports[l]->name = name_copy;
+            node->output_ports[l]->name =
+              bg_string_table_intern(names, old_graph->output_ports[l]->name);
           }
         }
+        /* direct edges read the output ports of the new sub-graph */
+        graph_update_direct_edges(node);
         err = bg_graph_free(old_graph);
         if(err != bg_SUCCESS) {
           return err;
@@ -997,22 +1998,22 @@ bg_error bg_graph_set_subgraph(bg_graph_t *graph, const char *graph_name,
 
 bg_error bg_graph_get_max_node_id(bg_graph_t *graph, size_t *max_id) {
   bg_node_t *node;
-  bg_node_list_iterator_t node_it;
+  bg_node_vector_iterator_t node_it;
   *max_id = 0;
-  for(node = bg_node_list_first(graph->input_nodes, &node_it);
-      node; node = bg_node_list_next(&node_it)) {
+  for(node = bg_node_vector_first(graph->input_nodes, &node_it);
+      node; node = bg_node_vector_next(&node_it)) {
     if(node->id > *max_id) {
       *max_id = node->id;
     }
   }
-  for(node = bg_node_list_first(graph->hidden_nodes, &node_it);
-      node; node = bg_node_list_next(&node_it)) {
+  for(node = bg_node_vector_first(graph->hidden_nodes, &node_it);
+      node; node = bg_node_vector_next(&node_it)) {
     if(node->id > *max_id) {
       *max_id = node->id;
     }
   }
-  for(node = bg_node_list_first(graph->output_nodes, &node_it);
-      node; node = bg_node_list_next(&node_it)) {
+  for(node = bg_node_vector_first(graph->output_nodes, &node_it);
+      node; node = bg_node_vector_next(&node_it)) {
     if(node->id > *max_id) {
       *max_id = node->id;
     }
@@ -1033,80 +2034,112 @@ bg_error bg_graph_get_max_edge_id(bg_graph_t *graph, size_t *max_id) {
   return bg_SUCCESS;
 }
 
+/* gives the node the next dense sort index on its first relation */
+static size_t graph_sort_index(bg_node_t *node, bg_node_t **nodes,
+                               size_t *node_cnt) {
+  if(node->order_idx == (size_t)-1) {
+    node->order_idx = (*node_cnt)++;
+    nodes[node->order_idx] = node;
+  }
+  return node->order_idx;
+}
+
 void determine_evaluation_order(bg_graph_t *graph) {
 
-  unsigned long *ids=NULL;
-  int i=0, relation_cnt=0;
-  bg_node_t *current_node, *output_node;
-  bg_node_list_t *node_list;
-  bg_node_list_t *process_list;
-  bg_node_list_iterator_t node_it, node_it2;
+  size_t i, node_cnt = 0, sorted_cnt = 0, source_idx, sink_idx;
+  size_t ignored_cnt = 0;
+  const size_t *order = NULL;
+  bg_tsort_t *ts = NULL;
+  bg_node_t **nodes;
+  bg_node_t *current_node;
+  bg_node_vector_t *node_list, *node_lists[3];
+  bg_node_vector_iterator_t node_it;
   bg_edge_t *current_edge;
   bg_edge_list_t *edge_list;
   bg_edge_list_iterator_t edge_it;
 
-  edge_list = graph->edge_list;
-  for(current_edge = bg_edge_list_first(edge_list, &edge_it);
-      current_edge; current_edge = bg_edge_list_next(&edge_it)) {
-    if(current_edge->source_node && current_edge->sink_node &&
-       !current_edge->ignore_for_sort) {
-      add_relation(current_edge->source_node->id,
-                   current_edge->sink_node->id);
-      ++relation_cnt;
+  /* the nodes by sort index, in the order of their first relation */
+  node_lists[0] = graph->input_nodes;
+  node_lists[1] = graph->hidden_nodes;
+  node_lists[2] = graph->output_nodes;
+  for(i = 0; i < 3; ++i) {
+    node_cnt += bg_node_vector_size(node_lists[i]);
+    for(current_node = bg_node_vector_first(node_lists[i], &node_it);
+        current_node; current_node = bg_node_vector_next(&node_it)) {
+      current_node->order_idx = (size_t)-1;
     }
   }
+  nodes = (bg_node_t**)malloc((node_cnt + 1) * sizeof(bg_node_t*));
+  node_cnt = 0;
 
-  bg_node_list_init(&process_list);
-  node_list = graph->input_nodes;
-  for(current_node = bg_node_list_first(node_list, &node_it);
-      current_node; current_node = bg_node_list_next(&node_it)) {
-    bg_node_list_append(process_list, current_node);
-  }
-
-  node_list = graph->hidden_nodes;
-  for(current_node = bg_node_list_first(node_list, &node_it);
-      current_node; current_node = bg_node_list_next(&node_it)) {
-    bg_node_list_append(process_list, current_node);
-  }
-
-  node_list = graph->output_nodes;
-  for(current_node = bg_node_list_first(node_list, &node_it);
-      current_node; current_node = bg_node_list_next(&node_it)) {
-    bg_node_list_append(process_list, current_node);
-  }
-
-  if(relation_cnt) {
-    tsort();
-    ids = get_sorted_ids();
+  if(nodes && bg_tsort_init(&ts)) {
+    edge_list = graph->edge_list;
+    for(current_edge = bg_edge_list_first(edge_list, &edge_it);
+        current_edge; current_edge = bg_edge_list_next(&edge_it)) {
+      if(!graph_edge_is_relation(current_edge)) {
+        if(current_edge->ignore_for_sort) {
+          ++ignored_cnt;
+        }
+        continue;
+      }
+      /* the source gets its index first, ties are broken by the indices */
+      source_idx = graph_sort_index(current_edge->source_node,
+                                    nodes, &node_cnt);
+      sink_idx = graph_sort_index(current_edge->sink_node, nodes, &node_cnt);
+      if(!bg_tsort_add_relation(ts, source_idx, sink_idx)) {
+        break;
+      }
+    }
+    if(!current_edge && bg_tsort_run(ts)) {
+      order = bg_tsort_order(ts);
+      sorted_cnt = bg_tsort_size(ts);
+    }
   }
 
   node_list = graph->evaluation_order;
-  bg_node_list_clear(node_list);
-
-  while(ids && ids[i]) {
-    for(current_node = bg_node_list_first(process_list, &node_it);
-        current_node; current_node = bg_node_list_next(&node_it)) {
-      if(current_node->id == ids[i]) {
-        bg_node_list_erase(&node_it);
-        if(current_node->type->id != bg_NODE_TYPE_INPUT && current_node->type->id != bg_NODE_TYPE_OUTPUT) {
-          bg_node_list_append(node_list, current_node);
-        }
-        break;
+  bg_node_vector_clear(node_list);
+  bg_node_vector_reserve(node_list,
+                         bg_node_vector_size(graph->hidden_nodes) +
+                         bg_node_vector_size(graph->output_nodes));
+
+  if(order) {
+    /* the sorted indices only contain nodes of this graph */
+    for(i = 0; i < sorted_cnt; ++i) {
+      current_node = nodes[order[i]];
+      if(current_node->type->id != bg_NODE_TYPE_INPUT &&
+         current_node->type->id != bg_NODE_TYPE_OUTPUT) {
+        bg_node_vector_append(node_list, current_node);
       }
     }
-    ++i;
   }
+  else {
+    /* without memory to sort, evaluate the nodes in creation order */
+    bg_error_set(bg_ERR_NO_MEMORY);
+    for(current_node = bg_node_vector_first(graph->hidden_nodes, &node_it);
+        current_node; current_node = bg_node_vector_next(&node_it)) {
+      bg_node_vector_append(node_list, current_node);
+    }
+  }
+  graph->eval_order_sorted_cnt = bg_node_vector_size(node_list);
   /* add output nodes that aren't processed yet (like unconnected outputs) */
-  for(output_node = bg_node_list_first(graph->output_nodes, &node_it);
-      output_node; output_node = bg_node_list_next(&node_it)) {
-    for(current_node = bg_node_list_first(process_list, &node_it2);
-        current_node; current_node = bg_node_list_next(&node_it2)) {
-      if(current_node == output_node) {
-        bg_node_list_erase(&node_it2);
-        bg_node_list_append(graph->evaluation_order, output_node);
-        break;
-      }
+  for(current_node = bg_node_vector_first(graph->output_nodes, &node_it);
+      current_node; current_node = bg_node_vector_next(&node_it)) {
+    if(!order || !graph_node_has_relation(current_node)) {
+      bg_node_vector_append(node_list, current_node);
     }
   }
-  bg_node_list_deinit(process_list);
+
+  /* the dense indices become positions in the order */
+  for(i = 0; i < node_cnt; ++i) {
+    nodes[i]->order_idx = (size_t)-1;
+  }
+  graph_order_renumber(graph, 0);
+  graph->eval_order_hole_cnt = 0;
+  graph->eval_order_is_maintained = order && !bg_tsort_loop_cnt(ts) &&
+    !ignored_cnt;
+
+  if(ts) {
+    bg_tsort_deinit(ts);
+  }
+  free(nodes);
 }
@@ -6,11 +6,19 @@
 
 bg_error bg_graph_find_node(bg_graph_t *graph, bg_node_id_t node_id,
                             bg_node_t **node);
+/* looks up the first len characters of name */
+bg_error bg_graph_find_node_by_name(bg_graph_t *graph, const char *name,
+                                    size_t len, bg_node_t **node);
 bg_error bg_graph_find_edge(bg_graph_t *graph, bg_edge_id_t edge_id,
                             bg_edge_t **edge);
+/* removes the given edge, unlike bg_graph_remove_edge() which removes the
+ * first edge with its id */
+bg_error bg_graph_remove_edge_p(bg_graph_t *graph, bg_edge_t *edge);
 bg_error bg_graph_get_max_node_id(bg_graph_t *graph, size_t *max_id);
 bg_error bg_graph_get_max_edge_id(bg_graph_t *graph, size_t *max_id);
 void determine_evaluation_order(bg_graph_t *graph);
+/* sorts the graph if needed, call before reading graph->evaluation_order */
+void bg_graph_update_evaluation_order(bg_graph_t *graph);
 
 
 
@@ -6,6 +6,7 @@
 #endif
 
 #include "bagel.h"
+#include "bg_value_store.h"
 #include <stdio.h> /* for debugging */
 
 #ifdef INTERVAL_SUPPORT
@@ -15,19 +16,21 @@
 #  ifndef mpfi_t
 typedef void* mpfi_t;
 #  endif
+#  ifndef mpfr_t
+typedef void* mpfr_t;
+#  endif
 #endif
 
-#define bg_MAX_EDGES 256
-#define bg_MAX_PORTS 512
-
 typedef struct input_port_t input_port_t;
 typedef struct output_port_t output_port_t;
 typedef struct node_type_t node_type_t;
 typedef struct merge_type_t merge_type_t;
 typedef struct bg_node_t bg_node_t;
+typedef struct bg_plan_t bg_plan_t;
+typedef struct bg_thread_pool_t bg_thread_pool_t;
 
 struct bg_list_t;
-struct bg_list_t;
+struct bg_vector_t;
 
 
 int bg_min(int a, int b);
@@ -36,19 +39,28 @@ struct input_port_t {
   const char *name;
   bg_real defaultValue;
   bg_real bias;
-  bg_real value;
+  /* the value is kept in the value store of the graph */
+  bg_value_store_t *store;
+  size_t value_idx;
   mpfi_t value_intv;
   merge_type_t *merge;
-  bg_edge_t *edges[bg_MAX_EDGES];
+  bg_edge_t **edges;
   size_t num_edges;
+  size_t edge_capacity;
+  /* edge_capacity values for merges that need a copy of their inputs */
+  bg_real *scratch;
 };
 
 struct output_port_t {
   const char *name;
-  bg_real value;
+  bg_value_store_t *store;
+  size_t value_idx;
+  /* edges reading this port directly that were given their own value */
+  size_t detached_cnt;
   mpfi_t value_intv;
-  bg_edge_t *edges[bg_MAX_EDGES];
+  bg_edge_t **edges;
   size_t num_edges;
+  size_t edge_capacity;
 };
 
 struct node_type_t {
@@ -62,6 +74,12 @@ struct node_type_t {
   bg_error (*eval_intv)(bg_node_t *n);
 };
 
+/* temporaries of the interval merges, set up once per graph evaluation */
+typedef struct bg_interval_scratch_t {
+  mpfi_t value, tmp;
+  mpfr_t left, right, low, high;
+} bg_interval_scratch_t;
+
 struct merge_type_t {
   bg_merge_type id;
   const char *name;
@@ -69,19 +87,61 @@ struct merge_type_t {
   bg_error (*merge_intv)(struct input_port_t *input_port);
 };
 
+/* interval merge with preinitialized temporaries, kept apart from
+ * merge_type_t so that the layout of registered type arrays stays fixed */
+typedef bg_error (*merge_intv_scratch_t)(struct input_port_t *input_port,
+                                         bg_interval_scratch_t *scratch);
+
 struct bg_graph_t {
   const char *name;
   const char *load_path;
   size_t input_port_cnt;
   size_t output_port_cnt;
-  input_port_t *input_ports[bg_MAX_PORTS];
-  output_port_t *output_ports[bg_MAX_PORTS];
+  /* the ports of the input and output nodes in creation order */
+  input_port_t **input_ports;
+  output_port_t **output_ports;
+  size_t input_port_capacity;
+  size_t output_port_capacity;
+  /* the node that uses this graph as sub-graph and shares its ports */
+  bg_node_t *subgraph_node;
   struct bg_list_t *edge_list;
-  struct bg_list_t *evaluation_order;
-  struct bg_list_t *input_nodes;
-  struct bg_list_t *output_nodes;
-  struct bg_list_t *hidden_nodes;
+  struct bg_vector_t *evaluation_order;
+  struct bg_vector_t *input_nodes;
+  struct bg_vector_t *output_nodes;
+  struct bg_vector_t *hidden_nodes;
+  /* all nodes and edges of the graph by id */
+  struct bg_map_t *node_map;
+  struct bg_map_t *edge_map;
+  /* nodes by name */
+  struct bg_map_t *name_map;
+  /* interned names of the nodes and ports */
+  struct bg_string_table_t *names;
+  /* memory of the nodes, ports, edges and names */
+  struct bg_arena_t *arena;
+  /* values of the ports and edges, weights of the edges */
+  bg_value_store_t store;
   bool eval_order_is_dirty;
+  /* the order has no loops and follows edits without a new sort */
+  bool eval_order_is_maintained;
+  /* the sorted nodes in front of the unconnected outputs, with holes */
+  size_t eval_order_sorted_cnt;
+  /* removed nodes leave NULL holes until the order is read again */
+  size_t eval_order_hole_cnt;
+  /* scratch memory of the order updates */
+  bg_node_t **order_nodes;
+  size_t *order_slots;
+  size_t order_capacity;
+  bg_plan_t *plan;
+  bool plan_is_dirty;
+  bool inline_subgraphs;
+  /* edges read the output values of their sources instead of copies */
+  bool direct_edges;
+  /* the graph whose plan evaluates this sub-graph */
+  bg_graph_t *inlined_into;
+  bg_thread_pool_t *thread_pool;
+  size_t parallel_min_width;
+  /* the pool only evaluates sub-graph nodes */
+  bool parallel_subgraphs;
   unsigned long next_id;
   unsigned long id;
 };
@@ -96,6 +156,12 @@ struct bg_node_t {
   void *_priv_data;
   bg_graph_t *_parent_graph;
   bg_node_id_t id;
+  size_t plan_slot;
+  /* position in the evaluation order of the graph or (size_t)-1, the dense
+   * index of the node while the order is determined */
+  size_t order_idx;
+  /* visited by an update of the evaluation order */
+  bool order_mark;
 };
 
 struct bg_edge_t {
@@ -103,22 +169,38 @@ struct bg_edge_t {
   size_t source_port_idx;
   bg_node_t *sink_node;
   size_t sink_port_idx;
-  bg_real weight;
-  bg_real value;
+  /* value and weight are kept in the value store of the graph */
+  bg_value_store_t *store;
+  size_t value_idx;
+  size_t weight_idx;
+  /* the slot merges read: the own value or the value of the source port */
+  bg_value_store_t *read_store;
+  size_t read_idx;
+  bool direct;
+  /* the value was set from outside and the source has not run since */
+  bool detached;
   mpfi_t value_intv;
   bg_edge_id_t id;
   unsigned long ignore_for_sort;
+  size_t plan_idx;
 };
 
 
 void bg_node_type_register(node_type_t *types);
 void bg_extern_node_type_register(node_type_t *types);
 void bg_merge_type_register(merge_type_t *types);
+/* used instead of merge_type_t::merge_intv, registering the merge type
+ * again removes it */
+void bg_merge_type_register_intv_scratch(bg_merge_type id,
+                                         merge_intv_scratch_t merge);
+/* median of cnt > 0 values, reorders the values */
+bg_real bg_merge_median(bg_real *values, size_t cnt);
 bg_error bg_error_set(bg_error err);
 
 
 extern node_type_t *node_types[bg_NUM_OF_NODE_TYPES];
 extern merge_type_t *merge_types[bg_NUM_OF_MERGE_TYPES];
+extern merge_intv_scratch_t merge_intv_scratch[bg_NUM_OF_MERGE_TYPES];
 
 extern node_type_t **extern_node_types;
 extern int num_extern_node_types;
@@ -0,0 +1,154 @@
+#include "bg_impl.h"
+#include "bg_plan.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/* The definition is a plan with inlined sub-graphs. Instances only read
+ * its ops, operands, slots and initial values, the references of the plan
+ * into the graph are dropped. */
+struct bg_definition_t {
+  bg_plan_t *plan;
+};
+
+/* the values are followed by the scratch space of the merges */
+struct bg_instance_t {
+  const bg_definition_t *definition;
+  bg_real *values;
+};
+
+bg_error bg_definition_create(bg_graph_t *graph,
+                              bg_definition_t **definition) {
+  size_t i;
+  bg_plan_t *plan;
+  bg_definition_t *def;
+  bg_error err = bg_plan_build_detached(graph, &plan);
+  if(err != bg_SUCCESS) {
+    return err;
+  }
+  for(i = 0; i < plan->op_cnt; ++i) {
+    if(plan->ops[i].kind == bg_PLAN_OP_CALL) {
+      /* extern nodes keep their state in the graph */
+      bg_plan_free(plan);
+      return bg_error_set(bg_ERR_WRONG_TYPE);
+    }
+  }
+  /* edges set from outside keep their current values */
+  for(i = 0; i < plan->extern_cnt; ++i) {
+    plan->values[plan->operands[plan->extern_operands[i]].src] =
+      bg_EDGE_VALUE(plan->extern_edges[i]);
+  }
+  /* nothing may point into the graph anymore */
+  for(i = 0; i < plan->op_cnt; ++i) {
+    plan->ops[i].ref = NULL;
+  }
+  free(plan->extern_edges);
+  free(plan->extern_operands);
+  plan->extern_edges = NULL;
+  plan->extern_operands = NULL;
+  plan->extern_cnt = 0;
+  free(plan->graphs);
+  plan->graphs = NULL;
+  plan->graph_cnt = 0;
+  def = (bg_definition_t*)calloc(1, sizeof(bg_definition_t));
+  if(!def) {
+    bg_plan_free(plan);
+    return bg_error_set(bg_ERR_NO_MEMORY);
+  }
+  def->plan = plan;
+  *definition = def;
+  return bg_SUCCESS;
+}
+
+bg_error bg_definition_free(bg_definition_t *definition) {
+  bg_plan_free(definition->plan);
+  free(definition);
+  return bg_SUCCESS;
+}
+
+bg_error bg_instance_create(const bg_definition_t *definition,
+                            bg_instance_t **instance) {
+  const bg_plan_t *plan = definition->plan;
+  bg_instance_t *inst = (bg_instance_t*)calloc(1, sizeof(bg_instance_t));
+  if(!inst) {
+    return bg_error_set(bg_ERR_NO_MEMORY);
+  }
+  inst->values = (bg_real*)malloc((plan->value_cnt + plan->max_fan_in) *
+                                  sizeof(bg_real));
+  if(!inst->values) {
+    free(inst);
+    return bg_error_set(bg_ERR_NO_MEMORY);
+  }
+  inst->definition = definition;
+  bg_instance_reset(inst);
+  *instance = inst;
+  return bg_SUCCESS;
+}
+
+bg_error bg_instance_free(bg_instance_t *instance) {
+  free(instance->values);
+  free(instance);
+  return bg_SUCCESS;
+}
+
+bg_error bg_instance_reset(bg_instance_t *instance) {
+  const bg_plan_t *plan = instance->definition->plan;
+  memcpy(instance->values, plan->values, plan->value_cnt * sizeof(bg_real));
+  return bg_SUCCESS;
+}
+
+bg_error bg_instance_set_inputs(bg_instance_t *instance,
+                                const bg_real *values) {
+  size_t i;
+  const bg_plan_t *plan = instance->definition->plan;
+  for(i = 0; i < plan->input_cnt; ++i) {
+    if(plan->input_slots[i] != bg_PLAN_NONE) {
+      instance->values[plan->input_slots[i]] = values[i];
+    }
+  }
+  return bg_SUCCESS;
+}
+
+bg_error bg_instance_set_input(bg_instance_t *instance,
+                               size_t input_port_idx, bg_real value) {
+  const bg_plan_t *plan = instance->definition->plan;
+  if(plan->input_cnt <= input_port_idx) {
+    return bg_error_set(bg_ERR_OUT_OF_RANGE);
+  }
+  if(plan->input_slots[input_port_idx] != bg_PLAN_NONE) {
+    instance->values[plan->input_slots[input_port_idx]] = value;
+  }
+  return bg_SUCCESS;
+}
+
+bg_error bg_instance_evaluate(bg_instance_t *instance) {
+  const bg_plan_t *plan = instance->definition->plan;
+  return bg_plan_execute_values(plan, instance->values,
+                                instance->values + plan->value_cnt);
+}
+
+bg_error bg_instance_get_outputs(const bg_instance_t *instance,
+                                 bg_real *values) {
+  size_t i;
+  const bg_plan_t *plan = instance->definition->plan;
+  for(i = 0; i < plan->output_cnt; ++i) {
+    values[i] = 0.;
+    if(plan->output_slots[i] != bg_PLAN_NONE) {
+      values[i] = instance->values[plan->output_slots[i]];
+    }
+  }
+  return bg_SUCCESS;
+}
+
+bg_error bg_instance_get_output(const bg_instance_t *instance,
+                                size_t output_port_idx, bg_real *value) {
+  const bg_plan_t *plan = instance->definition->plan;
+  if(plan->output_cnt <= output_port_idx) {
+    return bg_error_set(bg_ERR_OUT_OF_RANGE);
+  }
+  *value = 0.;
+  if(plan->output_slots[output_port_idx] != bg_PLAN_NONE) {
+    *value = instance->values[plan->output_slots[output_port_idx]];
+  }
+  return bg_SUCCESS;
+}
@@ -6,7 +6,7 @@
 #include "bg_graph.h"
 #include "bg_node.h"
 #include "generic_list.h"
-#include "node_list.h"
+#include "node_vector.h"
 #include <assert.h>
 #include <float.h>
 
@@ -31,7 +31,8 @@ static bg_error bg_graph_detect_inf_nan_intern(bg_graph_t *graph,
                                                bool *detected);
 static void bg_interval_get_endpoints(mpfi_t interval,
                                       bg_real *left, bg_real *right);
-static bg_error bg_interval_evaluate_node(bg_node_t *node);
+static bg_error bg_interval_evaluate_node(bg_node_t *node,
+                                          bg_interval_scratch_t *scratch);
 
 
 bg_error bg_interval_get_node_output(const bg_graph_t *graph,
@@ -105,15 +106,27 @@ bg_error bg_interval_get_edge_value(const bg_graph_t *graph,
 bg_error bg_interval_evaluate_graph(bg_graph_t *graph) {
   bg_error err = bg_SUCCESS;
   bg_node_t *current_node;
-  bg_node_list_t *node_list = graph->evaluation_order;
-  bg_node_list_iterator_t node_it;
-  if(graph->eval_order_is_dirty) {
-    determine_evaluation_order(graph);
-  }
-  for(current_node = bg_node_list_first(node_list, &node_it);
-      current_node; current_node = bg_node_list_next(&node_it)) {
-    err = bg_interval_evaluate_node(current_node);
+  bg_node_vector_t *node_list = graph->evaluation_order;
+  bg_node_vector_iterator_t node_it;
+  bg_interval_scratch_t scratch;
+  bg_graph_update_evaluation_order(graph);
+  /* the merges share these temporaries instead of creating their own */
+  mpfi_init(scratch.value);
+  mpfi_init(scratch.tmp);
+  mpfr_init(scratch.left);
+  mpfr_init(scratch.right);
+  mpfr_init(scratch.low);
+  mpfr_init(scratch.high);
+  for(current_node = bg_node_vector_first(node_list, &node_it);
+      current_node; current_node = bg_node_vector_next(&node_it)) {
+    err = bg_interval_evaluate_node(current_node, &scratch);
   }
+  mpfi_clear(scratch.value);
+  mpfi_clear(scratch.tmp);
+  mpfr_clear(scratch.left);
+  mpfr_clear(scratch.right);
+  mpfr_clear(scratch.low);
+  mpfr_clear(scratch.high);
   return err;
 }
 
@@ -493,25 +506,29 @@ static bg_error bg_interval_bisect(mpfi_t interval, BisectionMode mode,
   return bg_SUCCESS;
 }
 
-static bg_error bg_interval_evaluate_node(bg_node_t *node) {
+static bg_error bg_interval_evaluate_node(bg_node_t *node,
+                                          bg_interval_scratch_t *scratch) {
+  input_port_t *port;
   bg_error err;
   size_t i, j;
-  mpfi_t value;
-  mpfi_init(value);
   /* merge input ports */
   for(i = 0; i < node->input_port_cnt; ++i) {
-    node->input_ports[i]->merge->merge_intv(node->input_ports[i]);
+    port = node->input_ports[i];
+    if(merge_intv_scratch[port->merge->id]) {
+      merge_intv_scratch[port->merge->id](port, scratch);
+    } else {
+      port->merge->merge_intv(port);
+    }
   }
   /* evaluate nodes */
   err = node->type->eval_intv(node);
   /* write to outputs */
   for(i = 0; i < node->output_port_cnt; ++i) {
-    mpfi_set(value, node->output_ports[i]->value_intv);
+    mpfi_set(scratch->value, node->output_ports[i]->value_intv);
     for(j = 0; j < node->output_ports[i]->num_edges; ++j) {
-      mpfi_set(node->output_ports[i]->edges[j]->value_intv, value);
+      mpfi_set(node->output_ports[i]->edges[j]->value_intv, scratch->value);
     }
   }
-  mpfi_clear(value);
   return err;
 }
 
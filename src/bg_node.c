@@ -1,19 +1,79 @@
 #include "bg_node.h"
 #include "bg_impl.h"
 #include "bg_graph.h"
+#include "bg_edge.h"
 #include "node_types/bg_node_subgraph.h"
-#include "node_list.h"
+#include "node_vector.h"
+#include "bg_arena.h"
+#include "string_table.h"
 
 #include <stdlib.h>
 #include <string.h>
 
+/* Compiled plans keep a copy of the port settings. Ports of sub-graph nodes
+ * are owned by the input nodes of the sub-graph, so its plan is affected too.
+ */
+void bg_node_invalidate_plan(bg_node_t *node) {
+  subgraph_data_t *subgraph_data;
+  if(node->_parent_graph) {
+    node->_parent_graph->plan_is_dirty = true;
+  }
+  if(node->type->id == bg_NODE_TYPE_SUBGRAPH) {
+    subgraph_data = ((subgraph_data_t*)node->_priv_data);
+    if(subgraph_data && subgraph_data->subgraph) {
+      subgraph_data->subgraph->plan_is_dirty = true;
+    }
+  }
+}
+
+/* Nodes and their ports live in the arena of their graph. The ports of a
+ * sub-graph node are the ports of the sub-graph. */
+static bg_arena_t *bg_node_arena(const bg_node_t *node) {
+  return node->_parent_graph ? node->_parent_graph->arena : NULL;
+}
+
+static bg_arena_t *bg_node_port_arena(const bg_node_t *node) {
+  subgraph_data_t *subgraph_data;
+  if(node->type->id == bg_NODE_TYPE_SUBGRAPH) {
+    subgraph_data = ((subgraph_data_t*)node->_priv_data);
+    if(subgraph_data && subgraph_data->subgraph) {
+      return subgraph_data->subgraph->arena;
+    }
+  }
+  return bg_node_arena(node);
+}
+
+/* names are interned in the graph that owns the node or port */
+static bg_string_table_t *bg_node_names(const bg_node_t *node) {
+  return node->_parent_graph->names;
+}
+
+static bg_string_table_t *bg_node_port_names(const bg_node_t *node) {
+  subgraph_data_t *subgraph_data;
+  if(node->type->id == bg_NODE_TYPE_SUBGRAPH) {
+    subgraph_data = ((subgraph_data_t*)node->_priv_data);
+    if(subgraph_data && subgraph_data->subgraph) {
+      return subgraph_data->subgraph->names;
+    }
+  }
+  return bg_node_names(node);
+}
+
+/* the values of the ports are kept in the graph of the node */
+static bg_value_store_t *bg_node_store(const bg_node_t *node) {
+  return &node->_parent_graph->store;
+}
+
 bg_error bg_node_init(bg_node_t *node, const char *name, bg_node_id_t id,
                       bg_node_type type) {
-  char *name_copy = malloc(strlen(name)+1);
-  strcpy(name_copy, name);
-  node->name = name_copy;
+  node->name = bg_string_table_intern(bg_node_names(node), name);
+  if(!node->name) {
+    return bg_error_set(bg_ERR_NO_MEMORY);
+  }
   node->id = id;
   node->type = node_types[type];
+  /* not part of an evaluation order yet */
+  node->order_idx = (size_t)-1;
   return node->type->init(node);
 }
 
@@ -21,13 +81,13 @@ bg_error bg_node_reset(bg_node_t *node, bool recursive) {
   size_t i;
   subgraph_data_t *subgraph_data;
   for(i = 0; i < node->input_port_cnt; ++i) {
-    node->input_ports[i]->value = 0.;
+    bg_PORT_VALUE(node->input_ports[i]) = 0.;
 #ifdef INTERVAL_SUPPORT
     mpfi_set_ui(node->input_ports[i]->value_intv, 0);
 #endif
   }
   for(i = 0; i < node->output_port_cnt; ++i) {
-    node->output_ports[i]->value = 0.;
+    bg_PORT_VALUE(node->output_ports[i]) = 0.;
 #ifdef INTERVAL_SUPPORT
     mpfi_set_ui(node->output_ports[i]->value_intv, 0);
 #endif
@@ -42,22 +102,28 @@ bg_error bg_node_reset(bg_node_t *node, bool recursive) {
 bg_error bg_node_create_input_ports(bg_node_t *node, size_t cnt) {
   size_t i;
   char name[25];
-  char *copy_name;
   bg_error err = bg_SUCCESS;
+  bg_arena_t *arena = bg_node_arena(node);
   node->input_port_cnt = cnt;
-  node->input_ports = (input_port_t**)calloc(cnt, sizeof(input_port_t*));
+  node->input_ports = (input_port_t**)bg_arena_alloc(arena,
+                                                     cnt*sizeof(input_port_t*));
   if(node->input_ports) {
     for(i = 0; i < cnt; ++i) {
-      node->input_ports[i] = (input_port_t*)calloc(1, sizeof(input_port_t));
+      node->input_ports[i] = (input_port_t*)bg_arena_alloc(arena,
+                                                           sizeof(input_port_t));
       if(!node->input_ports[i]) {
         err = bg_error_set(bg_ERR_NO_MEMORY);
         break;
       }
-      node->input_ports[i]->value = 0.;
+      node->input_ports[i]->store = bg_node_store(node);
+      err = bg_value_store_alloc_value(node->input_ports[i]->store,
+                                       &node->input_ports[i]->value_idx);
+      if(err != bg_SUCCESS) {
+        break;
+      }
       sprintf(name, "in%lu", (unsigned long)i+1);
-      copy_name = malloc(strlen(name)+1);
-      strcpy(copy_name, name);
-      node->input_ports[i]->name = copy_name;
+      node->input_ports[i]->name = bg_string_table_intern(bg_node_names(node),
+                                                          name);
 #ifdef INTERVAL_SUPPORT
       mpfi_init_set_d(node->input_ports[i]->value_intv, 0.);
 #endif
@@ -75,21 +141,28 @@ bg_error bg_node_create_input_ports(bg_node_t *node, size_t cnt) {
 bg_error bg_node_create_output_ports(bg_node_t *node, size_t cnt) {
   size_t i;
   char name[25];
-  char *copy_name;
   bg_error err = bg_SUCCESS;
+  bg_arena_t *arena = bg_node_arena(node);
   node->output_port_cnt = cnt;
-  node->output_ports = (output_port_t**)calloc(cnt, sizeof(output_port_t*));
+  node->output_ports = (output_port_t**)bg_arena_alloc(arena,
+                                                       cnt*sizeof(output_port_t*));
   if(node->output_ports) {
     for(i = 0; i < cnt; ++i) {
-      node->output_ports[i] = (output_port_t*)calloc(1, sizeof(output_port_t));
+      node->output_ports[i] = (output_port_t*)bg_arena_alloc(arena,
+                                                             sizeof(output_port_t));
       if(!node->output_ports[i]) {
         err = bg_error_set(bg_ERR_NO_MEMORY);
         break;
       }
+      node->output_ports[i]->store = bg_node_store(node);
+      err = bg_value_store_alloc_value(node->output_ports[i]->store,
+                                       &node->output_ports[i]->value_idx);
+      if(err != bg_SUCCESS) {
+        break;
+      }
       sprintf(name, "out%lu", (unsigned long)i+1);
-      copy_name = malloc(strlen(name)+1);
-      strcpy(copy_name, name);
-      node->output_ports[i]->name = copy_name;
+      node->output_ports[i]->name = bg_string_table_intern(bg_node_names(node),
+                                                           name);
 #ifdef INTERVAL_SUPPORT
       mpfi_init_set_d(node->output_ports[i]->value_intv, 0.);
 #endif
@@ -102,36 +175,100 @@ bg_error bg_node_create_output_ports(bg_node_t *node, size_t cnt) {
 
 bg_error bg_node_remove_input_ports(bg_node_t *node) {
   size_t i;
+  bg_arena_t *arena = bg_node_arena(node);
   for(i = 0; i < node->input_port_cnt; ++i) {
 #ifdef INTERVAL_SUPPORT
     mpfi_clear(node->input_ports[i]->value_intv);
 #endif
-    if(node->input_ports[i]->name) {
-      free((void*)node->input_ports[i]->name);
-    }
-    free(node->input_ports[i]);
-  }
-  free(node->input_ports);
+    bg_value_store_free_value(node->input_ports[i]->store,
+                              node->input_ports[i]->value_idx);
+    bg_string_table_release(bg_node_names(node), node->input_ports[i]->name);
+    bg_arena_free(arena, node->input_ports[i]->edges,
+                  node->input_ports[i]->edge_capacity*sizeof(bg_edge_t*));
+    bg_arena_free(arena, node->input_ports[i]->scratch,
+                  node->input_ports[i]->edge_capacity*sizeof(bg_real));
+    bg_arena_free(arena, node->input_ports[i], sizeof(input_port_t));
+  }
+  bg_arena_free(arena, node->input_ports,
+                node->input_port_cnt*sizeof(input_port_t*));
   node->input_port_cnt = 0;
   return bg_SUCCESS;
 }
 
 bg_error bg_node_remove_output_ports(bg_node_t *node) {
   size_t i;
+  bg_arena_t *arena = bg_node_arena(node);
   for(i = 0; i < node->output_port_cnt; ++i) {
 #ifdef INTERVAL_SUPPORT
     mpfi_clear(node->output_ports[i]->value_intv);
 #endif
-    if(node->output_ports[i]->name) {
-      free((void*)node->output_ports[i]->name);
-    }
-    free(node->output_ports[i]);
-  }
-  free(node->output_ports);
+    bg_value_store_free_value(node->output_ports[i]->store,
+                              node->output_ports[i]->value_idx);
+    bg_string_table_release(bg_node_names(node), node->output_ports[i]->name);
+    bg_arena_free(arena, node->output_ports[i]->edges,
+                  node->output_ports[i]->edge_capacity*sizeof(bg_edge_t*));
+    bg_arena_free(arena, node->output_ports[i], sizeof(output_port_t));
+  }
+  bg_arena_free(arena, node->output_ports,
+                node->output_port_cnt*sizeof(output_port_t*));
   node->output_port_cnt = 0;
   return bg_SUCCESS;
 }
 
+static bg_error bg_node_reserve_edges(bg_arena_t *arena, bg_edge_t ***edges,
+                                      size_t *capacity, size_t cnt) {
+  size_t new_capacity;
+  bg_edge_t **new_edges;
+  if(cnt <= *capacity) {
+    return bg_SUCCESS;
+  }
+  new_capacity = *capacity ? *capacity : 1;
+  while(new_capacity < cnt) {
+    new_capacity *= 2;
+  }
+  new_edges = (bg_edge_t**)bg_arena_alloc(arena,
+                                          new_capacity*sizeof(bg_edge_t*));
+  if(!new_edges) {
+    return bg_error_set(bg_ERR_NO_MEMORY);
+  }
+  if(*capacity) {
+    memcpy(new_edges, *edges, *capacity*sizeof(bg_edge_t*));
+    bg_arena_free(arena, *edges, *capacity*sizeof(bg_edge_t*));
+  }
+  *edges = new_edges;
+  *capacity = new_capacity;
+  return bg_SUCCESS;
+}
+
+bg_error bg_node_reserve_input_edges(bg_node_t *node, size_t input_port_idx,
+                                     size_t cnt) {
+  bg_real *scratch;
+  bg_arena_t *arena = bg_node_port_arena(node);
+  input_port_t *input_port = node->input_ports[input_port_idx];
+  size_t capacity = input_port->edge_capacity;
+  bg_error err = bg_node_reserve_edges(arena, &input_port->edges,
+                                       &input_port->edge_capacity, cnt);
+  if(err != bg_SUCCESS || input_port->edge_capacity == capacity) {
+    return err;
+  }
+  /* the scratch space grows with the edges so that merges never allocate */
+  scratch = (bg_real*)bg_arena_alloc(arena,
+                                     input_port->edge_capacity*sizeof(bg_real));
+  if(!scratch) {
+    return bg_error_set(bg_ERR_NO_MEMORY);
+  }
+  bg_arena_free(arena, input_port->scratch, capacity*sizeof(bg_real));
+  input_port->scratch = scratch;
+  return bg_SUCCESS;
+}
+
+bg_error bg_node_reserve_output_edges(bg_node_t *node, size_t output_port_idx,
+                                      size_t cnt) {
+  output_port_t *output_port = node->output_ports[output_port_idx];
+  return bg_node_reserve_edges(bg_node_port_arena(node), &output_port->edges,
+                               &output_port->edge_capacity, cnt);
+}
+
 bg_error bg_node_set_merge(bg_graph_t *graph,
                            bg_node_id_t node_id, size_t inputPortIdx,
                            bg_merge_type mergeType,
@@ -154,22 +291,24 @@ bg_error bg_node_set_input_intern(bg_node_t *node, size_t inputPortIdx,
                                   bg_real default_value, bg_real bias,
                                   const char *name, bool clearName) {
   input_port_t *input_port;
+  const char *old_name;
   if(node->input_port_cnt <= inputPortIdx) {
     return bg_error_set(bg_ERR_OUT_OF_RANGE);
   }
   input_port = node->input_ports[inputPortIdx];
+  bg_node_invalidate_plan(node);
   input_port->merge = merge_types[mergeType];
   input_port->bias = bias;
   input_port->defaultValue = default_value;
-  if(clearName && input_port->name) {
-    free((void*)input_port->name);
+  old_name = input_port->name;
+  if(name) {
+    /* interned before the old name is released, which may be the same */
+    input_port->name = bg_string_table_intern(bg_node_port_names(node), name);
+  } else if(clearName) {
     input_port->name = 0;
   }
-  if(name) {
-    char *copy_name;
-    copy_name = malloc(strlen(name)+1);
-    strcpy(copy_name, name);
-    input_port->name = copy_name;
+  if(clearName || name) {
+    bg_string_table_release(bg_node_port_names(node), old_name);
   }
   return bg_SUCCESS;
 }
@@ -195,19 +334,20 @@ bg_error bg_node_set_input(bg_graph_t *graph,
 bg_error bg_node_set_output_intern(bg_node_t *node, size_t outputPortIdx,
                                    const char *name, bool clearName) {
   output_port_t *output_port;
+  const char *old_name;
   if(node->output_port_cnt <= outputPortIdx) {
     return bg_error_set(bg_ERR_OUT_OF_RANGE);
   }
   output_port = node->output_ports[outputPortIdx];
-  if(clearName && output_port->name) {
-    free((void*)output_port->name);
+  old_name = output_port->name;
+  if(name) {
+    /* interned before the old name is released, which may be the same */
+    output_port->name = bg_string_table_intern(bg_node_port_names(node), name);
+  } else if(clearName) {
     output_port->name = 0;
   }
-  if(name) {
-    char *copy_name;
-    copy_name = malloc(strlen(name)+1);
-    strcpy(copy_name, name);
-    output_port->name = copy_name;
+  if(clearName || name) {
+    bg_string_table_release(bg_node_port_names(node), old_name);
   }
   return bg_SUCCESS;
 }
@@ -241,6 +381,7 @@ bg_error bg_node_set_default(bg_graph_t *graph,
     return bg_error_set(bg_ERR_OUT_OF_RANGE);
   }
   node->input_ports[inputPortIdx]->defaultValue = defaultValue;
+  bg_node_invalidate_plan(node);
   return bg_SUCCESS;
 }
 
@@ -258,11 +399,14 @@ bg_error bg_node_set_bias(bg_graph_t *graph,
     return bg_error_set(bg_ERR_OUT_OF_RANGE);
   }
   node->input_ports[inputPortIdx]->bias = bias;
+  bg_node_invalidate_plan(node);
   return bg_SUCCESS;
 }
 
 bg_error bg_node_set_subgraph(bg_graph_t *graph, bg_node_id_t node_id,
                               bg_graph_t *subgraph) {
+  size_t i, j;
+  bg_edge_t *edge;
   bg_node_t *node = NULL;
   bg_error err = bg_graph_find_node(graph, node_id, &node);
   if(err != bg_SUCCESS) {
@@ -274,10 +418,19 @@ bg_error bg_node_set_subgraph(bg_graph_t *graph, bg_node_id_t node_id,
     return bg_error_set(bg_ERR_WRONG_TYPE);
   }
   ((subgraph_data_t*)node->_priv_data)->subgraph = subgraph;
+  subgraph->subgraph_node = node;
   node->input_port_cnt = subgraph->input_port_cnt;
   node->output_port_cnt = subgraph->output_port_cnt;
   node->input_ports = subgraph->input_ports;
   node->output_ports = subgraph->output_ports;
+  /* direct edges read the output ports of the new sub-graph */
+  for(i = 0; i < node->output_port_cnt; ++i) {
+    for(j = 0; j < node->output_ports[i]->num_edges; ++j) {
+      edge = node->output_ports[i]->edges[j];
+      bg_edge_set_direct(edge, edge->direct);
+    }
+  }
+  bg_node_invalidate_plan(node);
   return bg_SUCCESS;
 }
 
@@ -301,6 +454,7 @@ bg_error bg_node_set_extern(bg_graph_t *graph, bg_node_id_t node_id,
       if(strncmp(extern_node_name, extern_node_types[i]->name,
                  strlen(extern_node_types[i]->name)) == 0) {
         node->type = extern_node_types[i];
+        bg_node_invalidate_plan(node);
         return node->type->init(node);
       }
     }
@@ -322,7 +476,7 @@ bg_error bg_node_get_output(const bg_graph_t *graph,
   if(node->output_port_cnt <= outputPortIdx) {
     return bg_error_set(bg_ERR_OUT_OF_RANGE);
   }
-  *value = node->output_ports[outputPortIdx]->value;
+  *value = bg_PORT_VALUE(node->output_ports[outputPortIdx]);
   return bg_SUCCESS;
 }
 
@@ -495,6 +649,11 @@ bg_error bg_node_evaluate(bg_node_t *node) {
   bg_error err;
   size_t i, j;
   bg_real value;
+  output_port_t *output_port;
+  /* direct edges of the graph read the output ports themselves; the edges
+   * of output nodes belong to the parent graph */
+  bool copy = !node->_parent_graph || !node->_parent_graph->direct_edges ||
+    node->type->id == bg_NODE_TYPE_OUTPUT;
   /* merge input ports */
   for(i = 0; i < node->input_port_cnt; ++i) {
     node->input_ports[i]->merge->merge(node->input_ports[i]);
@@ -504,10 +663,19 @@ bg_error bg_node_evaluate(bg_node_t *node) {
   err = node->type->eval(node);
   /* write to outputs */
   for(i = 0; i < node->output_port_cnt; ++i) {
-    value = node->output_ports[i]->value;
+    output_port = node->output_ports[i];
+    value = bg_PORT_VALUE(output_port);
     /*printf("\"%s %lu:%lu\" output result: %g\n", node->name, node->id, i, value);*/
-    for(j = 0; j < node->output_ports[i]->num_edges; ++j) {
-      node->output_ports[i]->edges[j]->value = value;
+    if(copy) {
+      for(j = 0; j < output_port->num_edges; ++j) {
+        bg_EDGE_VALUE(output_port->edges[j]) = value;
+      }
+    }
+    if(output_port->detached_cnt) {
+      for(j = 0; j < output_port->num_edges; ++j) {
+        bg_edge_attach(output_port->edges[j]);
+      }
+      output_port->detached_cnt = 0;
     }
   }
   return err;
@@ -515,37 +683,13 @@ bg_error bg_node_evaluate(bg_node_t *node) {
 
 bg_error bg_node_get_id(const bg_graph_t *graph, const char *name,
                         unsigned long *id) {
-  bg_node_list_t *node_list;
-  bg_node_list_iterator_t it;
-  bg_node_t *current_node;
-  node_list = graph->input_nodes;
-  for(current_node = bg_node_list_first(node_list, &it);
-      current_node; current_node = bg_node_list_next(&it)) {
-    if(current_node->name != 0 &&
-       strcmp(current_node->name, name) == 0) {
-      *id = current_node->id;
-      return bg_SUCCESS;
-    }
-  }
-  node_list = graph->hidden_nodes;
-  for(current_node = bg_node_list_first(node_list, &it);
-      current_node; current_node = bg_node_list_next(&it)) {
-    if(current_node->name != 0 &&
-       strcmp(current_node->name, name) == 0) {
-      *id = current_node->id;
-      return bg_SUCCESS;
-    }
-  }
-  node_list = graph->output_nodes;
-  for(current_node = bg_node_list_first(node_list, &it);
-      current_node; current_node = bg_node_list_next(&it)) {
-    if(current_node->name != 0 &&
-       strcmp(current_node->name, name) == 0) {
-      *id = current_node->id;
-      return bg_SUCCESS;
-    }
+  bg_node_t *node;
+  bg_graph_find_node_by_name((bg_graph_t*)graph, name, strlen(name), &node);
+  if(node == NULL) {
+    return bg_ERR_UNKNOWN;
   }
-  return bg_ERR_UNKNOWN;
+  *id = node->id;
+  return bg_SUCCESS;
 }
 
 bg_error bg_node_get_output_idx(bg_graph_t *graph, bg_node_id_t node_id,
@@ -629,3 +773,40 @@ bg_error bg_node_get_output_name(const bg_graph_t *graph,
 
   return bg_ERR_UNKNOWN;
 }
+
+bg_error bg_node_get_output_pointer(bg_graph_t *graph, bg_node_id_t node_id,
+                                    size_t output_port_idx,
+                                    bg_output_port_t **output_port) {
+  bg_node_t *node = NULL;
+  bg_error err = bg_graph_find_node(graph, node_id, &node);
+  if(err != bg_SUCCESS) {
+    return err;
+  } else if(node == NULL) {
+    return bg_error_set(bg_ERR_NODE_NOT_FOUND);
+  }
+  if(node->output_port_cnt <= output_port_idx) {
+    return bg_error_set(bg_ERR_OUT_OF_RANGE);
+  }
+  *output_port = (bg_output_port_t*)node->output_ports[output_port_idx];
+  return bg_SUCCESS;
+}
+
+bg_error bg_input_set_value_p(bg_input_port_t *input_port, bg_real value) {
+  size_t i;
+  bg_error err = bg_ERR_EDGE_NOT_FOUND;
+  input_port_t *port = (input_port_t*)input_port;
+  /* graph inputs are fed by edges without a source node */
+  for(i = 0; i < port->num_edges; ++i) {
+    if(!port->edges[i]->source_node) {
+      bg_EDGE_VALUE(port->edges[i]) = value;
+      err = bg_SUCCESS;
+    }
+  }
+  return err;
+}
+
+bg_error bg_output_get_value_p(const bg_output_port_t *output_port,
+                               bg_real *value) {
+  *value = bg_PORT_VALUE((const output_port_t*)output_port);
+  return bg_SUCCESS;
+}
@@ -10,6 +10,11 @@ bg_error bg_node_create_input_ports(bg_node_t *node, size_t cnt);
 bg_error bg_node_create_output_ports(bg_node_t *node, size_t cnt);
 bg_error bg_node_remove_input_ports(bg_node_t *node);
 bg_error bg_node_remove_output_ports(bg_node_t *node);
+/* grows the edge array of a port to hold at least cnt edges */
+bg_error bg_node_reserve_input_edges(bg_node_t *node, size_t input_port_idx,
+                                     size_t cnt);
+bg_error bg_node_reserve_output_edges(bg_node_t *node, size_t output_port_idx,
+                                      size_t cnt);
 bg_error bg_node_is_connected(const bg_node_t *node, bool *is_connected);
 bg_error bg_node_set_input_intern(bg_node_t *node, size_t inputPortIdx,
                                   bg_merge_type mergeType,
@@ -17,6 +22,8 @@ bg_error bg_node_set_input_intern(bg_node_t *node, size_t inputPortIdx,
                                   const char *name, bool clearName);
 bg_error bg_node_set_output_intern(bg_node_t *node, size_t outputPortIdx,
                                    const char *name, bool clearName);
+/* marks the plan of the graph and of a sub-graph node as dirty */
+void bg_node_invalidate_plan(bg_node_t *node);
 bg_error bg_node_evaluate(bg_node_t *node);
 bg_error bg_node_evaluate_interval(bg_node_t *node);
 
@@ -0,0 +1,508 @@
+#include "bg_impl.h"
+#include "bg_graph.h"
+#include "bg_node.h"
+#include "node_types/bg_node_subgraph.h"
+#include "node_vector.h"
+#include "edge_list.h"
+
+#include <stdlib.h>
+#include <math.h>
+
+/**
+ * @file
+ * @brief Structural optimization of a graph.
+ *
+ * bg_graph_optimize() repeats three passes until none of them changes the
+ * graph any more:
+ *  - constant folding: builtin nodes without input edges are evaluated
+ *    once and their result is folded into the bias of the sink ports,
+ *  - pipe collapsing: PIPE nodes that only forward a weighted sum are
+ *    replaced by direct edges carrying the product of both weights,
+ *  - dead node elimination: hidden nodes that cannot reach an output node
+ *    (or an extern node) are removed together with their edges.
+ *
+ * Removing nodes and edges changes the order in which a new sort visits the
+ * nodes, and with it the edges at which loops are cut. The cuts of the
+ * first order are therefore kept by opt_pin_loops().
+ */
+
+/* all nodes of the graph sorted by id, with one mark per node */
+typedef struct opt_t {
+  bg_graph_t *graph;
+  bg_node_t **nodes;
+  unsigned char *marks;
+  bg_node_t **stack;
+  size_t node_cnt;
+  bg_edge_id_t next_edge_id;
+} opt_t;
+
+static int opt_cmp_nodes(const void *a, const void *b) {
+  bg_node_id_t id_a = (*(bg_node_t* const*)a)->id;
+  bg_node_id_t id_b = (*(bg_node_t* const*)b)->id;
+  return (id_a < id_b) ? -1 : (id_a > id_b);
+}
+
+static bg_error opt_index(opt_t *opt) {
+  size_t i, cnt = 0;
+  bg_node_t *node;
+  bg_node_vector_iterator_t it;
+  bg_node_vector_t *lists[3];
+  lists[0] = opt->graph->input_nodes;
+  lists[1] = opt->graph->hidden_nodes;
+  lists[2] = opt->graph->output_nodes;
+  for(i = 0; i < 3; ++i) {
+    cnt += bg_node_vector_size(lists[i]);
+  }
+  free(opt->nodes);
+  free(opt->marks);
+  free(opt->stack);
+  opt->nodes = (bg_node_t**)malloc(sizeof(bg_node_t*) * (cnt + 1));
+  opt->stack = (bg_node_t**)malloc(sizeof(bg_node_t*) * (cnt + 1));
+  opt->marks = (unsigned char*)calloc(cnt + 1, 1);
+  if(!opt->nodes || !opt->stack || !opt->marks) {
+    return bg_error_set(bg_ERR_NO_MEMORY);
+  }
+  opt->node_cnt = 0;
+  for(i = 0; i < 3; ++i) {
+    for(node = bg_node_vector_first(lists[i], &it);
+        node; node = bg_node_vector_next(&it)) {
+      opt->nodes[opt->node_cnt++] = node;
+    }
+  }
+  qsort(opt->nodes, opt->node_cnt, sizeof(bg_node_t*), opt_cmp_nodes);
+  return bg_SUCCESS;
+}
+
+static size_t opt_find(const opt_t *opt, const bg_node_t *node) {
+  size_t lo = 0, hi = opt->node_cnt, mid;
+  while(lo < hi) {
+    mid = lo + (hi - lo) / 2;
+    if(opt->nodes[mid]->id < node->id) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  return lo;
+}
+
+static bool opt_is_relation(const bg_edge_t *edge) {
+  return edge->source_node && edge->sink_node && !edge->ignore_for_sort &&
+    edge->source_node != edge->sink_node;
+}
+
+/* Gives a hidden node that lost all its relations back the relations to the
+ * inputs it feeds, or else the ones from the outputs it reads. Without
+ * relations it would drop out of the evaluation order. Since the node reads
+ * the previous value of every source, any place in the order will do, and
+ * relations in only one direction can't close a loop. */
+static void opt_keep_relations(bg_node_t *node) {
+  size_t i, j;
+  bg_edge_t *edge;
+  bool feeds_input = false;
+  for(i = 0; i < node->input_port_cnt; ++i) {
+    for(j = 0; j < node->input_ports[i]->num_edges; ++j) {
+      if(opt_is_relation(node->input_ports[i]->edges[j])) {
+        return;
+      }
+    }
+  }
+  for(i = 0; i < node->output_port_cnt; ++i) {
+    for(j = 0; j < node->output_ports[i]->num_edges; ++j) {
+      edge = node->output_ports[i]->edges[j];
+      if(opt_is_relation(edge)) {
+        return;
+      }
+      if(edge->sink_node && edge->sink_node->type->id == bg_NODE_TYPE_INPUT) {
+        feeds_input = true;
+      }
+    }
+  }
+  for(i = 0; i < node->output_port_cnt && feeds_input; ++i) {
+    for(j = 0; j < node->output_ports[i]->num_edges; ++j) {
+      edge = node->output_ports[i]->edges[j];
+      if(edge->sink_node && edge->sink_node->type->id == bg_NODE_TYPE_INPUT) {
+        edge->ignore_for_sort = 0;
+      }
+    }
+  }
+  for(i = 0; i < node->input_port_cnt && !feeds_input; ++i) {
+    for(j = 0; j < node->input_ports[i]->num_edges; ++j) {
+      edge = node->input_ports[i]->edges[j];
+      if(edge->source_node &&
+         edge->source_node->type->id == bg_NODE_TYPE_OUTPUT) {
+        edge->ignore_for_sort = 0;
+      }
+    }
+  }
+}
+
+/* Marks the edges that read the value of the previous evaluation as ignored
+ * for sorting and the others as relations. The sort dropped a relation only
+ * if a path of kept relations leads from its sink to its source, so every
+ * later sort keeps the sink first. Inputs come first and outputs last
+ * anyway. */
+static bg_error opt_pin_loops(opt_t *opt) {
+  size_t i, pos = 0;
+  size_t *positions;
+  bool changed = false, reads_previous;
+  bg_node_t *node;
+  bg_edge_t *edge;
+  bg_node_vector_iterator_t node_it;
+  bg_edge_list_iterator_t edge_it;
+  bg_node_vector_t *lists[3];
+  lists[0] = opt->graph->input_nodes;
+  lists[1] = opt->graph->evaluation_order;
+  lists[2] = opt->graph->output_nodes;
+  positions = (size_t*)malloc(sizeof(size_t) * (opt->node_cnt + 1));
+  if(!positions) {
+    return bg_error_set(bg_ERR_NO_MEMORY);
+  }
+  for(i = 0; i < opt->node_cnt; ++i) {
+    positions[i] = (size_t)-1;
+  }
+  /* outputs without relations are part of the evaluation order as well */
+  for(i = 0; i < 3; ++i) {
+    for(node = bg_node_vector_first(lists[i], &node_it);
+        node; node = bg_node_vector_next(&node_it)) {
+      if(positions[opt_find(opt, node)] == (size_t)-1) {
+        positions[opt_find(opt, node)] = pos++;
+      }
+    }
+  }
+  for(edge = bg_edge_list_first(opt->graph->edge_list, &edge_it);
+      edge; edge = bg_edge_list_next(&edge_it)) {
+    if(!edge->source_node || !edge->sink_node ||
+       edge->source_node == edge->sink_node) {
+      continue;
+    }
+    reads_previous = positions[opt_find(opt, edge->sink_node)] <
+      positions[opt_find(opt, edge->source_node)];
+    if(reads_previous && !edge->ignore_for_sort) {
+      edge->ignore_for_sort = 1;
+      changed = true;
+    } else if(!reads_previous && edge->ignore_for_sort) {
+      edge->ignore_for_sort = 0;
+      changed = true;
+    }
+  }
+  if(changed) {
+    for(node = bg_node_vector_first(lists[1], &node_it);
+        node; node = bg_node_vector_next(&node_it)) {
+      if(node->type->id != bg_NODE_TYPE_OUTPUT) {
+        opt_keep_relations(node);
+      }
+    }
+    opt->graph->eval_order_is_dirty = true;
+  }
+  free(positions);
+  return bg_SUCCESS;
+}
+
+static bool opt_is_builtin(const bg_node_t *node) {
+  return (node->type->id != bg_NODE_TYPE_SUBGRAPH &&
+          node->type->id != bg_NODE_TYPE_EXTERN &&
+          node->type->id != bg_NODE_TYPE_INPUT &&
+          node->type->id != bg_NODE_TYPE_OUTPUT &&
+          node->type == node_types[node->type->id]);
+}
+
+static bool opt_has_input_edges(const bg_node_t *node) {
+  size_t i;
+  for(i = 0; i < node->input_port_cnt; ++i) {
+    if(node->input_ports[i]->num_edges) {
+      return true;
+    }
+  }
+  return false;
+}
+
+/* Folds the constant value * weight of one edge into the bias of its sink
+ * port. Returns false if the merge of the port cannot absorb it. */
+static bool opt_fold_edge(bg_graph_t *graph, bg_edge_t *edge, bg_real value,
+                          bg_error *err) {
+  bg_node_t *sink = edge->sink_node;
+  size_t port_idx = edge->sink_port_idx;
+  input_port_t *port;
+  bg_real v, bias, default_value;
+  if(!sink || edge->ignore_for_sort) {
+    return false;
+  }
+  port = sink->input_ports[port_idx];
+  v = value * bg_EDGE_WEIGHT(edge);
+  bias = port->bias;
+  default_value = port->defaultValue;
+  switch(port->merge->id) {
+  case bg_MERGE_TYPE_SUM:
+    bias += v;
+    default_value = 0.;
+    break;
+  case bg_MERGE_TYPE_PRODUCT:
+    bias *= v;
+    default_value = 1.;
+    break;
+  case bg_MERGE_TYPE_MIN:
+    bias = (v < bias) ? v : bias;
+    default_value = bias;
+    break;
+  case bg_MERGE_TYPE_MAX:
+    bias = (v > bias) ? v : bias;
+    default_value = bias;
+    break;
+  case bg_MERGE_TYPE_NORM:
+    bias = sqrt(bias * bias + v * v);
+    default_value = 0.;
+    break;
+  default:
+    return false;
+  }
+  if(port->num_edges > 1) {
+    /* the default is only used once the port has no edges left */
+    default_value = port->defaultValue;
+  }
+  *err = bg_graph_remove_edge_p(graph, edge);
+  if(*err == bg_SUCCESS) {
+    *err = bg_node_set_bias(graph, sink->id, port_idx, bias);
+  }
+  if(*err == bg_SUCCESS) {
+    *err = bg_node_set_default(graph, sink->id, port_idx, default_value);
+  }
+  return true;
+}
+
+static bg_error opt_fold_constants(opt_t *opt, bool *changed) {
+  size_t i, j, k;
+  bg_node_t *node;
+  output_port_t *port;
+  bg_error err = bg_SUCCESS;
+  for(i = 0; i < opt->node_cnt && err == bg_SUCCESS; ++i) {
+    node = opt->nodes[i];
+    if(!opt_is_builtin(node) || opt_has_input_edges(node)) {
+      continue;
+    }
+    err = bg_node_evaluate(node);
+    for(j = 0; j < node->output_port_cnt && err == bg_SUCCESS; ++j) {
+      port = node->output_ports[j];
+      /* removing an edge moves the last one into its place */
+      for(k = port->num_edges; k > 0 && err == bg_SUCCESS; --k) {
+        if(opt_fold_edge(opt->graph, port->edges[k-1], bg_PORT_VALUE(port), &err)) {
+          *changed = true;
+        }
+      }
+    }
+  }
+  return err;
+}
+
+/* Whether node can reach itself. */
+static bool opt_is_on_cycle(opt_t *opt, bg_node_t *node) {
+  size_t i, j, idx, stack_cnt = 0, visited_cnt = 0;
+  bool found = false;
+  bg_node_t *current, *sink;
+  output_port_t *port;
+  opt->stack[stack_cnt++] = node;
+  while(stack_cnt && !found) {
+    current = opt->stack[--stack_cnt];
+    for(i = 0; i < current->output_port_cnt && !found; ++i) {
+      port = current->output_ports[i];
+      for(j = 0; j < port->num_edges; ++j) {
+        sink = port->edges[j]->sink_node;
+        if(!sink) {
+          continue;
+        }
+        if(sink == node) {
+          found = true;
+          break;
+        }
+        idx = opt_find(opt, sink);
+        if(!opt->marks[idx]) {
+          opt->marks[idx] = 1;
+          opt->stack[stack_cnt++] = sink;
+          ++visited_cnt;
+        }
+      }
+    }
+  }
+  if(visited_cnt) {
+    for(i = 0; i < opt->node_cnt; ++i) {
+      opt->marks[i] = 0;
+    }
+  }
+  return found;
+}
+
+static bool opt_can_collapse(opt_t *opt, bg_node_t *node) {
+  size_t i;
+  bg_edge_t *edge;
+  input_port_t *in = node->input_ports[0];
+  output_port_t *out = node->output_ports[0];
+  input_port_t *sink_port;
+  if(node->type->id != bg_NODE_TYPE_PIPE || !opt_is_builtin(node) ||
+     in->merge->id != bg_MERGE_TYPE_SUM || in->bias != 0. ||
+     in->num_edges == 0 || out->num_edges == 0) {
+    return false;
+  }
+  for(i = 0; i < in->num_edges; ++i) {
+    edge = in->edges[i];
+    /* external edges are referenced by id from outside of the graph */
+    if(!edge->source_node || edge->ignore_for_sort) {
+      return false;
+    }
+  }
+  for(i = 0; i < out->num_edges; ++i) {
+    edge = out->edges[i];
+    if(!edge->sink_node || edge->ignore_for_sort) {
+      return false;
+    }
+    sink_port = edge->sink_node->input_ports[edge->sink_port_idx];
+    if(sink_port->merge->id == bg_MERGE_TYPE_WEIGHTED_SUM) {
+      return false;
+    }
+    /* only a sum can take the inputs of the pipe one by one */
+    if(in->num_edges > 1 && sink_port->merge->id != bg_MERGE_TYPE_SUM) {
+      return false;
+    }
+  }
+  /* a cycle would be broken up at another edge without the pipe */
+  return !opt_is_on_cycle(opt, node);
+}
+
+static bg_error opt_collapse_pipes(opt_t *opt, bool *changed) {
+  size_t i, j, k;
+  bg_node_t *node;
+  bg_edge_t *in_edge, *out_edge;
+  input_port_t *in;
+  output_port_t *out;
+  bg_error err = bg_SUCCESS;
+  for(i = 0; i < opt->node_cnt && err == bg_SUCCESS; ++i) {
+    node = opt->nodes[i];
+    if(!opt_can_collapse(opt, node)) {
+      continue;
+    }
+    in = node->input_ports[0];
+    out = node->output_ports[0];
+    for(j = 0; j < in->num_edges && err == bg_SUCCESS; ++j) {
+      in_edge = in->edges[j];
+      for(k = 0; k < out->num_edges && err == bg_SUCCESS; ++k) {
+        out_edge = out->edges[k];
+        err = bg_graph_create_edge(opt->graph, in_edge->source_node->id,
+                                   in_edge->source_port_idx,
+                                   out_edge->sink_node->id,
+                                   out_edge->sink_port_idx,
+                                   bg_EDGE_WEIGHT(in_edge) * bg_EDGE_WEIGHT(out_edge),
+                                   opt->next_edge_id++);
+      }
+    }
+    if(err == bg_SUCCESS) {
+      /* the now unconnected pipe is removed as a dead node */
+      err = bg_graph_disconnect_node(opt->graph, node->id);
+      *changed = true;
+    }
+  }
+  return err;
+}
+
+static bg_error opt_remove_dead_nodes(opt_t *opt, bool *changed) {
+  size_t i, j, k, idx, stack_cnt = 0;
+  bg_node_t *node, *source;
+  input_port_t *port;
+  bg_error err = bg_SUCCESS;
+  /* everything that feeds an output or an extern node is alive */
+  for(i = 0; i < opt->node_cnt; ++i) {
+    node = opt->nodes[i];
+    if(node->type->id == bg_NODE_TYPE_OUTPUT ||
+       node->type->id == bg_NODE_TYPE_INPUT ||
+       node->type->id == bg_NODE_TYPE_EXTERN) {
+      opt->marks[i] = 1;
+      opt->stack[stack_cnt++] = node;
+    }
+  }
+  while(stack_cnt) {
+    node = opt->stack[--stack_cnt];
+    for(j = 0; j < node->input_port_cnt; ++j) {
+      port = node->input_ports[j];
+      for(k = 0; k < port->num_edges; ++k) {
+        source = port->edges[k]->source_node;
+        if(!source) {
+          continue;
+        }
+        idx = opt_find(opt, source);
+        if(!opt->marks[idx]) {
+          opt->marks[idx] = 1;
+          opt->stack[stack_cnt++] = source;
+        }
+      }
+    }
+  }
+  for(i = 0; i < opt->node_cnt && err == bg_SUCCESS; ++i) {
+    if(opt->marks[i]) {
+      opt->marks[i] = 0;
+      continue;
+    }
+    err = bg_graph_disconnect_node(opt->graph, opt->nodes[i]->id);
+    if(err == bg_SUCCESS) {
+      err = bg_graph_remove_node(opt->graph, opt->nodes[i]->id);
+      *changed = true;
+    }
+  }
+  return err;
+}
+
+static bg_error opt_optimize(bg_graph_t *graph, bool recursive) {
+  opt_t opt;
+  bool changed = true;
+  size_t max_edge_id;
+  bg_node_t *node;
+  bg_node_vector_iterator_t it;
+  bg_graph_t *subgraph;
+  bg_error err = bg_SUCCESS;
+  if(recursive) {
+    for(node = bg_node_vector_first(graph->hidden_nodes, &it);
+        node && err == bg_SUCCESS; node = bg_node_vector_next(&it)) {
+      if(node->type->id == bg_NODE_TYPE_SUBGRAPH) {
+        subgraph = ((subgraph_data_t*)node->_priv_data)->subgraph;
+        if(subgraph) {
+          err = opt_optimize(subgraph, recursive);
+        }
+      }
+    }
+    if(err != bg_SUCCESS) {
+      return err;
+    }
+  }
+  bg_graph_get_max_edge_id(graph, &max_edge_id);
+  opt.graph = graph;
+  opt.nodes = NULL;
+  opt.node_cnt = 0;
+  opt.marks = NULL;
+  opt.stack = NULL;
+  opt.next_edge_id = max_edge_id + 1;
+  bg_graph_update_evaluation_order(graph);
+  err = opt_index(&opt);
+  if(err == bg_SUCCESS) {
+    err = opt_pin_loops(&opt);
+  }
+  while(changed && err == bg_SUCCESS) {
+    changed = false;
+    /* feedback edges are only known after sorting */
+    bg_graph_update_evaluation_order(graph);
+    err = opt_index(&opt);
+    if(err == bg_SUCCESS) {
+      err = opt_fold_constants(&opt, &changed);
+    }
+    if(err == bg_SUCCESS) {
+      err = opt_collapse_pipes(&opt, &changed);
+    }
+    if(err == bg_SUCCESS) {
+      err = opt_remove_dead_nodes(&opt, &changed);
+    }
+  }
+  free(opt.nodes);
+  free(opt.marks);
+  free(opt.stack);
+  return err;
+}
+
+bg_error bg_graph_optimize(bg_graph_t *graph, bool recursive) {
+  return opt_optimize(graph, recursive);
+}
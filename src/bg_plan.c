@@ -0,0 +1,1822 @@
+#include "bg_plan.h"
+
+#include "bg_thread_pool.h"
+#include "bg_graph.h"
+#include "bg_node.h"
+#include "bg_edge.h"
+#include "node_types/bg_node_subgraph.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "node_vector.h"
+#include "edge_list.h"
+
+
+/* Nodes that the interpreter evaluates itself. Everything else (subgraphs,
+ * extern nodes) is called through the generic bg_node_evaluate(). */
+static bool plan_is_builtin(const bg_node_t *node) {
+  return (node->type->id != bg_NODE_TYPE_SUBGRAPH &&
+          node->type->id != bg_NODE_TYPE_EXTERN &&
+          node->type == node_types[node->type->id] &&
+          node->output_port_cnt == 1);
+}
+
+/* Input and output nodes only pass their merged input on. Their output
+ * shares the value slot of the input. */
+static bool plan_is_pass_through(const bg_node_t *node) {
+  return ((node->type->id == bg_NODE_TYPE_INPUT ||
+           node->type->id == bg_NODE_TYPE_OUTPUT) &&
+          node->type == node_types[node->type->id]);
+}
+
+/* Sub-graph nodes whose nodes are part of this plan. */
+static bool plan_is_inlined(const bg_plan_t *plan, const bg_node_t *node) {
+  return (plan->inline_subgraphs &&
+          node->type->id == bg_NODE_TYPE_SUBGRAPH &&
+          ((subgraph_data_t*)node->_priv_data)->subgraph);
+}
+
+static bg_graph_t *plan_get_subgraph(const bg_node_t *node) {
+  return ((subgraph_data_t*)node->_priv_data)->subgraph;
+}
+
+/* Calls that only touch a sub-graph of their own. */
+static bool plan_is_subgraph_call(const bg_plan_t *plan,
+                                  const plan_group_t *group) {
+  const plan_op_t *op = plan->ops + group->begin;
+  return (op->kind == bg_PLAN_OP_CALL &&
+          ((const bg_node_t*)op->ref)->type->id == bg_NODE_TYPE_SUBGRAPH);
+}
+
+/* Detached plans keep the first slots of the nodes in a hash table of
+ * their own instead of bg_node_t::plan_slot, so that building them doesn't
+ * write to the graph. Open addressing with linear probing on the node
+ * addresses. */
+static size_t plan_slot_hash(const plan_slot_map_t *map,
+                             const bg_node_t *node) {
+  return (((size_t)node >> 4) * 2654435761UL) & (map->capacity - 1);
+}
+
+static bool plan_slot_map_grow(plan_slot_map_t *map) {
+  size_t i, j, capacity = map->capacity ? map->capacity * 2 : 64;
+  const bg_node_t **nodes;
+  size_t *slots;
+  nodes = (const bg_node_t**)calloc(capacity, sizeof(bg_node_t*));
+  slots = (size_t*)malloc(capacity * sizeof(size_t));
+  if(!nodes || !slots) {
+    free(nodes);
+    free(slots);
+    return false;
+  }
+  for(i = 0; i < map->capacity; ++i) {
+    if(!map->nodes[i]) {
+      continue;
+    }
+    j = (((size_t)map->nodes[i] >> 4) * 2654435761UL) & (capacity - 1);
+    while(nodes[j]) {
+      j = (j + 1) & (capacity - 1);
+    }
+    nodes[j] = map->nodes[i];
+    slots[j] = map->slots[i];
+  }
+  free(map->nodes);
+  free(map->slots);
+  map->nodes = nodes;
+  map->slots = slots;
+  map->capacity = capacity;
+  return true;
+}
+
+static bg_error plan_set_slot(bg_plan_t *plan, bg_node_t *node, size_t slot) {
+  size_t i;
+  plan_slot_map_t *map = plan->slot_map;
+  if(!map) {
+    node->plan_slot = slot;
+    return bg_SUCCESS;
+  }
+  /* at most half full */
+  if(2 * (map->cnt + 1) > map->capacity && !plan_slot_map_grow(map)) {
+    return bg_error_set(bg_ERR_NO_MEMORY);
+  }
+  i = plan_slot_hash(map, node);
+  while(map->nodes[i] && map->nodes[i] != node) {
+    i = (i + 1) & (map->capacity - 1);
+  }
+  if(!map->nodes[i]) {
+    map->nodes[i] = node;
+    map->cnt++;
+  }
+  map->slots[i] = slot;
+  return bg_SUCCESS;
+}
+
+/* The first value slot of a node, or of the port slots of an inlined
+ * sub-graph node. */
+static size_t plan_slot(const bg_plan_t *plan, const bg_node_t *node) {
+  size_t i;
+  const plan_slot_map_t *map = plan->slot_map;
+  if(!map) {
+    return node->plan_slot;
+  }
+  i = plan_slot_hash(map, node);
+  while(map->nodes[i] != node) {
+    i = (i + 1) & (map->capacity - 1);
+  }
+  return map->slots[i];
+}
+
+/* The value slot that holds the given output of a node. */
+static size_t plan_output_slot(const bg_plan_t *plan, const bg_node_t *node,
+                               size_t output_port_idx) {
+  if(plan_is_inlined(plan, node)) {
+    return plan->port_slots[plan_slot(plan, node) + output_port_idx];
+  } else if(plan_is_pass_through(node)) {
+    return plan_slot(plan, node);
+  }
+  return plan_slot(plan, node) + node->input_port_cnt + output_port_idx;
+}
+
+/* An edge is internal if its value can be read from an output slot of this
+ * plan. All other edges are gathered from bg_edge_t::value before a run.
+ * The input ports of an inlined sub-graph are fed by its parent graph. */
+static bool plan_is_internal(const bg_graph_t *graph, const bg_graph_t *parent,
+                             const bg_edge_t *edge) {
+  return (edge->source_node &&
+          (edge->source_node->_parent_graph == graph ||
+           (parent && edge->source_node->_parent_graph == parent)));
+}
+
+static size_t plan_source_slot(const bg_plan_t *plan, const bg_edge_t *edge) {
+  return plan_output_slot(plan, edge->source_node, edge->source_port_idx);
+}
+
+static void plan_get_lists(bg_graph_t *graph, bg_node_vector_t *lists[3]) {
+  /* first input nodes, then hidden nodes, and last output nodes */
+  lists[0] = graph->input_nodes;
+  lists[1] = graph->evaluation_order;
+  lists[2] = graph->output_nodes;
+}
+
+void bg_plan_free(bg_plan_t *plan) {
+  if(!plan) {
+    return;
+  }
+  free(plan->ops);
+  free(plan->operands);
+  free(plan->values);
+  free(plan->extern_edges);
+  free(plan->extern_operands);
+  free(plan->scratch);
+  free(plan->input_slots);
+  free(plan->output_slots);
+  free(plan->lanes);
+  free(plan->groups);
+  free(plan->dirty);
+  free(plan->reader_offsets);
+  free(plan->readers);
+  free(plan->writers);
+  free(plan->overrides);
+  free(plan->old_outputs);
+  free(plan->level_groups);
+  free(plan->levels);
+  free(plan->group_levels);
+  free(plan->thread_scratch);
+  free(plan->call_groups);
+  free(plan->port_slots);
+  free(plan->operand_groups);
+  free(plan->graphs);
+  if(plan->slot_map) {
+    free(plan->slot_map->nodes);
+    free(plan->slot_map->slots);
+    free(plan->slot_map);
+  }
+  free(plan);
+}
+
+void bg_plan_reset(bg_plan_t *plan) {
+  size_t i;
+  for(i = 0; i < plan->value_cnt; ++i) {
+    plan->values[i] = 0.;
+  }
+  for(i = 0; i < plan->group_cnt; ++i) {
+    plan->dirty[i] = 1;
+  }
+}
+
+/* Calls the visitor for every value slot that is read by the given group. */
+static void plan_visit_reads(bg_plan_t *plan, size_t group_idx,
+                             void (*visit)(bg_plan_t*, size_t, size_t)) {
+  size_t j, k;
+  const plan_op_t *op;
+  const plan_group_t *group = plan->groups + group_idx;
+  const bg_node_t *node;
+  const bg_edge_t *edge;
+  for(op = plan->ops + group->begin; op != plan->ops + group->end; ++op) {
+    if(op->kind == bg_PLAN_OP_MERGE) {
+      for(j = 0; j < op->cnt; ++j) {
+        visit(plan, plan->operands[op->src + j].src, group_idx);
+      }
+    } else if(op->kind == bg_PLAN_OP_CALL) {
+      node = (const bg_node_t*)op->ref;
+      for(j = 0; j < node->input_port_cnt; ++j) {
+        for(k = 0; k < node->input_ports[j]->num_edges; ++k) {
+          edge = node->input_ports[j]->edges[k];
+          if(plan_is_internal(node->_parent_graph, NULL, edge)) {
+            visit(plan, plan_source_slot(plan, edge), group_idx);
+          }
+        }
+      }
+    }
+  }
+}
+
+static void plan_count_reader(bg_plan_t *plan, size_t slot,
+                              size_t group_idx) {
+  ++plan->reader_offsets[slot + 1];
+  (void)group_idx;
+}
+
+static void plan_add_reader(bg_plan_t *plan, size_t slot, size_t group_idx) {
+  plan->readers[plan->reader_offsets[slot]++] = group_idx;
+}
+
+/* Builds the lists of groups that have to be evaluated again when a value
+ * slot changes. */
+static bg_error plan_compute_readers(bg_plan_t *plan) {
+  size_t i;
+  plan->reader_offsets = (size_t*)calloc(plan->value_cnt + 1, sizeof(size_t));
+  if(!plan->reader_offsets) {
+    return bg_error_set(bg_ERR_NO_MEMORY);
+  }
+  for(i = 0; i < plan->group_cnt; ++i) {
+    plan_visit_reads(plan, i, plan_count_reader);
+  }
+  for(i = 0; i < plan->value_cnt; ++i) {
+    plan->reader_offsets[i + 1] += plan->reader_offsets[i];
+  }
+  plan->readers = (size_t*)calloc(plan->reader_offsets[plan->value_cnt] + 1,
+                                  sizeof(size_t));
+  if(!plan->readers) {
+    return bg_error_set(bg_ERR_NO_MEMORY);
+  }
+  for(i = 0; i < plan->group_cnt; ++i) {
+    plan_visit_reads(plan, i, plan_add_reader);
+  }
+  /* adding moved every offset to the start of the next slot */
+  for(i = plan->value_cnt; i > 0; --i) {
+    plan->reader_offsets[i] = plan->reader_offsets[i - 1];
+  }
+  plan->reader_offsets[0] = 0;
+  return bg_SUCCESS;
+}
+
+/* Looks up the group that writes every value slot. */
+static bg_error plan_compute_writers(bg_plan_t *plan) {
+  size_t i, j;
+  const plan_op_t *op;
+  plan->writers = (size_t*)malloc((plan->value_cnt + 1) * sizeof(size_t));
+  if(!plan->writers) {
+    return bg_error_set(bg_ERR_NO_MEMORY);
+  }
+  for(i = 0; i <= plan->value_cnt; ++i) {
+    plan->writers[i] = bg_PLAN_NONE;
+  }
+  for(i = 0; i < plan->group_cnt; ++i) {
+    for(op = plan->ops + plan->groups[i].begin;
+        op != plan->ops + plan->groups[i].end; ++op) {
+      if(op->kind == bg_PLAN_OP_CALL) {
+        for(j = 0; j < op->cnt; ++j) {
+          plan->writers[op->dst + j] = i;
+        }
+      } else {
+        plan->writers[op->dst] = i;
+      }
+    }
+  }
+  return bg_SUCCESS;
+}
+
+/* Assigns every group the first level after all groups it depends on. Two
+ * groups depend on each other if one of them writes a value slot that the
+ * other one reads or writes. Looking at the slots instead of the edges also
+ * orders the groups along edges that are ignored for sorting, so that every
+ * node reads the same values as in the serial evaluation. Calls share one
+ * virtual slot since extern nodes may have state in common, except for the
+ * sub-graph calls of a plan with concurrent sub-graphs. */
+static bg_error plan_compute_levels(bg_plan_t *plan) {
+  size_t i, j, k, level, slot;
+  size_t call_slot = plan->value_cnt;
+  size_t *read_level, *write_level, *group_level;
+  const plan_op_t *op;
+  const bg_node_t *node;
+  const bg_edge_t *edge;
+  plan_group_t *groups;
+
+  read_level = (size_t*)calloc(plan->value_cnt + 1, sizeof(size_t));
+  write_level = (size_t*)calloc(plan->value_cnt + 1, sizeof(size_t));
+  group_level = (size_t*)calloc(plan->group_cnt + 1, sizeof(size_t));
+  groups = (plan_group_t*)calloc(plan->group_cnt + 1, sizeof(plan_group_t));
+  if(!read_level || !write_level || !group_level || !groups) {
+    free(read_level);
+    free(write_level);
+    free(group_level);
+    free(groups);
+    return bg_error_set(bg_ERR_NO_MEMORY);
+  }
+
+  plan->level_cnt = 0;
+  for(i = 0; i < plan->group_cnt; ++i) {
+    /* find the level */
+    level = 0;
+    for(op = plan->ops + plan->groups[i].begin;
+        op != plan->ops + plan->groups[i].end; ++op) {
+      switch(op->kind) {
+      case bg_PLAN_OP_MERGE:
+        for(j = 0; j < op->cnt; ++j) {
+          slot = plan->operands[op->src + j].src;
+          if(write_level[slot] > level) level = write_level[slot];
+        }
+        if(write_level[op->dst] > level) level = write_level[op->dst];
+        if(read_level[op->dst] > level) level = read_level[op->dst];
+        break;
+      case bg_PLAN_OP_EVAL:
+        if(write_level[op->dst] > level) level = write_level[op->dst];
+        if(read_level[op->dst] > level) level = read_level[op->dst];
+        break;
+      case bg_PLAN_OP_CALL:
+        node = (const bg_node_t*)op->ref;
+        for(j = 0; j < node->input_port_cnt; ++j) {
+          for(k = 0; k < node->input_ports[j]->num_edges; ++k) {
+            edge = node->input_ports[j]->edges[k];
+            if(plan_is_internal(node->_parent_graph, NULL, edge)) {
+              slot = plan_source_slot(plan, edge);
+              if(write_level[slot] > level) level = write_level[slot];
+            }
+          }
+        }
+        for(j = 0; j < op->cnt; ++j) {
+          slot = op->dst + j;
+          if(write_level[slot] > level) level = write_level[slot];
+          if(read_level[slot] > level) level = read_level[slot];
+        }
+        if((!plan->concurrent_subgraphs ||
+            node->type->id != bg_NODE_TYPE_SUBGRAPH) &&
+           write_level[call_slot] > level) {
+          level = write_level[call_slot];
+        }
+        break;
+      }
+    }
+    ++level;
+    group_level[i] = level;
+    if(level > plan->level_cnt) {
+      plan->level_cnt = level;
+    }
+    /* mark the slots */
+    for(op = plan->ops + plan->groups[i].begin;
+        op != plan->ops + plan->groups[i].end; ++op) {
+      switch(op->kind) {
+      case bg_PLAN_OP_MERGE:
+        for(j = 0; j < op->cnt; ++j) {
+          slot = plan->operands[op->src + j].src;
+          if(read_level[slot] < level) read_level[slot] = level;
+        }
+        write_level[op->dst] = level;
+        break;
+      case bg_PLAN_OP_EVAL:
+        write_level[op->dst] = level;
+        break;
+      case bg_PLAN_OP_CALL:
+        node = (const bg_node_t*)op->ref;
+        for(j = 0; j < node->input_port_cnt; ++j) {
+          for(k = 0; k < node->input_ports[j]->num_edges; ++k) {
+            edge = node->input_ports[j]->edges[k];
+            if(plan_is_internal(node->_parent_graph, NULL, edge)) {
+              slot = plan_source_slot(plan, edge);
+              if(read_level[slot] < level) read_level[slot] = level;
+            }
+          }
+        }
+        for(j = 0; j < op->cnt; ++j) {
+          write_level[op->dst + j] = level;
+        }
+        if(!plan->concurrent_subgraphs ||
+           node->type->id != bg_NODE_TYPE_SUBGRAPH) {
+          write_level[call_slot] = level;
+        }
+        break;
+      }
+    }
+  }
+
+  /* sort the groups by level, keeping the serial order within a level */
+  plan->levels = (size_t*)calloc(plan->level_cnt + 1, sizeof(size_t));
+  if(!plan->levels) {
+    free(read_level);
+    free(write_level);
+    free(group_level);
+    free(groups);
+    return bg_error_set(bg_ERR_NO_MEMORY);
+  }
+  for(i = 0; i < plan->group_cnt; ++i) {
+    ++plan->levels[group_level[i]];
+  }
+  /* turn the counts into offsets */
+  for(i = 1; i <= plan->level_cnt; ++i) {
+    plan->levels[i] += plan->levels[i - 1];
+  }
+  for(i = 0; i < plan->group_cnt; ++i) {
+    groups[plan->levels[group_level[i] - 1]++] = plan->groups[i];
+  }
+  for(i = plan->level_cnt; i > 0; --i) {
+    plan->levels[i] = plan->levels[i - 1];
+  }
+  plan->levels[0] = 0;
+
+  plan->level_groups = groups;
+  /* keep the levels of the groups counting from 0 */
+  for(i = 0; i < plan->group_cnt; ++i) {
+    --group_level[i];
+  }
+  plan->group_levels = group_level;
+  free(read_level);
+  free(write_level);
+  return bg_SUCCESS;
+}
+
+/* Sizes of the plan, collected before it is allocated. */
+typedef struct plan_size_t {
+  size_t values;
+  size_t ops;
+  size_t operands;
+  size_t externs;
+  size_t groups;
+  size_t ports;
+  size_t graphs;
+  size_t max_edges;
+  size_t max_outputs;
+} plan_size_t;
+
+/* Assigns the value slots of all nodes of the graph and of its inlined
+ * sub-graphs. Sub-graphs that are not inlined get a plan of their own. */
+static bg_error plan_prepare(bg_plan_t *plan, bg_graph_t *graph,
+                             plan_size_t *size) {
+  size_t i;
+  bg_error err;
+  bg_node_t *node;
+  bg_edge_t *edge;
+  bg_graph_t *subgraph;
+  bg_node_vector_t *lists[3];
+  bg_node_vector_iterator_t node_it;
+  bg_edge_list_iterator_t edge_it;
+
+  bg_graph_update_evaluation_order(graph);
+  /* the operands of detached plans can't be patched */
+  for(edge = bg_edge_list_first(graph->edge_list, &edge_it);
+      edge && !plan->slot_map; edge = bg_edge_list_next(&edge_it)) {
+    edge->plan_idx = bg_PLAN_NONE;
+  }
+
+  /* inputs of a node followed by its outputs */
+  lists[0] = graph->input_nodes;
+  lists[1] = graph->hidden_nodes;
+  lists[2] = graph->output_nodes;
+  for(i = 0; i < 3; ++i) {
+    for(node = bg_node_vector_first(lists[i], &node_it);
+        node; node = bg_node_vector_next(&node_it)) {
+      if(node->type->id == bg_NODE_TYPE_SUBGRAPH &&
+         plan_get_subgraph(node)) {
+        subgraph = plan_get_subgraph(node);
+        if(plan->inline_subgraphs) {
+          err = plan_set_slot(plan, node, size->ports);
+          if(err != bg_SUCCESS) {
+            return err;
+          }
+          size->ports += node->output_port_cnt;
+          size->graphs++;
+          err = plan_prepare(plan, subgraph, size);
+          if(err != bg_SUCCESS) {
+            return err;
+          }
+          continue;
+        }
+        if(!subgraph->plan || subgraph->plan_is_dirty ||
+           bg_plan_is_stale(subgraph->plan)) {
+          err = bg_plan_compile(subgraph);
+          if(err != bg_SUCCESS) {
+            return err;
+          }
+        }
+      }
+      err = plan_set_slot(plan, node, size->values);
+      if(err != bg_SUCCESS) {
+        return err;
+      }
+      size->values += node->input_port_cnt;
+      if(!plan_is_pass_through(node)) {
+        size->values += node->output_port_cnt;
+      }
+    }
+  }
+  return bg_SUCCESS;
+}
+
+/* Counts instructions and operands in evaluation order. */
+static void plan_count(const bg_plan_t *plan, bg_graph_t *graph,
+                       const bg_graph_t *parent, plan_size_t *size) {
+  size_t i, j, k;
+  bg_node_t *node;
+  input_port_t *input_port;
+  bg_node_vector_t *lists[3];
+  bg_node_vector_iterator_t node_it;
+
+  plan_get_lists(graph, lists);
+  for(i = 0; i < 3; ++i) {
+    for(node = bg_node_vector_first(lists[i], &node_it);
+        node; node = bg_node_vector_next(&node_it)) {
+      if(plan_is_inlined(plan, node)) {
+        plan_count(plan, plan_get_subgraph(node), graph, size);
+        continue;
+      }
+      size->groups++;
+      if(node->output_port_cnt > size->max_outputs) {
+        size->max_outputs = node->output_port_cnt;
+      }
+      if(!plan_is_builtin(node)) {
+        size->ops++;
+        continue;
+      }
+      size->ops += node->input_port_cnt;
+      if(!plan_is_pass_through(node)) {
+        size->ops++;
+      }
+      for(j = 0; j < node->input_port_cnt; ++j) {
+        input_port = node->input_ports[j];
+        size->operands += input_port->num_edges;
+        if(input_port->num_edges > size->max_edges) {
+          size->max_edges = input_port->num_edges;
+        }
+        for(k = 0; k < input_port->num_edges; ++k) {
+          if(!plan_is_internal(graph, parent, input_port->edges[k])) {
+            size->externs++;
+          }
+        }
+      }
+    }
+  }
+}
+
+/* Looks up the output nodes behind the outputs of inlined sub-graph nodes
+ * and collects the inlined graphs. */
+static void plan_link_ports(bg_plan_t *plan, bg_graph_t *graph) {
+  size_t i;
+  bg_node_t *node, *output;
+  bg_graph_t *subgraph;
+  bg_node_vector_iterator_t node_it, output_it;
+
+  for(node = bg_node_vector_first(graph->hidden_nodes, &node_it);
+      node; node = bg_node_vector_next(&node_it)) {
+    if(!plan_is_inlined(plan, node)) {
+      continue;
+    }
+    subgraph = plan_get_subgraph(node);
+    plan->graphs[plan->graph_cnt++] = subgraph;
+    plan_link_ports(plan, subgraph);
+    for(i = 0; i < node->output_port_cnt; ++i) {
+      /* an output without node stays zero */
+      plan->port_slots[plan_slot(plan, node) + i] = plan->value_cnt;
+      for(output = bg_node_vector_first(subgraph->output_nodes, &output_it);
+          output; output = bg_node_vector_next(&output_it)) {
+        if(output->output_ports[0] == subgraph->output_ports[i]) {
+          plan->port_slots[plan_slot(plan, node) + i] =
+            plan_output_slot(plan, output, 0);
+          break;
+        }
+      }
+    }
+  }
+}
+
+/* Emits the instructions of the graph and of its inlined sub-graphs in
+ * evaluation order. Every node becomes one group. */
+static void plan_emit(bg_plan_t *plan, bg_graph_t *graph,
+                      const bg_graph_t *parent, size_t extern_base) {
+  size_t i, j, k, l;
+  plan_op_t *op;
+  plan_group_t *group;
+  bg_node_t *node;
+  bg_edge_t *edge;
+  input_port_t *input_port;
+  bg_node_vector_t *lists[3];
+  bg_node_vector_iterator_t node_it;
+
+  plan_get_lists(graph, lists);
+  for(i = 0; i < 3; ++i) {
+    for(node = bg_node_vector_first(lists[i], &node_it);
+        node; node = bg_node_vector_next(&node_it)) {
+      if(plan_is_inlined(plan, node)) {
+        plan_emit(plan, plan_get_subgraph(node), graph, extern_base);
+        continue;
+      }
+      group = plan->groups + plan->group_cnt;
+      group->begin = plan->op_cnt;
+      op = plan->ops + plan->op_cnt;
+      if(!plan_is_builtin(node)) {
+        op->kind = bg_PLAN_OP_CALL;
+        op->dst = plan_slot(plan, node) + node->input_port_cnt;
+        op->cnt = node->output_port_cnt;
+        op->ref = node;
+        ++op;
+      } else {
+        for(j = 0; j < node->input_port_cnt; ++j) {
+          input_port = node->input_ports[j];
+          op->kind = bg_PLAN_OP_MERGE;
+          op->type = (unsigned char)input_port->merge->id;
+          op->dst = plan_slot(plan, node) + j;
+          op->src = plan->operand_cnt;
+          op->cnt = input_port->num_edges;
+          op->bias = input_port->bias;
+          op->default_value = input_port->defaultValue;
+          for(k = 0; k < input_port->num_edges; ++k) {
+            edge = input_port->edges[k];
+            l = plan->operand_cnt++;
+            plan->operands[l].weight = bg_EDGE_WEIGHT(edge);
+            plan->operand_groups[l] = plan->group_cnt;
+            if(plan_is_internal(graph, parent, edge)) {
+              plan->operands[l].src = plan_source_slot(plan, edge);
+              if(!plan->slot_map) {
+                edge->plan_idx = l;
+              }
+            } else {
+              plan->operands[l].src = extern_base + plan->extern_cnt;
+              plan->extern_edges[plan->extern_cnt] = edge;
+              plan->extern_operands[plan->extern_cnt] = l;
+              plan->extern_cnt++;
+            }
+          }
+          ++op;
+        }
+        if(plan_is_pass_through(node)) {
+          /* the merge writes the output */
+          (op - 1)->ref = node->output_ports[0];
+        } else {
+          op->kind = bg_PLAN_OP_EVAL;
+          op->type = (unsigned char)node->type->id;
+          op->src = plan_slot(plan, node);
+          op->dst = op->src + node->input_port_cnt;
+          op->cnt = 1;
+          op->ref = node->output_ports[0];
+          ++op;
+        }
+      }
+      plan->op_cnt = op - plan->ops;
+      group->end = plan->op_cnt;
+      group->out = plan_output_slot(plan, node, 0);
+      group->out_cnt = node->output_port_cnt;
+      plan->dirty[plan->group_cnt++] = 1;
+    }
+    if(i == 0 && !parent) {
+      plan->input_op_cnt = plan->op_cnt;
+    }
+  }
+}
+
+/* Carries over the current state of the graph. */
+static void plan_load_state(bg_plan_t *plan, bg_graph_t *graph) {
+  size_t i, j;
+  bg_node_t *node;
+  bg_node_vector_t *lists[3];
+  bg_node_vector_iterator_t node_it;
+
+  lists[0] = graph->input_nodes;
+  lists[1] = graph->hidden_nodes;
+  lists[2] = graph->output_nodes;
+  for(i = 0; i < 3; ++i) {
+    for(node = bg_node_vector_first(lists[i], &node_it);
+        node; node = bg_node_vector_next(&node_it)) {
+      if(plan_is_inlined(plan, node)) {
+        plan_load_state(plan, plan_get_subgraph(node));
+        continue;
+      }
+      for(j = 0; j < node->input_port_cnt; ++j) {
+        plan->values[plan_slot(plan, node) + j] =
+          bg_PORT_VALUE(node->input_ports[j]);
+      }
+      for(j = 0; j < node->output_port_cnt; ++j) {
+        plan->values[plan_output_slot(plan, node, j)] =
+          bg_PORT_VALUE(node->output_ports[j]);
+      }
+    }
+  }
+}
+
+/* Lets a detached edge read its own value until its source is evaluated
+ * again. An operand that is read before its source runs is pointed to an
+ * override slot holding the value; the later operands and the calls read
+ * the source slot and the edge itself. */
+static bg_error plan_add_override(bg_plan_t *plan, bg_edge_t *edge,
+                                  bg_real value) {
+  size_t i, group, operand = edge->plan_idx;
+  plan_override_t *override;
+  const bg_node_t *sink = edge->sink_node;
+
+  if(plan->slot_map) {
+    return bg_SUCCESS;
+  }
+  for(i = 0; i < plan->override_cnt; ++i) {
+    override = plan->overrides + i;
+    if(override->edge == edge) {
+      if(override->src != bg_PLAN_NONE) {
+        plan->values[plan->override_base + operand] = value;
+        plan->dirty[plan->operand_groups[operand]] = 1;
+      }
+      return bg_SUCCESS;
+    }
+  }
+  /* extern edges are gathered anyway */
+  if(operand == bg_PLAN_NONE &&
+     (!sink || plan_is_builtin(sink) || plan_is_inlined(plan, sink) ||
+      !plan_is_internal(sink->_parent_graph, NULL, edge))) {
+    return bg_SUCCESS;
+  }
+  group = plan->writers[plan_source_slot(plan, edge)];
+  if(group == bg_PLAN_NONE) {
+    return bg_SUCCESS;
+  }
+  if(plan->override_cnt == plan->override_capacity) {
+    i = plan->override_capacity ? 2 * plan->override_capacity : 8;
+    override = (plan_override_t*)realloc(plan->overrides,
+                                         i * sizeof(plan_override_t));
+    if(!override) {
+      return bg_error_set(bg_ERR_NO_MEMORY);
+    }
+    plan->overrides = override;
+    plan->override_capacity = i;
+  }
+  override = plan->overrides + plan->override_cnt++;
+  override->edge = edge;
+  override->operand = operand;
+  override->src = bg_PLAN_NONE;
+  override->group = group;
+  if(operand != bg_PLAN_NONE && group >= plan->operand_groups[operand]) {
+    override->src = plan->operands[operand].src;
+    plan->operands[operand].src = plan->override_base + operand;
+    plan->values[plan->override_base + operand] = value;
+    plan->dirty[plan->operand_groups[operand]] = 1;
+  }
+  return bg_SUCCESS;
+}
+
+/* Carries over the edges that were given a value of their own. */
+static bg_error plan_load_overrides(bg_plan_t *plan, bg_graph_t *graph) {
+  size_t i, j, k;
+  bg_error err;
+  bg_node_t *node;
+  bg_edge_t *edge;
+  bg_node_vector_t *lists[3];
+  bg_node_vector_iterator_t node_it;
+
+  plan_get_lists(graph, lists);
+  for(i = 0; i < 3; ++i) {
+    for(node = bg_node_vector_first(lists[i], &node_it);
+        node; node = bg_node_vector_next(&node_it)) {
+      if(plan_is_inlined(plan, node)) {
+        err = plan_load_overrides(plan, plan_get_subgraph(node));
+        if(err != bg_SUCCESS) {
+          return err;
+        }
+        continue;
+      }
+      for(j = 0; j < node->input_port_cnt; ++j) {
+        for(k = 0; k < node->input_ports[j]->num_edges; ++k) {
+          edge = node->input_ports[j]->edges[k];
+          /* the input ports of a sub-graph also hold edges of the parent */
+          if(edge->detached &&
+             (edge->plan_idx != bg_PLAN_NONE || edge->sink_node == node)) {
+            err = plan_add_override(plan, edge, bg_EDGE_VALUE(edge));
+            if(err != bg_SUCCESS) {
+              return err;
+            }
+          }
+        }
+      }
+    }
+  }
+  return bg_SUCCESS;
+}
+
+static bg_error plan_build(bg_graph_t *graph, bool inline_subgraphs,
+                           bool detached, bg_plan_t **new_plan) {
+  size_t i;
+  bg_error err;
+  bg_plan_t *plan;
+  bg_node_t *node;
+  bg_node_vector_iterator_t node_it;
+  plan_size_t size;
+
+  plan = (bg_plan_t*)calloc(1, sizeof(bg_plan_t));
+  if(!plan) {
+    return bg_error_set(bg_ERR_NO_MEMORY);
+  }
+  plan->inline_subgraphs = inline_subgraphs;
+  plan->concurrent_subgraphs = graph->parallel_subgraphs;
+  if(detached) {
+    plan->slot_map = (plan_slot_map_t*)calloc(1, sizeof(plan_slot_map_t));
+    if(!plan->slot_map) {
+      bg_plan_free(plan);
+      return bg_error_set(bg_ERR_NO_MEMORY);
+    }
+  }
+
+  memset(&size, 0, sizeof(size));
+  size.max_edges = 1;
+  size.max_outputs = 1;
+  err = plan_prepare(plan, graph, &size);
+  if(err != bg_SUCCESS) {
+    bg_plan_free(plan);
+    return err;
+  }
+  plan_count(plan, graph, NULL, &size);
+
+  plan->ops = (plan_op_t*)calloc(size.ops + 1, sizeof(plan_op_t));
+  plan->operands = (plan_operand_t*)calloc(size.operands + 1,
+                                           sizeof(plan_operand_t));
+  plan->operand_groups = (size_t*)calloc(size.operands + 1, sizeof(size_t));
+  /* one more value for outputs of sub-graphs that have no node, followed
+   * by the values of the extern edges and of the overridden operands */
+  plan->values = (bg_real*)calloc(size.values + 1 + size.externs +
+                                  size.operands, sizeof(bg_real));
+  plan->extern_edges = (bg_edge_t**)calloc(size.externs + 1,
+                                           sizeof(bg_edge_t*));
+  plan->extern_operands = (size_t*)calloc(size.externs + 1, sizeof(size_t));
+  plan->scratch = (bg_real*)calloc(size.max_edges, sizeof(bg_real));
+  plan->input_slots = (size_t*)calloc(graph->input_port_cnt + 1,
+                                      sizeof(size_t));
+  plan->output_slots = (size_t*)calloc(graph->output_port_cnt + 1,
+                                       sizeof(size_t));
+  plan->groups = (plan_group_t*)calloc(size.groups + 1, sizeof(plan_group_t));
+  plan->dirty = (unsigned char*)calloc(size.groups + 1,
+                                       sizeof(unsigned char));
+  plan->old_outputs = (bg_real*)calloc(size.max_outputs, sizeof(bg_real));
+  plan->port_slots = (size_t*)calloc(size.ports + 1, sizeof(size_t));
+  plan->graphs = (bg_graph_t**)calloc(size.graphs + 1, sizeof(bg_graph_t*));
+  if(!plan->ops || !plan->operands || !plan->operand_groups ||
+     !plan->values || !plan->extern_edges || !plan->extern_operands ||
+     !plan->scratch || !plan->input_slots || !plan->output_slots ||
+     !plan->groups || !plan->dirty || !plan->old_outputs ||
+     !plan->port_slots || !plan->graphs) {
+    bg_plan_free(plan);
+    return bg_error_set(bg_ERR_NO_MEMORY);
+  }
+  plan->max_fan_in = size.max_edges;
+  plan->value_cnt = size.values;
+  plan_link_ports(plan, graph);
+  plan_emit(plan, graph, NULL, size.values + 1);
+  plan->override_base = size.values + 1 + size.externs;
+  plan->value_cnt = plan->override_base + size.operands;
+
+  /* locate the graph inputs and outputs */
+  plan->input_cnt = graph->input_port_cnt;
+  for(i = 0; i < plan->input_cnt; ++i) {
+    plan->input_slots[i] = bg_PLAN_NONE;
+    for(node = bg_node_vector_first(graph->input_nodes, &node_it);
+        node; node = bg_node_vector_next(&node_it)) {
+      if(node->input_ports[0] == graph->input_ports[i]) {
+        plan->input_slots[i] = plan_slot(plan, node);
+        break;
+      }
+    }
+  }
+  plan->output_cnt = graph->output_port_cnt;
+  for(i = 0; i < plan->output_cnt; ++i) {
+    plan->output_slots[i] = bg_PLAN_NONE;
+    for(node = bg_node_vector_first(graph->output_nodes, &node_it);
+        node; node = bg_node_vector_next(&node_it)) {
+      if(node->output_ports[0] == graph->output_ports[i]) {
+        plan->output_slots[i] = plan_output_slot(plan, node, 0);
+        break;
+      }
+    }
+  }
+  plan_load_state(plan, graph);
+
+  err = plan_compute_readers(plan);
+  if(err == bg_SUCCESS) {
+    err = plan_compute_writers(plan);
+  }
+  if(err == bg_SUCCESS) {
+    err = plan_compute_levels(plan);
+  }
+  /* after the levels, which have to follow the source slots */
+  if(err == bg_SUCCESS) {
+    err = plan_load_overrides(plan, graph);
+  }
+  if(err != bg_SUCCESS) {
+    bg_plan_free(plan);
+    return err;
+  }
+  *new_plan = plan;
+  return bg_SUCCESS;
+}
+
+bg_error bg_plan_build(bg_graph_t *graph, bool inline_subgraphs,
+                       bg_plan_t **plan) {
+  return plan_build(graph, inline_subgraphs, false, plan);
+}
+
+bg_error bg_plan_build_detached(bg_graph_t *graph, bg_plan_t **plan) {
+  return plan_build(graph, true, true, plan);
+}
+
+bg_error bg_plan_compile(bg_graph_t *graph) {
+  size_t i;
+  bg_plan_t *plan;
+  bg_error err = bg_plan_build(graph, graph->inline_subgraphs, &plan);
+  if(err != bg_SUCCESS) {
+    return err;
+  }
+  /* inlined sub-graphs are evaluated through this plan only */
+  for(i = 0; i < plan->graph_cnt; ++i) {
+    bg_plan_free(plan->graphs[i]->plan);
+    plan->graphs[i]->plan = NULL;
+    plan->graphs[i]->plan_is_dirty = false;
+    plan->graphs[i]->inlined_into = graph;
+  }
+  graph->inlined_into = NULL;
+  bg_plan_free(graph->plan);
+  graph->plan = plan;
+  graph->plan_is_dirty = false;
+  return bg_SUCCESS;
+}
+
+bool bg_plan_is_stale(const bg_plan_t *plan) {
+  size_t i;
+  for(i = 0; i < plan->graph_cnt; ++i) {
+    if(plan->graphs[i]->plan_is_dirty || plan->graphs[i]->eval_order_is_dirty) {
+      return true;
+    }
+  }
+  return false;
+}
+
+
+/* The merges mirror the ones in merge_types/bg_merge_basic.c operation by
+ * operation so that a compiled graph produces bit-identical results. */
+static bg_real plan_merge(const plan_op_t *op, const plan_operand_t *operands,
+                          const bg_real *values, bg_real *scratch) {
+  size_t i, cnt;
+  bg_real value, tmp, sum_weights;
+  const plan_operand_t *operand = operands + op->src;
+
+  switch(op->type) {
+  case bg_MERGE_TYPE_SUM:
+    value = op->bias;
+    if(op->cnt == 0) {
+      value += op->default_value;
+    } else {
+      for(i = 0; i < op->cnt; ++i) {
+        value += values[operand[i].src] * operand[i].weight;
+      }
+    }
+    return value;
+  case bg_MERGE_TYPE_WEIGHTED_SUM:
+    value = 0.0;
+    sum_weights = 0.0;
+    if(op->cnt == 0) {
+      value += op->default_value;
+      sum_weights = 1.0;
+    } else {
+      for(i = 0; i < op->cnt; ++i) {
+        value += values[operand[i].src] * operand[i].weight;
+        sum_weights += fabs(operand[i].weight);
+      }
+    }
+    if(sum_weights > bg_EPSILON) {
+      return (value / sum_weights) + op->bias;
+    }
+    return op->bias;
+  case bg_MERGE_TYPE_PRODUCT:
+    value = op->bias;
+    if(op->cnt == 0) {
+      value *= op->default_value;
+    } else {
+      for(i = 0; i < op->cnt; ++i) {
+        value *= values[operand[i].src] * operand[i].weight;
+      }
+    }
+    return value;
+  case bg_MERGE_TYPE_MIN:
+    value = op->bias;
+    if(op->cnt == 0) {
+      if(op->default_value < value) {
+        value = op->default_value;
+      }
+    } else {
+      for(i = 0; i < op->cnt; ++i) {
+        if(values[operand[i].src] * operand[i].weight < value) {
+          value = values[operand[i].src] * operand[i].weight;
+        }
+      }
+    }
+    return value;
+  case bg_MERGE_TYPE_MAX:
+    value = op->bias;
+    if(op->cnt == 0) {
+      if(op->default_value > value) {
+        value = op->default_value;
+      }
+    } else {
+      for(i = 0; i < op->cnt; ++i) {
+        if(values[operand[i].src] * operand[i].weight > value) {
+          value = values[operand[i].src] * operand[i].weight;
+        }
+      }
+    }
+    return value;
+  case bg_MERGE_TYPE_MEDIAN:
+    cnt = (op->cnt ? op->cnt : 1);
+    if(op->cnt == 0) {
+      scratch[0] = op->default_value;
+    } else {
+      for(i = 0; i < op->cnt; ++i) {
+        scratch[i] = values[operand[i].src] * operand[i].weight;
+      }
+    }
+    return bg_merge_median(scratch, cnt) + op->bias;
+  case bg_MERGE_TYPE_MEAN:
+    value = 0.0;
+    cnt = 1;
+    if(op->cnt == 0) {
+      value += op->default_value;
+    } else {
+      for(i = 0; i < op->cnt; ++i) {
+        value += values[operand[i].src] * operand[i].weight;
+      }
+      cnt = op->cnt;
+    }
+    return (value / cnt) + op->bias;
+  case bg_MERGE_TYPE_NORM:
+    value = op->bias * op->bias;
+    if(op->cnt == 0) {
+      tmp = op->default_value;
+      value += tmp * tmp;
+    }
+    for(i = 0; i < op->cnt; ++i) {
+      tmp = values[operand[i].src] * operand[i].weight;
+      value += tmp * tmp;
+    }
+    return sqrt(value);
+  default:
+    return 0.;
+  }
+}
+
+/* The node kernels mirror node_types/bg_node_atomic.c and
+ * node_types/bg_node_ports.c. */
+static bg_real plan_eval(unsigned char type, const bg_real *in) {
+  /* taken as in the rtneat */
+  const bg_real slope = 4.924273;
+  switch(type) {
+  case bg_NODE_TYPE_INPUT:
+  case bg_NODE_TYPE_OUTPUT:
+  case bg_NODE_TYPE_PIPE:
+    return in[0];
+  case bg_NODE_TYPE_DIVIDE:
+    return 1. / in[0];
+  case bg_NODE_TYPE_SIN:
+    return sin(in[0]);
+  case bg_NODE_TYPE_ASIN:
+    return asin(in[0]);
+  case bg_NODE_TYPE_COS:
+    return cos(in[0]);
+  case bg_NODE_TYPE_TAN:
+    return tan(in[0]);
+  case bg_NODE_TYPE_ACOS:
+    return acos(in[0]);
+  case bg_NODE_TYPE_ATAN2:
+    return atan2(in[0], in[1]);
+  case bg_NODE_TYPE_POW:
+    return pow(in[0], in[1]);
+  case bg_NODE_TYPE_MOD:
+    return fmod(in[0], in[1]);
+  case bg_NODE_TYPE_ABS:
+    return fabs(in[0]);
+  case bg_NODE_TYPE_SQRT:
+    return sqrt(in[0]);
+  case bg_NODE_TYPE_FSIGMOID:
+    return (1./(1+(exp(-(slope*in[0])))));
+  case bg_NODE_TYPE_GREATER_THAN_0:
+    return (in[0] > 0.0 ? in[1] : in[2]);
+  case bg_NODE_TYPE_EQUAL_TO_0:
+    return (fabs(in[0]) < bg_EPSILON ? in[1] : in[2]);
+  case bg_NODE_TYPE_TANH:
+    return tanh(in[0]);
+  default:
+    return 0.;
+  }
+}
+
+/* Fallback for nodes the interpreter does not know. The incoming edges get
+ * the current values of their sources so that the node can merge them. */
+static bg_error plan_call(bg_plan_t *plan, const plan_op_t *op) {
+  size_t i, j;
+  bg_error err;
+  bg_edge_t *edge;
+  bg_node_t *node = (bg_node_t*)op->ref;
+  for(i = 0; i < node->input_port_cnt; ++i) {
+    for(j = 0; j < node->input_ports[i]->num_edges; ++j) {
+      edge = node->input_ports[i]->edges[j];
+      /* a detached edge keeps its value until the source runs */
+      if(edge->source_node && !edge->detached) {
+        bg_EDGE_VALUE(edge) =
+          bg_PORT_VALUE(edge->source_node->output_ports[edge->source_port_idx]);
+      }
+    }
+  }
+  err = bg_node_evaluate(node);
+  for(i = 0; i < op->cnt; ++i) {
+    plan->values[op->dst + i] = bg_PORT_VALUE(node->output_ports[i]);
+  }
+  return err;
+}
+
+static bg_error plan_run_ops(bg_plan_t *plan, const plan_op_t *op,
+                             const plan_op_t *end, bg_real *scratch) {
+  bg_error err;
+  bg_real value;
+  bg_real *values = plan->values;
+  const plan_operand_t *operands = plan->operands;
+
+  for(; op != end; ++op) {
+    switch(op->kind) {
+    case bg_PLAN_OP_MERGE:
+      value = plan_merge(op, operands, values, scratch);
+      values[op->dst] = value;
+      if(op->ref) {
+        bg_PORT_VALUE((output_port_t*)op->ref) = value;
+      }
+      break;
+    case bg_PLAN_OP_EVAL:
+      value = plan_eval(op->type, values + op->src);
+      values[op->dst] = value;
+      bg_PORT_VALUE((output_port_t*)op->ref) = value;
+      break;
+    case bg_PLAN_OP_CALL:
+      err = plan_call(plan, op);
+      if(err != bg_SUCCESS) {
+        return err;
+      }
+      break;
+    }
+  }
+  return bg_SUCCESS;
+}
+
+/* Evaluates all ops on a value buffer of the caller. The merges of the graph
+ * inputs are skipped since the caller sets their values. Neither the plan
+ * nor the graph is touched. */
+bg_error bg_plan_execute_values(const bg_plan_t *plan, bg_real *values,
+                                bg_real *scratch) {
+  const plan_op_t *op, *end = plan->ops + plan->op_cnt;
+  const plan_op_t *inputs_end = plan->ops + plan->input_op_cnt;
+  const plan_operand_t *operands = plan->operands;
+
+  for(op = plan->ops; op != end; ++op) {
+    switch(op->kind) {
+    case bg_PLAN_OP_MERGE:
+      if(op >= inputs_end) {
+        values[op->dst] = plan_merge(op, operands, values, scratch);
+      }
+      break;
+    case bg_PLAN_OP_EVAL:
+      values[op->dst] = plan_eval(op->type, values + op->src);
+      break;
+    case bg_PLAN_OP_CALL:
+      return bg_error_set(bg_ERR_WRONG_TYPE);
+    }
+  }
+  return bg_SUCCESS;
+}
+
+/* Compares the bit patterns so that changes between 0. and -0. are noticed
+ * and NaN is not treated as a change. */
+static bool plan_value_changed(bg_real a, bg_real b) {
+  return memcmp(&a, &b, sizeof(bg_real)) != 0;
+}
+
+static void plan_mark_readers(bg_plan_t *plan, size_t slot) {
+  size_t i;
+  for(i = plan->reader_offsets[slot]; i < plan->reader_offsets[slot + 1];
+      ++i) {
+    plan->dirty[plan->readers[i]] = 1;
+  }
+}
+
+/* gather values that were set from outside */
+static void plan_gather(bg_plan_t *plan) {
+  size_t i;
+  bg_edge_t *edge;
+  plan_operand_t *operand;
+  for(i = 0; i < plan->extern_cnt; ++i) {
+    edge = plan->extern_edges[i];
+    operand = plan->operands + plan->extern_operands[i];
+    if(plan_value_changed(operand->weight, bg_EDGE_WEIGHT(edge)) ||
+       plan_value_changed(plan->values[operand->src], bg_EDGE_VALUE(edge))) {
+      operand->weight = bg_EDGE_WEIGHT(edge);
+      plan->values[operand->src] = bg_EDGE_VALUE(edge);
+      plan_mark_readers(plan, operand->src);
+    }
+  }
+}
+
+void bg_plan_set_weight(bg_plan_t *plan, bg_edge_t *edge, bg_real weight) {
+  if(edge->plan_idx != bg_PLAN_NONE) {
+    plan->operands[edge->plan_idx].weight = weight;
+    plan->dirty[plan->operand_groups[edge->plan_idx]] = 1;
+  }
+}
+
+bg_error bg_plan_set_value(bg_plan_t *plan, bg_edge_t *edge, bg_real value) {
+  return plan_add_override(plan, edge, value);
+}
+
+/* The source of the overridden edge wrote its next value. */
+static void plan_release(bg_plan_t *plan, size_t override_idx) {
+  size_t slot;
+  output_port_t *port;
+  plan_override_t *override = plan->overrides + override_idx;
+  bg_edge_t *edge = override->edge;
+  if(override->src != bg_PLAN_NONE) {
+    slot = plan->override_base + override->operand;
+    plan->operands[override->operand].src = override->src;
+    if(plan_value_changed(plan->values[slot], plan->values[override->src])) {
+      plan->dirty[plan->operand_groups[override->operand]] = 1;
+    }
+  }
+  port = edge->source_node->output_ports[edge->source_port_idx];
+  if(port->detached_cnt) {
+    port->detached_cnt--;
+  }
+  bg_edge_attach(edge);
+  *override = plan->overrides[--plan->override_cnt];
+}
+
+/* Releases the overrides of the edges leaving the given group. */
+static void plan_release_group(bg_plan_t *plan, size_t group_idx) {
+  size_t i = 0;
+  while(i < plan->override_cnt) {
+    if(plan->overrides[i].group == group_idx) {
+      plan_release(plan, i);
+    } else {
+      ++i;
+    }
+  }
+}
+
+/* Releases the overrides of the edges leaving the groups of a level. */
+static void plan_release_level(bg_plan_t *plan, size_t level) {
+  size_t i = 0;
+  while(i < plan->override_cnt) {
+    if(plan->group_levels[plan->overrides[i].group] == level) {
+      plan_release(plan, i);
+    } else {
+      ++i;
+    }
+  }
+}
+
+/* Evaluates the groups whose inputs changed since the last run. The outputs
+ * of a group are compared with their old values to decide whether the
+ * groups reading them are affected. A group that reads the output of a later
+ * group (an edge that is ignored for sorting) sees the change in the next
+ * run, just like in the serial evaluation. Calls are always evaluated since
+ * sub-graphs and extern nodes may change on their own. */
+bg_error bg_plan_execute(bg_plan_t *plan) {
+  size_t i, j;
+  bg_error err;
+  const plan_group_t *group;
+  bg_real *values = plan->values;
+
+  plan_gather(plan);
+  for(i = 0; i < plan->group_cnt; ++i) {
+    group = plan->groups + i;
+    if(plan->dirty[i] || plan->ops[group->begin].kind == bg_PLAN_OP_CALL) {
+      plan->dirty[i] = 0;
+      for(j = 0; j < group->out_cnt; ++j) {
+        plan->old_outputs[j] = values[group->out + j];
+      }
+      err = plan_run_ops(plan, plan->ops + group->begin,
+                         plan->ops + group->end, plan->scratch);
+      if(err != bg_SUCCESS) {
+        return err;
+      }
+      for(j = 0; j < group->out_cnt; ++j) {
+        if(plan_value_changed(plan->old_outputs[j], values[group->out + j])) {
+          plan_mark_readers(plan, group->out + j);
+        }
+      }
+    }
+    /* a clean group keeps its outputs, which count as written */
+    if(plan->override_cnt) {
+      plan_release_group(plan, i);
+    }
+  }
+  return bg_SUCCESS;
+}
+
+typedef struct plan_level_task_t {
+  bg_plan_t *plan;
+  const plan_group_t *groups;
+} plan_level_task_t;
+
+static bg_error plan_run_group(void *arg, size_t task_idx,
+                               size_t thread_idx) {
+  plan_level_task_t *task = (plan_level_task_t*)arg;
+  bg_plan_t *plan = task->plan;
+  const plan_group_t *group = task->groups + task_idx;
+  return plan_run_ops(plan, plan->ops + group->begin, plan->ops + group->end,
+                      plan->thread_scratch + thread_idx * plan->max_fan_in);
+}
+
+bg_error bg_plan_execute_parallel(bg_plan_t *plan, bg_thread_pool_t *pool,
+                                  size_t min_width) {
+  size_t i, j, width;
+  size_t thread_cnt = bg_thread_pool_get_thread_cnt(pool);
+  bg_error err;
+  plan_level_task_t task;
+
+  if(plan->thread_scratch_cnt < thread_cnt) {
+    free(plan->thread_scratch);
+    plan->thread_scratch_cnt = 0;
+    plan->thread_scratch = (bg_real*)calloc(thread_cnt * plan->max_fan_in,
+                                            sizeof(bg_real));
+    if(!plan->thread_scratch) {
+      return bg_error_set(bg_ERR_NO_MEMORY);
+    }
+    plan->thread_scratch_cnt = thread_cnt;
+  }
+  if(min_width < 2) {
+    min_width = 2;
+  }
+
+  plan_gather(plan);
+  task.plan = plan;
+  for(i = 0; i < plan->level_cnt; ++i) {
+    task.groups = plan->level_groups + plan->levels[i];
+    width = plan->levels[i + 1] - plan->levels[i];
+    if(width < min_width) {
+      for(j = 0; j < width; ++j) {
+        err = plan_run_group(&task, j, 0);
+        if(err != bg_SUCCESS) {
+          return err;
+        }
+      }
+    } else {
+      err = bg_thread_pool_run(pool, plan_run_group, &task, width);
+      if(err != bg_SUCCESS) {
+        return err;
+      }
+    }
+    if(plan->override_cnt) {
+      plan_release_level(plan, i);
+    }
+  }
+  return bg_SUCCESS;
+}
+
+static bg_error plan_run_call(void *arg, size_t task_idx, size_t thread_idx) {
+  plan_level_task_t *task = (plan_level_task_t*)arg;
+  (void)thread_idx;
+  return plan_call(task->plan,
+                   task->plan->ops + task->groups[task_idx].begin);
+}
+
+/* Evaluates the levels on the calling thread, only the sub-graph calls of a
+ * level are spread over the pool. Their cost differs a lot, so idle threads
+ * take over calls from busy ones. Like the level-parallel evaluation, every
+ * group is evaluated. */
+bg_error bg_plan_execute_subgraphs(bg_plan_t *plan, bg_thread_pool_t *pool) {
+  size_t i, j, call_cnt;
+  bg_error err;
+  const plan_group_t *group;
+  plan_level_task_t task;
+
+  if(!plan->call_groups) {
+    plan->call_groups = (plan_group_t*)calloc(plan->group_cnt + 1,
+                                              sizeof(plan_group_t));
+    if(!plan->call_groups) {
+      return bg_error_set(bg_ERR_NO_MEMORY);
+    }
+  }
+
+  plan_gather(plan);
+  task.plan = plan;
+  task.groups = plan->call_groups;
+  for(i = 0; i < plan->level_cnt; ++i) {
+    call_cnt = 0;
+    for(j = plan->levels[i]; j < plan->levels[i + 1]; ++j) {
+      group = plan->level_groups + j;
+      if(plan_is_subgraph_call(plan, group)) {
+        plan->call_groups[call_cnt++] = *group;
+        continue;
+      }
+      err = plan_run_ops(plan, plan->ops + group->begin,
+                         plan->ops + group->end, plan->scratch);
+      if(err != bg_SUCCESS) {
+        return err;
+      }
+    }
+    if(call_cnt == 1) {
+      err = plan_run_call(&task, 0, 0);
+    } else if(call_cnt > 1) {
+      err = bg_thread_pool_run_stealing(pool, plan_run_call, &task, call_cnt);
+    } else {
+      err = bg_SUCCESS;
+    }
+    if(err != bg_SUCCESS) {
+      return err;
+    }
+    if(plan->override_cnt) {
+      plan_release_level(plan, i);
+    }
+  }
+  return bg_SUCCESS;
+}
+
+/*
+ * Batched evaluation: every value slot holds bg_PLAN_LANES samples side by
+ * side. The merges and kernels are plain loops over the lanes that the
+ * compiler can vectorize. The arithmetic is the same as in plan_merge() and
+ * plan_eval() so that every lane matches a scalar evaluation.
+ */
+#define LANES bg_PLAN_LANES
+#define FOR_LANES(expr) for(l = 0; l < lane_cnt; ++l) { expr; }
+
+static void plan_merge_lanes(const plan_op_t *op,
+                             const plan_operand_t *operands,
+                             bg_real *values, bg_real *scratch,
+                             size_t lane_cnt) {
+  size_t i, l, cnt;
+  bg_real weight, sum_weights, tmp;
+  bg_real *dst = values + op->dst * LANES;
+  const bg_real *src;
+  const plan_operand_t *operand = operands + op->src;
+
+  switch(op->type) {
+  case bg_MERGE_TYPE_SUM:
+    FOR_LANES(dst[l] = op->bias);
+    if(op->cnt == 0) {
+      FOR_LANES(dst[l] += op->default_value);
+    }
+    for(i = 0; i < op->cnt; ++i) {
+      src = values + operand[i].src * LANES;
+      weight = operand[i].weight;
+      FOR_LANES(dst[l] += src[l] * weight);
+    }
+    break;
+  case bg_MERGE_TYPE_WEIGHTED_SUM:
+    FOR_LANES(dst[l] = 0.0);
+    sum_weights = 0.0;
+    if(op->cnt == 0) {
+      FOR_LANES(dst[l] += op->default_value);
+      sum_weights = 1.0;
+    }
+    for(i = 0; i < op->cnt; ++i) {
+      src = values + operand[i].src * LANES;
+      weight = operand[i].weight;
+      FOR_LANES(dst[l] += src[l] * weight);
+      sum_weights += fabs(weight);
+    }
+    if(sum_weights > bg_EPSILON) {
+      FOR_LANES(dst[l] = (dst[l] / sum_weights) + op->bias);
+    } else {
+      FOR_LANES(dst[l] = op->bias);
+    }
+    break;
+  case bg_MERGE_TYPE_PRODUCT:
+    FOR_LANES(dst[l] = op->bias);
+    if(op->cnt == 0) {
+      FOR_LANES(dst[l] *= op->default_value);
+    }
+    for(i = 0; i < op->cnt; ++i) {
+      src = values + operand[i].src * LANES;
+      weight = operand[i].weight;
+      FOR_LANES(dst[l] *= src[l] * weight);
+    }
+    break;
+  case bg_MERGE_TYPE_MIN:
+    FOR_LANES(dst[l] = op->bias);
+    if(op->cnt == 0 && op->default_value < op->bias) {
+      FOR_LANES(dst[l] = op->default_value);
+    }
+    for(i = 0; i < op->cnt; ++i) {
+      src = values + operand[i].src * LANES;
+      weight = operand[i].weight;
+      FOR_LANES(tmp = src[l] * weight; dst[l] = (tmp < dst[l] ? tmp : dst[l]));
+    }
+    break;
+  case bg_MERGE_TYPE_MAX:
+    FOR_LANES(dst[l] = op->bias);
+    if(op->cnt == 0 && op->default_value > op->bias) {
+      FOR_LANES(dst[l] = op->default_value);
+    }
+    for(i = 0; i < op->cnt; ++i) {
+      src = values + operand[i].src * LANES;
+      weight = operand[i].weight;
+      FOR_LANES(tmp = src[l] * weight; dst[l] = (tmp > dst[l] ? tmp : dst[l]));
+    }
+    break;
+  case bg_MERGE_TYPE_MEDIAN:
+    cnt = (op->cnt ? op->cnt : 1);
+    for(l = 0; l < lane_cnt; ++l) {
+      if(op->cnt == 0) {
+        scratch[0] = op->default_value;
+      }
+      for(i = 0; i < op->cnt; ++i) {
+        scratch[i] = values[operand[i].src * LANES + l] * operand[i].weight;
+      }
+      dst[l] = bg_merge_median(scratch, cnt) + op->bias;
+    }
+    break;
+  case bg_MERGE_TYPE_MEAN:
+    FOR_LANES(dst[l] = 0.0);
+    cnt = 1;
+    if(op->cnt == 0) {
+      FOR_LANES(dst[l] += op->default_value);
+    } else {
+      cnt = op->cnt;
+    }
+    for(i = 0; i < op->cnt; ++i) {
+      src = values + operand[i].src * LANES;
+      weight = operand[i].weight;
+      FOR_LANES(dst[l] += src[l] * weight);
+    }
+    FOR_LANES(dst[l] = (dst[l] / cnt) + op->bias);
+    break;
+  case bg_MERGE_TYPE_NORM:
+    FOR_LANES(dst[l] = op->bias * op->bias);
+    if(op->cnt == 0) {
+      tmp = op->default_value;
+      FOR_LANES(dst[l] += tmp * tmp);
+    }
+    for(i = 0; i < op->cnt; ++i) {
+      src = values + operand[i].src * LANES;
+      weight = operand[i].weight;
+      FOR_LANES(tmp = src[l] * weight; dst[l] += tmp * tmp);
+    }
+    FOR_LANES(dst[l] = sqrt(dst[l]));
+    break;
+  default:
+    FOR_LANES(dst[l] = 0.);
+    break;
+  }
+}
+
+static void plan_eval_lanes(const plan_op_t *op, bg_real *values,
+                            size_t lane_cnt) {
+  size_t l;
+  /* taken as in the rtneat */
+  const bg_real slope = 4.924273;
+  const bg_real *in0 = values + op->src * LANES;
+  const bg_real *in1, *in2;
+  bg_real *out = values + op->dst * LANES;
+
+  switch(op->type) {
+  case bg_NODE_TYPE_INPUT:
+  case bg_NODE_TYPE_OUTPUT:
+  case bg_NODE_TYPE_PIPE:
+    FOR_LANES(out[l] = in0[l]);
+    break;
+  case bg_NODE_TYPE_DIVIDE:
+    FOR_LANES(out[l] = 1. / in0[l]);
+    break;
+  case bg_NODE_TYPE_SIN:
+    FOR_LANES(out[l] = sin(in0[l]));
+    break;
+  case bg_NODE_TYPE_ASIN:
+    FOR_LANES(out[l] = asin(in0[l]));
+    break;
+  case bg_NODE_TYPE_COS:
+    FOR_LANES(out[l] = cos(in0[l]));
+    break;
+  case bg_NODE_TYPE_TAN:
+    FOR_LANES(out[l] = tan(in0[l]));
+    break;
+  case bg_NODE_TYPE_ACOS:
+    FOR_LANES(out[l] = acos(in0[l]));
+    break;
+  case bg_NODE_TYPE_ATAN2:
+    in1 = in0 + LANES;
+    FOR_LANES(out[l] = atan2(in0[l], in1[l]));
+    break;
+  case bg_NODE_TYPE_POW:
+    in1 = in0 + LANES;
+    FOR_LANES(out[l] = pow(in0[l], in1[l]));
+    break;
+  case bg_NODE_TYPE_MOD:
+    in1 = in0 + LANES;
+    FOR_LANES(out[l] = fmod(in0[l], in1[l]));
+    break;
+  case bg_NODE_TYPE_ABS:
+    FOR_LANES(out[l] = fabs(in0[l]));
+    break;
+  case bg_NODE_TYPE_SQRT:
+    FOR_LANES(out[l] = sqrt(in0[l]));
+    break;
+  case bg_NODE_TYPE_FSIGMOID:
+    FOR_LANES(out[l] = (1./(1+(exp(-(slope*in0[l]))))));
+    break;
+  case bg_NODE_TYPE_GREATER_THAN_0:
+    in1 = in0 + LANES;
+    in2 = in1 + LANES;
+    FOR_LANES(out[l] = (in0[l] > 0.0 ? in1[l] : in2[l]));
+    break;
+  case bg_NODE_TYPE_EQUAL_TO_0:
+    in1 = in0 + LANES;
+    in2 = in1 + LANES;
+    FOR_LANES(out[l] = (fabs(in0[l]) < bg_EPSILON ? in1[l] : in2[l]));
+    break;
+  case bg_NODE_TYPE_TANH:
+    FOR_LANES(out[l] = tanh(in0[l]));
+    break;
+  default:
+    FOR_LANES(out[l] = 0.);
+    break;
+  }
+}
+
+static bg_error plan_run_lanes(bg_plan_t *plan, const plan_op_t *inputs_end,
+                               size_t lane_cnt);
+
+static bg_error plan_alloc_lanes(bg_plan_t *plan) {
+  if(!plan->lanes) {
+    plan->lanes = (bg_real*)calloc(plan->value_cnt * LANES + 1,
+                                   sizeof(bg_real));
+    if(!plan->lanes) {
+      return bg_error_set(bg_ERR_NO_MEMORY);
+    }
+  }
+  return bg_SUCCESS;
+}
+
+/* A sub-graph is evaluated for all lanes at once by its own plan. Like the
+ * lanes of this plan, every lane of the sub-graph starts from its current
+ * state, which is left as it is. Extern nodes may have a state of their own
+ * that can't be kept, so they are not supported. */
+static bg_error plan_call_lanes(const bg_plan_t *plan, const plan_op_t *op,
+                                bg_real *values, size_t lane_cnt) {
+  size_t i, l, slot;
+  bg_error err;
+  bg_edge_t *edge;
+  bg_plan_t *sub;
+  bg_real *sub_values;
+  bg_graph_t *subgraph;
+  const bg_node_t *node = (const bg_node_t*)op->ref;
+
+  if(node->type->id != bg_NODE_TYPE_SUBGRAPH) {
+    return bg_error_set(bg_ERR_WRONG_TYPE);
+  }
+  subgraph = plan_get_subgraph(node);
+  if(!subgraph) {
+    return bg_SUCCESS;
+  }
+  if(!subgraph->plan || subgraph->plan_is_dirty ||
+     subgraph->eval_order_is_dirty || bg_plan_is_stale(subgraph->plan)) {
+    err = bg_plan_compile(subgraph);
+    if(err != bg_SUCCESS) {
+      return err;
+    }
+  }
+  sub = subgraph->plan;
+  err = plan_alloc_lanes(sub);
+  if(err != bg_SUCCESS) {
+    return err;
+  }
+  sub_values = sub->lanes;
+  plan_gather(sub);
+  for(i = 0; i < sub->value_cnt; ++i) {
+    FOR_LANES(sub_values[i * LANES + l] = sub->values[i]);
+  }
+  /* the edges into the sub-graph read the lanes of this plan */
+  for(i = 0; i < sub->extern_cnt; ++i) {
+    edge = sub->extern_edges[i];
+    if(plan_is_internal(node->_parent_graph, NULL, edge) &&
+       !edge->detached) {
+      slot = sub->operands[sub->extern_operands[i]].src;
+      FOR_LANES(sub_values[slot * LANES + l] =
+                values[plan_source_slot(plan, edge) * LANES + l]);
+    }
+  }
+  err = plan_run_lanes(sub, sub->ops, lane_cnt);
+  if(err != bg_SUCCESS) {
+    return err;
+  }
+  for(i = 0; i < op->cnt; ++i) {
+    slot = sub->output_slots[i];
+    if(slot != bg_PLAN_NONE) {
+      FOR_LANES(values[(op->dst + i) * LANES + l] =
+                sub_values[slot * LANES + l]);
+    } else {
+      FOR_LANES(values[(op->dst + i) * LANES + l] = 0.);
+    }
+  }
+  return bg_SUCCESS;
+}
+
+/* Runs all ops on plan->lanes. The merges before inputs_end are skipped. */
+static bg_error plan_run_lanes(bg_plan_t *plan, const plan_op_t *inputs_end,
+                               size_t lane_cnt) {
+  bg_error err;
+  bg_real *values = plan->lanes;
+  const plan_operand_t *operands = plan->operands;
+  const plan_op_t *op, *end = plan->ops + plan->op_cnt;
+
+  for(op = plan->ops; op != end; ++op) {
+    switch(op->kind) {
+    case bg_PLAN_OP_MERGE:
+      if(op >= inputs_end) {
+        plan_merge_lanes(op, operands, values, plan->scratch, lane_cnt);
+      }
+      break;
+    case bg_PLAN_OP_EVAL:
+      plan_eval_lanes(op, values, lane_cnt);
+      break;
+    case bg_PLAN_OP_CALL:
+      err = plan_call_lanes(plan, op, values, lane_cnt);
+      if(err != bg_SUCCESS) {
+        return err;
+      }
+      break;
+    }
+  }
+  return bg_SUCCESS;
+}
+
+bg_error bg_plan_execute_batch(bg_plan_t *plan, const bg_real *inputs,
+                               bg_real *outputs, size_t sample_cnt) {
+  size_t i, l, first, lane_cnt, slot;
+  bg_error err;
+  bg_real *values;
+
+  err = plan_alloc_lanes(plan);
+  if(err != bg_SUCCESS) {
+    return err;
+  }
+  values = plan->lanes;
+  plan_gather(plan);
+
+  for(first = 0; first < sample_cnt; first += LANES) {
+    lane_cnt = sample_cnt - first;
+    if(lane_cnt > LANES) {
+      lane_cnt = LANES;
+    }
+    /* every sample starts from the current state of the graph */
+    for(i = 0; i < plan->value_cnt; ++i) {
+      FOR_LANES(values[i * LANES + l] = plan->values[i]);
+    }
+    for(i = 0; i < plan->input_cnt; ++i) {
+      slot = plan->input_slots[i];
+      if(slot != bg_PLAN_NONE) {
+        FOR_LANES(values[slot * LANES + l] =
+                  inputs[(first + l) * plan->input_cnt + i]);
+      }
+    }
+    /* the inputs of the graph are given by the caller */
+    err = plan_run_lanes(plan, plan->ops + plan->input_op_cnt, lane_cnt);
+    if(err != bg_SUCCESS) {
+      return err;
+    }
+    for(i = 0; i < plan->output_cnt; ++i) {
+      slot = plan->output_slots[i];
+      if(slot != bg_PLAN_NONE) {
+        FOR_LANES(outputs[(first + l) * plan->output_cnt + i] =
+                  values[slot * LANES + l]);
+      } else {
+        FOR_LANES(outputs[(first + l) * plan->output_cnt + i] = 0.);
+      }
+    }
+  }
+  return bg_SUCCESS;
+}
+
+#undef FOR_LANES
+#undef LANES
+
+bg_error bg_graph_compile(bg_graph_t *graph) {
+  return bg_plan_compile(graph);
+}
+
+bg_error bg_graph_evaluate_batch(bg_graph_t *graph, const bg_real *inputs,
+                                 bg_real *outputs, size_t sample_cnt) {
+  bg_error err;
+  if(!graph->plan || graph->plan_is_dirty || graph->eval_order_is_dirty ||
+     bg_plan_is_stale(graph->plan)) {
+    err = bg_plan_compile(graph);
+    if(err != bg_SUCCESS) {
+      return err;
+    }
+  }
+  return bg_plan_execute_batch(graph->plan, inputs, outputs, sample_cnt);
+}
@@ -0,0 +1,152 @@
+#ifndef C_BAGEL_PLAN_H
+#define C_BAGEL_PLAN_H
+
+#include "bg_impl.h"
+
+/**
+ * @file
+ * @brief Flat execution plan of a graph.
+ *
+ * bg_plan_compile() turns the evaluation order of a graph into a contiguous
+ * array of instructions that address one dense value buffer. The plan is
+ * executed by a single interpreter loop in bg_plan_execute().
+ */
+
+#define bg_PLAN_NONE ((size_t)-1)
+/* number of samples evaluated side by side by bg_graph_evaluate_batch() */
+#define bg_PLAN_LANES 64
+
+typedef enum { bg_PLAN_OP_MERGE,
+               bg_PLAN_OP_EVAL,
+               bg_PLAN_OP_CALL } plan_op_kind;
+
+typedef struct plan_op_t {
+  unsigned char kind;     /* plan_op_kind */
+  unsigned char type;     /* bg_merge_type (MERGE) or bg_node_type (EVAL) */
+  size_t dst;             /* first value slot written */
+  size_t src;             /* first operand (MERGE) or value slot (EVAL) read */
+  size_t cnt;             /* number of operands (MERGE) or outputs (CALL) */
+  bg_real bias;
+  bg_real default_value;
+  void *ref;              /* output_port_t (EVAL) or bg_node_t (CALL) */
+} plan_op_t;
+
+typedef struct plan_operand_t {
+  size_t src;             /* value slot of the source output or extern edge */
+  bg_real weight;
+} plan_operand_t;
+
+/* the ops of one node and the value slots of its outputs */
+typedef struct plan_group_t {
+  size_t begin;
+  size_t end;
+  size_t out;
+  size_t out_cnt;
+} plan_group_t;
+
+/* an edge that reads the value set from outside until its source runs */
+typedef struct plan_override_t {
+  bg_edge_t *edge;
+  size_t operand;         /* the operand of the edge or bg_PLAN_NONE */
+  size_t src;             /* source slot of the redirected operand or
+                           * bg_PLAN_NONE if the operand was not redirected */
+  size_t group;           /* the group writing the source slot */
+} plan_override_t;
+
+/* the first value slots of the nodes of a detached plan */
+typedef struct plan_slot_map_t {
+  const bg_node_t **nodes;
+  size_t *slots;
+  size_t cnt;
+  size_t capacity;
+} plan_slot_map_t;
+
+struct bg_plan_t {
+  /* sub-graphs are part of the plan instead of being called */
+  bool inline_subgraphs;
+  /* called sub-graphs of one level may be evaluated at the same time */
+  bool concurrent_subgraphs;
+  /* the inlined sub-graphs */
+  bg_graph_t **graphs;
+  size_t graph_cnt;
+  /* output slots of inlined sub-graph nodes, indexed by their plan_slot */
+  size_t *port_slots;
+  /* replaces bg_node_t::plan_slot and bg_edge_t::plan_idx if not NULL */
+  plan_slot_map_t *slot_map;
+  plan_op_t *ops;
+  size_t op_cnt;
+  plan_operand_t *operands;
+  size_t operand_cnt;
+  /* the group each operand belongs to */
+  size_t *operand_groups;
+  bg_real *values;
+  size_t value_cnt;
+  /* edges whose value is written from outside the graph */
+  bg_edge_t **extern_edges;
+  size_t *extern_operands;
+  size_t extern_cnt;
+  /* scratch space for merges that need a copy of their operands */
+  bg_real *scratch;
+  size_t max_fan_in;
+  /* groups in serial order and whether they have to be evaluated again */
+  plan_group_t *groups;
+  size_t group_cnt;
+  unsigned char *dirty;
+  /* the groups reading value slot i are
+   * readers[reader_offsets[i]] to readers[reader_offsets[i+1]-1] */
+  size_t *reader_offsets;
+  size_t *readers;
+  /* the group writing value slot i or bg_PLAN_NONE */
+  size_t *writers;
+  /* operand i of an override reads value slot override_base + i */
+  size_t override_base;
+  plan_override_t *overrides;
+  size_t override_cnt;
+  size_t override_capacity;
+  /* output values of the current group before its evaluation */
+  bg_real *old_outputs;
+  /* groups sorted by level; the groups of level i are
+   * level_groups[levels[i]] to level_groups[levels[i+1]-1] */
+  plan_group_t *level_groups;
+  size_t *levels;
+  size_t level_cnt;
+  /* the level of every group in serial order */
+  size_t *group_levels;
+  /* max_fan_in scratch values per thread of a parallel evaluation */
+  bg_real *thread_scratch;
+  size_t thread_scratch_cnt;
+  /* the sub-graph calls of the current level of a concurrent evaluation */
+  plan_group_t *call_groups;
+  /* the ops of the input nodes come first */
+  size_t input_op_cnt;
+  /* value slots of the graph inputs and outputs (bg_PLAN_NONE if unused) */
+  size_t *input_slots;
+  size_t input_cnt;
+  size_t *output_slots;
+  size_t output_cnt;
+  /* value_cnt * bg_PLAN_LANES values for batched evaluation, lane-minor */
+  bg_real *lanes;
+};
+
+/* builds a plan without attaching it to the graph */
+bg_error bg_plan_build(bg_graph_t *graph, bool inline_subgraphs,
+                       bg_plan_t **plan);
+/* builds an inlined plan without writing to the graph */
+bg_error bg_plan_build_detached(bg_graph_t *graph, bg_plan_t **plan);
+bg_error bg_plan_compile(bg_graph_t *graph);
+void bg_plan_free(bg_plan_t *plan);
+void bg_plan_reset(bg_plan_t *plan);
+bool bg_plan_is_stale(const bg_plan_t *plan);
+void bg_plan_set_weight(bg_plan_t *plan, bg_edge_t *edge, bg_real weight);
+/* makes the detached edge read value until its source is evaluated */
+bg_error bg_plan_set_value(bg_plan_t *plan, bg_edge_t *edge, bg_real value);
+bg_error bg_plan_execute(bg_plan_t *plan);
+bg_error bg_plan_execute_parallel(bg_plan_t *plan, bg_thread_pool_t *pool,
+                                  size_t min_width);
+bg_error bg_plan_execute_subgraphs(bg_plan_t *plan, bg_thread_pool_t *pool);
+bg_error bg_plan_execute_values(const bg_plan_t *plan, bg_real *values,
+                                bg_real *scratch);
+bg_error bg_plan_execute_batch(bg_plan_t *plan, const bg_real *inputs,
+                               bg_real *outputs, size_t sample_cnt);
+
+#endif /* C_BAGEL_PLAN_H */
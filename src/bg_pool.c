@@ -0,0 +1,89 @@
+#include "bg_impl.h"
+#include "bg_thread_pool.h"
+
+#include <stdlib.h>
+
+/* the results are kept in the pool if the caller doesn't want them */
+struct bg_pool_t {
+  bg_thread_pool_t *threads;
+  bg_error *errors;
+  size_t error_capacity;
+};
+
+typedef struct pool_job_t {
+  bg_graph_t **graphs;
+  bg_error *errors;
+} pool_job_t;
+
+static bg_error pool_evaluate_graph(void *arg, size_t task_idx,
+                                    size_t thread_idx) {
+  pool_job_t *job = (pool_job_t*)arg;
+  bg_error err, saved = bg_error_get();
+  (void)thread_idx;
+  bg_error_clear();
+  err = bg_graph_evaluate(job->graphs[task_idx]);
+  if(err == bg_SUCCESS) {
+    err = bg_error_get();
+  }
+  job->errors[task_idx] = err;
+  /* the first error of the thread is its own again */
+  bg_error_clear();
+  bg_error_set(saved);
+  /* the errors are reported by graph, not by thread */
+  return bg_SUCCESS;
+}
+
+bg_error bg_pool_alloc(bg_pool_t **pool, size_t thread_cnt) {
+  bg_error err;
+  bg_pool_t *new_pool = (bg_pool_t*)calloc(1, sizeof(bg_pool_t));
+  if(!new_pool) {
+    return bg_error_set(bg_ERR_NO_MEMORY);
+  }
+  err = bg_thread_pool_create(&new_pool->threads, thread_cnt);
+  if(err != bg_SUCCESS) {
+    free(new_pool);
+    return err;
+  }
+  *pool = new_pool;
+  return bg_SUCCESS;
+}
+
+bg_error bg_pool_free(bg_pool_t *pool) {
+  if(pool) {
+    bg_thread_pool_free(pool->threads);
+    free(pool->errors);
+    free(pool);
+  }
+  return bg_SUCCESS;
+}
+
+bg_error bg_pool_evaluate(bg_pool_t *pool, bg_graph_t **graphs,
+                          size_t graph_cnt, bg_error *errors) {
+  size_t i;
+  pool_job_t job;
+  bg_error err, *buffer;
+  job.graphs = graphs;
+  job.errors = errors;
+  if(!errors) {
+    if(graph_cnt > pool->error_capacity) {
+      buffer = (bg_error*)realloc(pool->errors, graph_cnt * sizeof(bg_error));
+      if(!buffer) {
+        return bg_error_set(bg_ERR_NO_MEMORY);
+      }
+      pool->errors = buffer;
+      pool->error_capacity = graph_cnt;
+    }
+    job.errors = pool->errors;
+  }
+  err = bg_thread_pool_run_stealing(pool->threads, pool_evaluate_graph, &job,
+                                    graph_cnt);
+  if(err != bg_SUCCESS) {
+    return err;
+  }
+  for(i = 0; i < graph_cnt; ++i) {
+    if(job.errors[i] != bg_SUCCESS) {
+      return bg_error_set(job.errors[i]);
+    }
+  }
+  return bg_SUCCESS;
+}
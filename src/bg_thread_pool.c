@@ -0,0 +1,278 @@
+#include "bg_thread_pool.h"
+
+#include <stdlib.h>
+
+#ifdef THREAD_SUPPORT
+
+#include <pthread.h>
+
+typedef struct worker_t {
+  bg_thread_pool_t *pool;
+  size_t idx;
+  unsigned long generation;
+  pthread_t thread;
+  /* the tasks [next, end) left to the worker in a job with stealing */
+  pthread_mutex_t lock;
+  size_t next, end;
+} worker_t;
+
+struct bg_thread_pool_t {
+  worker_t *workers;
+  size_t thread_cnt;
+  pthread_mutex_t mutex;
+  pthread_cond_t start_cond;
+  pthread_cond_t done_cond;
+  unsigned long generation;
+  size_t busy_cnt;
+  bool quit;
+  /* the current job */
+  bg_thread_task_t task;
+  void *arg;
+  size_t task_cnt;
+  bool steal;
+  bg_error err;
+};
+
+static bg_error run_range(bg_thread_pool_t *pool, size_t thread_idx) {
+  size_t i;
+  bg_error err = bg_SUCCESS, tmp_err;
+  size_t begin = pool->task_cnt * thread_idx / pool->thread_cnt;
+  size_t end = pool->task_cnt * (thread_idx + 1) / pool->thread_cnt;
+  for(i = begin; i < end; ++i) {
+    tmp_err = pool->task(pool->arg, i, thread_idx);
+    if(err == bg_SUCCESS) {
+      err = tmp_err;
+    }
+  }
+  return err;
+}
+
+/* moves the back half of the tasks left to another worker to thread_idx */
+static bool steal_tasks(bg_thread_pool_t *pool, size_t thread_idx) {
+  size_t i, left, begin = 0, end = 0;
+  worker_t *victim, *self = pool->workers + thread_idx;
+  for(i = 1; i < pool->thread_cnt && begin == end; ++i) {
+    victim = pool->workers + (thread_idx + i) % pool->thread_cnt;
+    pthread_mutex_lock(&victim->lock);
+    left = victim->end - victim->next;
+    if(left) {
+      end = victim->end;
+      begin = end - (left + 1) / 2;
+      victim->end = begin;
+    }
+    pthread_mutex_unlock(&victim->lock);
+  }
+  if(begin == end) {
+    return false;
+  }
+  pthread_mutex_lock(&self->lock);
+  self->next = begin;
+  self->end = end;
+  pthread_mutex_unlock(&self->lock);
+  return true;
+}
+
+static bg_error run_stealing(bg_thread_pool_t *pool, size_t thread_idx) {
+  size_t i;
+  bg_error err = bg_SUCCESS, tmp_err;
+  worker_t *self = pool->workers + thread_idx;
+  for(;;) {
+    pthread_mutex_lock(&self->lock);
+    if(self->next == self->end) {
+      pthread_mutex_unlock(&self->lock);
+      if(!steal_tasks(pool, thread_idx)) {
+        break;
+      }
+      continue;
+    }
+    i = self->next++;
+    pthread_mutex_unlock(&self->lock);
+    tmp_err = pool->task(pool->arg, i, thread_idx);
+    if(err == bg_SUCCESS) {
+      err = tmp_err;
+    }
+  }
+  return err;
+}
+
+static bg_error run_job(bg_thread_pool_t *pool, size_t thread_idx) {
+  return pool->steal ? run_stealing(pool, thread_idx) :
+    run_range(pool, thread_idx);
+}
+
+static void *worker_main(void *arg) {
+  worker_t *worker = (worker_t*)arg;
+  bg_thread_pool_t *pool = worker->pool;
+  bg_error err;
+  pthread_mutex_lock(&pool->mutex);
+  for(;;) {
+    while(worker->generation == pool->generation && !pool->quit) {
+      pthread_cond_wait(&pool->start_cond, &pool->mutex);
+    }
+    if(pool->quit) {
+      break;
+    }
+    worker->generation = pool->generation;
+    pthread_mutex_unlock(&pool->mutex);
+    /* errors of earlier jobs must not leak into this one */
+    bg_error_clear();
+    err = run_job(pool, worker->idx);
+    pthread_mutex_lock(&pool->mutex);
+    if(pool->err == bg_SUCCESS) {
+      pool->err = err;
+    }
+    if(--pool->busy_cnt == 0) {
+      pthread_cond_signal(&pool->done_cond);
+    }
+  }
+  pthread_mutex_unlock(&pool->mutex);
+  return NULL;
+}
+
+bg_error bg_thread_pool_create(bg_thread_pool_t **pool, size_t thread_cnt) {
+  size_t i;
+  bg_thread_pool_t *new_pool;
+  if(thread_cnt == 0) {
+    return bg_error_set(bg_ERR_OUT_OF_RANGE);
+  }
+  new_pool = (bg_thread_pool_t*)calloc(1, sizeof(bg_thread_pool_t));
+  if(!new_pool) {
+    return bg_error_set(bg_ERR_NO_MEMORY);
+  }
+  new_pool->workers = (worker_t*)calloc(thread_cnt, sizeof(worker_t));
+  if(!new_pool->workers) {
+    free(new_pool);
+    return bg_error_set(bg_ERR_NO_MEMORY);
+  }
+  new_pool->thread_cnt = thread_cnt;
+  pthread_mutex_init(&new_pool->mutex, NULL);
+  pthread_cond_init(&new_pool->start_cond, NULL);
+  pthread_cond_init(&new_pool->done_cond, NULL);
+  /* worker 0 is the thread that calls bg_thread_pool_run() */
+  pthread_mutex_init(&new_pool->workers[0].lock, NULL);
+  for(i = 1; i < thread_cnt; ++i) {
+    new_pool->workers[i].pool = new_pool;
+    new_pool->workers[i].idx = i;
+    pthread_mutex_init(&new_pool->workers[i].lock, NULL);
+    if(pthread_create(&new_pool->workers[i].thread, NULL,
+                      worker_main, &new_pool->workers[i]) != 0) {
+      pthread_mutex_destroy(&new_pool->workers[i].lock);
+      new_pool->thread_cnt = i;
+      bg_thread_pool_free(new_pool);
+      return bg_error_set(bg_ERR_UNKNOWN);
+    }
+  }
+  *pool = new_pool;
+  return bg_SUCCESS;
+}
+
+void bg_thread_pool_free(bg_thread_pool_t *pool) {
+  size_t i;
+  if(!pool) {
+    return;
+  }
+  pthread_mutex_lock(&pool->mutex);
+  pool->quit = true;
+  pthread_cond_broadcast(&pool->start_cond);
+  pthread_mutex_unlock(&pool->mutex);
+  for(i = 1; i < pool->thread_cnt; ++i) {
+    pthread_join(pool->workers[i].thread, NULL);
+  }
+  for(i = 0; i < pool->thread_cnt; ++i) {
+    pthread_mutex_destroy(&pool->workers[i].lock);
+  }
+  pthread_cond_destroy(&pool->done_cond);
+  pthread_cond_destroy(&pool->start_cond);
+  pthread_mutex_destroy(&pool->mutex);
+  free(pool->workers);
+  free(pool);
+}
+
+size_t bg_thread_pool_get_thread_cnt(const bg_thread_pool_t *pool) {
+  return pool->thread_cnt;
+}
+
+static bg_error pool_run(bg_thread_pool_t *pool, bg_thread_task_t task,
+                         void *arg, size_t task_cnt, bool steal) {
+  size_t i;
+  bg_error err;
+  pthread_mutex_lock(&pool->mutex);
+  pool->task = task;
+  pool->arg = arg;
+  pool->task_cnt = task_cnt;
+  pool->steal = steal;
+  pool->err = bg_SUCCESS;
+  pool->busy_cnt = pool->thread_cnt - 1;
+  if(steal) {
+    /* the workers pick up their ranges after the broadcast */
+    for(i = 0; i < pool->thread_cnt; ++i) {
+      pool->workers[i].next = task_cnt * i / pool->thread_cnt;
+      pool->workers[i].end = task_cnt * (i + 1) / pool->thread_cnt;
+    }
+  }
+  pool->generation++;
+  pthread_cond_broadcast(&pool->start_cond);
+  pthread_mutex_unlock(&pool->mutex);
+
+  err = run_job(pool, 0);
+
+  pthread_mutex_lock(&pool->mutex);
+  while(pool->busy_cnt > 0) {
+    pthread_cond_wait(&pool->done_cond, &pool->mutex);
+  }
+  if(err == bg_SUCCESS) {
+    err = pool->err;
+  }
+  pthread_mutex_unlock(&pool->mutex);
+  /* the workers record their errors in their own error state */
+  return bg_error_set(err);
+}
+
+bg_error bg_thread_pool_run(bg_thread_pool_t *pool, bg_thread_task_t task,
+                            void *arg, size_t task_cnt) {
+  return pool_run(pool, task, arg, task_cnt, false);
+}
+
+bg_error bg_thread_pool_run_stealing(bg_thread_pool_t *pool,
+                                     bg_thread_task_t task, void *arg,
+                                     size_t task_cnt) {
+  return pool_run(pool, task, arg, task_cnt, true);
+}
+
+#else /* THREAD_SUPPORT */
+
+bg_error bg_thread_pool_create(bg_thread_pool_t **pool, size_t thread_cnt) {
+  return bg_ERR_NOT_IMPLEMENTED;
+  (void)pool;
+  (void)thread_cnt;
+}
+
+void bg_thread_pool_free(bg_thread_pool_t *pool) {
+  (void)pool;
+}
+
+size_t bg_thread_pool_get_thread_cnt(const bg_thread_pool_t *pool) {
+  return 1;
+  (void)pool;
+}
+
+bg_error bg_thread_pool_run(bg_thread_pool_t *pool, bg_thread_task_t task,
+                            void *arg, size_t task_cnt) {
+  return bg_ERR_NOT_IMPLEMENTED;
+  (void)pool;
+  (void)task;
+  (void)arg;
+  (void)task_cnt;
+}
+
+bg_error bg_thread_pool_run_stealing(bg_thread_pool_t *pool,
+                                     bg_thread_task_t task, void *arg,
+                                     size_t task_cnt) {
+  return bg_ERR_NOT_IMPLEMENTED;
+  (void)pool;
+  (void)task;
+  (void)arg;
+  (void)task_cnt;
+}
+
+#endif /* THREAD_SUPPORT */
@@ -0,0 +1,34 @@
+#ifndef C_BAGEL_THREAD_POOL_H
+#define C_BAGEL_THREAD_POOL_H
+
+#include "bg_impl.h"
+
+/**
+ * @file
+ * @brief Persistent pool of worker threads.
+ *
+ * bg_thread_pool_run() splits task_cnt tasks into contiguous ranges, one
+ * per thread, and returns when all of them are done. The calling thread
+ * works on the first range. bg_thread_pool_run_stealing() starts from the
+ * same ranges, but a thread that is done takes over the back half of the
+ * tasks left to another thread, which balances tasks of uneven cost. The
+ * first error of the tasks is returned and set in the error state of the
+ * calling thread. Only one run may be in progress per pool, the workers
+ * share a single job. Without THREAD_SUPPORT all functions return
+ * bg_ERR_NOT_IMPLEMENTED.
+ */
+
+/* task_idx in [0, task_cnt), thread_idx in [0, thread_cnt) */
+typedef bg_error (*bg_thread_task_t)(void *arg, size_t task_idx,
+                                     size_t thread_idx);
+
+bg_error bg_thread_pool_create(bg_thread_pool_t **pool, size_t thread_cnt);
+void bg_thread_pool_free(bg_thread_pool_t *pool);
+size_t bg_thread_pool_get_thread_cnt(const bg_thread_pool_t *pool);
+bg_error bg_thread_pool_run(bg_thread_pool_t *pool, bg_thread_task_t task,
+                            void *arg, size_t task_cnt);
+bg_error bg_thread_pool_run_stealing(bg_thread_pool_t *pool,
+                                     bg_thread_task_t task, void *arg,
+                                     size_t task_cnt);
+
+#endif /* C_BAGEL_THREAD_POOL_H */
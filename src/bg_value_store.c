@@ -0,0 +1,102 @@
+#include "bg_value_store.h"
+#include "bg_impl.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+static void slot_array_init(bg_slot_array_t *array) {
+  memset(array, 0, sizeof(bg_slot_array_t));
+}
+
+static void slot_array_deinit(bg_slot_array_t *array) {
+  free(array->data);
+  free(array->free_slots);
+  slot_array_init(array);
+}
+
+static bg_error slot_array_reserve(bg_slot_array_t *array, size_t capacity) {
+  bg_real *data;
+  size_t *free_slots;
+  if(capacity <= array->capacity) {
+    return bg_SUCCESS;
+  }
+  data = (bg_real*)realloc(array->data, capacity*sizeof(bg_real));
+  if(!data) {
+    return bg_error_set(bg_ERR_NO_MEMORY);
+  }
+  array->data = data;
+  /* every slot can be released at most once */
+  free_slots = (size_t*)realloc(array->free_slots, capacity*sizeof(size_t));
+  if(!free_slots) {
+    return bg_error_set(bg_ERR_NO_MEMORY);
+  }
+  array->free_slots = free_slots;
+  array->capacity = capacity;
+  return bg_SUCCESS;
+}
+
+static bg_error slot_array_alloc(bg_slot_array_t *array, size_t *idx) {
+  bg_error err;
+  if(array->free_cnt) {
+    *idx = array->free_slots[--array->free_cnt];
+  } else {
+    if(array->cnt == array->capacity) {
+      err = slot_array_reserve(array,
+                               array->capacity ? array->capacity*2 : 64);
+      if(err != bg_SUCCESS) {
+        return err;
+      }
+    }
+    *idx = array->cnt++;
+  }
+  array->data[*idx] = 0.;
+  return bg_SUCCESS;
+}
+
+static void slot_array_free(bg_slot_array_t *array, size_t idx) {
+  array->free_slots[array->free_cnt++] = idx;
+}
+
+void bg_value_store_init(bg_value_store_t *store) {
+  slot_array_init(&store->values);
+  slot_array_init(&store->weights);
+}
+
+void bg_value_store_deinit(bg_value_store_t *store) {
+  slot_array_deinit(&store->values);
+  slot_array_deinit(&store->weights);
+}
+
+bg_error bg_value_store_alloc_value(bg_value_store_t *store, size_t *idx) {
+  return slot_array_alloc(&store->values, idx);
+}
+
+bg_error bg_value_store_alloc_weight(bg_value_store_t *store, size_t *idx) {
+  return slot_array_alloc(&store->weights, idx);
+}
+
+void bg_value_store_free_value(bg_value_store_t *store, size_t idx) {
+  slot_array_free(&store->values, idx);
+}
+
+void bg_value_store_free_weight(bg_value_store_t *store, size_t idx) {
+  slot_array_free(&store->weights, idx);
+}
+
+bg_error bg_value_store_reserve(bg_value_store_t *store, size_t value_cnt,
+                                size_t weight_cnt) {
+  bg_error err;
+  /* released slots are used up first */
+  if(value_cnt > store->values.free_cnt) {
+    err = slot_array_reserve(&store->values, store->values.cnt + value_cnt -
+                             store->values.free_cnt);
+    if(err != bg_SUCCESS) {
+      return err;
+    }
+  }
+  if(weight_cnt > store->weights.free_cnt) {
+    return slot_array_reserve(&store->weights, store->weights.cnt +
+                              weight_cnt - store->weights.free_cnt);
+  }
+  return bg_SUCCESS;
+}
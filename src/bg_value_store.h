@@ -0,0 +1,52 @@
+#ifndef C_BAGEL_VALUE_STORE_H
+#define C_BAGEL_VALUE_STORE_H
+
+#include "bagel.h"
+
+/**
+ * @file
+ * @brief Dense value and weight arrays of one graph.
+ *
+ * Ports and edges do not hold their values themselves. They keep an index
+ * into the value array of their graph, and edges a second index into the
+ * weight array. Merges thereby read dense arrays and the whole state of a
+ * graph can be saved by copying two blocks. Released slots are reused by
+ * later allocations. The arrays grow on demand, so pointers into them are
+ * only valid until the next allocation; indices stay valid.
+ */
+
+typedef struct bg_slot_array_t {
+  bg_real *data;
+  size_t cnt;
+  size_t capacity;
+  /* released slots, reused before the array grows */
+  size_t *free_slots;
+  size_t free_cnt;
+} bg_slot_array_t;
+
+typedef struct bg_value_store_t {
+  /* values of the input ports, output ports and edges */
+  bg_slot_array_t values;
+  /* weights of the edges */
+  bg_slot_array_t weights;
+} bg_value_store_t;
+
+void bg_value_store_init(bg_value_store_t *store);
+void bg_value_store_deinit(bg_value_store_t *store);
+/* the new slot is set to 0 */
+bg_error bg_value_store_alloc_value(bg_value_store_t *store, size_t *idx);
+bg_error bg_value_store_alloc_weight(bg_value_store_t *store, size_t *idx);
+void bg_value_store_free_value(bg_value_store_t *store, size_t idx);
+void bg_value_store_free_weight(bg_value_store_t *store, size_t idx);
+/* makes room for the given number of further values and weights at once */
+bg_error bg_value_store_reserve(bg_value_store_t *store, size_t value_cnt,
+                                size_t weight_cnt);
+
+/* lvalues of the values and weights of ports and edges */
+#define bg_PORT_VALUE(port) ((port)->store->values.data[(port)->value_idx])
+#define bg_EDGE_VALUE(edge) ((edge)->store->values.data[(edge)->value_idx])
+/* the value merges read from an edge, see bg_edge_set_direct() */
+#define bg_EDGE_INPUT(edge) ((edge)->read_store->values.data[(edge)->read_idx])
+#define bg_EDGE_WEIGHT(edge) ((edge)->store->weights.data[(edge)->weight_idx])
+
+#endif /* C_BAGEL_VALUE_STORE_H */
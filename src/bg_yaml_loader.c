@@ -36,8 +36,8 @@ typedef struct node_struct {
   char type_str[bg_MAX_STRING_LENGTH];
   bg_node_type type;
   char name[bg_MAX_STRING_LENGTH];
-  input_struct inputs[bg_MAX_PORTS];
-  output_struct outputs[bg_MAX_PORTS];
+  input_struct *inputs;
+  output_struct *outputs;
   size_t input_cnt;
   size_t output_cnt;
 } node_struct;
@@ -77,10 +77,10 @@ static bg_error parse_node(yaml_parser_t *parser, bg_graph_t *g);
 static bg_error parse_node_id(yaml_parser_t *parser, unsigned long *id);
 static bg_error parse_node_type(yaml_parser_t *parser,
                                 bg_node_type *type);
-static bg_error parse_node_inputs(yaml_parser_t *parser, input_struct *inputs,
+static bg_error parse_node_inputs(yaml_parser_t *parser, input_struct **inputs,
                                   size_t *input_cnt);
 static bg_error parse_node_outputs(yaml_parser_t *parser,
-                                   output_struct *outputs,
+                                   output_struct **outputs,
                                    size_t *output_cnt);
 static bg_error parse_edges(yaml_parser_t *parser, bg_edge_struct_list_t *edges);
 
@@ -268,6 +268,8 @@ static bg_error parse_node(yaml_parser_t *parser, bg_graph_t *g) {
   char err_message[bg_MAX_STRING_LENGTH];
 
   node_name[0] = '\0';
+  node.inputs = NULL;
+  node.outputs = NULL;
   node.input_cnt = 0;
   node.output_cnt = 0;
   /*fprintf(stderr, "parse node...\n");*/
@@ -291,13 +293,13 @@ static bg_error parse_node(yaml_parser_t *parser, bg_graph_t *g) {
       if(done & done_INPUTS) {
         fprintf(stderr, "ERROR! multiple \"inputs\" sections.\n");
       }
-      err = parse_node_inputs(parser, node.inputs, &node.input_cnt);
+      err = parse_node_inputs(parser, &node.inputs, &node.input_cnt);
       done |= done_INPUTS;
     } else if(strcmp((const char*)event.data.scalar.value, "outputs") == 0) {
       if(done & done_OUTPUTS) {
         fprintf(stderr, "ERROR! multiple \"outputs\" sections.\n");
       }
-      err = parse_node_outputs(parser, node.outputs, &node.output_cnt);
+      err = parse_node_outputs(parser, &node.outputs, &node.output_cnt);
       done |= done_OUTPUTS;
     } else if(strcmp((const char*)event.data.scalar.value, "subgraph_name") == 0) {
       if(done & done_SUBGRAPH_NAME) {
@@ -399,6 +401,8 @@ static bg_error parse_node(yaml_parser_t *parser, bg_graph_t *g) {
       }
     }
   }
+  free(node.inputs);
+  free(node.outputs);
   return err;
 }
 
@@ -487,7 +491,7 @@ static bg_error parse_merge_type(yaml_parser_t *parser,
 }
 
 static bg_error parse_node_inputs(yaml_parser_t *parser,
-                                  input_struct *inputs, size_t *input_cnt) {
+                                  input_struct **inputs, size_t *input_cnt) {
   bg_error err;
   yaml_event_t event;
   const char done_TYPE = 1<<1;
@@ -497,6 +501,8 @@ static bg_error parse_node_inputs(yaml_parser_t *parser,
   char input_name[bg_MAX_STRING_LENGTH];
   char done = 0;
   size_t cnt = 0;
+  size_t capacity = 0;
+  input_struct *new_inputs;
   bool single_input = false;
 
   if(!yaml_parser_parse(parser, &event)) {
@@ -521,11 +527,17 @@ static bg_error parse_node_inputs(yaml_parser_t *parser,
   /*fprintf(stderr, "parse nodes inputs...");*/
 
   while(err == bg_SUCCESS && event.type != YAML_SEQUENCE_END_EVENT) {
-    if(cnt >= bg_MAX_PORTS) {
-      fprintf(stderr, "ERROR: to many inputs\n");
-      err = bg_error_set(bg_ERR_UNKNOWN);
-      break;
+    if(cnt == capacity) {
+      capacity = capacity ? capacity*2 : 4;
+      new_inputs = (input_struct*)realloc(*inputs,
+                                          capacity*sizeof(input_struct));
+      if(!new_inputs) {
+        err = bg_error_set(bg_ERR_NO_MEMORY);
+        break;
+      }
+      *inputs = new_inputs;
     }
+    memset(*inputs+cnt, 0, sizeof(input_struct));
     yaml_event_delete(&event);
     err = get_event(parser, &event, YAML_SCALAR_EVENT);
     done = 0;
@@ -535,7 +547,7 @@ static bg_error parse_node_inputs(yaml_parser_t *parser,
           fprintf(stderr, "ERROR! multiple \"default\" sections.\n");
           err = bg_error_set(bg_ERR_UNKNOWN);
         } else {
-          err = get_double(parser, &inputs[cnt].defaultValue);
+          err = get_double(parser, &(*inputs)[cnt].defaultValue);
           done |= done_DEFAULT;
         }
       } else if(strcmp((const char*)event.data.scalar.value, "bias") == 0) {
@@ -543,16 +555,16 @@ static bg_error parse_node_inputs(yaml_parser_t *parser,
           fprintf(stderr, "ERROR! multiple \"bias\" sections.\n");
           err = bg_error_set(bg_ERR_UNKNOWN);
         } else {
-          err = get_double(parser, &inputs[cnt].bias);
+          err = get_double(parser, &(*inputs)[cnt].bias);
           done |= done_BIAS;
-          /*fprintf(stderr, "read bias: %g\n", inputs[cnt].bias);*/
+          /*fprintf(stderr, "read bias: %g\n", (*inputs)[cnt].bias);*/
         }
       } else if(strcmp((const char*)event.data.scalar.value, "type") == 0) {
         if(done & done_TYPE) {
           fprintf(stderr, "ERROR! multiple \"type\" sections.\n");
           err = bg_error_set(bg_ERR_UNKNOWN);
         } else {
-          err = parse_merge_type(parser, &inputs[cnt].merge);
+          err = parse_merge_type(parser, &(*inputs)[cnt].merge);
           done |= done_TYPE;
         }
       } else if(strcmp((const char*)event.data.scalar.value, "name") == 0) {
@@ -583,7 +595,7 @@ static bg_error parse_node_inputs(yaml_parser_t *parser,
       char *name_copy;
       name_copy = malloc(strlen(input_name)+1);
       strcpy(name_copy, input_name);
-      inputs[cnt].name = name_copy;
+      (*inputs)[cnt].name = name_copy;
     }
     if(single_input) {
       event.type = YAML_SEQUENCE_END_EVENT;
@@ -603,13 +615,15 @@ static bg_error parse_node_inputs(yaml_parser_t *parser,
 }
 
 static bg_error parse_node_outputs(yaml_parser_t *parser,
-                                  output_struct *outputs, size_t *output_cnt) {
+                                  output_struct **outputs, size_t *output_cnt) {
   bg_error err;
   yaml_event_t event;
   const char done_OUTPUT_NAME = 1<<1;
   char output_name[bg_MAX_STRING_LENGTH];
   char done = 0;
   size_t cnt = 0;
+  size_t capacity = 0;
+  output_struct *new_outputs;
   bool single_output = false;
 
   if(!yaml_parser_parse(parser, &event)) {
@@ -628,11 +642,17 @@ static bg_error parse_node_outputs(yaml_parser_t *parser,
   /*fprintf(stderr, "parse nodes outputs...");*/
 
   while(err == bg_SUCCESS && event.type != YAML_SEQUENCE_END_EVENT) {
-    if(cnt >= bg_MAX_PORTS) {
-      fprintf(stderr, "ERROR: to many outputs\n");
-      err = bg_error_set(bg_ERR_UNKNOWN);
-      break;
+    if(cnt == capacity) {
+      capacity = capacity ? capacity*2 : 4;
+      new_outputs = (output_struct*)realloc(*outputs,
+                                            capacity*sizeof(output_struct));
+      if(!new_outputs) {
+        err = bg_error_set(bg_ERR_NO_MEMORY);
+        break;
+      }
+      *outputs = new_outputs;
     }
+    memset(*outputs+cnt, 0, sizeof(output_struct));
     yaml_event_delete(&event);
     err = get_event(parser, &event, YAML_SCALAR_EVENT);
     done = 0;
@@ -665,7 +685,7 @@ static bg_error parse_node_outputs(yaml_parser_t *parser,
       char *name_copy;
       name_copy = malloc(strlen(output_name)+1);
       strcpy(name_copy, output_name);
-      outputs[cnt].name = name_copy;
+      (*outputs)[cnt].name = name_copy;
     }
     if(single_output) {
       event.type = YAML_SEQUENCE_END_EVENT;
@@ -899,6 +919,10 @@ static bg_error connect_nodes(bg_graph_t *g, bg_edge_struct_list_t *edges) {
     }
     else {
       e->ignore_for_sort = edge->ignore_for_sort;
+      if(e->ignore_for_sort) {
+        /* the edge may have been ordered already */
+        g->eval_order_is_dirty = true;
+      }
     }
     free(edge);
   }
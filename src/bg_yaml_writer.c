@@ -4,7 +4,7 @@
 
 
 #include "generic_list.h"
-#include "node_list.h"
+#include "node_vector.h"
 #include "edge_list.h"
 #include "node_types/bg_node_subgraph.h"
 
@@ -51,14 +51,14 @@ static int emit_double(yaml_emitter_t *emitter, bg_real x) {
   return ok;
 }
 
-static int emit_node_list(yaml_emitter_t *emitter, bg_node_list_t *node_list) {
+static int emit_node_list(yaml_emitter_t *emitter, bg_node_vector_t *node_list) {
   yaml_event_t event;
   bg_node_t *current_node;
-  bg_node_list_iterator_t it;
+  bg_node_vector_iterator_t it;
   size_t i;
   int ok = 1;
-  for(current_node = bg_node_list_first(node_list, &it);
-      current_node; current_node = bg_node_list_next(&it)) {
+  for(current_node = bg_node_vector_first(node_list, &it);
+      current_node; current_node = bg_node_vector_next(&it)) {
     ok &= yaml_mapping_start_event_initialize(&event, NULL, NULL, 0,
                                         YAML_BLOCK_MAPPING_STYLE);
     ok &= yaml_emitter_emit(emitter, &event);
@@ -177,7 +177,7 @@ static int emit_edge_list(yaml_emitter_t *emitter, bg_edge_list_t *edge_list) {
       ok &= emit_ulong(emitter, current_edge->sink_port_idx);
 
       ok &= emit_str(emitter, "weight");
-      ok &= emit_double(emitter, current_edge->weight);
+      ok &= emit_double(emitter, bg_EDGE_WEIGHT(current_edge));
       ok &= emit_str(emitter, "ignore_for_sort");
       ok &= emit_ulong(emitter, current_edge->ignore_for_sort);
     
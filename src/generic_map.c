@@ -0,0 +1,147 @@
+#include "generic_map.h"
+
+#define MAP_MIN_CAPACITY 16
+
+typedef struct bg_map_item {
+  bg_map_key_t key;
+  size_t hash;
+  void *value;
+} bg_map_item;
+
+struct bg_map_t {
+  bg_map_item *items;
+  /* always a power of two */
+  size_t capacity;
+  size_t size;
+  bg_map_equal_fn equal;
+};
+
+static bool map_resize(bg_map_t *map, size_t capacity) {
+  bg_map_item *old_items = map->items;
+  size_t i, j, old_capacity = map->capacity;
+  bg_map_item *items = calloc(capacity, sizeof(bg_map_item));
+  if(!items) {
+    return false;
+  }
+  for(i = 0; i < old_capacity; ++i) {
+    if(old_items[i].value) {
+      j = old_items[i].hash & (capacity-1);
+      while(items[j].value) {
+        j = (j+1) & (capacity-1);
+      }
+      items[j] = old_items[i];
+    }
+  }
+  free(old_items);
+  map->items = items;
+  map->capacity = capacity;
+  return true;
+}
+
+/* the slot of the key or the free slot ending its probe sequence */
+static size_t map_slot(const bg_map_t *map, bg_map_key_t key, size_t len,
+                       size_t hash) {
+  size_t i = hash & (map->capacity-1);
+  while(map->items[i].value &&
+        !(map->items[i].hash == hash &&
+          map->equal(map->items[i].key, key, len))) {
+    i = (i+1) & (map->capacity-1);
+  }
+  return i;
+}
+
+void bg_map_init(bg_map_t **map, bg_map_equal_fn equal) {
+  *map = (bg_map_t*)calloc(1, sizeof(bg_map_t));
+  (*map)->items = NULL;
+  (*map)->capacity = 0;
+  (*map)->size = 0;
+  (*map)->equal = equal;
+}
+
+void bg_map_deinit(bg_map_t *map) {
+  free(map->items);
+  free(map);
+}
+
+void bg_map_clear(bg_map_t *map) {
+  size_t i;
+  for(i = 0; i < map->capacity; ++i) {
+    map->items[i].value = NULL;
+  }
+  map->size = 0;
+}
+
+bool bg_map_reserve(bg_map_t *map, size_t size) {
+  size_t capacity = map->capacity ? map->capacity : MAP_MIN_CAPACITY;
+  while(2*size > capacity) {
+    capacity *= 2;
+  }
+  if(capacity == map->capacity) {
+    return true;
+  }
+  return map_resize(map, capacity);
+}
+
+bool bg_map_insert(bg_map_t *map, bg_map_key_t key, size_t len, size_t hash,
+                   void *value) {
+  size_t i;
+  /* keep the load factor at or below 1/2 */
+  if(2*(map->size+1) > map->capacity) {
+    if(!map_resize(map, map->capacity ?
+                   2*map->capacity : MAP_MIN_CAPACITY)) {
+      return false;
+    }
+  }
+  i = map_slot(map, key, len, hash);
+  if(!map->items[i].value) {
+    map->size++;
+  }
+  map->items[i].key = key;
+  map->items[i].hash = hash;
+  map->items[i].value = value;
+  return true;
+}
+
+void* bg_map_find(const bg_map_t *map, bg_map_key_t key, size_t len,
+                  size_t hash) {
+  if(!map->size) {
+    return NULL;
+  }
+  return map->items[map_slot(map, key, len, hash)].value;
+}
+
+void* bg_map_erase(bg_map_t *map, bg_map_key_t key, size_t len, size_t hash) {
+  size_t i, j, home, mask = map->capacity-1;
+  void *ret;
+  if(!map->size) {
+    return NULL;
+  }
+  i = map_slot(map, key, len, hash);
+  ret = map->items[i].value;
+  if(!ret) {
+    return NULL;
+  }
+  /* shift the following items of the probe sequence back instead of
+   * leaving a tombstone */
+  j = i;
+  for(;;) {
+    j = (j+1) & mask;
+    if(!map->items[j].value) {
+      break;
+    }
+    home = map->items[j].hash & mask;
+    /* the item at j may move to i if its home is not in (i, j] */
+    if((i <= j) ? (i < home && home <= j) : (i < home || home <= j)) {
+      continue;
+    }
+    map->items[i] = map->items[j];
+    i = j;
+  }
+  map->items[i].value = NULL;
+  map->size--;
+  return ret;
+}
+
+size_t bg_map_size(const bg_map_t *map) {
+  return map->size;
+}
@@ -0,0 +1,120 @@
+#ifndef C_BAGEL_GENERIC_MAP_H
+#define C_BAGEL_GENERIC_MAP_H
+
+/**
+ * @file
+ * @brief Hash map with open addressing and linear probing.
+ *
+ * Values are stored as \c void* and must not be \c NULL since \c NULL marks
+ * a free slot. Keys are integers or strings; the map does not copy strings,
+ * they have to stay valid as long as they are in the map. The hash of a key
+ * is computed by the caller and stored with it. You can use the
+ * \ref MAP_TYPE_DEF macro to define maps for a specific key type.
+ */
+
+
+#include <stdlib.h>
+/*#include <stdbool.h>*/
+#include "bool.h"
+
+typedef struct bg_map_t bg_map_t;
+typedef union bg_map_key_t {
+  unsigned long id;
+  const char *str;
+} bg_map_key_t;
+
+/* compares a key in the map with a looked up key of length len */
+typedef bool (*bg_map_equal_fn)(bg_map_key_t stored, bg_map_key_t key,
+                                size_t len);
+
+void bg_map_init(bg_map_t **map, bg_map_equal_fn equal);
+void bg_map_deinit(bg_map_t *map);
+void bg_map_clear(bg_map_t *map);
+/* makes room for size keys without rehashing; returns false if out of memory */
+bool bg_map_reserve(bg_map_t *map, size_t size);
+/* replaces the value of an existing key; returns false if out of memory */
+bool bg_map_insert(bg_map_t *map, bg_map_key_t key, size_t len, size_t hash,
+                   void *value);
+void* bg_map_find(const bg_map_t *map, bg_map_key_t key, size_t len,
+                  size_t hash);
+/* returns the removed value or NULL if the key is not in the map */
+void* bg_map_erase(bg_map_t *map, bg_map_key_t key, size_t len, size_t hash);
+size_t bg_map_size(const bg_map_t *map);
+
+/**
+ * @brief macro to create maps for a specific key type.
+ * @param typename A short name describing the keys.
+ * @param keytype The type of the keys.
+ *
+ * Putting MAP_TYPE_DEF(foo, bar) in your code will define a new map type
+ * \c bg_foo_map_t and wrappers around the \c bg_map_* functions following
+ * the name convention \c bg_foo_map_*. The wrappers take keys of type
+ * \c bar and hash them for you.
+ * E.g., there will be a wrapper
+ * \code void* bg_foo_map_find(const bg_foo_map_t *map, bar key);\endcode
+ */
+#define MAP_TYPE_DEF(typename, keytype)                                 \
+  typedef struct bg_map_t bg_##typename##_map_t;                        \
+                                                                        \
+  void bg_##typename##_map_init(bg_##typename##_map_t **map);           \
+  void bg_##typename##_map_deinit(bg_##typename##_map_t *map);          \
+  void bg_##typename##_map_clear(bg_##typename##_map_t *map);           \
+  bool bg_##typename##_map_reserve(bg_##typename##_map_t *map,          \
+                                   size_t size);                        \
+  bool bg_##typename##_map_insert(bg_##typename##_map_t *map,           \
+                                  keytype key, void *value);            \
+  void* bg_##typename##_map_find(const bg_##typename##_map_t *map,      \
+                                 keytype key);                          \
+  void* bg_##typename##_map_erase(bg_##typename##_map_t *map,           \
+                                  keytype key);                         \
+  size_t bg_##typename##_map_size(const bg_##typename##_map_t *map);    \
+
+
+/**
+ * @brief macro to implement the wrappers declared by \ref MAP_TYPE_DEF.
+ * @param member The member of \c bg_map_key_t holding the keys.
+ * @param length A function returning the length of a key.
+ * @param hash A function hashing a key of the given length.
+ * @param equal The \c bg_map_equal_fn of the keys.
+ */
+#define MAP_TYPE_IMPL(typename, keytype, member, length, hash, equal)   \
+                                                                        \
+  static bg_map_key_t bg_##typename##_map_key(keytype key)              \
+  { bg_map_key_t map_key; map_key.member = key; return map_key; }       \
+                                                                        \
+  void bg_##typename##_map_init(bg_##typename##_map_t **map)            \
+  { bg_map_init(map, equal); }                                          \
+                                                                        \
+  void bg_##typename##_map_deinit(bg_##typename##_map_t *map)           \
+  { bg_map_deinit(map); }                                               \
+                                                                        \
+  void bg_##typename##_map_clear(bg_##typename##_map_t *map)            \
+  { bg_map_clear(map); }                                                \
+                                                                        \
+  bool bg_##typename##_map_reserve(bg_##typename##_map_t *map,          \
+                                   size_t size)                         \
+  { return bg_map_reserve(map, size); }                                 \
+                                                                        \
+  bool bg_##typename##_map_insert(bg_##typename##_map_t *map,           \
+                                  keytype key, void *value)             \
+  { size_t len = length(key);                                           \
+    return bg_map_insert(map, bg_##typename##_map_key(key), len,        \
+                         hash(key, len), value); }                      \
+                                                                        \
+  void* bg_##typename##_map_find(const bg_##typename##_map_t *map,      \
+                                 keytype key)                           \
+  { size_t len = length(key);                                           \
+    return bg_map_find(map, bg_##typename##_map_key(key), len,          \
+                       hash(key, len)); }                               \
+                                                                        \
+  void* bg_##typename##_map_erase(bg_##typename##_map_t *map,           \
+                                  keytype key)                          \
+  { size_t len = length(key);                                           \
+    return bg_map_erase(map, bg_##typename##_map_key(key), len,         \
+                        hash(key, len)); }                              \
+                                                                        \
+  size_t bg_##typename##_map_size(const bg_##typename##_map_t *map)     \
+  { return bg_map_size(map); }                                          \
+
+
+#endif /* C_BAGEL_GENERIC_MAP_H */
@@ -0,0 +1,171 @@
+#include "generic_vector.h"
+
+#include <assert.h>
+#include <string.h>
+
+struct bg_vector_t {
+  void **items;
+  size_t size;
+  size_t capacity;
+};
+
+
+
+void bg_vector_init(bg_vector_t **vector) {
+  *vector = (bg_vector_t*)calloc(1, sizeof(bg_vector_t));
+}
+
+void bg_vector_deinit(bg_vector_t *vector) {
+  free(vector->items);
+  free(vector);
+}
+
+void bg_vector_clear(bg_vector_t *vector) {
+  /* keeps the memory for the next fill */
+  vector->size = 0;
+}
+
+bool bg_vector_reserve(bg_vector_t *vector, size_t capacity) {
+  void **items;
+  if(capacity <= vector->capacity) {
+    return true;
+  }
+  items = (void**)realloc(vector->items, capacity*sizeof(void*));
+  if(!items) {
+    return false;
+  }
+  vector->items = items;
+  vector->capacity = capacity;
+  return true;
+}
+
+static bool bg_vector_grow(bg_vector_t *vector) {
+  if(vector->size < vector->capacity) {
+    return true;
+  }
+  return bg_vector_reserve(vector, vector->capacity ? vector->capacity*2 : 8);
+}
+
+void bg_vector_copy(bg_vector_t *dest_vector, const bg_vector_t *src_vector) {
+  bg_vector_clear(dest_vector);
+  if(!bg_vector_reserve(dest_vector, src_vector->size)) {
+    return;
+  }
+  if(src_vector->size) {
+    memcpy(dest_vector->items, src_vector->items,
+           src_vector->size*sizeof(void*));
+  }
+  dest_vector->size = src_vector->size;
+}
+
+void bg_vector_append(bg_vector_t *vector, void *obj) {
+  if(!bg_vector_grow(vector)) {
+    return;
+  }
+  vector->items[vector->size++] = obj;
+}
+
+void bg_vector_insert(bg_vector_iterator_t *it, void *obj) {
+  bg_vector_t *vector = it->vector;
+  /* an iterator past the end appends */
+  if(it->idx > vector->size) {
+    it->idx = vector->size;
+  }
+  if(!bg_vector_grow(vector)) {
+    return;
+  }
+  memmove(vector->items+it->idx+1, vector->items+it->idx,
+          (vector->size-it->idx)*sizeof(void*));
+  vector->items[it->idx] = obj;
+  vector->size++;
+}
+
+void* bg_vector_erase(bg_vector_iterator_t *it) {
+  bg_vector_t *vector = it->vector;
+  assert(it->idx < vector->size);
+  memmove(vector->items+it->idx, vector->items+it->idx+1,
+          (vector->size-it->idx-1)*sizeof(void*));
+  vector->size--;
+  return bg_vector_get_element(it);
+}
+
+void* bg_vector_first(bg_vector_t *vector, bg_vector_iterator_t *it) {
+  it->vector = vector;
+  it->idx = 0;
+  return bg_vector_get_element(it);
+}
+
+void* bg_vector_next(bg_vector_iterator_t *it) {
+  const bg_vector_t *vector = it->vector;
+  if(it->idx+1 < vector->size) {
+    return vector->items[++it->idx];
+  }
+  it->idx = vector->size;
+  return NULL;
+}
+
+void* bg_vector_last(bg_vector_t *vector, bg_vector_iterator_t *it) {
+  it->vector = vector;
+  it->idx = vector->size ? vector->size-1 : 0;
+  return bg_vector_get_element(it);
+}
+
+void* bg_vector_prev(bg_vector_iterator_t *it) {
+  /* moving before the first value ends the iteration */
+  it->idx = it->idx ? it->idx-1 : it->vector->size;
+  return bg_vector_get_element(it);
+}
+
+bool bg_vector_find(bg_vector_t *vector, const void *obj,
+                    bg_vector_iterator_t *it) {
+  size_t i;
+  it->vector = vector;
+  for(i = 0; i < vector->size; ++i) {
+    if(vector->items[i] == obj) {
+      break;
+    }
+  }
+  it->idx = i;
+  return i < vector->size;
+}
+
+void* bg_vector_get_element(bg_vector_iterator_t *it) {
+  void *ret = NULL;
+  if(it->idx < it->vector->size) {
+    ret = it->vector->items[it->idx];
+  }
+  return ret;
+}
+
+void* bg_vector_get(const bg_vector_t *vector, size_t idx) {
+  void *ret = NULL;
+  if(idx < vector->size) {
+    ret = vector->items[idx];
+  }
+  return ret;
+}
+
+void bg_vector_set(bg_vector_t *vector, size_t idx, void *obj) {
+  assert(idx < vector->size);
+  vector->items[idx] = obj;
+}
+
+void bg_vector_truncate(bg_vector_t *vector, size_t size) {
+  /* keeps the memory like bg_vector_clear() */
+  if(size < vector->size) {
+    vector->size = size;
+  }
+}
+
+size_t bg_vector_size(const bg_vector_t *vector) {
+  return vector->size;
+}
+
+bool bg_vector_empty(const bg_vector_t *vector) {
+  return vector->size == 0;
+}
+
+bool bg_vector_contains(bg_vector_t *vector, const void *obj) {
+  bg_vector_iterator_t it;
+  return bg_vector_find(vector, obj, &it);
+}
@@ -0,0 +1,174 @@
+#ifndef C_BAGEL_GENERIC_VECTOR_H
+#define C_BAGEL_GENERIC_VECTOR_H
+
+/**
+ * @file
+ * @brief Growable array.
+ *
+ * Values are stored as \c void* in one contiguous block. The interface
+ * mirrors the one of the doubly linked list in generic_list.h, so the
+ * iterator based loops work unchanged. Inserting and erasing in the middle
+ * moves the following values. You can use the \ref VECTOR_TYPE_DEF macro
+ * to define vectors for a specific type.
+ */
+
+
+#include <stdlib.h>
+/*#include <stdbool.h>*/
+#include "bool.h"
+
+typedef struct bg_vector_t bg_vector_t;
+typedef struct bg_vector_iterator_t {
+  bg_vector_t *vector;
+  size_t idx;
+} bg_vector_iterator_t;
+
+void bg_vector_init(bg_vector_t **vector);
+void bg_vector_deinit(bg_vector_t *vector);
+void bg_vector_clear(bg_vector_t *vector);
+bool bg_vector_reserve(bg_vector_t *vector, size_t capacity);
+void bg_vector_copy(bg_vector_t *dest_vector, const bg_vector_t *src_vector);
+void bg_vector_append(bg_vector_t *vector, void *obj);
+void bg_vector_insert(bg_vector_iterator_t *it, void *obj);
+void* bg_vector_erase(bg_vector_iterator_t *it);
+void* bg_vector_first(bg_vector_t *vector, bg_vector_iterator_t *it);
+void* bg_vector_next(bg_vector_iterator_t *it);
+void* bg_vector_last(bg_vector_t *vector, bg_vector_iterator_t *it);
+void* bg_vector_prev(bg_vector_iterator_t *it);
+bool bg_vector_find(bg_vector_t *vector, const void *obj,
+                    bg_vector_iterator_t *it);
+void* bg_vector_get_element(bg_vector_iterator_t *it);
+void* bg_vector_get(const bg_vector_t *vector, size_t idx);
+/* replaces the element at idx < size */
+void bg_vector_set(bg_vector_t *vector, size_t idx, void *obj);
+/* drops the elements from size on */
+void bg_vector_truncate(bg_vector_t *vector, size_t size);
+size_t bg_vector_size(const bg_vector_t *vector);
+bool bg_vector_empty(const bg_vector_t *vector);
+bool bg_vector_contains(bg_vector_t *vector, const void *obj);
+
+/**
+ * @brief macro to create vectors for a specific type.
+ * @param typename A short name describing the type.
+ * @param basetype The type of the underlying objects.
+ *
+ * Putting VECTOR_TYPE_DEF(foo, bar) in your code will define a new vector
+ * type \c bg_foo_vector_t and wrappers around the \c bg_vector_* functions
+ * following the name convention \c bg_foo_vector_*. The accessor functions
+ * will take care to cast from and to type \c bar for you.
+ * E.g., there will be a wrapper
+ * \code bar* bg_foo_vector_get(const bg_foo_vector_t *vector, size_t idx);\endcode
+ */
+#define VECTOR_TYPE_DEF(typename, basetype)                             \
+  typedef struct bg_vector_t bg_##typename##_vector_t;                  \
+  typedef struct bg_vector_iterator_t bg_##typename##_vector_iterator_t; \
+                                                                        \
+  void bg_##typename##_vector_init(bg_##typename##_vector_t **vector);  \
+  void bg_##typename##_vector_deinit(bg_##typename##_vector_t *vector); \
+  void bg_##typename##_vector_clear(bg_##typename##_vector_t *vector);  \
+  bool bg_##typename##_vector_reserve(bg_##typename##_vector_t *vector, \
+                                      size_t capacity);                 \
+  void bg_##typename##_vector_copy(bg_##typename##_vector_t *dest_vector, \
+                                   const bg_##typename##_vector_t *src_vector); \
+  void bg_##typename##_vector_append(bg_##typename##_vector_t *vector,  \
+                                     basetype *obj);                    \
+  void bg_##typename##_vector_insert(bg_##typename##_vector_iterator_t *it, \
+                                     basetype *obj);                    \
+  basetype * bg_##typename##_vector_erase(bg_##typename##_vector_iterator_t *it); \
+  basetype * bg_##typename##_vector_first(bg_##typename##_vector_t *vector, \
+                                          bg_##typename##_vector_iterator_t *it); \
+  basetype * bg_##typename##_vector_next(bg_##typename##_vector_iterator_t *it); \
+  basetype * bg_##typename##_vector_last(bg_##typename##_vector_t *vector, \
+                                         bg_##typename##_vector_iterator_t *it); \
+  basetype * bg_##typename##_vector_prev(bg_##typename##_vector_iterator_t *it); \
+  bool bg_##typename##_vector_find(bg_##typename##_vector_t *vector,    \
+                                   const basetype *obj,                 \
+                                   bg_##typename##_vector_iterator_t *it); \
+  basetype * bg_##typename##_vector_get_element(bg_##typename##_vector_iterator_t *it); \
+  basetype * bg_##typename##_vector_get(const bg_##typename##_vector_t *vector, \
+                                        size_t idx);                    \
+  void bg_##typename##_vector_set(bg_##typename##_vector_t *vector,     \
+                                  size_t idx, basetype *obj);           \
+  void bg_##typename##_vector_truncate(bg_##typename##_vector_t *vector, \
+                                       size_t size);                    \
+  size_t bg_##typename##_vector_size(const bg_##typename##_vector_t *vector); \
+  bool bg_##typename##_vector_empty(const bg_##typename##_vector_t *vector); \
+  bool bg_##typename##_vector_contains(bg_##typename##_vector_t *vector, \
+                                       const basetype *obj);            \
+
+
+#define VECTOR_TYPE_IMPL(typename, basetype)                            \
+                                                                        \
+  void bg_##typename##_vector_init(bg_##typename##_vector_t **vector)   \
+  { bg_vector_init(vector); }                                           \
+                                                                        \
+  void bg_##typename##_vector_deinit(bg_##typename##_vector_t *vector)  \
+  { bg_vector_deinit(vector); }                                         \
+                                                                        \
+  void bg_##typename##_vector_clear(bg_##typename##_vector_t *vector)   \
+  { bg_vector_clear(vector); }                                          \
+                                                                        \
+  bool bg_##typename##_vector_reserve(bg_##typename##_vector_t *vector, \
+                                      size_t capacity)                  \
+  { return bg_vector_reserve(vector, capacity); }                       \
+                                                                        \
+  void bg_##typename##_vector_copy(bg_##typename##_vector_t *dest_vector, \
+                                   const bg_##typename##_vector_t *src_vector) \
+  { bg_vector_copy(dest_vector, src_vector); }                          \
+                                                                        \
+  void bg_##typename##_vector_append(bg_##typename##_vector_t *vector,  \
+                                     basetype *obj)                     \
+  { bg_vector_append(vector, (void*)obj); }                             \
+                                                                        \
+  void bg_##typename##_vector_insert(bg_##typename##_vector_iterator_t *it, \
+                                     basetype *obj)                     \
+  { bg_vector_insert(it, obj); }                                        \
+                                                                        \
+  basetype * bg_##typename##_vector_erase(bg_##typename##_vector_iterator_t *it) \
+  { return bg_vector_erase(it); }                                       \
+                                                                        \
+  basetype * bg_##typename##_vector_first(bg_##typename##_vector_t *vector, \
+                                          bg_##typename##_vector_iterator_t *it) \
+  { return bg_vector_first(vector, it); }                               \
+                                                                        \
+  basetype * bg_##typename##_vector_next(bg_##typename##_vector_iterator_t *it) \
+  { return bg_vector_next(it); }                                        \
+                                                                        \
+  basetype * bg_##typename##_vector_last(bg_##typename##_vector_t *vector, \
+                                         bg_##typename##_vector_iterator_t *it) \
+  { return bg_vector_last(vector, it); }                                \
+                                                                        \
+  basetype * bg_##typename##_vector_prev(bg_##typename##_vector_iterator_t *it) \
+  { return bg_vector_prev(it); }                                        \
+                                                                        \
+  bool bg_##typename##_vector_find(bg_##typename##_vector_t *vector,    \
+                                   const basetype *obj,                 \
+                                   bg_##typename##_vector_iterator_t *it) \
+  { return bg_vector_find(vector, obj, it); }                           \
+                                                                        \
+  basetype * bg_##typename##_vector_get_element(bg_##typename##_vector_iterator_t *it) \
+  { return bg_vector_get_element(it); }                                 \
+                                                                        \
+  basetype * bg_##typename##_vector_get(const bg_##typename##_vector_t *vector, \
+                                        size_t idx)                     \
+  { return bg_vector_get(vector, idx); }                                \
+                                                                        \
+  void bg_##typename##_vector_set(bg_##typename##_vector_t *vector,     \
+                                  size_t idx, basetype *obj)            \
+  { bg_vector_set(vector, idx, (void*)obj); }                           \
+                                                                        \
+  void bg_##typename##_vector_truncate(bg_##typename##_vector_t *vector, \
+                                       size_t size)                     \
+  { bg_vector_truncate(vector, size); }                                 \
+                                                                        \
+  size_t bg_##typename##_vector_size(const bg_##typename##_vector_t *vector) \
+  { return bg_vector_size(vector); }                                    \
+                                                                        \
+  bool bg_##typename##_vector_empty(const bg_##typename##_vector_t *vector) \
+  { return bg_vector_empty(vector); }                                   \
+  bool bg_##typename##_vector_contains(bg_##typename##_vector_t *vector, \
+                                       const basetype *obj)             \
+  { return bg_vector_contains(vector, obj); }                           \
+
+
+#endif /* C_BAGEL_GENERIC_VECTOR_H */
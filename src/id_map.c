@@ -0,0 +1,21 @@
+#include "id_map.h"
+
+static size_t id_map_length(unsigned long key) {
+  return 0;
+  (void)key;
+}
+
+static size_t id_map_hash(unsigned long key, size_t len) {
+  key ^= key >> 16;
+  key *= 0x45d9f3bUL;
+  key ^= key >> 16;
+  return (size_t)key;
+  (void)len;
+}
+
+static bool id_map_equal(bg_map_key_t stored, bg_map_key_t key, size_t len) {
+  return stored.id == key.id;
+  (void)len;
+}
+
+MAP_TYPE_IMPL(id, unsigned long, id, id_map_length, id_map_hash, id_map_equal)
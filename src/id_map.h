@@ -0,0 +1,13 @@
+#ifndef C_BAGEL_ID_MAP_H
+#define C_BAGEL_ID_MAP_H
+
+/**
+ * @file
+ * @brief Hash map from node and edge ids to objects.
+ */
+
+#include "generic_map.h"
+
+MAP_TYPE_DEF(id, unsigned long)
+
+#endif /* C_BAGEL_ID_MAP_H */
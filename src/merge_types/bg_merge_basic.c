@@ -13,17 +13,18 @@ static bg_error merge_sum(input_port_t *input_port) {
     value += input_port->defaultValue;
   } else {
     for(i = 0; i < input_port->num_edges; ++i) {
-      value += input_port->edges[i]->value * input_port->edges[i]->weight;
+      value += bg_EDGE_INPUT(input_port->edges[i]) * bg_EDGE_WEIGHT(input_port->edges[i]);
       /*fprintf(stderr, "%lu %lu in->value: %g, in->weight: %g\n", i,
               (size_t)input_port->edges[i],
               input_port->edges[i]->value, input_port->edges[i]->weight);*/
     }
   }
-  input_port->value = value;
+  bg_PORT_VALUE(input_port) = value;
   return bg_SUCCESS;
 }
 
-static bg_error merge_sum_interval(input_port_t *input_port) {
+static bg_error merge_sum_interval(input_port_t *input_port,
+                                   bg_interval_scratch_t *scratch) {
 #ifdef INTERVAL_SUPPORT
   size_t i;
   mpfi_set_d(input_port->value_intv, input_port->bias);
@@ -31,19 +32,17 @@ static bg_error merge_sum_interval(input_port_t *input_port) {
     mpfi_add_d(input_port->value_intv,
                input_port->value_intv, input_port->defaultValue);
   } else {
-    mpfi_t tmp;
-    mpfi_init(tmp);
     for(i = 0; i < input_port->num_edges; ++i) {
-      mpfi_mul_d(tmp, input_port->edges[i]->value_intv,
-                 input_port->edges[i]->weight);
-      mpfi_add(input_port->value_intv, input_port->value_intv, tmp);
+      mpfi_mul_d(scratch->tmp, input_port->edges[i]->value_intv,
+                 bg_EDGE_WEIGHT(input_port->edges[i]));
+      mpfi_add(input_port->value_intv, input_port->value_intv, scratch->tmp);
     }
-    mpfi_clear(tmp);
   }
   return bg_SUCCESS;
 #else
   return bg_ERR_NOT_IMPLEMENTED;
   (void)input_port;
+  (void)scratch;
 #endif
 }
 
@@ -60,50 +59,48 @@ static bg_error merge_weighted_sum(input_port_t *input_port) {
   } else {
     for(i = 0; i < input_port->num_edges; ++i) {
       edge = input_port->edges[i];
-      value += edge->value * edge->weight;
-      sum_weights += fabs(edge->weight);
+      value += bg_EDGE_INPUT(edge) * bg_EDGE_WEIGHT(edge);
+      sum_weights += fabs(bg_EDGE_WEIGHT(edge));
     }
   }
   if(sum_weights > bg_EPSILON) {
-    input_port->value = (value / sum_weights) + input_port->bias;
+    bg_PORT_VALUE(input_port) = (value / sum_weights) + input_port->bias;
   }
   else {
-    input_port->value = input_port->bias;
+    bg_PORT_VALUE(input_port) = input_port->bias;
   }
   return bg_SUCCESS;
 }
 
-static bg_error merge_weighted_sum_interval(input_port_t *input_port) {
+static bg_error merge_weighted_sum_interval(input_port_t *input_port,
+                                            bg_interval_scratch_t *scratch) {
 #ifdef INTERVAL_SUPPORT
   size_t i;
   bg_edge_t *edge;
   bg_real sum_weights = 0.0;
-  mpfi_t value, tmp;
-  mpfi_init_set_d(value, 0.);
-  mpfi_init_set_d(tmp, 0.);
+  mpfi_set_d(scratch->value, 0.);
   if(input_port->num_edges == 0) {
-    mpfi_add_d(value, value, input_port->defaultValue);
+    mpfi_add_d(scratch->value, scratch->value, input_port->defaultValue);
     sum_weights = 1.0;
   } else {
     for(i = 0; i < input_port->num_edges; ++i) {
       edge = input_port->edges[i];
-      mpfi_mul_d(tmp, edge->value_intv, edge->weight);
-      mpfi_add(value, value, tmp);
-      sum_weights += fabs(edge->weight);
+      mpfi_mul_d(scratch->tmp, edge->value_intv, bg_EDGE_WEIGHT(edge));
+      mpfi_add(scratch->value, scratch->value, scratch->tmp);
+      sum_weights += fabs(bg_EDGE_WEIGHT(edge));
     }
   }
   if(sum_weights > bg_EPSILON) {
-    mpfi_div_d(value, value, sum_weights);
-    mpfi_add_d(input_port->value_intv, value, input_port->bias);
+    mpfi_div_d(scratch->value, scratch->value, sum_weights);
+    mpfi_add_d(input_port->value_intv, scratch->value, input_port->bias);
   } else {
     mpfi_set_d(input_port->value_intv, input_port->bias);
   }
-  mpfi_clear(tmp);
-  mpfi_clear(value);
   return bg_SUCCESS;
 #else
   return bg_ERR_NOT_IMPLEMENTED;
   (void)input_port;
+  (void)scratch;
 #endif
 }
 
@@ -115,35 +112,33 @@ static bg_error merge_product(input_port_t *input_port) {
     value *= input_port->defaultValue;
   } else {
     for(i = 0; i < input_port->num_edges; ++i) {
-      value *= input_port->edges[i]->value * input_port->edges[i]->weight;
+      value *= bg_EDGE_INPUT(input_port->edges[i]) * bg_EDGE_WEIGHT(input_port->edges[i]);
     }
   }
-  input_port->value = value;
+  bg_PORT_VALUE(input_port) = value;
   return bg_SUCCESS;
 }
 
-static bg_error merge_product_interval(input_port_t *input_port) {
+static bg_error merge_product_interval(input_port_t *input_port,
+                                       bg_interval_scratch_t *scratch) {
 #ifdef INTERVAL_SUPPORT
   size_t i;
-  mpfi_t value, tmp;
-  mpfi_init(tmp);
-  mpfi_init_set_d(value, input_port->bias);
+  mpfi_set_d(scratch->value, input_port->bias);
   if(input_port->num_edges == 0) {
-    mpfi_mul_d(value, value, input_port->defaultValue);
+    mpfi_mul_d(scratch->value, scratch->value, input_port->defaultValue);
   } else {
     for(i = 0; i < input_port->num_edges; ++i) {
-      mpfi_mul_d(tmp, input_port->edges[i]->value_intv,
-                 input_port->edges[i]->weight);
-      mpfi_mul(value, value, tmp);
+      mpfi_mul_d(scratch->tmp, input_port->edges[i]->value_intv,
+                 bg_EDGE_WEIGHT(input_port->edges[i]));
+      mpfi_mul(scratch->value, scratch->value, scratch->tmp);
     }
   }
-  mpfi_set(input_port->value_intv, value);
-  mpfi_clear(tmp);
-  mpfi_clear(value);
+  mpfi_set(input_port->value_intv, scratch->value);
   return bg_SUCCESS;
 #else
   return bg_ERR_NOT_IMPLEMENTED;
   (void)input_port;
+  (void)scratch;
 #endif
 }
 
@@ -159,55 +154,47 @@ static bg_error merge_min(input_port_t *input_port) {
   } else {
     for(i = 0; i < input_port->num_edges; ++i) {
       edge = input_port->edges[i];
-      if(edge->value * edge->weight < value) {
-        value = edge->value * edge->weight;
+      if(bg_EDGE_INPUT(edge) * bg_EDGE_WEIGHT(edge) < value) {
+        value = bg_EDGE_INPUT(edge) * bg_EDGE_WEIGHT(edge);
       }
     }
   }
-  input_port->value = value;
+  bg_PORT_VALUE(input_port) = value;
   return bg_SUCCESS;
 }
 
-static bg_error merge_min_interval(input_port_t *input_port) {
+static bg_error merge_min_interval(input_port_t *input_port,
+                                   bg_interval_scratch_t *scratch) {
 #ifdef INTERVAL_SUPPORT
   size_t i;
   bg_edge_t *edge;
-  mpfi_t tmp;
-  mpfr_t left, right, low, high;
-  mpfi_init(tmp);
-  mpfr_init(left);
-  mpfr_init(right);
-  mpfr_init_set_d(low, input_port->bias, MPFR_RNDD);
-  mpfr_init_set_d(high, input_port->bias, MPFR_RNDU);
+  mpfr_set_d(scratch->low, input_port->bias, MPFR_RNDD);
+  mpfr_set_d(scratch->high, input_port->bias, MPFR_RNDU);
   if(input_port->num_edges == 0) {
-    if(mpfr_cmp_d(low, input_port->defaultValue) > 0) {
-      mpfr_set_d(low, input_port->defaultValue, MPFR_RNDD);
-      mpfr_set_d(high, input_port->defaultValue, MPFR_RNDU);
+    if(mpfr_cmp_d(scratch->low, input_port->defaultValue) > 0) {
+      mpfr_set_d(scratch->low, input_port->defaultValue, MPFR_RNDD);
+      mpfr_set_d(scratch->high, input_port->defaultValue, MPFR_RNDU);
     }
   } else {
     for(i = 0; i < input_port->num_edges; ++i) {
       edge = input_port->edges[i];
-      mpfi_mul_d(tmp, edge->value_intv, edge->weight);
-      mpfi_get_left(left, tmp);
-      mpfi_get_right(right, tmp);
-      if(mpfr_cmp(low, left) > 0) {
-        mpfr_set(low, left, MPFR_RNDD);
+      mpfi_mul_d(scratch->tmp, edge->value_intv, bg_EDGE_WEIGHT(edge));
+      mpfi_get_left(scratch->left, scratch->tmp);
+      mpfi_get_right(scratch->right, scratch->tmp);
+      if(mpfr_cmp(scratch->low, scratch->left) > 0) {
+        mpfr_set(scratch->low, scratch->left, MPFR_RNDD);
       }
-      if(mpfr_cmp(high, right) > 0) {
-        mpfr_set(high, right, MPFR_RNDU);
+      if(mpfr_cmp(scratch->high, scratch->right) > 0) {
+        mpfr_set(scratch->high, scratch->right, MPFR_RNDU);
       }
     }
   }
-  mpfi_interv_fr(input_port->value_intv, low, high);
-  mpfi_clear(tmp);
-  mpfr_clear(left);
-  mpfr_clear(right);
-  mpfr_clear(low);
-  mpfr_clear(high);
+  mpfi_interv_fr(input_port->value_intv, scratch->low, scratch->high);
   return bg_SUCCESS;
 #else
   return bg_ERR_NOT_IMPLEMENTED;
   (void)input_port;
+  (void)scratch;
 #endif
 }
 
@@ -223,55 +210,47 @@ static bg_error merge_max(input_port_t *input_port) {
   } else {
     for(i = 0; i < input_port->num_edges; ++i) {
       edge = input_port->edges[i];
-      if(edge->value * edge->weight > value) {
-        value = edge->value * edge->weight;
+      if(bg_EDGE_INPUT(edge) * bg_EDGE_WEIGHT(edge) > value) {
+        value = bg_EDGE_INPUT(edge) * bg_EDGE_WEIGHT(edge);
       }
     }
   }
-  input_port->value = value;
+  bg_PORT_VALUE(input_port) = value;
   return bg_SUCCESS;
 }
 
-static bg_error merge_max_interval(input_port_t *input_port) {
+static bg_error merge_max_interval(input_port_t *input_port,
+                                   bg_interval_scratch_t *scratch) {
 #ifdef INTERVAL_SUPPORT
   size_t i;
   bg_edge_t *edge;
-  mpfi_t tmp;
-  mpfr_t left, right, low, high;
-  mpfi_init(tmp);
-  mpfr_init(left);
-  mpfr_init(right);
-  mpfr_init_set_d(low, input_port->bias, MPFR_RNDD);
-  mpfr_init_set_d(high, input_port->bias, MPFR_RNDU);
+  mpfr_set_d(scratch->low, input_port->bias, MPFR_RNDD);
+  mpfr_set_d(scratch->high, input_port->bias, MPFR_RNDU);
   if(input_port->num_edges == 0) {
-    if(mpfr_cmp_d(low, input_port->defaultValue) < 0) {
-      mpfr_set_d(low, input_port->defaultValue, MPFR_RNDD);
-      mpfr_set_d(high, input_port->defaultValue, MPFR_RNDU);
+    if(mpfr_cmp_d(scratch->low, input_port->defaultValue) < 0) {
+      mpfr_set_d(scratch->low, input_port->defaultValue, MPFR_RNDD);
+      mpfr_set_d(scratch->high, input_port->defaultValue, MPFR_RNDU);
     }
   } else {
     for(i = 0; i < input_port->num_edges; ++i) {
       edge = input_port->edges[i];
-      mpfi_mul_d(tmp, edge->value_intv, edge->weight);
-      mpfi_get_left(left, tmp);
-      mpfi_get_right(right, tmp);
-      if(mpfr_cmp(low, left) < 0) {
-        mpfr_set(low, left, MPFR_RNDD);
+      mpfi_mul_d(scratch->tmp, edge->value_intv, bg_EDGE_WEIGHT(edge));
+      mpfi_get_left(scratch->left, scratch->tmp);
+      mpfi_get_right(scratch->right, scratch->tmp);
+      if(mpfr_cmp(scratch->low, scratch->left) < 0) {
+        mpfr_set(scratch->low, scratch->left, MPFR_RNDD);
       }
-      if(mpfr_cmp(high, right) < 0) {
-        mpfr_set(high, right, MPFR_RNDU);
+      if(mpfr_cmp(scratch->high, scratch->right) < 0) {
+        mpfr_set(scratch->high, scratch->right, MPFR_RNDU);
       }
     }
   }
-  mpfi_interv_fr(input_port->value_intv, low, high);
-  mpfi_clear(tmp);
-  mpfr_clear(left);
-  mpfr_clear(right);
-  mpfr_clear(low);
-  mpfr_clear(high);
+  mpfi_interv_fr(input_port->value_intv, scratch->low, scratch->high);
   return bg_SUCCESS;
 #else
   return bg_ERR_NOT_IMPLEMENTED;
   (void)input_port;
+  (void)scratch;
 #endif
 }
 
@@ -309,72 +288,124 @@ static bg_real kth_smallest(bg_real *a, int n, int k) {
   return a[k];
 }
 
+/*
+ * Selection networks for small fan-ins, from the same page by N. Devillard
+ * (opt_med3, opt_med5, opt_med7 and opt_med9). They need no branches on the
+ * data besides the compare-exchange steps.
+ */
+#define SORT2(a, b) { if((a) > (b)) { tmp = (a); (a) = (b); (b) = tmp; } }
+
+/* NaNs and zeros of either sign are not ordered the same way by the
+ * networks and by kth_smallest, so those values are left to kth_smallest */
+static bool median_is_ordered(const bg_real *p, size_t cnt) {
+  size_t i;
+  for(i = 0; i < cnt; ++i) {
+    if(p[i] != p[i] || p[i] == 0.) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bg_real bg_merge_median(bg_real *p, size_t cnt) {
+  bg_real tmp, value;
+  switch(median_is_ordered(p, cnt) ? cnt : 0) {
+  case 1:
+    return p[0];
+  case 2:
+    SORT2(p[0], p[1]);
+    return (p[1] + p[0]) / 2.;
+  case 3:
+    SORT2(p[0], p[1]); SORT2(p[1], p[2]); SORT2(p[0], p[1]);
+    return p[1];
+  case 4:
+    SORT2(p[0], p[1]); SORT2(p[2], p[3]); SORT2(p[0], p[2]);
+    SORT2(p[1], p[3]); SORT2(p[1], p[2]);
+    return (p[2] + p[1]) / 2.;
+  case 5:
+    SORT2(p[0], p[1]); SORT2(p[3], p[4]); SORT2(p[0], p[3]);
+    SORT2(p[1], p[4]); SORT2(p[1], p[2]); SORT2(p[2], p[3]);
+    SORT2(p[1], p[2]);
+    return p[2];
+  case 7:
+    SORT2(p[0], p[5]); SORT2(p[0], p[3]); SORT2(p[1], p[6]);
+    SORT2(p[2], p[4]); SORT2(p[0], p[1]); SORT2(p[3], p[5]);
+    SORT2(p[2], p[6]); SORT2(p[2], p[3]); SORT2(p[3], p[6]);
+    SORT2(p[4], p[5]); SORT2(p[1], p[4]); SORT2(p[1], p[3]);
+    SORT2(p[3], p[4]);
+    return p[3];
+  case 9:
+    SORT2(p[1], p[2]); SORT2(p[4], p[5]); SORT2(p[7], p[8]);
+    SORT2(p[0], p[1]); SORT2(p[3], p[4]); SORT2(p[6], p[7]);
+    SORT2(p[1], p[2]); SORT2(p[4], p[5]); SORT2(p[7], p[8]);
+    SORT2(p[0], p[3]); SORT2(p[5], p[8]); SORT2(p[4], p[7]);
+    SORT2(p[3], p[6]); SORT2(p[1], p[4]); SORT2(p[2], p[5]);
+    SORT2(p[4], p[7]); SORT2(p[4], p[2]); SORT2(p[6], p[4]);
+    SORT2(p[4], p[2]);
+    return p[4];
+  default:
+    value = kth_smallest(p, cnt, cnt / 2);
+    /* if even number of elements take mean of the middle two */
+    if(!(cnt & 1)) {
+      value += kth_smallest(p, cnt, (cnt / 2) - 1);
+      value /= 2.;
+    }
+    return value;
+  }
+}
+
+#undef SORT2
+
 /*
   We handle the bias differently, documentation needed!
  */
 static bg_error merge_median(input_port_t *input_port) {
-  size_t i, cnt;
-  bg_real *values;
+  size_t i;
   bg_real value;
-  cnt = (input_port->num_edges ? input_port->num_edges : 1);
-  values = (bg_real*)malloc(sizeof(bg_real) * cnt);
+  bg_real *values = input_port->scratch;
 
   if(input_port->num_edges == 0) {
-    values[0] = input_port->defaultValue;
+    value = input_port->defaultValue;
   } else {
     for(i = 0; i < input_port->num_edges; ++i) {
-      values[i] = input_port->edges[i]->value * input_port->edges[i]->weight;
+      values[i] = bg_EDGE_INPUT(input_port->edges[i]) * bg_EDGE_WEIGHT(input_port->edges[i]);
     }
+    value = bg_merge_median(values, input_port->num_edges);
   }
-
-  value = kth_smallest(values, cnt, cnt / 2);
-  /* if even number of elements take mean of the middle two */
-  if(!(cnt & 1)) {
-    value += kth_smallest(values, cnt, (cnt / 2) - 1);
-    value /= 2.;
-  }
-  free(values);
-  input_port->value = value + input_port->bias;
+  bg_PORT_VALUE(input_port) = value + input_port->bias;
   return bg_SUCCESS;
 }
 
-static bg_error merge_median_interval(input_port_t *input_port) {
+static bg_error merge_median_interval(input_port_t *input_port,
+                                      bg_interval_scratch_t *scratch) {
 #ifdef INTERVAL_SUPPORT
   size_t i;
-  mpfr_t low, high, left, right;
-  mpfi_t tmp;
-  mpfi_init(tmp);
-  mpfr_init(low);
-  mpfr_init(high);
-  mpfr_init(left);
-  mpfr_init(right);
   if(input_port->num_edges == 0) {
-    mpfr_set_d(low, input_port->defaultValue, MPFR_RNDD);
-    mpfr_set_d(high, input_port->defaultValue, MPFR_RNDU);
+    mpfr_set_d(scratch->low, input_port->defaultValue, MPFR_RNDD);
+    mpfr_set_d(scratch->high, input_port->defaultValue, MPFR_RNDU);
   } else {
+    /* start from NaN like freshly initialized numbers */
+    mpfr_set_nan(scratch->low);
+    mpfr_set_nan(scratch->high);
     for(i = 0; i < input_port->num_edges; ++i) {
-      mpfi_mul_d(tmp, input_port->edges[i]->value_intv,
-                 input_port->edges[i]->weight);
-      mpfi_get_left(left, tmp);
-      mpfi_get_right(right, tmp);
-      if(mpfr_cmp(left, low) < 0) {
-        mpfr_set(low, left, MPFR_RNDD);
+      mpfi_mul_d(scratch->tmp, input_port->edges[i]->value_intv,
+                 bg_EDGE_WEIGHT(input_port->edges[i]));
+      mpfi_get_left(scratch->left, scratch->tmp);
+      mpfi_get_right(scratch->right, scratch->tmp);
+      if(mpfr_cmp(scratch->left, scratch->low) < 0) {
+        mpfr_set(scratch->low, scratch->left, MPFR_RNDD);
       }
-      if(mpfr_cmp(right, high) > 0) {
-        mpfr_set(high, right, MPFR_RNDU);
+      if(mpfr_cmp(scratch->right, scratch->high) > 0) {
+        mpfr_set(scratch->high, scratch->right, MPFR_RNDU);
       }
     }
   }
-  mpfi_interv_fr(input_port->value_intv, low, high);
-  mpfi_clear(tmp);
-  mpfr_clear(low);
-  mpfr_clear(high);
-  mpfr_clear(left);
-  mpfr_clear(right);
+  mpfi_interv_fr(input_port->value_intv, scratch->low, scratch->high);
   return bg_SUCCESS;
 #else
   return bg_ERR_NOT_IMPLEMENTED;
   (void)input_port;
+  (void)scratch;
 #endif
 }
 
@@ -389,38 +420,36 @@ static bg_error merge_mean(input_port_t *input_port) {
     value += input_port->defaultValue;
   } else {
     for(i = 0; i < input_port->num_edges; ++i) {
-      value += input_port->edges[i]->value * input_port->edges[i]->weight;
+      value += bg_EDGE_INPUT(input_port->edges[i]) * bg_EDGE_WEIGHT(input_port->edges[i]);
     }
     cnt = input_port->num_edges;
   }
-  input_port->value = (value / cnt) + input_port->bias;
+  bg_PORT_VALUE(input_port) = (value / cnt) + input_port->bias;
   return bg_SUCCESS;
 }
 
-static bg_error merge_mean_interval(input_port_t *input_port) {
+static bg_error merge_mean_interval(input_port_t *input_port,
+                                    bg_interval_scratch_t *scratch) {
 #ifdef INTERVAL_SUPPORT
   size_t i, cnt = 1;
-  mpfi_t value, tmp;
-  mpfi_init(tmp);
-  mpfi_init_set_d(value, 0.0);
+  mpfi_set_d(scratch->value, 0.0);
   if(input_port->num_edges == 0) {
-    mpfi_add_d(value, value, input_port->defaultValue);
+    mpfi_add_d(scratch->value, scratch->value, input_port->defaultValue);
   } else {
     for(i = 0; i < input_port->num_edges; ++i) {
-      mpfi_mul_d(tmp, input_port->edges[i]->value_intv,
-                 input_port->edges[i]->weight);
-      mpfi_add(value, value, tmp);
+      mpfi_mul_d(scratch->tmp, input_port->edges[i]->value_intv,
+                 bg_EDGE_WEIGHT(input_port->edges[i]));
+      mpfi_add(scratch->value, scratch->value, scratch->tmp);
     }
     cnt = input_port->num_edges;
   }
-  mpfi_div_ui(value, value, cnt);
-  mpfi_add_d(input_port->value_intv, value, input_port->bias);
-  mpfi_clear(value);
-  mpfi_clear(tmp);
+  mpfi_div_ui(scratch->value, scratch->value, cnt);
+  mpfi_add_d(input_port->value_intv, scratch->value, input_port->bias);
   return bg_SUCCESS;
 #else
   return bg_ERR_NOT_IMPLEMENTED;
   (void)input_port;
+  (void)scratch;
 #endif
 }
 
@@ -433,36 +462,34 @@ static bg_error merge_norm(input_port_t *input_port) {
     value += tmp * tmp;
   }
   for(i = 0; i < input_port->num_edges; ++i) {
-    tmp = input_port->edges[i]->value * input_port->edges[i]->weight;
+    tmp = bg_EDGE_INPUT(input_port->edges[i]) * bg_EDGE_WEIGHT(input_port->edges[i]);
     value += tmp * tmp;
   }
-  input_port->value = sqrt(value);
+  bg_PORT_VALUE(input_port) = sqrt(value);
   return bg_SUCCESS;
 }
 
-static bg_error merge_norm_interval(input_port_t *input_port) {
+static bg_error merge_norm_interval(input_port_t *input_port,
+                                    bg_interval_scratch_t *scratch) {
 #ifdef INTERVAL_SUPPORT
   size_t i;
-  mpfi_t value, tmp;
-  mpfi_init(tmp);
-  mpfi_init_set_d(value, input_port->bias * input_port->bias);
+  mpfi_set_d(scratch->value, input_port->bias * input_port->bias);
   if(input_port->num_edges == 0) {
-    mpfi_add_d(value, value,
+    mpfi_add_d(scratch->value, scratch->value,
                input_port->defaultValue * input_port->defaultValue);
   }
   for(i = 0; i < input_port->num_edges; ++i) {
-    mpfi_mul_d(tmp, input_port->edges[i]->value_intv,
-               input_port->edges[i]->weight);
-    mpfi_sqr(tmp, tmp);
-    mpfi_add(value, value, tmp);
+    mpfi_mul_d(scratch->tmp, input_port->edges[i]->value_intv,
+               bg_EDGE_WEIGHT(input_port->edges[i]));
+    mpfi_sqr(scratch->tmp, scratch->tmp);
+    mpfi_add(scratch->value, scratch->value, scratch->tmp);
   }
-  mpfi_sqrt(input_port->value_intv, value);
-  mpfi_clear(tmp);
-  mpfi_clear(value);
+  mpfi_sqrt(input_port->value_intv, scratch->value);
   return bg_SUCCESS;
 #else
   return bg_ERR_NOT_IMPLEMENTED;
   (void)input_port;
+  (void)scratch;
 #endif
 }
 
@@ -477,32 +504,49 @@ static bg_error merge_wta(input_port_t *input_port) {
     winner_value = input_port->defaultValue;
   }
   for(i = 0; i < input_port->num_edges; ++i) {
-    if(input_port->edges[i]->weight > winner_weight) {
-      winner_weight = input_port->edges[i]->weight;
-      winner_value = input_port->edges[i]->value;
+    if(bg_EDGE_WEIGHT(input_port->edges[i]) > winner_weight) {
+      winner_weight = bg_EDGE_WEIGHT(input_port->edges[i]);
+      winner_value = bg_EDGE_INPUT(input_port->edges[i]);
     }
   }
-  input_port->value = winner_value;
+  bg_PORT_VALUE(input_port) = winner_value;
   return bg_SUCCESS;
 }
 */
 
 static merge_type_t basic_merges[] = {
-/*{ merge_id, name, merge_func } */
-  { bg_MERGE_TYPE_SUM, "SUM", &merge_sum, &merge_sum_interval },
-  { bg_MERGE_TYPE_WEIGHTED_SUM, "WEIGHTED_SUM", &merge_weighted_sum, &merge_weighted_sum_interval },
-  { bg_MERGE_TYPE_PRODUCT, "PRODUCT", &merge_product, &merge_product_interval },
-  { bg_MERGE_TYPE_MIN, "MIN", &merge_min, &merge_min_interval },
-  { bg_MERGE_TYPE_MAX, "MAX", &merge_max, &merge_max_interval },
-  { bg_MERGE_TYPE_MEDIAN, "MEDIAN", &merge_median, &merge_median_interval },
-  { bg_MERGE_TYPE_MEAN, "MEAN", &merge_mean, &merge_mean_interval },
-  { bg_MERGE_TYPE_NORM, "NORM", &merge_norm, &merge_norm_interval },
+/*{ merge_id, name, merge_func, merge_intv } */
+  { bg_MERGE_TYPE_SUM, "SUM", &merge_sum, NULL },
+  { bg_MERGE_TYPE_WEIGHTED_SUM, "WEIGHTED_SUM", &merge_weighted_sum, NULL },
+  { bg_MERGE_TYPE_PRODUCT, "PRODUCT", &merge_product, NULL },
+  { bg_MERGE_TYPE_MIN, "MIN", &merge_min, NULL },
+  { bg_MERGE_TYPE_MAX, "MAX", &merge_max, NULL },
+  { bg_MERGE_TYPE_MEDIAN, "MEDIAN", &merge_median, NULL },
+  { bg_MERGE_TYPE_MEAN, "MEAN", &merge_mean, NULL },
+  { bg_MERGE_TYPE_NORM, "NORM", &merge_norm, NULL },
   /*  { bg_MERGE_TYPE_WTA, "WTA", &merge_wta }, */
   /* sentinel */
   { 0, NULL, NULL, NULL }
 };
 
+/* interval merges, in the order of basic_merges */
+static merge_intv_scratch_t basic_merges_intv[] = {
+  &merge_sum_interval,
+  &merge_weighted_sum_interval,
+  &merge_product_interval,
+  &merge_min_interval,
+  &merge_max_interval,
+  &merge_median_interval,
+  &merge_mean_interval,
+  &merge_norm_interval
+};
+
 
 void bg_register_basic_merges(void) {
+  size_t i;
   bg_merge_type_register(basic_merges);
+  for(i = 0; basic_merges[i].merge; ++i) {
+    bg_merge_type_register_intv_scratch(basic_merges[i].id,
+                                        basic_merges_intv[i]);
+  }
 }
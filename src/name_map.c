@@ -0,0 +1,26 @@
+#include "name_map.h"
+
+#include <string.h>
+
+/* FNV-1a */
+static size_t name_map_hash(const char *key, size_t len) {
+  unsigned long hash = 2166136261UL;
+  size_t i;
+  for(i = 0; i < len; ++i) {
+    hash ^= (unsigned char)key[i];
+    hash *= 16777619UL;
+  }
+  return (size_t)hash;
+}
+
+static bool name_map_equal(bg_map_key_t stored, bg_map_key_t key,
+                           size_t len) {
+  return (strncmp(stored.str, key.str, len) == 0 && stored.str[len] == '\0');
+}
+
+MAP_TYPE_IMPL(name, const char *, str, strlen, name_map_hash, name_map_equal)
+
+void* bg_name_map_find_n(const bg_name_map_t *map, const char *key,
+                         size_t len) {
+  return bg_map_find(map, bg_name_map_key(key), len, name_map_hash(key, len));
+}
@@ -0,0 +1,20 @@
+#ifndef C_BAGEL_NAME_MAP_H
+#define C_BAGEL_NAME_MAP_H
+
+/**
+ * @file
+ * @brief Hash map from names to objects.
+ *
+ * The map does not copy the names, they have to stay valid as long as they
+ * are in the map.
+ */
+
+#include "generic_map.h"
+
+MAP_TYPE_DEF(name, const char *)
+
+/* looks up the first len characters of key, which need not be terminated */
+void* bg_name_map_find_n(const bg_name_map_t *map, const char *key,
+                         size_t len);
+
+#endif /* C_BAGEL_NAME_MAP_H */
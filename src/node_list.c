@@ -1,3 +0,0 @@
-#include "node_list.h"
-
-LIST_TYPE_IMPL(node, bg_node_t)
@@ -1,10 +0,0 @@
-#ifndef C_BAGEL_NODE_LIST_H
-#define C_BAGEL_NODE_LIST_H
-
-#include "generic_list.h"
-#include "bg_impl.h"
-
-LIST_TYPE_DEF(node, bg_node_t)
-
-#endif /* C_BAGEL_NODE_LIST_H */
-
@@ -8,22 +8,26 @@
 #include <math.h>
 
 static bg_error init_atomic(bg_node_t *node) {
-  bg_node_create_input_ports(node, node->type->input_port_cnt);
-  bg_node_create_output_ports(node, node->type->output_port_cnt);
-  return bg_error_get();
+  bg_error err = bg_node_create_input_ports(node, node->type->input_port_cnt);
+  if(err == bg_SUCCESS) {
+    err = bg_node_create_output_ports(node, node->type->output_port_cnt);
+  }
+  return err;
 }
 
 static bg_error deinit_atomic(bg_node_t *node) {
-  bg_node_remove_input_ports(node);
-  bg_node_remove_output_ports(node);
-  return bg_error_get();
+  bg_error err = bg_node_remove_input_ports(node);
+  if(err == bg_SUCCESS) {
+    err = bg_node_remove_output_ports(node);
+  }
+  return err;
 }
 
 static bg_error eval_pipe(bg_node_t *node) {
   assert(node->input_ports && node->input_port_cnt == 1);
   assert(node->output_ports && node->output_port_cnt == 1);
-  node->output_ports[0]->value = node->input_ports[0]->value;
-  /*fprintf(stderr, "eval_pipe %lu: %g\n", node->id, node->output_ports[0]->value);*/
+  bg_PORT_VALUE(node->output_ports[0]) = bg_PORT_VALUE(node->input_ports[0]);
+  /*fprintf(stderr, "eval_pipe %lu: %g\n", node->id, bg_PORT_VALUE(node->output_ports[0]));*/
   return bg_SUCCESS;
 }
 
@@ -43,7 +47,7 @@ static bg_error eval_pipe_interval(bg_node_t *node) {
 static bg_error eval_divide(bg_node_t *node) {
   assert(node->input_ports && node->input_port_cnt == 1);
   assert(node->output_ports && node->output_port_cnt == 1);
-  node->output_ports[0]->value = 1. / node->input_ports[0]->value;
+  bg_PORT_VALUE(node->output_ports[0]) = 1. / bg_PORT_VALUE(node->input_ports[0]);
   return bg_SUCCESS;
 }
 
@@ -63,7 +67,7 @@ static bg_error eval_divide_interval(bg_node_t *node) {
 static bg_error eval_sin(bg_node_t *node) {
   assert(node->input_ports && node->input_port_cnt == 1);
   assert(node->output_ports && node->output_port_cnt == 1);
-  node->output_ports[0]->value = sin(node->input_ports[0]->value);
+  bg_PORT_VALUE(node->output_ports[0]) = sin(bg_PORT_VALUE(node->input_ports[0]));
   return bg_SUCCESS;
 }
 
@@ -82,7 +86,7 @@ static bg_error eval_sin_interval(bg_node_t *node) {
 static bg_error eval_asin(bg_node_t *node) {
   assert(node->input_ports && node->input_port_cnt == 1);
   assert(node->output_ports && node->output_port_cnt == 1);
-  node->output_ports[0]->value = asin(node->input_ports[0]->value);
+  bg_PORT_VALUE(node->output_ports[0]) = asin(bg_PORT_VALUE(node->input_ports[0]));
   return bg_SUCCESS;
 }
 
@@ -102,7 +106,7 @@ static bg_error eval_asin_interval(bg_node_t *node) {
 static bg_error eval_cos(bg_node_t *node) {
   assert(node->input_ports && node->input_port_cnt == 1);
   assert(node->output_ports && node->output_port_cnt == 1);
-  node->output_ports[0]->value = cos(node->input_ports[0]->value);
+  bg_PORT_VALUE(node->output_ports[0]) = cos(bg_PORT_VALUE(node->input_ports[0]));
   return bg_SUCCESS;
 }
 
@@ -122,7 +126,7 @@ static bg_error eval_cos_interval(bg_node_t *node) {
 static bg_error eval_tan(bg_node_t *node) {
   assert(node->input_ports && node->input_port_cnt == 1);
   assert(node->output_ports && node->output_port_cnt == 1);
-  node->output_ports[0]->value = tan(node->input_ports[0]->value);
+  bg_PORT_VALUE(node->output_ports[0]) = tan(bg_PORT_VALUE(node->input_ports[0]));
   return bg_SUCCESS;
 }
 
@@ -142,7 +146,7 @@ static bg_error eval_tan_interval(bg_node_t *node) {
 static bg_error eval_acos(bg_node_t *node) {
   assert(node->input_ports && node->input_port_cnt == 1);
   assert(node->output_ports && node->output_port_cnt == 1);
-  node->output_ports[0]->value = acos(node->input_ports[0]->value);
+  bg_PORT_VALUE(node->output_ports[0]) = acos(bg_PORT_VALUE(node->input_ports[0]));
   return bg_SUCCESS;
 }
 
@@ -163,8 +167,8 @@ static bg_error eval_acos_interval(bg_node_t *node) {
 static bg_error eval_atan2(bg_node_t *node) {
   assert(node->input_ports && node->input_port_cnt == 2);
   assert(node->output_ports && node->output_port_cnt == 1);
-  node->output_ports[0]->value = atan2(node->input_ports[0]->value,
-                                       node->input_ports[1]->value);
+  bg_PORT_VALUE(node->output_ports[0]) = atan2(bg_PORT_VALUE(node->input_ports[0]),
+                                       bg_PORT_VALUE(node->input_ports[1]));
   return bg_SUCCESS;
 }
 
@@ -186,8 +190,8 @@ static bg_error eval_atan2_interval(bg_node_t *node) {
 static bg_error eval_pow(bg_node_t *node) {
   assert(node->input_ports && node->input_port_cnt == 2);
   assert(node->output_ports && node->output_port_cnt == 1);
-  node->output_ports[0]->value = pow(node->input_ports[0]->value,
-                                     node->input_ports[1]->value);
+  bg_PORT_VALUE(node->output_ports[0]) = pow(bg_PORT_VALUE(node->input_ports[0]),
+                                     bg_PORT_VALUE(node->input_ports[1]));
   return bg_SUCCESS;
 }
 
@@ -213,8 +217,8 @@ static bg_error eval_pow_interval(bg_node_t *node) {
 static bg_error eval_mod(bg_node_t *node) {
   assert(node->input_ports && node->input_port_cnt == 2);
   assert(node->output_ports && node->output_port_cnt == 1);
-  node->output_ports[0]->value = fmod(node->input_ports[0]->value,
-                                      node->input_ports[1]->value);
+  bg_PORT_VALUE(node->output_ports[0]) = fmod(bg_PORT_VALUE(node->input_ports[0]),
+                                      bg_PORT_VALUE(node->input_ports[1]));
   return bg_SUCCESS;
 }
 
@@ -253,7 +257,7 @@ static bg_error eval_mod_interval(bg_node_t *node) {
 static bg_error eval_abs(bg_node_t *node) {
   assert(node->input_ports && node->input_port_cnt == 1);
   assert(node->output_ports && node->output_port_cnt == 1);
-  node->output_ports[0]->value = fabs(node->input_ports[0]->value);
+  bg_PORT_VALUE(node->output_ports[0]) = fabs(bg_PORT_VALUE(node->input_ports[0]));
   return bg_SUCCESS;
 }
 
@@ -273,7 +277,7 @@ static bg_error eval_abs_interval(bg_node_t *node) {
 static bg_error eval_sqrt(bg_node_t *node) {
   assert(node->input_ports && node->input_port_cnt == 1);
   assert(node->output_ports && node->output_port_cnt == 1);
-  node->output_ports[0]->value = sqrt(node->input_ports[0]->value);
+  bg_PORT_VALUE(node->output_ports[0]) = sqrt(bg_PORT_VALUE(node->input_ports[0]));
   return bg_SUCCESS;
 }
 
@@ -303,7 +307,7 @@ static bg_real doSigmoid(bg_real input) {
 static bg_error eval_fsigmoid(bg_node_t *node) {
   assert(node->input_ports && node->input_port_cnt == 1);
   assert(node->output_ports && node->output_port_cnt == 1);
-  node->output_ports[0]->value = doSigmoid(node->input_ports[0]->value);
+  bg_PORT_VALUE(node->output_ports[0]) = doSigmoid(bg_PORT_VALUE(node->input_ports[0]));
   return bg_SUCCESS;
 }
 
@@ -331,12 +335,12 @@ static bg_error eval_greater_than_0(bg_node_t *node) {
   bg_real result = 0.0;
   assert(node->input_ports && node->input_port_cnt == 3);
   assert(node->output_ports && node->output_port_cnt == 1);
-  if(node->input_ports[0]->value > 0.0) {
-    result = node->input_ports[1]->value;
+  if(bg_PORT_VALUE(node->input_ports[0]) > 0.0) {
+    result = bg_PORT_VALUE(node->input_ports[1]);
   } else {
-    result = node->input_ports[2]->value;
+    result = bg_PORT_VALUE(node->input_ports[2]);
   }
-  node->output_ports[0]->value = result;
+  bg_PORT_VALUE(node->output_ports[0]) = result;
   return bg_SUCCESS;
 }
 
@@ -367,12 +371,12 @@ static bg_error eval_equal_to_0(bg_node_t *node) {
   bg_real result = 0.0;
   assert(node->input_ports && node->input_port_cnt == 3);
   assert(node->output_ports && node->output_port_cnt == 1);
-  if(fabs(node->input_ports[0]->value) < bg_EPSILON) {
-    result = node->input_ports[1]->value;
+  if(fabs(bg_PORT_VALUE(node->input_ports[0])) < bg_EPSILON) {
+    result = bg_PORT_VALUE(node->input_ports[1]);
   } else {
-    result = node->input_ports[2]->value;
+    result = bg_PORT_VALUE(node->input_ports[2]);
   }
-  node->output_ports[0]->value = result;
+  bg_PORT_VALUE(node->output_ports[0]) = result;
   return bg_SUCCESS;
 }
 
@@ -401,7 +405,7 @@ static bg_error eval_equal_to_0_interval(bg_node_t *node) {
 static bg_error eval_tanh(bg_node_t *node) {
   assert(node->input_ports && node->input_port_cnt == 1);
   assert(node->output_ports && node->output_port_cnt == 1);
-  node->output_ports[0]->value = tanh(node->input_ports[0]->value);
+  bg_PORT_VALUE(node->output_ports[0]) = tanh(bg_PORT_VALUE(node->input_ports[0]));
   return bg_SUCCESS;
 }
 
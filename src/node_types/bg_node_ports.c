@@ -10,22 +10,26 @@
 
 
 static bg_error init_port(bg_node_t *node) {
-  bg_node_create_input_ports(node, 1);
-  bg_node_create_output_ports(node, 1);
-  return bg_error_get();
+  bg_error err = bg_node_create_input_ports(node, 1);
+  if(err == bg_SUCCESS) {
+    err = bg_node_create_output_ports(node, 1);
+  }
+  return err;
 }
 
 static bg_error deinit_port(bg_node_t *node) {
-  bg_node_remove_input_ports(node);
-  bg_node_remove_output_ports(node);
-  return bg_error_get();
+  bg_error err = bg_node_remove_input_ports(node);
+  if(err == bg_SUCCESS) {
+    err = bg_node_remove_output_ports(node);
+  }
+  return err;
 }
 
 static bg_error eval_port(bg_node_t *node) {
   assert(node->input_ports && node->input_port_cnt == 1);
   assert(node->output_ports && node->output_port_cnt == 1);
-  node->output_ports[0]->value = node->input_ports[0]->value;
-  /*fprintf(stderr, "eval_port %lu: %g\n", node->id, node->output_ports[0]->value);*/
+  bg_PORT_VALUE(node->output_ports[0]) = bg_PORT_VALUE(node->input_ports[0]);
+  /*fprintf(stderr, "eval_port %lu: %g\n", node->id, bg_PORT_VALUE(node->output_ports[0]));*/
   return bg_SUCCESS;
 }
 
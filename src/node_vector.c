@@ -0,0 +1,3 @@
+#include "node_vector.h"
+
+VECTOR_TYPE_IMPL(node, bg_node_t)
@@ -0,0 +1,9 @@
+#ifndef C_BAGEL_NODE_VECTOR_H
+#define C_BAGEL_NODE_VECTOR_H
+
+#include "generic_vector.h"
+#include "bg_impl.h"
+
+VECTOR_TYPE_DEF(node, bg_node_t)
+
+#endif /* C_BAGEL_NODE_VECTOR_H */
@@ -0,0 +1,82 @@
+#include "string_table.h"
+#include "name_map.h"
+
+#include <stddef.h>
+#include <string.h>
+
+typedef struct bg_string_entry {
+  size_t refs;
+  /* allocated with the length of the string */
+  char str[1];
+} bg_string_entry;
+
+struct bg_string_table_t {
+  /* the entries by their own string */
+  bg_name_map_t *map;
+  bool strip;
+};
+
+static bg_string_entry *string_table_entry(const char *str) {
+  return (bg_string_entry*)(str - offsetof(bg_string_entry, str));
+}
+
+void bg_string_table_init(bg_string_table_t **table) {
+  *table = (bg_string_table_t*)calloc(1, sizeof(bg_string_table_t));
+  bg_name_map_init(&(*table)->map);
+  (*table)->strip = false;
+}
+
+void bg_string_table_deinit(bg_string_table_t *table) {
+  /* all names are released before their graph is freed */
+  bg_name_map_deinit(table->map);
+  free(table);
+}
+
+const char* bg_string_table_intern(bg_string_table_t *table,
+                                   const char *str) {
+  size_t len;
+  bg_string_entry *entry;
+  if(table->strip) {
+    str = "";
+  }
+  len = strlen(str);
+  entry = (bg_string_entry*)bg_name_map_find_n(table->map, str, len);
+  if(!entry) {
+    entry = (bg_string_entry*)malloc(sizeof(bg_string_entry) + len);
+    if(!entry) {
+      return NULL;
+    }
+    memcpy(entry->str, str, len + 1);
+    entry->refs = 0;
+    if(!bg_name_map_insert(table->map, entry->str, entry)) {
+      free(entry);
+      return NULL;
+    }
+  }
+  entry->refs++;
+  return entry->str;
+}
+
+void bg_string_table_release(bg_string_table_t *table, const char *str) {
+  bg_string_entry *entry;
+  if(!str) {
+    return;
+  }
+  entry = string_table_entry(str);
+  if(--entry->refs == 0) {
+    bg_name_map_erase(table->map, entry->str);
+    free(entry);
+  }
+}
+
+void bg_string_table_set_strip(bg_string_table_t *table, bool strip) {
+  table->strip = strip;
+}
+
+bool bg_string_table_get_strip(const bg_string_table_t *table) {
+  return table->strip;
+}
+
+size_t bg_string_table_size(const bg_string_table_t *table) {
+  return bg_name_map_size(table->map);
+}
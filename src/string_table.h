@@ -0,0 +1,29 @@
+#ifndef C_BAGEL_STRING_TABLE_H
+#define C_BAGEL_STRING_TABLE_H
+
+/**
+ * @file
+ * @brief Interned names of one graph.
+ *
+ * Every distinct name of the nodes and ports of a graph is stored once and
+ * shared by reference counting, so equal names of the same table can be
+ * compared by pointer. In strip mode all names are interned as the empty
+ * string, which keeps deployed graphs free of names they never look up.
+ */
+
+#include <stdlib.h>
+#include "bool.h"
+
+typedef struct bg_string_table_t bg_string_table_t;
+
+void bg_string_table_init(bg_string_table_t **table);
+void bg_string_table_deinit(bg_string_table_t *table);
+/* returns the shared copy of str or NULL if out of memory */
+const char* bg_string_table_intern(bg_string_table_t *table, const char *str);
+/* str has to be returned by bg_string_table_intern() of the same table */
+void bg_string_table_release(bg_string_table_t *table, const char *str);
+void bg_string_table_set_strip(bg_string_table_t *table, bool strip);
+bool bg_string_table_get_strip(const bg_string_table_t *table);
+size_t bg_string_table_size(const bg_string_table_t *table);
+
+#endif /* C_BAGEL_STRING_TABLE_H */
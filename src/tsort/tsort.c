@@ -1,263 +1,251 @@
-#include <sys/types.h>
-#include <unistd.h>
-#include <stdlib.h>
-#include <stdio.h>
-#include <string.h>
-
-struct successor
-{
-  unsigned long item;
-  unsigned long next;
-};
+#include "tsort.h"
 
+#include <string.h>
 
-struct item
-{
-  unsigned long id;
-  unsigned long top;
-  unsigned long checked;
-  unsigned long visited;
-  unsigned long num_incoming;
+/* marks a successor whose relation closes a loop */
+#define REMOVED ((size_t)-1)
+
+enum { UNVISITED = 0, ON_STACK, FINISHED };
+
+struct bg_tsort_t {
+  /* the relations in the order they were added */
+  size_t *from, *to;
+  size_t relation_cnt, relation_capacity;
+  /* the successors of node i are succ[first[i]] to succ[first[i+1]-1] */
+  size_t *first, *succ;
+  size_t *incoming;
+  /* depth-first search state, the stack holds the next successor to check
+   * of every node on it */
+  unsigned char *state;
+  size_t *stack, *cursor;
+  size_t *order;
+  size_t node_cnt, node_capacity, succ_capacity;
+  /* the relations dropped to break loops */
+  size_t loop_cnt;
 };
 
-#define BUFFER_STEPS 100
-
-struct item *node_list = NULL;
-unsigned long nodes_buffer_size, next_node_index;
-
-static struct successor *succ_list = NULL;
-unsigned long succ_buffer_size, next_succ_index;
-
-unsigned long *ids = NULL;
-
-void init(void) {
-  nodes_buffer_size = BUFFER_STEPS;
-  node_list = (struct item*)malloc(sizeof(struct item)*nodes_buffer_size);
-  next_node_index = 0;
-  succ_buffer_size = BUFFER_STEPS;
-  succ_list = (struct successor*)malloc(sizeof(struct successor)*succ_buffer_size);
-  next_succ_index = 0;
+/* grows *buffer to at least cnt elements of size, doubling the capacity */
+static int tsort_reserve(void **buffer, size_t *capacity, size_t cnt,
+                         size_t size) {
+  size_t new_capacity;
+  void *new_buffer;
+  if(cnt <= *capacity) {
+    return 1;
+  }
+  new_capacity = *capacity ? *capacity : 16;
+  while(new_capacity < cnt) {
+    new_capacity *= 2;
+  }
+  new_buffer = realloc(*buffer, new_capacity * size);
+  if(!new_buffer) {
+    return 0;
+  }
+  *buffer = new_buffer;
+  *capacity = new_capacity;
+  return 1;
 }
 
-void deinit(void) {
-  free(node_list);
-  node_list = NULL;
-  free(succ_list);
-  succ_list = NULL;
+int bg_tsort_init(bg_tsort_t **ts) {
+  *ts = (bg_tsort_t*)calloc(1, sizeof(bg_tsort_t));
+  return *ts != NULL;
 }
 
+void bg_tsort_deinit(bg_tsort_t *ts) {
+  free(ts->from);
+  free(ts->to);
+  free(ts->first);
+  free(ts->succ);
+  free(ts->incoming);
+  free(ts->state);
+  free(ts->stack);
+  free(ts->cursor);
+  free(ts->order);
+  free(ts);
+}
 
-/* return index of existing or newly node */
-
-unsigned long search_item (unsigned long id) {
-  unsigned long i;
-  unsigned long new_node_index;
-
-  new_node_index = next_node_index;
+void bg_tsort_clear(bg_tsort_t *ts) {
+  ts->relation_cnt = 0;
+  ts->node_cnt = 0;
+}
 
-  for(i=0; i<next_node_index; ++i) {
-    if(node_list[i].id == id) {
-      return i;
-    }
+int bg_tsort_add_relation(bg_tsort_t *ts, size_t index1, size_t index2) {
+  size_t capacity;
+  /* don't add relation if index1 == index2 */
+  if(index1 == index2) {
+    return 1;
   }
-
-  if(new_node_index == nodes_buffer_size) {
-    /* reallocate memory */
-    void *buffer;
-    buffer = malloc(sizeof(struct item)*(nodes_buffer_size+BUFFER_STEPS));
-    memcpy(buffer, node_list, sizeof(struct item)*nodes_buffer_size);
-    free(node_list);
-    node_list = buffer;
-    nodes_buffer_size += BUFFER_STEPS;
+  capacity = ts->relation_capacity;
+  if(!tsort_reserve((void**)&ts->from, &capacity, ts->relation_cnt + 1,
+                    sizeof(size_t))) {
+    return 0;
   }
-
-  /* add new node */
-  node_list[new_node_index].id = id;
-  node_list[new_node_index].top = 0;
-  node_list[new_node_index].visited = 0;
-  node_list[new_node_index].checked = 0;
-  node_list[new_node_index].num_incoming = 0;
-  ++next_node_index;
-  return next_node_index-1;
-}
-
-
-void add_relation(unsigned long id1, unsigned long id2) {
-  unsigned long j;
-  unsigned long k;
-
-  /* don't add relation if id1 == id2 */
-  if(id1 == id2) {
-    return;
+  capacity = ts->relation_capacity;
+  if(!tsort_reserve((void**)&ts->to, &capacity, ts->relation_cnt + 1,
+                    sizeof(size_t))) {
+    return 0;
   }
-
-  /* init tsort if not already done */
-  if(node_list == NULL) {
-    init();
+  ts->relation_capacity = capacity;
+  ts->from[ts->relation_cnt] = index1;
+  ts->to[ts->relation_cnt] = index2;
+  ts->relation_cnt++;
+  if(index1 >= ts->node_cnt) {
+    ts->node_cnt = index1 + 1;
   }
-
-  j = search_item(id1);
-  k = search_item(id2);
-
-  /* reallocate memory if required */
-  if(++next_succ_index == succ_buffer_size) {
-    void *buffer;
-    buffer = malloc(sizeof(struct successor)*(succ_buffer_size+BUFFER_STEPS));
-    memcpy(buffer, succ_list, sizeof(struct successor)*succ_buffer_size);
-    free(succ_list);
-    succ_list = buffer;
-    succ_buffer_size += BUFFER_STEPS;
+  if(index2 >= ts->node_cnt) {
+    ts->node_cnt = index2 + 1;
   }
-
-  /* add succ to j */
-  succ_list[next_succ_index].item = k;
-  succ_list[next_succ_index].next = node_list[j].top;
-  node_list[j].top = next_succ_index;
-
-  /* increment incoming count for k */
-  node_list[k].num_incoming++;
+  return 1;
 }
 
-
-void detect_loops_for_node(struct item *item) {
-  unsigned long sid;
-  unsigned long *last_link;
-  struct successor *s;
-
-  /* set checked */
-  item->visited = 1;
-  item->checked = 1;
-
-  /* loop over successors */
-  sid = item->top;
-  last_link = &(item->top);
-  while(sid != 0) {
-    s = succ_list+sid;
-    if(node_list[s->item].checked) {
-      /* we have a loop */
-
-      /* remove successor */
-      *last_link = s->next;
-
-      /* decrease num incomming for target node */
-      node_list[s->item].num_incoming--;
-
-      /* for debugging purpose */
-      /*fprintf(stderr, "remove relation: %lu -> %lu\n", item->id, node_list[s->item].id);*/
-    }
-    else if(node_list[s->item].visited == 0) {
-      /* this node wasn't checked before */
-      detect_loops_for_node(node_list + s->item);
-    }
-    /* else it is known that the node doesn't produce a loop */
-    last_link = &(s->next);
-    sid = s->next;
+static int tsort_reserve_nodes(bg_tsort_t *ts) {
+  size_t n = ts->node_cnt, capacity;
+  void **buffers[5];
+  size_t i;
+  capacity = ts->succ_capacity;
+  if(!tsort_reserve((void**)&ts->succ, &capacity, ts->relation_cnt,
+                    sizeof(size_t))) {
+    return 0;
   }
-  item->checked = 0;
-}
-
-void detect_loops(void) {
-  unsigned long i;
-
-  for(i=0; i<next_node_index; ++i) {
-    if(node_list[i].visited == 0) {
-      detect_loops_for_node(node_list+i);
+  ts->succ_capacity = capacity;
+  if(n + 1 <= ts->node_capacity) {
+    return 1;
+  }
+  /* all node buffers share the capacity, first has one extra element */
+  buffers[0] = (void**)&ts->first;
+  buffers[1] = (void**)&ts->incoming;
+  buffers[2] = (void**)&ts->stack;
+  buffers[3] = (void**)&ts->cursor;
+  buffers[4] = (void**)&ts->order;
+  for(i = 0; i < 5; ++i) {
+    capacity = ts->node_capacity;
+    if(!tsort_reserve(buffers[i], &capacity, n + 1, sizeof(size_t))) {
+      return 0;
     }
   }
+  capacity = ts->node_capacity;
+  if(!tsort_reserve((void**)&ts->state, &capacity, n + 1, 1)) {
+    return 0;
+  }
+  ts->node_capacity = capacity;
+  return 1;
 }
 
-void debug_graph(void) {
-  unsigned long i, sid;
-
-  for(i=0; i<next_node_index; ++i) {
-    fprintf(stderr, "node: %lu (%lu)\n", node_list[i].id, node_list[i].num_incoming);
-    sid = node_list[i].top;
-    while(sid!=0) {
-      fprintf(stderr, "    -> %lu\n", node_list[succ_list[sid].item].id);
-      sid = succ_list[sid].next;
+/* Drops every relation to a node that is on the stack of a depth-first
+ * search started from the nodes in index order. */
+static void tsort_remove_loops(bg_tsort_t *ts) {
+  size_t i, node, next, depth;
+  memset(ts->state, UNVISITED, ts->node_cnt);
+  ts->loop_cnt = 0;
+  for(i = 0; i < ts->node_cnt; ++i) {
+    if(ts->state[i] != UNVISITED) {
+      continue;
+    }
+    ts->stack[0] = i;
+    ts->cursor[i] = ts->first[i];
+    ts->state[i] = ON_STACK;
+    depth = 1;
+    while(depth) {
+      node = ts->stack[depth - 1];
+      if(ts->cursor[node] == ts->first[node + 1]) {
+        ts->state[node] = FINISHED;
+        --depth;
+        continue;
+      }
+      next = ts->succ[ts->cursor[node]];
+      if(ts->state[next] == ON_STACK) {
+        /* we have a loop */
+        ts->succ[ts->cursor[node]] = REMOVED;
+        ts->incoming[next]--;
+        ts->loop_cnt++;
+      }
+      else if(ts->state[next] == UNVISITED) {
+        ts->stack[depth++] = next;
+        ts->cursor[next] = ts->first[next];
+        ts->state[next] = ON_STACK;
+      }
+      ts->cursor[node]++;
     }
   }
 }
 
-int tsort (void) {
-  unsigned long next_id = 0;
-  unsigned long *buffer1, *buffer2;
-  unsigned long *src_vertices, *cpy_vertices;
-  unsigned long num_src_vertices, num_cpy_vertices;
-  unsigned long sid, i;
+int bg_tsort_run(bg_tsort_t *ts) {
+  size_t n = ts->node_cnt, i, k, head, tail, node, next;
+  size_t *pass;
 
-  /* detect loops */
-  detect_loops();
+  if(!tsort_reserve_nodes(ts)) {
+    return 0;
+  }
 
-  /* allocate memory for return ids */
-  if(ids) {
-    free(ids);
+  /* group the successors by node, the last added relation comes first */
+  memset(ts->first, 0, (n + 1) * sizeof(size_t));
+  memset(ts->incoming, 0, n * sizeof(size_t));
+  for(k = 0; k < ts->relation_cnt; ++k) {
+    ts->first[ts->from[k] + 1]++;
+    ts->incoming[ts->to[k]]++;
+  }
+  for(i = 0; i < n; ++i) {
+    ts->first[i + 1] += ts->first[i];
+    /* the cursor is the next free successor slot of the node */
+    ts->cursor[i] = ts->first[i];
+  }
+  for(k = ts->relation_cnt; k > 0; --k) {
+    ts->succ[ts->cursor[ts->from[k - 1]]++] = ts->to[k - 1];
   }
-  ids = (unsigned long*)malloc(sizeof(unsigned long)*(next_node_index+1));
-  ids[next_node_index] = 0;
 
-  /* allocate memory for fast sort */
-  buffer1 = (unsigned long*)malloc(sizeof(unsigned long)*next_node_index);
-  buffer2 = (unsigned long*)malloc(sizeof(unsigned long)*next_node_index);
+  tsort_remove_loops(ts);
 
-  /* init buffers */
-  num_src_vertices = 0;
-  for(i=0; i<next_node_index; ++i) {
-    if(node_list[i].num_incoming == 0) {
-      /* add to id list */
-      ids[next_id++] = node_list[i].id;
-      /* decrease incoming of successors */
-      sid = node_list[i].top;
-      while(sid != 0) {
-        node_list[succ_list[sid].item].num_incoming--;
-        sid = succ_list[sid].next;
-      }
+  /* the order doubles as the queue of nodes without pending relations */
+  tail = 0;
+  for(i = 0; i < n; ++i) {
+    if(ts->incoming[i] == 0) {
+      ts->order[tail++] = i;
     }
-    else {
-      buffer1[num_src_vertices++] = i;
+  }
+  for(head = 0; head < tail; ++head) {
+    node = ts->order[head];
+    for(k = ts->first[node]; k < ts->first[node + 1]; ++k) {
+      next = ts->succ[k];
+      if(next != REMOVED && --ts->incoming[next] == 0) {
+        ts->order[tail++] = next;
+      }
     }
   }
 
-  src_vertices = buffer1;
-  num_cpy_vertices = 0;
-  cpy_vertices = buffer2;
-
-  /* loop over nodes and sort them into ids */
-  while(num_src_vertices > 0) {
-    for(i=0; i<num_src_vertices; ++i) {
-      if(node_list[src_vertices[i]].num_incoming == 0) {
-        /* add to id list */
-        ids[next_id++] = node_list[src_vertices[i]].id;
-        /* decrease incoming of successors */
-        sid = node_list[src_vertices[i]].top;
-        while(sid != 0) {
-          node_list[succ_list[sid].item].num_incoming--;
-          sid = succ_list[sid].next;
-        }
+  /* Emit the nodes in the order of repeated passes over all remaining
+   * indices, taking every node whose predecessors are taken. A node is
+   * taken in the pass of its latest predecessor if that one has a lower
+   * index and in the pass after it otherwise. The stack holds the pass of
+   * every node and the cursor counts the nodes per pass. */
+  pass = ts->stack;
+  memset(pass, 0, n * sizeof(size_t));
+  memset(ts->cursor, 0, (n + 1) * sizeof(size_t));
+  for(head = 0; head < n; ++head) {
+    node = ts->order[head];
+    for(k = ts->first[node]; k < ts->first[node + 1]; ++k) {
+      next = ts->succ[k];
+      if(next != REMOVED && pass[next] < pass[node] + (node > next)) {
+        pass[next] = pass[node] + (node > next);
       }
-      else {
-        cpy_vertices[num_cpy_vertices++] = src_vertices[i];
-      }
-    }
-    if(src_vertices == buffer1) {
-      src_vertices = buffer2;
-      cpy_vertices = buffer1;
     }
-    else {
-      src_vertices = buffer1;
-      cpy_vertices = buffer2;
-    }
-    num_src_vertices = num_cpy_vertices;
-    num_cpy_vertices = 0;
+    ts->cursor[pass[node] + 1]++;
+  }
+  for(i = 0; i < n; ++i) {
+    ts->cursor[i + 1] += ts->cursor[i];
+  }
+  for(i = 0; i < n; ++i) {
+    ts->order[ts->cursor[pass[i]]++] = i;
   }
-
-  /* free memory */
-  free(buffer1);
-  free(buffer2);
-  deinit();
   return 1;
 }
 
-unsigned long* get_sorted_ids(void) {
-  return ids;
+size_t bg_tsort_size(const bg_tsort_t *ts) {
+  return ts->node_cnt;
+}
+
+const size_t* bg_tsort_order(const bg_tsort_t *ts) {
+  return ts->order;
+}
+
+size_t bg_tsort_loop_cnt(const bg_tsort_t *ts) {
+  return ts->loop_cnt;
 }
@@ -1,3 +1,38 @@
-void add_relation(unsigned long id1, unsigned long id2);
-int tsort (void);
-unsigned long* get_sorted_ids(void);
+#ifndef C_BAGEL_TSORT_H
+#define C_BAGEL_TSORT_H
+
+/**
+ * @file
+ * @brief Topological sort of dense node indices.
+ *
+ * The relations are collected in a sort object owned by the caller, so
+ * different graphs can be sorted at the same time. Loops are broken by
+ * dropping the relations that close them in a depth-first search over the
+ * nodes in index order, the remaining relations are sorted with Kahn's
+ * algorithm. The result is then ordered like repeated passes over the
+ * indices in ascending order would emit them, so ties are broken the same
+ * way for every sort of the same relations. All steps are linear in the
+ * number of nodes and relations.
+ */
+
+#include <stdlib.h>
+
+typedef struct bg_tsort_t bg_tsort_t;
+
+/* returns 0 if out of memory */
+int bg_tsort_init(bg_tsort_t **ts);
+void bg_tsort_deinit(bg_tsort_t *ts);
+/* removes all relations but keeps the memory for the next sort */
+void bg_tsort_clear(bg_tsort_t *ts);
+/* index1 has to be sorted before index2, returns 0 if out of memory */
+int bg_tsort_add_relation(bg_tsort_t *ts, size_t index1, size_t index2);
+/* sorts the indices below the largest one of a relation, returns 0 if out
+ * of memory */
+int bg_tsort_run(bg_tsort_t *ts);
+/* the sorted indices after bg_tsort_run() */
+size_t bg_tsort_size(const bg_tsort_t *ts);
+const size_t* bg_tsort_order(const bg_tsort_t *ts);
+/* the number of relations bg_tsort_run() dropped to break loops */
+size_t bg_tsort_loop_cnt(const bg_tsort_t *ts);
+
+#endif /* C_BAGEL_TSORT_H */
@@ -0,0 +1,134 @@
+/*
+ * Measures the iteration throughput of the node containers, the
+ * interpreted evaluation and cloning of a wide graph and the evaluation
+ * order of a long chain before and after edits:
+ *   benchmark_c_bagel [node count] [repetitions]
+ */
+#include "../src/bagel.h"
+#include "../src/generic_list.h"
+#include "../src/generic_vector.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+static double seconds_since(clock_t start) {
+  return (double)(clock() - start) / CLOCKS_PER_SEC;
+}
+
+static void report(const char *name, double seconds, size_t elements) {
+  printf("%-24s %8.3f s %10.2f ns/element\n", name, seconds,
+         elements ? 1e9 * seconds / elements : 0.);
+}
+
+int main(int argc, const char **argv) {
+  size_t n = 100000, reps = 200, i, r;
+  size_t sum = 0;
+  char *objects;
+  void *obj;
+  bg_list_t *list;
+  bg_list_iterator_t list_it;
+  bg_vector_t *vector;
+  bg_vector_iterator_t vector_it;
+  bg_graph_t *g, *clone;
+  clock_t start;
+
+  if(argc > 1) {
+    n = strtoul(argv[1], NULL, 10);
+  }
+  if(argc > 2) {
+    reps = strtoul(argv[2], NULL, 10);
+  }
+  objects = (char*)malloc(n);
+  bg_list_init(&list);
+  bg_vector_init(&vector);
+
+  start = clock();
+  for(i = 0; i < n; ++i) {
+    bg_list_append(list, objects + i);
+  }
+  report("list append", seconds_since(start), n);
+  start = clock();
+  for(i = 0; i < n; ++i) {
+    bg_vector_append(vector, objects + i);
+  }
+  report("vector append", seconds_since(start), n);
+
+  start = clock();
+  for(r = 0; r < reps; ++r) {
+    for(obj = bg_list_first(list, &list_it); obj;
+        obj = bg_list_next(&list_it)) {
+      sum += (size_t)((char*)obj - objects);
+    }
+  }
+  report("list iterate", seconds_since(start), n * reps);
+  start = clock();
+  for(r = 0; r < reps; ++r) {
+    for(obj = bg_vector_first(vector, &vector_it); obj;
+        obj = bg_vector_next(&vector_it)) {
+      sum -= (size_t)((char*)obj - objects);
+    }
+  }
+  report("vector iterate", seconds_since(start), n * reps);
+
+  bg_list_deinit(list);
+  bg_vector_deinit(vector);
+  free(objects);
+
+  /* every hidden node reads the input and feeds the output */
+  bg_initialize();
+  bg_graph_alloc(&g, "benchmark");
+  bg_graph_create_input(g, "in", 1);
+  bg_graph_create_output(g, "out", 2);
+  bg_graph_create_edge(g, 0, 0, 1, 0, 1., 1);
+  for(i = 0; i < n; ++i) {
+    bg_graph_create_node(g, "pipe", 10 + i, bg_NODE_TYPE_PIPE);
+    bg_graph_create_edge(g, 1, 0, 10 + i, 0, 1., 10 + i);
+    bg_graph_create_edge(g, 10 + i, 0, 2, 0, 1., 10 + n + i);
+  }
+  bg_graph_evaluate(g);
+  start = clock();
+  for(r = 0; r < reps / 10 + 1; ++r) {
+    bg_edge_set_value(g, 1, (bg_real)r);
+    bg_graph_evaluate(g);
+  }
+  report("graph evaluate", seconds_since(start), n * (reps / 10 + 1));
+  start = clock();
+  for(r = 0; r < reps / 100 + 1; ++r) {
+    bg_graph_alloc(&clone, "clone");
+    bg_graph_clone(clone, g);
+    bg_graph_free(clone);
+  }
+  report("graph clone", seconds_since(start), n * (reps / 100 + 1));
+  bg_graph_free(g);
+
+  /* a chain whose edges are created from the output towards the input */
+  bg_graph_alloc(&g, "chain");
+  bg_graph_create_input(g, "in", 1);
+  bg_graph_create_output(g, "out", 2);
+  for(i = 0; i < n; ++i) {
+    bg_graph_create_node(g, "pipe", 10 + i, bg_NODE_TYPE_PIPE);
+  }
+  bg_graph_create_edge(g, 10 + n - 1, 0, 2, 0, 1., 1);
+  for(i = n - 1; i > 0; --i) {
+    bg_graph_create_edge(g, 10 + i - 1, 0, 10 + i, 0, 1., 10 + i);
+  }
+  bg_graph_create_edge(g, 1, 0, 10, 0, 1., 2);
+  bg_graph_create_edge(g, 0, 0, 1, 0, 1., 3);
+  /* the first evaluation determines the evaluation order */
+  start = clock();
+  bg_graph_evaluate(g);
+  report("graph sort", seconds_since(start), n);
+  /* edits between evaluations keep the order */
+  start = clock();
+  for(r = 0; r < reps / 10 + 1; ++r) {
+    bg_graph_remove_edge(g, 10 + n / 2);
+    bg_graph_create_edge(g, 10 + n / 2 - 1, 0, 10 + n / 2, 0, 1., 10 + n / 2);
+    bg_graph_evaluate(g);
+  }
+  report("graph edit", seconds_since(start), n * (reps / 10 + 1));
+  bg_graph_free(g);
+  bg_terminate();
+
+  /* keeps the loops from being optimized away */
+  return sum != 0;
+}
@@ -0,0 +1,28 @@
+/*
+ * Translates a graph file into C source code for the round-trip test:
+ *   generate_c_code <graph.yml> <prefix> <output.c>
+ */
+#include "../src/bagel.h"
+#include <stdio.h>
+
+int main(int argc, const char **argv) {
+  bg_graph_t *g;
+  bg_error err;
+  if(argc != 4) {
+    fprintf(stderr, "usage: %s <graph.yml> <prefix> <output.c>\n", argv[0]);
+    return 1;
+  }
+  bg_initialize();
+  bg_graph_alloc(&g, argv[2]);
+  err = bg_graph_from_yaml_file(argv[1], g);
+  if(err == bg_SUCCESS) {
+    err = bg_graph_to_c(argv[3], argv[2], g);
+  }
+  bg_graph_free(g);
+  bg_terminate();
+  if(err != bg_SUCCESS) {
+    fprintf(stderr, "%s: error %d\n", argv[0], (int)err);
+    return 1;
+  }
+  return 0;
+}
@@ -1,6 +1,10 @@
 #include "../src/bagel.h"
 #include "bg_test.h"
 #include <math.h>
+#include <string.h>
+#ifdef THREAD_SUPPORT
+#  include <pthread.h>
+#endif
 
 
 
@@ -244,6 +248,502 @@ START_TEST(test_bg_graph_get_nodes) {
 } END_TEST
 
 
+START_TEST(test_bg_graph_id_index) {
+  size_t i, x;
+  const size_t n = 4000;
+  bg_error err;
+  bg_node_type type;
+  bg_real w;
+  /* scattered ids, two interleaved chains of pipes */
+  bg_graph_create_input(g, "in", 1);
+  for(i = 0; i < n; ++i) {
+    bg_graph_create_node(g, "pipe", 2+i*7919, bg_NODE_TYPE_PIPE);
+    bg_graph_create_edge(g, i < 2 ? 1 : 2+(i-2)*7919, 0, 2+i*7919, 0,
+                         (bg_real)i, 3+i*104729);
+  }
+  ck_assert_int_eq(bg_error_get(), bg_SUCCESS);
+  /* remove the chain of even nodes */
+  for(i = 0; i < n; i += 2) {
+    bg_graph_disconnect_node(g, 2+i*7919);
+    bg_graph_remove_node(g, 2+i*7919);
+  }
+  ck_assert_int_eq(bg_error_get(), bg_SUCCESS);
+  bg_graph_get_node_cnt(g, false, &x);
+  ck_assert_int_eq(x, 1+n/2);
+  for(i = 0; i < n; ++i) {
+    err = bg_node_get_type(g, 2+i*7919, &type);
+    if(i % 2) {
+      ck_assert_int_eq(err, bg_SUCCESS);
+      ck_assert_int_eq(type, bg_NODE_TYPE_PIPE);
+      bg_edge_get_weight(g, 3+i*104729, &w);
+      ck_assert(w == (bg_real)i);
+    } else {
+      ck_assert_int_eq(err, bg_ERR_NODE_NOT_FOUND);
+      err = bg_edge_get_weight(g, 3+i*104729, &w);
+      ck_assert_int_eq(err, bg_ERR_EDGE_NOT_FOUND);
+      bg_error_clear();
+    }
+  }
+  /* the removed ids can be used again */
+  bg_graph_create_node(g, "pipe", 2, bg_NODE_TYPE_PIPE);
+  bg_graph_create_edge(g, 1, 0, 2, 0, 0.5, 3);
+  /* duplicate edge ids resolve to the oldest edge */
+  bg_graph_create_edge(g, 1, 0, 2+7919, 0, 1.5, 3);
+  bg_edge_get_weight(g, 3, &w);
+  ck_assert(w == 0.5);
+  bg_graph_remove_edge(g, 3);
+  bg_edge_get_weight(g, 3, &w);
+  ck_assert(w == 1.5);
+  ck_assert_int_eq(bg_error_get(), bg_SUCCESS);
+} END_TEST
+
+
+START_TEST(test_bg_graph_reuse_memory) {
+  size_t i, j;
+  char name[1024];
+  const char *node_name;
+  bg_node_id_t id;
+  bg_real x;
+  bg_graph_create_input(g, "in", 1);
+  bg_graph_create_output(g, "out", 2);
+  bg_graph_create_edge(g, 0, 0, 1, 0, 1., 1);
+  for(i = 0; i < 20; ++i) {
+    /* names of different lengths, some above the small object size */
+    memset(name, 'a' + (int)(i % 26), i * 50);
+    name[i * 50] = '\0';
+    for(j = 0; j < 10; ++j) {
+      bg_graph_create_node(g, name, 10 + j, bg_NODE_TYPE_ATAN2);
+      bg_node_set_input(g, 10 + j, 1, bg_MERGE_TYPE_SUM, 1., 0., name);
+      bg_graph_create_edge(g, 1, 0, 10 + j, 0, 0.5, 10 + j);
+      bg_graph_create_edge(g, 10 + j, 0, 2, 0, 1., 20 + j);
+    }
+    bg_edge_set_value(g, 1, (bg_real)i);
+    bg_graph_evaluate(g);
+    bg_graph_get_output(g, 0, &x);
+    ck_assert_flt_almost_eq(x, 10. * atan2(0.5 * i, 1.));
+    bg_node_get_name(g, 15, &node_name);
+    ck_assert(strcmp(node_name, name) == 0);
+    ck_assert_int_eq(bg_node_get_id(g, name, &id), bg_SUCCESS);
+    ck_assert_int_eq(id, 10);
+    for(j = 0; j < 10; ++j) {
+      bg_graph_disconnect_node(g, 10 + j);
+      bg_graph_remove_node(g, 10 + j);
+    }
+  }
+  ck_assert_int_eq(bg_error_get(), bg_SUCCESS);
+} END_TEST
+
+
+START_TEST(test_bg_graph_high_fan_in) {
+  size_t i, x;
+  const size_t n = 5000;
+  bg_real value;
+  bg_edge_id_t *edge_ids;
+  /* every hidden node reads the input and feeds the output */
+  bg_graph_create_input(g, "in", 1);
+  bg_graph_create_output(g, "out", 2);
+  bg_graph_create_edge(g, 0, 0, 1, 0, 1., 1);
+  for(i = 0; i < n; ++i) {
+    bg_graph_create_node(g, "pipe", 10 + i, bg_NODE_TYPE_PIPE);
+    bg_graph_create_edge(g, 1, 0, 10 + i, 0, 1., 10 + i);
+    bg_graph_create_edge(g, 10 + i, 0, 2, 0, (bg_real)i, 10 + n + i);
+  }
+  ck_assert_int_eq(bg_error_get(), bg_SUCCESS);
+  bg_node_get_input_edges(g, 2, 0, NULL, &x);
+  ck_assert_int_eq(x, n);
+  bg_node_get_output_edges(g, 1, 0, NULL, &x);
+  ck_assert_int_eq(x, n);
+  edge_ids = (bg_edge_id_t*)malloc(n * sizeof(bg_edge_id_t));
+  bg_node_get_input_edges(g, 2, 0, edge_ids, &x);
+  for(i = 0; i < n; ++i) {
+    ck_assert_int_eq(edge_ids[i], 10 + n + i);
+  }
+  free(edge_ids);
+  bg_edge_set_value(g, 1, 2.);
+  bg_graph_evaluate(g);
+  bg_graph_get_output(g, 0, &value);
+  ck_assert_flt_almost_eq(value, 2. * (n - 1) * n / 2);
+  bg_graph_compile(g);
+  bg_edge_set_value(g, 1, 3.);
+  bg_graph_evaluate(g);
+  bg_graph_get_output(g, 0, &value);
+  ck_assert_flt_almost_eq(value, 3. * (n - 1) * n / 2);
+  /* remove the odd nodes */
+  for(i = 1; i < n; i += 2) {
+    bg_graph_disconnect_node(g, 10 + i);
+    bg_graph_remove_node(g, 10 + i);
+  }
+  bg_node_get_input_edges(g, 2, 0, NULL, &x);
+  ck_assert_int_eq(x, n / 2);
+  bg_graph_evaluate(g);
+  bg_graph_get_output(g, 0, &value);
+  ck_assert_flt_almost_eq(value, 3. * (n - 2) * n / 4);
+  ck_assert_int_eq(bg_error_get(), bg_SUCCESS);
+} END_TEST
+
+
+START_TEST(test_bg_graph_many_ports) {
+  size_t i;
+  const size_t n = 2000;
+  bg_real *values;
+  /* every input feeds its own output */
+  for(i = 0; i < n; ++i) {
+    bg_graph_create_input(g, "in", 1 + i);
+    bg_graph_create_output(g, "out", 1 + n + i);
+    bg_graph_create_edge(g, 0, 0, 1 + i, 0, 1., 1 + i);
+    bg_graph_create_edge(g, 1 + i, 0, 1 + n + i, 0, (bg_real)i, 1 + n + i);
+  }
+  ck_assert_int_eq(bg_error_get(), bg_SUCCESS);
+  values = (bg_real*)malloc(n * sizeof(bg_real));
+  for(i = 0; i < n; ++i) {
+    values[i] = 2.;
+  }
+  bg_graph_set_inputs(g, values);
+  bg_graph_evaluate(g);
+  bg_graph_get_outputs(g, values);
+  for(i = 0; i < n; ++i) {
+    ck_assert_flt_almost_eq(values[i], 2. * i);
+  }
+  /* the following inputs move up one index */
+  bg_graph_remove_edge(g, 1 + n / 2);
+  bg_graph_disconnect_node(g, 1 + n / 2);
+  ck_assert_int_eq(bg_graph_remove_input(g, 1 + n / 2), bg_SUCCESS);
+  for(i = 0; i < n - 1; ++i) {
+    values[i] = 3.;
+  }
+  bg_graph_set_inputs(g, values);
+  bg_graph_evaluate(g);
+  bg_graph_get_outputs(g, values);
+  ck_assert_flt_almost_eq(values[n / 2 - 1], 3. * (n / 2 - 1));
+  ck_assert_flt_almost_eq(values[n / 2], 0.);
+  ck_assert_flt_almost_eq(values[n - 1], 3. * (n - 1));
+  free(values);
+  ck_assert_int_eq(bg_error_get(), bg_SUCCESS);
+} END_TEST
+
+/* in -> 10 -> 11 -> ... -> out with a loop from the last node back to the
+ * first one, the chain edges are created from the output towards the input */
+static void create_reverse_chain(bg_graph_t *graph, size_t n) {
+  size_t i;
+  bg_graph_create_input(graph, "in", 1);
+  bg_graph_create_output(graph, "out", 2);
+  for(i = 0; i < n; ++i) {
+    bg_graph_create_node(graph, "pipe", 10 + i, bg_NODE_TYPE_PIPE);
+  }
+  bg_graph_create_edge(graph, 0, 0, 1, 0, 1., 3);
+  bg_graph_create_edge(graph, 1, 0, 10, 0, 1., 2);
+  bg_graph_create_edge(graph, 10 + n - 1, 0, 10, 0, 0., 10);
+  bg_graph_create_edge(graph, 10 + n - 1, 0, 2, 0, 1., 1);
+  for(i = n - 1; i > 0; --i) {
+    bg_graph_create_edge(graph, 10 + i - 1, 0, 10 + i, 0, 1., 10 + i);
+  }
+}
+
+START_TEST(test_bg_graph_long_chain) {
+  double value;
+  create_reverse_chain(g, 200000);
+  ck_assert_int_eq(bg_error_get(), bg_SUCCESS);
+  /* the value passes the whole chain in one evaluation */
+  bg_edge_set_value(g, 3, 2.);
+  bg_graph_evaluate(g);
+  bg_graph_get_output(g, 0, &value);
+  ck_assert_flt_almost_eq(value, 2.);
+  ck_assert_int_eq(bg_error_get(), bg_SUCCESS);
+} END_TEST
+
+static unsigned long edit_rand(unsigned long *state) {
+  *state = *state * 1103515245UL + 12345UL;
+  return (*state >> 16) & 0x7fff;
+}
+
+/* the position of the node in the order, cnt if it is missing */
+static size_t order_position(const bg_node_id_t *order, size_t cnt,
+                             bg_node_id_t id) {
+  size_t i;
+  for(i = 0; i < cnt && order[i] != id; ++i);
+  return i;
+}
+
+/* Random edits of a graph that is evaluated between most of them. Every node
+ * reads the input and feeds the output, the inner edges follow a random rank
+ * of the nodes except for short lived loops. Without loops a fresh clone,
+ * whose order is sorted from scratch, has to yield the same output, and the
+ * maintained order has to hold the same nodes in an order that respects
+ * every edge. */
+START_TEST(test_bg_graph_edit_order) {
+  enum { MAX_NODES = 40, MAX_EDGES = 120 };
+  double rank[MAX_NODES];
+  bool alive[MAX_NODES];
+  size_t edge_src[MAX_EDGES], edge_dst[MAX_EDGES];
+  bg_edge_id_t edge_ids[MAX_EDGES], next_edge_id = 3000;
+  bg_node_id_t order[MAX_NODES + 1], sorted[MAX_NODES + 1];
+  size_t edge_cnt = 0, step, i, a, b, order_cnt, sorted_cnt;
+  unsigned long state = 1 + _i;
+  double value, expected;
+  bg_graph_t *clone;
+  bg_graph_create_input(g, "in", 1);
+  bg_graph_create_output(g, "out", 2);
+  bg_graph_create_edge(g, 0, 0, 1, 0, 1., 1);
+  for(i = 0; i < MAX_NODES; ++i) {
+    alive[i] = false;
+  }
+  if(_i & 1) {
+    bg_graph_compile(g);
+  }
+  for(step = 0; step < 300; ++step) {
+    a = edit_rand(&state) % MAX_NODES;
+    b = edit_rand(&state) % MAX_NODES;
+    switch(edit_rand(&state) % 10) {
+    case 7:
+      if(!alive[a]) {
+        alive[a] = true;
+        rank[a] = edit_rand(&state) / 32768.;
+        bg_graph_create_node(g, "n", 10 + a,
+                             a % 3 ? bg_NODE_TYPE_PIPE : bg_NODE_TYPE_SIN);
+        bg_graph_create_edge(g, 1, 0, 10 + a, 0, 0.5 + a / 40., 1000 + a);
+        bg_graph_create_edge(g, 10 + a, 0, 2, 0, 1. / (1 + a), 2000 + a);
+      }
+      break;
+    case 8:
+      if(alive[a]) {
+        alive[a] = false;
+        ck_assert_int_eq(bg_graph_disconnect_node(g, 10 + a), bg_SUCCESS);
+        ck_assert_int_eq(bg_graph_remove_node(g, 10 + a), bg_SUCCESS);
+        for(i = edge_cnt; i > 0; --i) {
+          if(edge_src[i - 1] == a || edge_dst[i - 1] == a) {
+            --edge_cnt;
+            edge_src[i - 1] = edge_src[edge_cnt];
+            edge_dst[i - 1] = edge_dst[edge_cnt];
+            edge_ids[i - 1] = edge_ids[edge_cnt];
+          }
+        }
+      }
+      break;
+    case 5:
+    case 6:
+      if(edge_cnt) {
+        i = a % edge_cnt;
+        ck_assert_int_eq(bg_graph_remove_edge(g, edge_ids[i]), bg_SUCCESS);
+        --edge_cnt;
+        edge_src[i] = edge_src[edge_cnt];
+        edge_dst[i] = edge_dst[edge_cnt];
+        edge_ids[i] = edge_ids[edge_cnt];
+      }
+      break;
+    default:
+      if(alive[a] && alive[b] && a != b && edge_cnt < MAX_EDGES) {
+        if(rank[a] > rank[b]) {
+          i = a;
+          a = b;
+          b = i;
+        }
+        ck_assert_int_eq(bg_graph_create_edge(g, 10 + a, 0, 10 + b, 0,
+                                              0.25 + b / 80., next_edge_id),
+                         bg_SUCCESS);
+        edge_src[edge_cnt] = a;
+        edge_dst[edge_cnt] = b;
+        edge_ids[edge_cnt++] = next_edge_id++;
+        if(edit_rand(&state) % 10 == 9) {
+          /* a loop the order can't follow, gone before the comparison */
+          bg_graph_create_edge(g, 10 + b, 0, 10 + a, 0, 0.5, next_edge_id);
+          bg_graph_evaluate(g);
+          bg_graph_remove_edge(g, next_edge_id++);
+        }
+      }
+      break;
+    }
+    if(edit_rand(&state) % 4 == 0) {
+      /* let several edits pile up before the order is read */
+      continue;
+    }
+    bg_edge_set_value(g, 1, 0.1 * step);
+    bg_graph_evaluate(g);
+    bg_graph_get_output(g, 0, &value);
+    bg_graph_alloc(&clone, "clone");
+    bg_graph_clone(clone, g);
+    bg_edge_set_value(clone, 1, 0.1 * step);
+    bg_graph_evaluate(clone);
+    bg_graph_get_output(clone, 0, &expected);
+    bg_graph_get_evaluation_order(g, NULL, &order_cnt);
+    bg_graph_get_evaluation_order(g, order, &order_cnt);
+    bg_graph_get_evaluation_order(clone, NULL, &sorted_cnt);
+    bg_graph_get_evaluation_order(clone, sorted, &sorted_cnt);
+    bg_graph_free(clone);
+    ck_assert_flt_almost_eq(value, expected);
+    ck_assert_int_eq(order_cnt, sorted_cnt);
+    for(i = 0; i < order_cnt; ++i) {
+      ck_assert(order_position(sorted, sorted_cnt, order[i]) < sorted_cnt);
+    }
+    for(i = 0; i < edge_cnt; ++i) {
+      ck_assert(order_position(order, order_cnt, 10 + edge_src[i]) <
+                order_position(order, order_cnt, 10 + edge_dst[i]));
+    }
+  }
+  ck_assert_int_eq(bg_error_get(), bg_SUCCESS);
+} END_TEST
+
+#ifdef THREAD_SUPPORT
+typedef struct {
+  size_t idx;
+  size_t failures;
+} error_thread_t;
+
+/* Odd threads keep an error set while they work and leave it set when they
+ * are done, even threads must never see one. */
+static void *error_thread_main(void *arg) {
+  size_t i, j;
+  double x;
+  bg_node_type type;
+  bg_graph_t *graph;
+  error_thread_t *thread = (error_thread_t*)arg;
+  for(i = 0; i < 200; ++i) {
+    bg_error_clear();
+    bg_graph_alloc(&graph, "thread graph");
+    bg_graph_create_input(graph, "in", 1);
+    bg_graph_create_output(graph, "out", 2);
+    if(thread->idx & 1) {
+      bg_edge_get_value(graph, 1000, &x);
+    }
+    for(j = 0; j < 20; ++j) {
+      /* a kept error does not make later calls fail */
+      if(bg_graph_create_node(graph, "sin", 10 + j,
+                              bg_NODE_TYPE_SIN) != bg_SUCCESS ||
+         bg_graph_create_edge(graph, 1, 0, 10 + j, 0, 1.,
+                              10 + j) != bg_SUCCESS ||
+         bg_graph_create_edge(graph, 10 + j, 0, 2, 0, 1.,
+                              100 + j) != bg_SUCCESS) {
+        thread->failures++;
+      }
+      if(thread->idx & 1) {
+        /* the first error is kept */
+        if(bg_node_get_type(graph, 1000 + j, &type) != bg_ERR_NODE_NOT_FOUND ||
+           bg_error_get() != bg_ERR_EDGE_NOT_FOUND) {
+          thread->failures++;
+        }
+      } else if(bg_error_occurred()) {
+        thread->failures++;
+      }
+    }
+    bg_graph_free(graph);
+  }
+  return NULL;
+}
+
+/* every thread sorts and evaluates graphs of its own */
+static void *sort_thread_main(void *arg) {
+  size_t i;
+  double value;
+  bg_graph_t *graph;
+  error_thread_t *thread = (error_thread_t*)arg;
+  for(i = 0; i < 20; ++i) {
+    bg_graph_alloc(&graph, "thread graph");
+    create_reverse_chain(graph, 500 + 10 * thread->idx + i);
+    bg_edge_set_value(graph, 3, (double)i);
+    bg_graph_evaluate(graph);
+    bg_graph_get_output(graph, 0, &value);
+    if(value != (double)i || bg_error_occurred()) {
+      thread->failures++;
+    }
+    bg_graph_free(graph);
+  }
+  return NULL;
+}
+#endif
+
+START_TEST(test_error_state_per_thread) {
+#ifdef THREAD_SUPPORT
+  size_t i;
+  const char *name;
+  pthread_t threads[8];
+  error_thread_t states[8];
+  for(i = 0; i < 8; ++i) {
+    states[i].idx = i;
+    states[i].failures = 0;
+    ck_assert(pthread_create(&threads[i], NULL, error_thread_main,
+                             &states[i]) == 0);
+  }
+  for(i = 0; i < 8; ++i) {
+    pthread_join(threads[i], NULL);
+  }
+  for(i = 0; i < 8; ++i) {
+    ck_assert_int_eq(states[i].failures, 0);
+  }
+  /* the errors of the other threads are not visible here */
+  ck_assert_int_eq(bg_error_get(), bg_SUCCESS);
+  bg_node_get_name(g, 1, &name);
+  ck_assert_int_eq(bg_error_get(), bg_ERR_NODE_NOT_FOUND);
+  bg_error_clear();
+#endif
+} END_TEST
+
+
+START_TEST(test_sort_concurrently) {
+#ifdef THREAD_SUPPORT
+  size_t i;
+  pthread_t threads[8];
+  error_thread_t states[8];
+  for(i = 0; i < 8; ++i) {
+    states[i].idx = i;
+    states[i].failures = 0;
+    ck_assert(pthread_create(&threads[i], NULL, sort_thread_main,
+                             &states[i]) == 0);
+  }
+  for(i = 0; i < 8; ++i) {
+    pthread_join(threads[i], NULL);
+  }
+  for(i = 0; i < 8; ++i) {
+    ck_assert_int_eq(states[i].failures, 0);
+  }
+#endif
+} END_TEST
+
+
+/* Graphs of uneven length, every seventh one fails at an extern node
+ * without implementation. */
+START_TEST(test_pool_evaluate) {
+#ifdef THREAD_SUPPORT
+  enum { GRAPH_CNT = 200 };
+  size_t i;
+  double value;
+  bg_pool_t *pool;
+  bg_graph_t *graphs[GRAPH_CNT];
+  bg_error errors[GRAPH_CNT];
+  for(i = 0; i < GRAPH_CNT; ++i) {
+    bg_graph_alloc(&graphs[i], "pool graph");
+    create_reverse_chain(graphs[i], 1 + (i * 37) % 300);
+    bg_edge_set_value(graphs[i], 3, (double)i);
+  }
+  ck_assert_int_eq(bg_error_get(), bg_SUCCESS);
+  ck_assert_int_eq(bg_pool_alloc(&pool, 4), bg_SUCCESS);
+  /* an error of the caller must not leak into the graphs */
+  ck_assert_int_eq(bg_graph_remove_edge(graphs[0], 999),
+                   bg_ERR_EDGE_NOT_FOUND);
+  ck_assert_int_eq(bg_pool_evaluate(pool, graphs, GRAPH_CNT, errors),
+                   bg_SUCCESS);
+  ck_assert_int_eq(bg_error_get(), bg_ERR_EDGE_NOT_FOUND);
+  bg_error_clear();
+  for(i = 0; i < GRAPH_CNT; ++i) {
+    ck_assert_int_eq(errors[i], bg_SUCCESS);
+    bg_graph_get_output(graphs[i], 0, &value);
+    ck_assert_flt_almost_eq(value, (double)i);
+  }
+  /* without an error array */
+  for(i = 0; i < GRAPH_CNT; ++i) {
+    bg_edge_set_value(graphs[i], 3, 2. * i);
+  }
+  ck_assert_int_eq(bg_pool_evaluate(pool, graphs, GRAPH_CNT, NULL),
+                   bg_SUCCESS);
+  ck_assert_int_eq(bg_error_get(), bg_SUCCESS);
+  for(i = 0; i < GRAPH_CNT; ++i) {
+    bg_graph_get_output(graphs[i], 0, &value);
+    ck_assert_flt_almost_eq(value, 2. * i);
+    bg_graph_free(graphs[i]);
+  }
+  bg_pool_free(pool);
+#endif
+} END_TEST
+
+
 /********************
  * node API
  ********************/
@@ -317,6 +817,75 @@ START_TEST(test_bg_node_merge_median) {
   ck_assert_flt_almost_eq(x, (3.-5)/2. + 17);
 } END_TEST
 
+/* the loop index is the number of edges added to the two of the fixture */
+START_TEST(test_bg_node_merge_median_fan_in) {
+  size_t i, j, cnt = _i + 2;
+  double x, y, tmp, weights[16];
+  bg_graph_t *compiled;
+  weights[0] = -5.;
+  weights[1] = 3.;
+  for(i = 2; i < cnt; ++i) {
+    weights[i] = (double)((i * 7) % 11) - 4.5;
+    bg_graph_create_edge(g, 0, 0, 1, 0, weights[i], i + 1);
+    bg_edge_set_value(g, i + 1, 1.);
+  }
+  bg_node_set_merge(g, 1, 0, bg_MERGE_TYPE_MEDIAN, 0., 17.);
+  bg_graph_alloc(&compiled, "compiled");
+  ck_assert_int_eq(bg_graph_clone(compiled, g), bg_SUCCESS);
+  ck_assert_int_eq(bg_graph_compile(compiled), bg_SUCCESS);
+  for(i = 0; i < cnt; ++i) {
+    bg_edge_set_value(compiled, i + 1, 1.);
+  }
+  bg_graph_evaluate(g);
+  bg_graph_evaluate(compiled);
+  bg_node_get_output(g, 1, 0, &x);
+  bg_node_get_output(compiled, 1, 0, &y);
+  ck_assert(x == y);
+  for(i = 1; i < cnt; ++i) {
+    for(j = i; j > 0 && weights[j - 1] > weights[j]; --j) {
+      tmp = weights[j];
+      weights[j] = weights[j - 1];
+      weights[j - 1] = tmp;
+    }
+  }
+  if(cnt & 1) {
+    ck_assert_flt_almost_eq(x, weights[cnt / 2] + 17);
+  } else {
+    ck_assert_flt_almost_eq(x, (weights[cnt / 2] + weights[cnt / 2 - 1]) / 2.
+                            + 17);
+  }
+  ck_assert_int_eq(bg_error_get(), bg_SUCCESS);
+  bg_graph_free(compiled);
+} END_TEST
+
+/* NaNs and zeros of either sign give the same median for all fan-ins */
+START_TEST(test_bg_node_merge_median_nan) {
+  size_t i;
+  double x, y, zero = 0.;
+  bg_graph_t *compiled;
+  bg_edge_set_weight(g, 1, 3.);
+  bg_edge_set_weight(g, 2, -zero);
+  bg_graph_create_edge(g, 0, 0, 1, 0, 0., 3);
+  bg_graph_create_edge(g, 0, 0, 1, 0, zero / zero, 4);
+  bg_edge_set_value(g, 3, 1.);
+  bg_edge_set_value(g, 4, 1.);
+  bg_node_set_merge(g, 1, 0, bg_MERGE_TYPE_MEDIAN, 0., 0.);
+  bg_graph_alloc(&compiled, "compiled");
+  ck_assert_int_eq(bg_graph_clone(compiled, g), bg_SUCCESS);
+  ck_assert_int_eq(bg_graph_compile(compiled), bg_SUCCESS);
+  for(i = 1; i <= 4; ++i) {
+    bg_edge_set_value(compiled, i, 1.);
+  }
+  bg_graph_evaluate(g);
+  bg_graph_evaluate(compiled);
+  bg_node_get_output(g, 1, 0, &x);
+  bg_node_get_output(compiled, 1, 0, &y);
+  ck_assert(x == 0.);
+  ck_assert(y == 0.);
+  ck_assert_int_eq(bg_error_get(), bg_SUCCESS);
+  bg_graph_free(compiled);
+} END_TEST
+
 START_TEST(test_bg_node_merge_mean) {
   double x;
   bg_node_set_merge(g, 1, 0, bg_MERGE_TYPE_MEAN, 0., 17.);
@@ -548,10 +1117,1257 @@ START_TEST(test_simple_net) {
 } END_TEST
 
 
+/********************
+ * compiled graphs
+ ********************/
+
+static void create_mixed_graph(bg_graph_t *graph, bg_merge_type merge_type) {
+  bg_graph_create_input(graph, "x", 1);
+  bg_graph_create_input(graph, "y", 2);
+  bg_graph_create_node(graph, "pipe", 3, bg_NODE_TYPE_PIPE);
+  bg_graph_create_node(graph, "sin", 4, bg_NODE_TYPE_SIN);
+  bg_graph_create_node(graph, "atan2", 5, bg_NODE_TYPE_ATAN2);
+  bg_graph_create_node(graph, ">0", 6, bg_NODE_TYPE_GREATER_THAN_0);
+  bg_graph_create_node(graph, "sigmoid", 7, bg_NODE_TYPE_FSIGMOID);
+  bg_graph_create_output(graph, "out", 8);
+  bg_graph_create_output(graph, "unconnected", 9);
+  bg_node_set_merge(graph, 3, 0, merge_type, 1.5, 0.25);
+  bg_node_set_merge(graph, 8, 0, merge_type, 0., -0.5);
+  bg_node_set_default(graph, 6, 2, -2.);
+  bg_graph_create_edge(graph, 0, 0, 1, 0, 1., 1);
+  bg_graph_create_edge(graph, 0, 0, 2, 0, 1., 2);
+  bg_graph_create_edge(graph, 1, 0, 3, 0, 0.7, 3);
+  bg_graph_create_edge(graph, 2, 0, 3, 0, -1.3, 4);
+  bg_graph_create_edge(graph, 2, 0, 3, 0, 2.1, 5);
+  bg_graph_create_edge(graph, 1, 0, 4, 0, 1., 6);
+  bg_graph_create_edge(graph, 3, 0, 5, 0, 1., 7);
+  bg_graph_create_edge(graph, 4, 0, 5, 1, 0.5, 8);
+  bg_graph_create_edge(graph, 4, 0, 6, 0, 1., 9);
+  bg_graph_create_edge(graph, 5, 0, 6, 1, 3., 10);
+  bg_graph_create_edge(graph, 6, 0, 7, 0, 1., 11);
+  bg_graph_create_edge(graph, 5, 0, 8, 0, 1., 12);
+  bg_graph_create_edge(graph, 6, 0, 8, 0, -0.3, 13);
+  bg_graph_create_edge(graph, 7, 0, 8, 0, 2., 14);
+  bg_graph_create_edge(graph, 3, 0, 8, 0, 0.9, 15);
+}
+
+START_TEST(test_compiled_matches_interpreted) {
+  size_t i, j;
+  double x, y;
+  bg_graph_t *compiled;
+  bg_graph_alloc(&compiled, "compiled");
+  create_mixed_graph(g, (bg_merge_type)_i);
+  create_mixed_graph(compiled, (bg_merge_type)_i);
+  ck_assert_int_eq(bg_graph_compile(compiled), bg_SUCCESS);
+  for(i = 0; i < test_vals_num; ++i) {
+    j = test_vals_num - 1 - i;
+    bg_edge_set_value(g, 1, test_vals[i]);
+    bg_edge_set_value(g, 2, test_vals[j]);
+    bg_edge_set_value(compiled, 1, test_vals[i]);
+    bg_edge_set_value(compiled, 2, test_vals[j]);
+    bg_graph_evaluate(g);
+    bg_graph_evaluate(compiled);
+    bg_graph_get_output(g, 0, &x);
+    bg_graph_get_output(compiled, 0, &y);
+    ck_assert(x == y || (isnan(x) && isnan(y)));
+    bg_node_get_output(g, 5, 0, &x);
+    bg_node_get_output(compiled, 5, 0, &y);
+    ck_assert(x == y || (isnan(x) && isnan(y)));
+    bg_edge_get_value(g, 13, &x);
+    bg_edge_get_value(compiled, 13, &y);
+    ck_assert(x == y || (isnan(x) && isnan(y)));
+  }
+  ck_assert_int_eq(bg_error_get(), bg_SUCCESS);
+  bg_graph_free(compiled);
+} END_TEST
+
+START_TEST(test_compiled_modify) {
+  double x;
+  create_mixed_graph(g, bg_MERGE_TYPE_SUM);
+  bg_graph_compile(g);
+  bg_edge_set_value(g, 1, 2.);
+  bg_edge_set_value(g, 2, 1.);
+  bg_graph_evaluate(g);
+  bg_node_get_output(g, 3, 0, &x);
+  ck_assert_flt_almost_eq(x, 0.25 + 1.4 - 1.3 + 2.1);
+  /* weights are patched into the plan */
+  bg_edge_set_weight(g, 3, 1.);
+  bg_graph_evaluate(g);
+  bg_node_get_output(g, 3, 0, &x);
+  ck_assert_flt_almost_eq(x, 0.25 + 2. - 1.3 + 2.1);
+  /* merges and structural changes rebuild the plan */
+  bg_node_set_merge(g, 3, 0, bg_MERGE_TYPE_MAX, 0., 0.);
+  bg_graph_evaluate(g);
+  bg_node_get_output(g, 3, 0, &x);
+  ck_assert_flt_almost_eq(x, 2.1);
+  bg_graph_remove_edge(g, 5);
+  bg_graph_evaluate(g);
+  bg_node_get_output(g, 3, 0, &x);
+  ck_assert_flt_almost_eq(x, 2.);
+  bg_graph_reset(g, true);
+  bg_node_get_output(g, 3, 0, &x);
+  ck_assert_flt_almost_eq(x, 0.);
+  ck_assert_int_eq(bg_error_get(), bg_SUCCESS);
+} END_TEST
+
+START_TEST(test_batch_matches_scalar) {
+  size_t i;
+  double x;
+  double inputs[2 * 150];
+  double outputs[2 * 150];
+  create_mixed_graph(g, (bg_merge_type)_i);
+  for(i = 0; i < 150; ++i) {
+    inputs[2 * i] = test_vals[i % test_vals_num];
+    inputs[2 * i + 1] = test_vals[(i / test_vals_num) % test_vals_num];
+  }
+  ck_assert_int_eq(bg_graph_evaluate_batch(g, inputs, outputs, 150),
+                   bg_SUCCESS);
+  for(i = 0; i < 150; ++i) {
+    bg_edge_set_value(g, 1, inputs[2 * i]);
+    bg_edge_set_value(g, 2, inputs[2 * i + 1]);
+    bg_graph_evaluate(g);
+    bg_graph_get_output(g, 0, &x);
+    ck_assert(x == outputs[2 * i] || (isnan(x) && isnan(outputs[2 * i])));
+    bg_graph_get_output(g, 1, &x);
+    ck_assert(x == outputs[2 * i + 1]);
+  }
+  ck_assert_int_eq(bg_error_get(), bg_SUCCESS);
+} END_TEST
+
+START_TEST(test_batch_subgraph) {
+  size_t i;
+  double x;
+  double inputs[100];
+  double outputs[100];
+  bg_graph_t *subgraph;
+  bg_graph_alloc(&subgraph, "sub");
+  bg_graph_create_input(subgraph, "in", 1);
+  bg_graph_create_node(subgraph, "sin", 2, bg_NODE_TYPE_SIN);
+  bg_graph_create_output(subgraph, "out", 3);
+  bg_graph_create_edge(subgraph, 1, 0, 2, 0, 2., 1);
+  bg_graph_create_edge(subgraph, 2, 0, 3, 0, 1., 2);
+  bg_graph_create_input(g, "x", 1);
+  bg_graph_create_node(g, "sub", 2, bg_NODE_TYPE_SUBGRAPH);
+  bg_node_set_subgraph(g, 2, subgraph);
+  bg_graph_create_output(g, "y", 3);
+  bg_graph_create_edge(g, 0, 0, 1, 0, 1., 1);
+  bg_graph_create_edge(g, 1, 0, 2, 0, 0.5, 2);
+  bg_graph_create_edge(g, 2, 0, 3, 0, 3., 3);
+  for(i = 0; i < 100; ++i) {
+    inputs[i] = i * 0.1 - 5.;
+  }
+  ck_assert_int_eq(bg_graph_evaluate_batch(g, inputs, outputs, 100),
+                   bg_SUCCESS);
+  for(i = 0; i < 100; ++i) {
+    bg_edge_set_value(g, 1, inputs[i]);
+    bg_graph_evaluate(g);
+    bg_graph_get_output(g, 0, &x);
+    ck_assert(x == outputs[i]);
+    ck_assert_flt_almost_eq(x, 3. * sin(inputs[i]));
+  }
+  ck_assert_int_eq(bg_error_get(), bg_SUCCESS);
+} END_TEST
+
+/* in -> 10 -> 11 -> out with an edge from 11 back to 10 that sums up the
+ * inputs */
+static void create_accumulator(bg_graph_t *graph) {
+  bg_graph_create_input(graph, "in", 1);
+  bg_graph_create_output(graph, "out", 2);
+  bg_graph_create_node(graph, "sum", 10, bg_NODE_TYPE_PIPE);
+  bg_graph_create_node(graph, "pipe", 11, bg_NODE_TYPE_PIPE);
+  bg_graph_create_edge(graph, 0, 0, 1, 0, 1., 1);
+  bg_graph_create_edge(graph, 1, 0, 10, 0, 1., 2);
+  bg_graph_create_edge(graph, 10, 0, 11, 0, 1., 4);
+  bg_graph_create_edge(graph, 11, 0, 10, 0, 1., 3);
+  bg_graph_create_edge(graph, 11, 0, 2, 0, 1., 5);
+}
+
+/* The samples of a batch don't see each other in the state of a
+ * sub-graph. */
+START_TEST(test_batch_subgraph_state) {
+  size_t i;
+  double x;
+  double inputs[3] = {1., 1., 1.};
+  double outputs[3];
+  bg_graph_t *subgraph;
+  bg_graph_alloc(&subgraph, "sub");
+  create_accumulator(subgraph);
+  bg_graph_create_input(g, "x", 1);
+  bg_graph_create_node(g, "sub", 2, bg_NODE_TYPE_SUBGRAPH);
+  bg_node_set_subgraph(g, 2, subgraph);
+  bg_graph_create_output(g, "y", 3);
+  bg_graph_create_edge(g, 0, 0, 1, 0, 1., 1);
+  bg_graph_create_edge(g, 1, 0, 2, 0, 1., 2);
+  bg_graph_create_edge(g, 2, 0, 3, 0, 1., 3);
+  bg_edge_set_value(g, 1, 1.);
+  bg_graph_evaluate(g);
+  bg_graph_evaluate(g);
+  ck_assert_int_eq(bg_graph_evaluate_batch(g, inputs, outputs, 3),
+                   bg_SUCCESS);
+  for(i = 0; i < 3; ++i) {
+    ck_assert_flt_almost_eq(outputs[i], 3.);
+  }
+  /* the state of the sub-graph is left as it was */
+  bg_graph_evaluate(g);
+  bg_graph_get_output(g, 0, &x);
+  ck_assert_flt_almost_eq(x, 3.);
+  ck_assert_int_eq(bg_error_get(), bg_SUCCESS);
+} END_TEST
+
+static void create_wide_graph(bg_graph_t *graph) {
+  static const bg_node_type types[] = {
+    bg_NODE_TYPE_PIPE, bg_NODE_TYPE_SIN, bg_NODE_TYPE_TANH,
+    bg_NODE_TYPE_ABS, bg_NODE_TYPE_FSIGMOID, bg_NODE_TYPE_ATAN2,
+    bg_NODE_TYPE_GREATER_THAN_0, bg_NODE_TYPE_MOD};
+  static const size_t inputs[] = {1, 1, 1, 1, 1, 2, 3, 2};
+  size_t i, j, type;
+  bg_edge_id_t edge_id = 1;
+  bg_graph_create_input(graph, "x", 1);
+  bg_graph_create_input(graph, "y", 2);
+  bg_graph_create_edge(graph, 0, 0, 1, 0, 1., edge_id++);
+  bg_graph_create_edge(graph, 0, 0, 2, 0, 1., edge_id++);
+  for(i = 0; i < 200; ++i) {
+    type = i % (sizeof(types) / sizeof(types[0]));
+    bg_graph_create_node(graph, "l1", 10 + i, types[type]);
+    for(j = 0; j < inputs[type]; ++j) {
+      bg_graph_create_edge(graph, 1 + (i + j) % 2, 0, 10 + i, j,
+                           0.01 * (i + 1) - j, edge_id++);
+    }
+  }
+  for(i = 0; i < 100; ++i) {
+    bg_graph_create_node(graph, "l2", 400 + i, bg_NODE_TYPE_PIPE);
+    bg_node_set_merge(graph, 400 + i, 0, (bg_merge_type)(i % 8), 0., 0.1);
+    for(j = 0; j < 3; ++j) {
+      bg_graph_create_edge(graph, 10 + (7 * i + 13 * j) % 200, 0,
+                           400 + i, 0, 1. - 0.3 * j, edge_id++);
+    }
+  }
+  /* feedback from the second into the first layer */
+  bg_graph_create_edge(graph, 450, 0, 10, 0, 0.5, edge_id++);
+  for(i = 0; i < 4; ++i) {
+    bg_graph_create_output(graph, "out", 1000 + i);
+    bg_node_set_merge(graph, 1000 + i, 0, (bg_merge_type)(i * 2), 0., 0.);
+    for(j = 0; j < 100; ++j) {
+      bg_graph_create_edge(graph, 400 + j, 0, 1000 + i, 0, 0.5,
+                           edge_id++);
+    }
+  }
+}
+
+START_TEST(test_parallel_matches_serial) {
+  size_t i, j;
+  double x, y;
+  bg_error err;
+  bg_graph_t *parallel;
+  create_wide_graph(g);
+  bg_graph_alloc(&parallel, "parallel");
+  create_wide_graph(parallel);
+  ck_assert_int_eq(bg_error_get(), bg_SUCCESS);
+  err = bg_graph_set_parallel(parallel, 4, _i);
+  if(err == bg_ERR_NOT_IMPLEMENTED) {
+    bg_graph_free(parallel);
+    return;
+  }
+  ck_assert_int_eq(err, bg_SUCCESS);
+  for(i = 0; i < 3 * test_vals_num; ++i) {
+    bg_edge_set_value(g, 1, test_vals[i % test_vals_num]);
+    bg_edge_set_value(g, 2, test_vals[(i / 3) % test_vals_num]);
+    bg_edge_set_value(parallel, 1, test_vals[i % test_vals_num]);
+    bg_edge_set_value(parallel, 2, test_vals[(i / 3) % test_vals_num]);
+    bg_graph_evaluate(g);
+    bg_graph_evaluate(parallel);
+    for(j = 0; j < 4; ++j) {
+      bg_graph_get_output(g, j, &x);
+      bg_graph_get_output(parallel, j, &y);
+      ck_assert(x == y || (isnan(x) && isnan(y)));
+    }
+    for(j = 0; j < 200; j += 7) {
+      bg_node_get_output(g, 10 + j, 0, &x);
+      bg_node_get_output(parallel, 10 + j, 0, &y);
+      ck_assert(x == y || (isnan(x) && isnan(y)));
+    }
+  }
+  /* back to serial */
+  ck_assert_int_eq(bg_graph_set_parallel(parallel, 1, 0), bg_SUCCESS);
+  bg_graph_evaluate(g);
+  bg_graph_evaluate(parallel);
+  bg_graph_get_output(g, 0, &x);
+  bg_graph_get_output(parallel, 0, &y);
+  ck_assert(x == y || (isnan(x) && isnan(y)));
+  ck_assert_int_eq(bg_error_get(), bg_SUCCESS);
+  bg_graph_free(parallel);
+} END_TEST
+
+START_TEST(test_incremental_matches_full) {
+  size_t i, j;
+  double x, y;
+  bg_edge_t *edge;
+  bg_graph_t *compiled;
+  create_wide_graph(g);
+  bg_graph_alloc(&compiled, "compiled");
+  create_wide_graph(compiled);
+  bg_graph_compile(compiled);
+  bg_edge_get_pointer(compiled, 2, &edge);
+  for(i = 0; i < 4 * test_vals_num; ++i) {
+    /* only a few inputs change per step */
+    if(i % 2 == 0) {
+      bg_edge_set_value(g, 1, test_vals[(i / 2) % test_vals_num]);
+      bg_edge_set_value(compiled, 1, test_vals[(i / 2) % test_vals_num]);
+    }
+    if(i % 5 == 0) {
+      bg_edge_set_value(g, 2, test_vals[(i / 5) % test_vals_num]);
+      bg_edge_set_value_p(edge, test_vals[(i / 5) % test_vals_num]);
+    }
+    if(i % 7 == 3) {
+      bg_edge_set_weight(g, 20 + i, 0.1 * i);
+      bg_edge_set_weight(compiled, 20 + i, 0.1 * i);
+    }
+    bg_graph_evaluate(g);
+    bg_graph_evaluate(compiled);
+    for(j = 0; j < 4; ++j) {
+      bg_graph_get_output(g, j, &x);
+      bg_graph_get_output(compiled, j, &y);
+      ck_assert(x == y || (isnan(x) && isnan(y)));
+    }
+    for(j = 0; j < 100; ++j) {
+      bg_node_get_output(g, 400 + j, 0, &x);
+      bg_node_get_output(compiled, 400 + j, 0, &y);
+      ck_assert(x == y || (isnan(x) && isnan(y)));
+    }
+  }
+  bg_graph_reset(g, true);
+  bg_graph_reset(compiled, true);
+  bg_graph_evaluate(g);
+  bg_graph_evaluate(compiled);
+  bg_graph_get_output(g, 2, &x);
+  bg_graph_get_output(compiled, 2, &y);
+  ck_assert(x == y || (isnan(x) && isnan(y)));
+  ck_assert_int_eq(bg_error_get(), bg_SUCCESS);
+  bg_graph_free(compiled);
+} END_TEST
+
+/* Values set on inner edges of a compiled or a parallel graph are read until
+ * the source of the edge is evaluated again. */
+START_TEST(test_compiled_edge_values) {
+  size_t i, j;
+  double x, y, value;
+  bg_error err = bg_SUCCESS;
+  bg_graph_t *compiled;
+  create_accumulator(g);
+  bg_graph_alloc(&compiled, "compiled");
+  create_accumulator(compiled);
+  if(_i == 0) {
+    bg_graph_compile(compiled);
+  } else {
+    err = bg_graph_set_parallel(compiled, 2, 0);
+  }
+  if(err == bg_ERR_NOT_IMPLEMENTED) {
+    bg_graph_free(compiled);
+    return;
+  }
+  ck_assert_int_eq(err, bg_SUCCESS);
+  for(i = 0; i < 12; ++i) {
+    bg_edge_set_value(g, 1, 1.);
+    bg_edge_set_value(compiled, 1, 1.);
+    if(i % 3 == 1) {
+      /* the edge back to the sum is read before its source runs */
+      value = 100. + i;
+      bg_edge_set_value(g, 3, value);
+      bg_edge_set_value(compiled, 3, value);
+      bg_edge_get_value(compiled, 3, &y);
+      ck_assert(y == value);
+    }
+    if(i % 4 == 2) {
+      /* the source writes over the value before it is read */
+      bg_edge_set_value(g, 4, -7.);
+      bg_edge_set_value(compiled, 4, -7.);
+      bg_edge_get_value(compiled, 4, &y);
+      ck_assert(y == -7.);
+    }
+    bg_graph_evaluate(g);
+    bg_graph_evaluate(compiled);
+    bg_graph_get_output(g, 0, &x);
+    bg_graph_get_output(compiled, 0, &y);
+    ck_assert(x == y);
+    for(j = 3; j <= 4; ++j) {
+      bg_edge_get_value(g, j, &x);
+      bg_edge_get_value(compiled, j, &y);
+      ck_assert(x == y);
+    }
+  }
+  /* a value set before the plan is built is carried over */
+  bg_edge_set_value(g, 3, 0.5);
+  bg_edge_set_value(compiled, 3, 0.5);
+  bg_graph_remove_edge(g, 5);
+  bg_graph_remove_edge(compiled, 5);
+  bg_graph_evaluate(g);
+  bg_graph_evaluate(compiled);
+  bg_node_get_output(g, 11, 0, &x);
+  bg_node_get_output(compiled, 11, 0, &y);
+  ck_assert_flt_almost_eq(x, 1.5);
+  ck_assert(x == y);
+  ck_assert_int_eq(bg_error_get(), bg_SUCCESS);
+  bg_graph_free(compiled);
+} END_TEST
+
+/* Every level feeds two inputs through a sub-graph of the next level. */
+static bg_graph_t *create_nested_graph(size_t depth) {
+  bg_graph_t *graph, *subgraph;
+  bg_graph_alloc(&graph, "nested");
+  bg_graph_create_input(graph, "a", 1);
+  bg_graph_create_input(graph, "b", 2);
+  bg_graph_create_node(graph, "sin", 3, bg_NODE_TYPE_SIN);
+  bg_graph_create_node(graph, "atan2", 4, bg_NODE_TYPE_ATAN2);
+  bg_graph_create_output(graph, "sum", 6);
+  bg_graph_create_output(graph, "max", 7);
+  bg_node_set_merge(graph, 7, 0, bg_MERGE_TYPE_MAX, 0., -1.);
+  bg_graph_create_edge(graph, 0, 0, 1, 0, 1., 20);
+  bg_graph_create_edge(graph, 0, 0, 2, 0, 1., 21);
+  bg_graph_create_edge(graph, 1, 0, 3, 0, 1.1, 1);
+  bg_graph_create_edge(graph, 1, 0, 4, 0, 0.9, 2);
+  bg_graph_create_edge(graph, 2, 0, 4, 1, -1.2, 3);
+  bg_graph_create_edge(graph, 3, 0, 6, 0, 0.5, 4);
+  bg_graph_create_edge(graph, 4, 0, 7, 0, 2., 5);
+  if(depth > 0) {
+    subgraph = create_nested_graph(depth - 1);
+    bg_graph_create_node(graph, "sub", 5, bg_NODE_TYPE_SUBGRAPH);
+    bg_node_set_subgraph(graph, 5, subgraph);
+    bg_graph_create_edge(graph, 3, 0, 5, 0, 1.5, 6);
+    bg_graph_create_edge(graph, 4, 0, 5, 1, 0.7, 7);
+    bg_graph_create_edge(graph, 2, 0, 5, 1, 0.3, 8);
+    bg_graph_create_edge(graph, 5, 0, 6, 0, -0.8, 9);
+    bg_graph_create_edge(graph, 5, 1, 7, 0, 1.3, 10);
+    bg_graph_create_edge(graph, 5, 1, 6, 0, 0.2, 11);
+  }
+  return graph;
+}
+
+START_TEST(test_inline_subgraphs) {
+  size_t i, j;
+  double x, y;
+  bg_graph_t *flat, *nested, *sub, *inner;
+  bg_graph_free(g);
+  g = create_nested_graph(5);
+  flat = create_nested_graph(5);
+  ck_assert_int_eq(bg_graph_set_inline_subgraphs(flat, true), bg_SUCCESS);
+  for(i = 0; i < 2 * test_vals_num; ++i) {
+    if(i == test_vals_num) {
+      /* modify a nested graph through its own handle */
+      bg_graph_get_subgraph(g, "sub", &nested);
+      bg_graph_get_subgraph(nested, "sub", &inner);
+      bg_edge_set_weight(inner, 2, -2.);
+      bg_graph_get_subgraph(flat, "sub", &nested);
+      bg_graph_get_subgraph(nested, "sub", &sub);
+      bg_edge_set_weight(sub, 2, -2.);
+      bg_node_set_merge(inner, 6, 0, bg_MERGE_TYPE_PRODUCT, 0., 1.);
+      bg_node_set_merge(sub, 6, 0, bg_MERGE_TYPE_PRODUCT, 0., 1.);
+    }
+    bg_edge_set_value(g, 20, test_vals[i % test_vals_num]);
+    bg_edge_set_value(flat, 20, test_vals[i % test_vals_num]);
+    bg_edge_set_value(g, 21, test_vals[(i + 3) % test_vals_num]);
+    bg_edge_set_value(flat, 21, test_vals[(i + 3) % test_vals_num]);
+    bg_graph_evaluate(g);
+    bg_graph_evaluate(flat);
+    for(j = 0; j < 2; ++j) {
+      bg_graph_get_output(g, j, &x);
+      bg_graph_get_output(flat, j, &y);
+      ck_assert(x == y || (isnan(x) && isnan(y)));
+    }
+    bg_node_get_output(g, 5, 1, &x);
+    bg_node_get_output(flat, 5, 1, &y);
+    ck_assert(x == y || (isnan(x) && isnan(y)));
+  }
+  ck_assert_int_eq(bg_error_get(), bg_SUCCESS);
+  bg_graph_free(flat);
+} END_TEST
+
+/* Four independent sub-graphs, a fifth one that reads two of them and a
+ * loop back into the first level. */
+static void create_limb_graph(bg_graph_t *graph) {
+  size_t i;
+  bg_graph_create_input(graph, "a", 1);
+  bg_graph_create_input(graph, "b", 2);
+  bg_graph_create_node(graph, "tanh", 3, bg_NODE_TYPE_TANH);
+  bg_graph_create_output(graph, "sum", 20);
+  bg_graph_create_output(graph, "max", 21);
+  bg_node_set_merge(graph, 21, 0, bg_MERGE_TYPE_MAX, 0., -1.);
+  bg_graph_create_edge(graph, 0, 0, 1, 0, 1., 1);
+  bg_graph_create_edge(graph, 0, 0, 2, 0, 1., 2);
+  bg_graph_create_edge(graph, 2, 0, 3, 0, 0.8, 3);
+  for(i = 0; i < 5; ++i) {
+    bg_graph_create_node(graph, "sub", 10 + i, bg_NODE_TYPE_SUBGRAPH);
+    bg_node_set_subgraph(graph, 10 + i, create_nested_graph(3 + i % 2));
+    bg_graph_create_edge(graph, 10 + i, 0, 20, 0, 0.3 * (i + 1), 10 + i);
+    bg_graph_create_edge(graph, 10 + i, 1, 21, 0, 1. - 0.2 * i, 20 + i);
+  }
+  for(i = 0; i < 4; ++i) {
+    bg_graph_create_edge(graph, 1, 0, 10 + i, 0, 0.5 + 0.1 * i, 30 + i);
+    bg_graph_create_edge(graph, 3, 0, 10 + i, 1, 1.2 - 0.4 * i, 40 + i);
+  }
+  bg_graph_create_edge(graph, 10, 0, 14, 0, 0.9, 50);
+  bg_graph_create_edge(graph, 11, 1, 14, 1, -1.1, 51);
+  /* feedback from the second into the first level */
+  bg_graph_create_edge(graph, 14, 0, 10, 0, 0.25, 52);
+}
+
+/* Edges into and out of a sub-graph node of a compiled graph, the loop
+ * index selects a compiled, an inlined or a sub-graph parallel graph. */
+START_TEST(test_compiled_subgraph_edges) {
+  size_t i, j;
+  double x, y;
+  bg_error err = bg_SUCCESS;
+  bg_graph_t *compiled;
+  bg_graph_free(g);
+  g = create_nested_graph(2);
+  compiled = create_nested_graph(2);
+  if(_i == 0) {
+    bg_graph_compile(compiled);
+  } else if(_i == 1) {
+    bg_graph_set_inline_subgraphs(compiled, true);
+  } else {
+    err = bg_graph_set_parallel_subgraphs(compiled, 2);
+  }
+  if(err == bg_ERR_NOT_IMPLEMENTED) {
+    bg_graph_free(compiled);
+    return;
+  }
+  for(i = 0; i < 4 * test_vals_num; ++i) {
+    if(i % test_vals_num == 1) {
+      /* a second edge into the first input of the sub-graph */
+      bg_graph_create_edge(g, 1, 0, 5, 0, 0.5, 50 + i);
+      bg_graph_create_edge(compiled, 1, 0, 5, 0, 0.5, 50 + i);
+      bg_graph_create_edge(g, 5, 0, 7, 0, -0.5, 150 + i);
+      bg_graph_create_edge(compiled, 5, 0, 7, 0, -0.5, 150 + i);
+    } else if(i % test_vals_num == 3) {
+      bg_graph_remove_edge(g, 50 + i - 2);
+      bg_graph_remove_edge(compiled, 50 + i - 2);
+      bg_graph_remove_edge(g, 150 + i - 2);
+      bg_graph_remove_edge(compiled, 150 + i - 2);
+    }
+    bg_edge_set_value(g, 20, test_vals[i % test_vals_num]);
+    bg_edge_set_value(compiled, 20, test_vals[i % test_vals_num]);
+    bg_edge_set_value(g, 21, test_vals[(i + 5) % test_vals_num]);
+    bg_edge_set_value(compiled, 21, test_vals[(i + 5) % test_vals_num]);
+    bg_graph_evaluate(g);
+    bg_graph_evaluate(compiled);
+    for(j = 0; j < 2; ++j) {
+      bg_graph_get_output(g, j, &x);
+      bg_graph_get_output(compiled, j, &y);
+      ck_assert(x == y || (isnan(x) && isnan(y)));
+    }
+  }
+  ck_assert_int_eq(bg_error_get(), bg_SUCCESS);
+  bg_graph_free(compiled);
+} END_TEST
+
+START_TEST(test_parallel_subgraphs) {
+  size_t i, j;
+  double x, y;
+  bg_error err;
+  bg_graph_t *parallel, *clone;
+  create_limb_graph(g);
+  bg_graph_alloc(&parallel, "parallel");
+  create_limb_graph(parallel);
+  ck_assert_int_eq(bg_error_get(), bg_SUCCESS);
+  err = bg_graph_set_parallel_subgraphs(parallel, 3);
+  if(err == bg_ERR_NOT_IMPLEMENTED) {
+    bg_graph_free(parallel);
+    return;
+  }
+  ck_assert_int_eq(err, bg_SUCCESS);
+  bg_graph_alloc(&clone, "clone");
+  bg_graph_clone(clone, parallel);
+  for(i = 0; i < 3 * test_vals_num; ++i) {
+    bg_edge_set_value(g, 1, test_vals[i % test_vals_num]);
+    bg_edge_set_value(g, 2, test_vals[(i / 3) % test_vals_num]);
+    bg_edge_set_value(parallel, 1, test_vals[i % test_vals_num]);
+    bg_edge_set_value(parallel, 2, test_vals[(i / 3) % test_vals_num]);
+    bg_edge_set_value(clone, 1, test_vals[i % test_vals_num]);
+    bg_edge_set_value(clone, 2, test_vals[(i / 3) % test_vals_num]);
+    bg_graph_evaluate(g);
+    bg_graph_evaluate(parallel);
+    bg_graph_evaluate(clone);
+    for(j = 0; j < 2; ++j) {
+      bg_graph_get_output(g, j, &x);
+      bg_graph_get_output(parallel, j, &y);
+      ck_assert(x == y || (isnan(x) && isnan(y)));
+      bg_graph_get_output(clone, j, &y);
+      ck_assert(x == y || (isnan(x) && isnan(y)));
+    }
+    for(j = 0; j < 5; ++j) {
+      bg_node_get_output(g, 10 + j, 1, &x);
+      bg_node_get_output(parallel, 10 + j, 1, &y);
+      ck_assert(x == y || (isnan(x) && isnan(y)));
+    }
+  }
+  /* back to serial */
+  ck_assert_int_eq(bg_graph_set_parallel_subgraphs(parallel, 1), bg_SUCCESS);
+  bg_graph_evaluate(g);
+  bg_graph_evaluate(parallel);
+  bg_graph_get_output(g, 0, &x);
+  bg_graph_get_output(parallel, 0, &y);
+  ck_assert(x == y || (isnan(x) && isnan(y)));
+  ck_assert_int_eq(bg_error_get(), bg_SUCCESS);
+  bg_graph_free(clone);
+  bg_graph_free(parallel);
+} END_TEST
+
+START_TEST(test_direct_edges_match_copies) {
+  size_t i, j;
+  double x, y;
+  bg_graph_t *direct, *nested, *sub;
+  bg_graph_alloc(&direct, "direct");
+  create_mixed_graph(g, (bg_merge_type)_i);
+  create_mixed_graph(direct, (bg_merge_type)_i);
+  ck_assert_int_eq(bg_graph_set_direct_edges(direct, true), bg_SUCCESS);
+  for(i = 0; i < test_vals_num; ++i) {
+    j = test_vals_num - 1 - i;
+    bg_edge_set_value(g, 1, test_vals[i]);
+    bg_edge_set_value(g, 2, test_vals[j]);
+    bg_edge_set_value(direct, 1, test_vals[i]);
+    bg_edge_set_value(direct, 2, test_vals[j]);
+    if(i % 3 == 1) {
+      /* a value set on an inner edge holds until its source runs again */
+      bg_edge_set_value(g, 7, test_vals[j]);
+      bg_edge_set_value(direct, 7, test_vals[j]);
+      bg_edge_get_value(direct, 7, &y);
+      ck_assert(y == test_vals[j] || (isnan(y) && isnan(test_vals[j])));
+    }
+    bg_graph_evaluate(g);
+    bg_graph_evaluate(direct);
+    bg_graph_get_output(g, 0, &x);
+    bg_graph_get_output(direct, 0, &y);
+    ck_assert(x == y || (isnan(x) && isnan(y)));
+    bg_edge_get_value(g, 13, &x);
+    bg_edge_get_value(direct, 13, &y);
+    ck_assert(x == y || (isnan(x) && isnan(y)));
+  }
+  bg_graph_free(direct);
+
+  /* sub-graphs and clones follow the setting */
+  bg_graph_free(g);
+  g = create_nested_graph(3);
+  direct = create_nested_graph(3);
+  ck_assert_int_eq(bg_graph_set_direct_edges(direct, true), bg_SUCCESS);
+  bg_graph_alloc(&nested, "clone");
+  ck_assert_int_eq(bg_graph_clone(nested, direct), bg_SUCCESS);
+  bg_graph_free(direct);
+  direct = nested;
+  for(i = 0; i < 2 * test_vals_num; ++i) {
+    if(i == test_vals_num) {
+      /* switching back keeps the current edge values */
+      ck_assert_int_eq(bg_graph_set_direct_edges(direct, false), bg_SUCCESS);
+      bg_graph_get_subgraph(direct, "sub", &sub);
+      bg_edge_get_value(sub, 4, &y);
+      bg_graph_get_subgraph(g, "sub", &sub);
+      bg_edge_get_value(sub, 4, &x);
+      ck_assert(x == y || (isnan(x) && isnan(y)));
+    }
+    bg_edge_set_value(g, 20, test_vals[i % test_vals_num]);
+    bg_edge_set_value(direct, 20, test_vals[i % test_vals_num]);
+    bg_edge_set_value(g, 21, test_vals[(i + 3) % test_vals_num]);
+    bg_edge_set_value(direct, 21, test_vals[(i + 3) % test_vals_num]);
+    bg_graph_evaluate(g);
+    bg_graph_evaluate(direct);
+    for(j = 0; j < 2; ++j) {
+      bg_graph_get_output(g, j, &x);
+      bg_graph_get_output(direct, j, &y);
+      ck_assert(x == y || (isnan(x) && isnan(y)));
+    }
+  }
+  ck_assert_int_eq(bg_error_get(), bg_SUCCESS);
+  bg_graph_free(direct);
+} END_TEST
+
+
+/* A new edge reads 0 until its source is evaluated, whether it reads a copy,
+ * the source port or a compiled plan. */
+START_TEST(test_new_edges_read_zero) {
+  size_t i, j;
+  double x, y;
+  bg_graph_t *others[2];
+  create_accumulator(g);
+  bg_graph_remove_edge(g, 3);
+  for(i = 0; i < 2; ++i) {
+    bg_graph_alloc(&others[i], "other");
+    create_accumulator(others[i]);
+    bg_graph_remove_edge(others[i], 3);
+  }
+  bg_graph_set_direct_edges(others[0], true);
+  bg_graph_compile(others[1]);
+  for(i = 0; i < 6; ++i) {
+    if(i == 2) {
+      bg_graph_create_edge(g, 11, 0, 10, 0, 1., 6);
+      for(j = 0; j < 2; ++j) {
+        bg_graph_create_edge(others[j], 11, 0, 10, 0, 1., 6);
+        bg_edge_get_value(others[j], 6, &y);
+        ck_assert(y == 0.);
+      }
+    }
+    bg_edge_set_value(g, 1, 1.);
+    bg_graph_evaluate(g);
+    bg_graph_get_output(g, 0, &x);
+    for(j = 0; j < 2; ++j) {
+      bg_edge_set_value(others[j], 1, 1.);
+      bg_graph_evaluate(others[j]);
+      bg_graph_get_output(others[j], 0, &y);
+      ck_assert(x == y);
+    }
+  }
+  ck_assert_flt_almost_eq(x, 4.);
+  ck_assert_int_eq(bg_error_get(), bg_SUCCESS);
+  for(i = 0; i < 2; ++i) {
+    bg_graph_free(others[i]);
+  }
+} END_TEST
+
+START_TEST(test_bg_graph_clone) {
+  size_t i, j, cnt, clone_cnt;
+  double x, y;
+  bg_graph_t *clone, *sub;
+  bg_merge_type merge;
+  bg_graph_free(g);
+  g = create_nested_graph(4);
+  bg_node_set_input(g, 7, 0, bg_MERGE_TYPE_MIN, 1., 0.5, "min");
+  bg_edge_set_weight(g, 1, 1.7);
+  bg_graph_alloc(&clone, "clone");
+  ck_assert_int_eq(bg_graph_clone(clone, g), bg_SUCCESS);
+  bg_graph_get_node_cnt(g, true, &cnt);
+  bg_graph_get_node_cnt(clone, true, &clone_cnt);
+  ck_assert_int_eq(cnt, clone_cnt);
+  bg_graph_get_edge_cnt(g, true, &cnt);
+  bg_graph_get_edge_cnt(clone, true, &clone_cnt);
+  ck_assert_int_eq(cnt, clone_cnt);
+  bg_node_get_merge(clone, 7, 0, &merge);
+  ck_assert_int_eq(merge, bg_MERGE_TYPE_MIN);
+  for(i = 0; i < test_vals_num; ++i) {
+    bg_edge_set_value(g, 20, test_vals[i]);
+    bg_edge_set_value(clone, 20, test_vals[i]);
+    bg_edge_set_value(g, 21, test_vals[(i + 3) % test_vals_num]);
+    bg_edge_set_value(clone, 21, test_vals[(i + 3) % test_vals_num]);
+    bg_graph_evaluate(g);
+    bg_graph_evaluate(clone);
+    for(j = 0; j < 2; ++j) {
+      bg_graph_get_output(g, j, &x);
+      bg_graph_get_output(clone, j, &y);
+      ck_assert(x == y || (isnan(x) && isnan(y)));
+    }
+  }
+  /* the clone owns its nested graphs */
+  bg_graph_get_subgraph(clone, "sub", &sub);
+  bg_edge_set_weight(sub, 1, 4.);
+  bg_graph_get_subgraph(g, "sub", &sub);
+  bg_edge_get_weight(sub, 1, &x);
+  ck_assert(x == 1.1);
+  /* node ids must not collide */
+  ck_assert_int_eq(bg_graph_clone(clone, g), bg_ERR_DUPLICATE_NODE_ID);
+  bg_error_clear();
+  bg_graph_free(clone);
+} END_TEST
+
+START_TEST(test_bg_graph_names) {
+  const char *name1, *name2;
+  unsigned long id;
+  double x, y;
+  char port_name[bg_MAX_STRING_LENGTH];
+  bg_graph_t *clone, *sub;
+  bg_graph_free(g);
+  g = create_nested_graph(2);
+  /* equal names share their storage */
+  bg_graph_create_node(g, "sin", 8, bg_NODE_TYPE_SIN);
+  bg_node_get_name(g, 3, &name1);
+  bg_node_get_name(g, 8, &name2);
+  ck_assert(name1 == name2);
+  ck_assert_int_eq(bg_graph_remove_node(g, 8), bg_SUCCESS);
+  ck_assert_int_eq(bg_node_get_id(g, "sin", &id), bg_SUCCESS);
+  ck_assert_int_eq(id, 3);
+  bg_node_set_input(g, 7, 0, bg_MERGE_TYPE_MAX, 0., -1., "x");
+  bg_node_get_input_name(g, 7, 0, port_name);
+  ck_assert(strcmp(port_name, "x") == 0);
+
+  bg_edge_set_value(g, 20, 0.3);
+  bg_edge_set_value(g, 21, -0.7);
+  bg_graph_evaluate(g);
+  bg_graph_get_output(g, 0, &x);
+  ck_assert_int_eq(bg_graph_set_strip_names(g, true), bg_SUCCESS);
+  bg_node_get_name(g, 3, &name1);
+  ck_assert(strcmp(name1, "") == 0);
+  ck_assert(bg_node_get_id(g, "sin", &id) != bg_SUCCESS);
+  bg_graph_get_subgraph(g, "sub", &sub);
+  ck_assert(sub == NULL);
+  /* names set later on are dropped as well */
+  bg_node_set_input(g, 7, 0, bg_MERGE_TYPE_MAX, 0., -1., "y");
+  bg_node_get_input_name(g, 7, 0, port_name);
+  ck_assert(strcmp(port_name, "") == 0);
+
+  bg_graph_alloc(&clone, "clone");
+  ck_assert_int_eq(bg_graph_clone(clone, g), bg_SUCCESS);
+  bg_graph_create_node(clone, "cos", 8, bg_NODE_TYPE_COS);
+  bg_node_get_name(clone, 8, &name1);
+  ck_assert(strcmp(name1, "") == 0);
+  bg_graph_reset(g, true);
+  bg_edge_set_value(g, 20, 0.3);
+  bg_edge_set_value(g, 21, -0.7);
+  bg_graph_evaluate(g);
+  bg_graph_get_output(g, 0, &y);
+  ck_assert(x == y);
+  bg_edge_set_value(clone, 20, 0.3);
+  bg_edge_set_value(clone, 21, -0.7);
+  bg_graph_evaluate(clone);
+  bg_graph_get_output(clone, 0, &y);
+  ck_assert(x == y);
+  bg_graph_free(clone);
+  ck_assert_int_eq(bg_error_get(), bg_SUCCESS);
+} END_TEST
+
+START_TEST(test_bg_graph_resolve_path) {
+  bg_graph_t *node_graph, *sub, *inner;
+  bg_node_id_t id;
+  bool is_input;
+  size_t idx;
+  bg_graph_free(g);
+  g = create_nested_graph(3);
+  bg_graph_get_subgraph(g, "sub", &sub);
+  bg_graph_get_subgraph(sub, "sub", &inner);
+  ck_assert(sub != NULL && inner != NULL);
+  ck_assert_int_eq(bg_graph_resolve_path(g, "sub/sub/atan2:in2", &node_graph,
+                                         &id, &is_input, &idx), bg_SUCCESS);
+  ck_assert(node_graph == inner);
+  ck_assert_int_eq(id, 4);
+  ck_assert(is_input);
+  ck_assert_int_eq(idx, 1);
+  ck_assert_int_eq(bg_graph_resolve_path(g, "sub/sin:out1", &node_graph,
+                                         &id, &is_input, &idx), bg_SUCCESS);
+  ck_assert(node_graph == sub);
+  ck_assert_int_eq(id, 3);
+  ck_assert(!is_input);
+  ck_assert_int_eq(idx, 0);
+  ck_assert_int_eq(bg_graph_resolve_path(g, "sub/sub/sub", &node_graph,
+                                         &id, &is_input, &idx), bg_SUCCESS);
+  ck_assert(node_graph == inner);
+  ck_assert_int_eq(id, 5);
+  ck_assert_int_eq(bg_graph_resolve_path(g, "max", &node_graph,
+                                         &id, &is_input, &idx), bg_SUCCESS);
+  ck_assert(node_graph == g);
+  ck_assert_int_eq(id, 7);
+  /* unknown names */
+  ck_assert_int_eq(bg_graph_resolve_path(g, "sub/foo/sin", &node_graph,
+                                         &id, &is_input, &idx),
+                   bg_ERR_NODE_NOT_FOUND);
+  ck_assert_int_eq(bg_graph_resolve_path(g, "sub/sin/sin", &node_graph,
+                                         &id, &is_input, &idx),
+                   bg_ERR_NODE_NOT_FOUND);
+  ck_assert_int_eq(bg_graph_resolve_path(g, "sub/sub/foo", &node_graph,
+                                         &id, &is_input, &idx),
+                   bg_ERR_NODE_NOT_FOUND);
+  ck_assert_int_eq(bg_graph_resolve_path(g, "sub/sin:in2", &node_graph,
+                                         &id, &is_input, &idx),
+                   bg_ERR_OUT_OF_RANGE);
+  /* hidden nodes shadow outputs of the same name */
+  bg_graph_create_node(g, "sum", 50, bg_NODE_TYPE_PIPE);
+  ck_assert_int_eq(bg_node_get_id(g, "sum", &id), bg_SUCCESS);
+  ck_assert_int_eq(id, 50);
+  bg_graph_remove_node(g, 50);
+  ck_assert_int_eq(bg_node_get_id(g, "sum", &id), bg_SUCCESS);
+  ck_assert_int_eq(id, 6);
+  ck_assert_int_eq(bg_node_get_id(g, "sum2", &id), bg_ERR_UNKNOWN);
+  ck_assert_int_eq(bg_error_get(), bg_SUCCESS);
+} END_TEST
+
+
+START_TEST(test_port_pointers) {
+  size_t i, j;
+  bg_real in[2], out[2], ref_in[3], x, y;
+  bg_graph_t *ref;
+  bg_input_port_t *input;
+  bg_output_port_t *output, *sub_output;
+  bg_graph_free(g);
+  g = create_nested_graph(2);
+  ref = create_nested_graph(2);
+  bg_graph_compile(g);
+  bg_graph_get_input_pointer(g, 1, &input);
+  bg_graph_get_output_pointer(g, 1, &output);
+  bg_node_get_output_pointer(g, 5, 1, &sub_output);
+  ck_assert_int_eq(bg_error_get(), bg_SUCCESS);
+  for(i = 0; i < test_vals_num; ++i) {
+    in[0] = test_vals[i];
+    in[1] = test_vals[(i + 3) % test_vals_num];
+    bg_graph_set_inputs(g, in);
+    bg_input_set_value_p(input, in[1]);
+    bg_edge_set_value(ref, 20, in[0]);
+    bg_edge_set_value(ref, 21, in[1]);
+    bg_graph_evaluate(g);
+    bg_graph_evaluate(ref);
+    bg_graph_get_outputs(g, out);
+    for(j = 0; j < 2; ++j) {
+      bg_graph_get_output(ref, j, &y);
+      ck_assert(out[j] == y || (isnan(out[j]) && isnan(y)));
+    }
+    bg_output_get_value_p(output, &x);
+    ck_assert(x == out[1] || (isnan(x) && isnan(out[1])));
+    bg_output_get_value_p(sub_output, &x);
+    bg_node_get_output(ref, 5, 1, &y);
+    ck_assert(x == y || (isnan(x) && isnan(y)));
+  }
+  ck_assert_int_eq(bg_error_get(), bg_SUCCESS);
+  ck_assert_int_eq(bg_graph_get_input_pointer(g, 2, &input),
+                   bg_ERR_OUT_OF_RANGE);
+  bg_error_clear();
+  /* an input that isn't wired yet can't take a value */
+  bg_graph_create_input(ref, "unwired", 30);
+  bg_graph_get_input_pointer(ref, 2, &input);
+  ck_assert_int_eq(bg_input_set_value_p(input, 1.), bg_ERR_EDGE_NOT_FOUND);
+  ref_in[0] = 0.5;
+  ref_in[1] = 0.25;
+  ref_in[2] = 1.;
+  ck_assert_int_eq(bg_graph_set_inputs(ref, ref_in), bg_ERR_EDGE_NOT_FOUND);
+  bg_graph_evaluate(ref);
+  bg_graph_get_output(ref, 0, &y);
+  bg_edge_set_value(ref, 20, 0.5);
+  bg_edge_set_value(ref, 21, 0.25);
+  bg_graph_evaluate(ref);
+  bg_graph_get_output(ref, 0, &x);
+  ck_assert(x == y);
+  bg_graph_create_edge(ref, 0, 0, 30, 0, 1., 30);
+  bg_graph_get_input_pointer(ref, 2, &input);
+  ck_assert_int_eq(bg_input_set_value_p(input, 1.), bg_SUCCESS);
+  bg_graph_remove_edge(ref, 30);
+  bg_graph_get_input_pointer(ref, 2, &input);
+  ck_assert_int_eq(bg_input_set_value_p(input, 1.), bg_ERR_EDGE_NOT_FOUND);
+  ck_assert_int_eq(bg_error_get(), bg_SUCCESS);
+  bg_graph_free(ref);
+} END_TEST
+
+
+START_TEST(test_instances) {
+  size_t i, j, k;
+  bg_real in[2], out[2], x, y;
+  bg_definition_t *definition;
+  bg_instance_t *instances[3];
+  bg_graph_t *source;
+  bg_graph_free(g);
+  g = create_nested_graph(3);
+  /* the definition outlives its graph */
+  source = create_nested_graph(3);
+  bg_graph_set_inline_subgraphs(source, true);
+  bg_graph_compile(source);
+  ck_assert_int_eq(bg_definition_create(source, &definition), bg_SUCCESS);
+  bg_graph_free(source);
+  for(k = 0; k < 3; ++k) {
+    ck_assert_int_eq(bg_instance_create(definition, &instances[k]),
+                     bg_SUCCESS);
+  }
+  for(i = 0; i < test_vals_num; ++i) {
+    /* every instance gets its own inputs */
+    for(k = 0; k < 3; ++k) {
+      in[0] = test_vals[(i + k) % test_vals_num];
+      in[1] = test_vals[(i + k + 3) % test_vals_num];
+      bg_instance_set_inputs(instances[k], in);
+      bg_instance_evaluate(instances[k]);
+    }
+    for(k = 0; k < 3; ++k) {
+      bg_edge_set_value(g, 20, test_vals[(i + k) % test_vals_num]);
+      bg_edge_set_value(g, 21, test_vals[(i + k + 3) % test_vals_num]);
+      bg_graph_evaluate(g);
+      bg_instance_get_outputs(instances[k], out);
+      for(j = 0; j < 2; ++j) {
+        bg_graph_get_output(g, j, &y);
+        ck_assert(out[j] == y || (isnan(out[j]) && isnan(y)));
+      }
+    }
+  }
+  ck_assert_int_eq(bg_error_get(), bg_SUCCESS);
+  /* the definition does not follow changes of the graph */
+  bg_instance_set_input(instances[0], 0, 0.5);
+  bg_instance_set_input(instances[0], 1, -0.5);
+  bg_instance_evaluate(instances[0]);
+  bg_instance_get_output(instances[0], 0, &x);
+  bg_edge_set_weight(g, 1, 3.);
+  bg_instance_reset(instances[0]);
+  bg_instance_set_input(instances[0], 0, 0.5);
+  bg_instance_set_input(instances[0], 1, -0.5);
+  bg_instance_evaluate(instances[0]);
+  bg_instance_get_output(instances[0], 0, &y);
+  ck_assert(x == y);
+  ck_assert_int_eq(bg_instance_get_output(instances[0], 2, &y),
+                   bg_ERR_OUT_OF_RANGE);
+  bg_error_clear();
+  for(k = 0; k < 3; ++k) {
+    bg_instance_free(instances[k]);
+  }
+  bg_definition_free(definition);
+} END_TEST
+
+#ifdef THREAD_SUPPORT
+enum { INSTANCE_THREAD_CNT = 8, INSTANCE_CNT = 16 };
+
+typedef struct {
+  size_t idx;
+  size_t failures;
+  const bg_definition_t *definition;
+  /* the outputs of every step, starting at input sequence k */
+  const bg_real *expected;
+} instance_thread_t;
+
+/* the inputs of step i of the sequence starting at k */
+static void instance_inputs(size_t k, size_t i, bg_real *in) {
+  in[0] = test_vals[(i + k) % test_vals_num];
+  in[1] = test_vals[(i + k + 3) % test_vals_num];
+}
+
+/* every thread evaluates instances of its own in turns */
+static void *instance_thread_main(void *arg) {
+  size_t i, j, k;
+  bg_real in[2], out[2];
+  const bg_real *expected;
+  bg_instance_t *instances[INSTANCE_CNT];
+  instance_thread_t *thread = (instance_thread_t*)arg;
+  for(k = 0; k < INSTANCE_CNT; ++k) {
+    if(bg_instance_create(thread->definition, &instances[k]) != bg_SUCCESS) {
+      thread->failures++;
+      return NULL;
+    }
+  }
+  for(i = 0; i < test_vals_num; ++i) {
+    for(k = 0; k < INSTANCE_CNT; ++k) {
+      instance_inputs(thread->idx + k, i, in);
+      bg_instance_set_inputs(instances[k], in);
+      bg_instance_evaluate(instances[k]);
+      bg_instance_get_outputs(instances[k], out);
+      expected = thread->expected +
+        (((thread->idx + k) % test_vals_num) * test_vals_num + i) * 2;
+      for(j = 0; j < 2; ++j) {
+        if(!(out[j] == expected[j] ||
+             (isnan(out[j]) && isnan(expected[j])))) {
+          thread->failures++;
+        }
+      }
+    }
+  }
+  for(k = 0; k < INSTANCE_CNT; ++k) {
+    bg_instance_free(instances[k]);
+  }
+  if(bg_error_occurred()) {
+    thread->failures++;
+  }
+  return NULL;
+}
+#endif
+
+/* many instances of one definition are evaluated from different threads */
+START_TEST(test_instances_concurrently) {
+#ifdef THREAD_SUPPORT
+  size_t i, k;
+  bg_real in[2], *expected;
+  bg_definition_t *definition;
+  bg_instance_t *instance;
+  bg_graph_t *source;
+  pthread_t threads[INSTANCE_THREAD_CNT];
+  instance_thread_t states[INSTANCE_THREAD_CNT];
+  source = create_nested_graph(3);
+  bg_graph_set_inline_subgraphs(source, true);
+  bg_graph_compile(source);
+  ck_assert_int_eq(bg_definition_create(source, &definition), bg_SUCCESS);
+  bg_graph_free(source);
+  /* the outputs of a single instance for every input sequence */
+  expected = (bg_real*)malloc(test_vals_num * test_vals_num * 2 *
+                              sizeof(bg_real));
+  ck_assert(expected != NULL);
+  ck_assert_int_eq(bg_instance_create(definition, &instance), bg_SUCCESS);
+  for(k = 0; k < test_vals_num; ++k) {
+    bg_instance_reset(instance);
+    for(i = 0; i < test_vals_num; ++i) {
+      instance_inputs(k, i, in);
+      bg_instance_set_inputs(instance, in);
+      bg_instance_evaluate(instance);
+      bg_instance_get_outputs(instance,
+                              expected + (k * test_vals_num + i) * 2);
+    }
+  }
+  bg_instance_free(instance);
+  for(i = 0; i < INSTANCE_THREAD_CNT; ++i) {
+    states[i].idx = i;
+    states[i].failures = 0;
+    states[i].definition = definition;
+    states[i].expected = expected;
+    ck_assert(pthread_create(&threads[i], NULL, instance_thread_main,
+                             &states[i]) == 0);
+  }
+  for(i = 0; i < INSTANCE_THREAD_CNT; ++i) {
+    pthread_join(threads[i], NULL);
+  }
+  for(i = 0; i < INSTANCE_THREAD_CNT; ++i) {
+    ck_assert_int_eq(states[i].failures, 0);
+  }
+  ck_assert_int_eq(bg_error_get(), bg_SUCCESS);
+  free(expected);
+  bg_definition_free(definition);
+#endif
+} END_TEST
+
+static void create_optimizable_graph(bg_graph_t *graph,
+                                     bg_merge_type merge_type) {
+  bg_graph_create_input(graph, "x", 1);
+  bg_graph_create_output(graph, "out", 2);
+  /* constants */
+  bg_graph_create_node(graph, "sin", 10, bg_NODE_TYPE_SIN);
+  bg_graph_create_node(graph, "atan2", 11, bg_NODE_TYPE_ATAN2);
+  bg_graph_create_node(graph, "pipe", 12, bg_NODE_TYPE_PIPE);
+  bg_graph_create_node(graph, "tanh", 20, bg_NODE_TYPE_TANH);
+  /* pipe chains */
+  bg_graph_create_node(graph, "pipe1", 30, bg_NODE_TYPE_PIPE);
+  bg_graph_create_node(graph, "pipe2", 31, bg_NODE_TYPE_PIPE);
+  bg_graph_create_node(graph, "pipe3", 32, bg_NODE_TYPE_PIPE);
+  /* dead nodes */
+  bg_graph_create_node(graph, "dead1", 40, bg_NODE_TYPE_SIN);
+  bg_graph_create_node(graph, "dead2", 41, bg_NODE_TYPE_PIPE);
+  bg_graph_create_node(graph, "dead3", 42, bg_NODE_TYPE_COS);
+  bg_node_set_merge(graph, 10, 0, bg_MERGE_TYPE_SUM, 0.5, 0.1);
+  bg_node_set_default(graph, 11, 0, 1.);
+  bg_node_set_default(graph, 11, 1, 2.);
+  bg_node_set_merge(graph, 20, 0, merge_type, 0., 0.25);
+  bg_graph_create_edge(graph, 0, 0, 1, 0, 1., 1);
+  bg_graph_create_edge(graph, 11, 0, 12, 0, 3., 2);
+  bg_graph_create_edge(graph, 12, 0, 20, 0, -0.5, 3);
+  bg_graph_create_edge(graph, 10, 0, 20, 0, 2., 4);
+  bg_graph_create_edge(graph, 1, 0, 20, 0, 1.5, 5);
+  bg_graph_create_edge(graph, 10, 0, 2, 0, 0.5, 6);
+  bg_graph_create_edge(graph, 20, 0, 2, 0, 1., 7);
+  bg_graph_create_edge(graph, 1, 0, 30, 0, 2., 8);
+  bg_graph_create_edge(graph, 30, 0, 31, 0, -0.5, 9);
+  bg_graph_create_edge(graph, 31, 0, 2, 0, 1., 10);
+  bg_graph_create_edge(graph, 1, 0, 32, 0, 0.3, 11);
+  bg_graph_create_edge(graph, 20, 0, 32, 0, 0.7, 12);
+  bg_graph_create_edge(graph, 32, 0, 2, 0, 1.1, 13);
+  bg_graph_create_edge(graph, 1, 0, 40, 0, 1., 14);
+  bg_graph_create_edge(graph, 40, 0, 41, 0, 1., 15);
+  bg_graph_create_edge(graph, 41, 0, 40, 0, 1., 16);
+  bg_graph_create_edge(graph, 1, 0, 42, 0, 1., 17);
+}
+
+START_TEST(test_optimize_matches_original) {
+  size_t i, j, node_cnt, sub_node_cnt;
+  double x, y;
+  bg_graph_t *optimized, *subgraph;
+  bg_graph_alloc(&optimized, "optimized");
+  create_optimizable_graph(g, (bg_merge_type)_i);
+  create_optimizable_graph(optimized, (bg_merge_type)_i);
+  ck_assert_int_eq(bg_graph_optimize(optimized, false), bg_SUCCESS);
+  bg_graph_get_node_cnt(optimized, false, &node_cnt);
+  if(_i == bg_MERGE_TYPE_SUM) {
+    /* only x, tanh and out are left */
+    ck_assert_int_eq(node_cnt, 3);
+  } else {
+    ck_assert(node_cnt <= 9);
+  }
+  for(i = 0; i < 2; ++i) {
+    if(i == 1) {
+      /* the same graph as sub-graph */
+      bg_graph_free(optimized);
+      bg_graph_alloc(&optimized, "optimized");
+      bg_graph_alloc(&subgraph, "sub");
+      create_optimizable_graph(subgraph, (bg_merge_type)_i);
+      bg_graph_create_input(optimized, "x", 1);
+      bg_graph_create_node(optimized, "sub", 3, bg_NODE_TYPE_SUBGRAPH);
+      bg_node_set_subgraph(optimized, 3, subgraph);
+      bg_graph_create_output(optimized, "y", 2);
+      bg_graph_create_edge(optimized, 0, 0, 1, 0, 1., 1);
+      bg_graph_create_edge(optimized, 1, 0, 3, 0, 1., 2);
+      bg_graph_create_edge(optimized, 3, 0, 2, 0, 1., 3);
+      ck_assert_int_eq(bg_graph_optimize(optimized, true), bg_SUCCESS);
+      bg_graph_get_node_cnt(optimized, true, &sub_node_cnt);
+      ck_assert_int_eq(sub_node_cnt, node_cnt + 2);
+    }
+    for(j = 0; j < 17; ++j) {
+      bg_edge_set_value(g, 1, -2. + 0.25 * j);
+      bg_edge_set_value(optimized, 1, -2. + 0.25 * j);
+      bg_graph_evaluate(g);
+      bg_graph_evaluate(optimized);
+      bg_graph_get_output(g, 0, &x);
+      bg_graph_get_output(optimized, 0, &y);
+      ck_assert_flt_almost_eq(x, y);
+    }
+  }
+  ck_assert_int_eq(bg_error_get(), bg_SUCCESS);
+  bg_graph_free(optimized);
+} END_TEST
+
+/* Folding the constant and removing the dead node change the order in which
+ * a new sort would visit the loop between 10 and 11. */
+START_TEST(test_optimize_loop) {
+  size_t i;
+  double x, y;
+  bg_graph_t *optimized;
+  bg_graph_t *graphs[2];
+  bg_graph_alloc(&optimized, "optimized");
+  graphs[0] = g;
+  graphs[1] = optimized;
+  for(i = 0; i < 2; ++i) {
+    bg_graph_create_input(graphs[i], "x", 1);
+    bg_graph_create_output(graphs[i], "out", 2);
+    bg_graph_create_node(graphs[i], "const", 5, bg_NODE_TYPE_PIPE);
+    bg_graph_create_node(graphs[i], "dead", 6, bg_NODE_TYPE_SIN);
+    bg_graph_create_node(graphs[i], "a", 10, bg_NODE_TYPE_SIN);
+    bg_graph_create_node(graphs[i], "b", 11, bg_NODE_TYPE_TANH);
+    bg_node_set_merge(graphs[i], 5, 0, bg_MERGE_TYPE_SUM, 0., 0.5);
+    bg_graph_create_edge(graphs[i], 0, 0, 1, 0, 1., 1);
+    bg_graph_create_edge(graphs[i], 5, 0, 11, 0, 1., 2);
+    bg_graph_create_edge(graphs[i], 11, 0, 6, 0, 1., 3);
+    bg_graph_create_edge(graphs[i], 10, 0, 11, 0, 2., 4);
+    bg_graph_create_edge(graphs[i], 11, 0, 10, 0, -1., 5);
+    bg_graph_create_edge(graphs[i], 1, 0, 10, 0, 1., 6);
+    bg_graph_create_edge(graphs[i], 11, 0, 2, 0, 1., 7);
+  }
+  ck_assert_int_eq(bg_graph_optimize(optimized, false), bg_SUCCESS);
+  for(i = 0; i < 8; ++i) {
+    bg_edge_set_value(g, 1, 0.25 * i);
+    bg_edge_set_value(optimized, 1, 0.25 * i);
+    bg_graph_evaluate(g);
+    bg_graph_evaluate(optimized);
+    bg_graph_get_output(g, 0, &x);
+    bg_graph_get_output(optimized, 0, &y);
+    ck_assert_flt_almost_eq(x, y);
+  }
+  ck_assert_int_eq(bg_error_get(), bg_SUCCESS);
+  bg_graph_free(optimized);
+} END_TEST
+
+/* The input port of a sub-graph node holds an edge of the sub-graph with
+ * the same id as the edge into the node. */
+START_TEST(test_optimize_unused_subgraph) {
+  size_t node_cnt;
+  double x;
+  bg_edge_t *edge;
+  bg_graph_t *subgraph;
+  bg_graph_alloc(&subgraph, "sub");
+  bg_graph_create_input(subgraph, "in", 1);
+  bg_graph_create_output(subgraph, "out", 2);
+  bg_graph_create_edge(subgraph, 0, 0, 1, 0, 1., 1);
+  bg_graph_create_edge(subgraph, 1, 0, 2, 0, 1., 2);
+  bg_graph_create_input(g, "x", 1);
+  bg_graph_create_node(g, "sub", 3, bg_NODE_TYPE_SUBGRAPH);
+  bg_node_set_subgraph(g, 3, subgraph);
+  bg_graph_create_output(g, "y", 2);
+  bg_graph_create_edge(g, 1, 0, 3, 0, 1., 1);
+  bg_graph_create_edge(g, 0, 0, 1, 0, 1., 3);
+  bg_graph_create_edge(g, 1, 0, 2, 0, 2., 4);
+  ck_assert_int_eq(bg_graph_optimize(g, false), bg_SUCCESS);
+  ck_assert_int_eq(bg_edge_get_pointer(g, 1, &edge), bg_ERR_EDGE_NOT_FOUND);
+  bg_error_clear();
+  /* the unused sub-graph node is gone */
+  bg_graph_get_node_cnt(g, false, &node_cnt);
+  ck_assert_int_eq(node_cnt, 2);
+  bg_edge_set_value(g, 3, 1.5);
+  bg_graph_evaluate(g);
+  bg_graph_get_output(g, 0, &x);
+  ck_assert_flt_almost_eq(x, 3.);
+  ck_assert_int_eq(bg_error_get(), bg_SUCCESS);
+} END_TEST
+
 Suite* bg_suite() {
   Suite *s = suite_create("c_bagel");
   TCase *tc_general, *tc_graph, *tc_node, *tc_node_merge, *tc_node_type;
-  TCase *tc_float_exc, *tc_networks;
+  TCase *tc_float_exc, *tc_networks, *tc_compiled;
 
   tc_general = tcase_create("General");
   tcase_add_test(tc_general, test_bg_not_initialized);
@@ -564,6 +2380,18 @@ Suite* bg_suite() {
   tcase_add_test(tc_graph, test_bg_graph_empty);
   tcase_add_test(tc_graph, test_bg_graph_create_remove);
   tcase_add_test(tc_graph, test_bg_graph_get_nodes);
+  tcase_add_test(tc_graph, test_bg_graph_id_index);
+  tcase_add_test(tc_graph, test_bg_graph_resolve_path);
+  tcase_add_test(tc_graph, test_bg_graph_clone);
+  tcase_add_test(tc_graph, test_bg_graph_names);
+  tcase_add_test(tc_graph, test_bg_graph_reuse_memory);
+  tcase_add_test(tc_graph, test_bg_graph_high_fan_in);
+  tcase_add_test(tc_graph, test_bg_graph_many_ports);
+  tcase_add_test(tc_graph, test_error_state_per_thread);
+  tcase_add_test(tc_graph, test_bg_graph_long_chain);
+  tcase_add_loop_test(tc_graph, test_bg_graph_edit_order, 0, 20);
+  tcase_add_test(tc_graph, test_sort_concurrently);
+  tcase_add_test(tc_graph, test_pool_evaluate);
   suite_add_tcase(s, tc_graph);
 
   tc_node = tcase_create("Node");
@@ -580,6 +2408,8 @@ Suite* bg_suite() {
   tcase_add_test(tc_node_merge, test_bg_node_merge_min);
   tcase_add_test(tc_node_merge, test_bg_node_merge_max);
   tcase_add_test(tc_node_merge, test_bg_node_merge_median);
+  tcase_add_loop_test(tc_node_merge, test_bg_node_merge_median_fan_in, 0, 12);
+  tcase_add_test(tc_node_merge, test_bg_node_merge_median_nan);
   tcase_add_test(tc_node_merge, test_bg_node_merge_mean);
   tcase_add_test(tc_node_merge, test_bg_node_merge_norm);
   suite_add_tcase(s, tc_node_merge);
@@ -612,5 +2442,34 @@ Suite* bg_suite() {
   tcase_add_test(tc_networks, test_simple_net);
   suite_add_tcase(s, tc_networks);
 
+  tc_compiled = tcase_create("Compiled Graphs");
+  tcase_add_checked_fixture(tc_compiled, setup_graph, teardown_graph);
+  tcase_add_loop_test(tc_compiled, test_compiled_matches_interpreted,
+                      0, bg_NUM_OF_MERGE_TYPES);
+  tcase_add_test(tc_compiled, test_compiled_modify);
+  tcase_add_loop_test(tc_compiled, test_batch_matches_scalar,
+                      0, bg_NUM_OF_MERGE_TYPES);
+  tcase_add_test(tc_compiled, test_batch_subgraph);
+  tcase_add_test(tc_compiled, test_batch_subgraph_state);
+  tcase_add_test(tc_compiled, test_incremental_matches_full);
+  /* the loop index selects a compiled or a parallel graph */
+  tcase_add_loop_test(tc_compiled, test_compiled_edge_values, 0, 2);
+  tcase_add_test(tc_compiled, test_inline_subgraphs);
+  tcase_add_test(tc_compiled, test_parallel_subgraphs);
+  tcase_add_loop_test(tc_compiled, test_compiled_subgraph_edges, 0, 3);
+  tcase_add_loop_test(tc_compiled, test_direct_edges_match_copies,
+                      0, bg_NUM_OF_MERGE_TYPES);
+  tcase_add_test(tc_compiled, test_new_edges_read_zero);
+  tcase_add_test(tc_compiled, test_port_pointers);
+  tcase_add_test(tc_compiled, test_instances);
+  tcase_add_test(tc_compiled, test_instances_concurrently);
+  tcase_add_loop_test(tc_compiled, test_optimize_matches_original,
+                      0, bg_NUM_OF_MERGE_TYPES);
+  tcase_add_test(tc_compiled, test_optimize_loop);
+  tcase_add_test(tc_compiled, test_optimize_unused_subgraph);
+  /* the loop index is the minimal width of a parallel level */
+  tcase_add_loop_test(tc_compiled, test_parallel_matches_serial, 0, 3);
+  suite_add_tcase(s, tc_compiled);
+
   return s;
 }
@@ -2,9 +2,15 @@
 #include "bg_test.h"
 #include <string.h>
 #include <math.h>
+#include <stdlib.h>
 
 extern char base_dir[];
 
+/* generated from test_graphs/codegenTest.yml by generate_c_code */
+size_t codegen_state_size(void);
+void codegen_init(double *state);
+void codegen_evaluate(double *state, const double *inputs, double *outputs);
+
 START_TEST(test_simple_graph) {
   double x, y, result;
   bg_graph_t *g;
@@ -33,12 +39,75 @@ START_TEST(test_simple_graph) {
 } END_TEST
 
 
+START_TEST(test_ignore_for_sort) {
+  double result;
+  bg_graph_t *g;
+  char path[MAX_STRING_SIZE];
+  bg_initialize();
+  bg_graph_alloc(&g, "ignore for sort");
+  strncpy(path, base_dir, MAX_STRING_SIZE);
+  strncat(path, "/test_graphs/ignoreForSortTest.yml", MAX_STRING_SIZE);
+  bg_graph_from_yaml_file(path, g);
+  bg_graph_create_edge(g, 0, 0, 1, 0, 1., 100);
+  ck_assert_int_eq(bg_error_get(), bg_SUCCESS);
+  /* node 12 has no relation left and is sorted after node 11 by its
+   * index, so the value reaches the output in the first evaluation */
+  bg_edge_set_value(g, 100, 1.);
+  bg_graph_evaluate(g);
+  bg_graph_get_output(g, 0, &result);
+  ck_assert_int_eq(bg_error_get(), bg_SUCCESS);
+  ck_assert_flt_almost_eq(result, 1.);
+  bg_graph_free(g);
+  bg_terminate();
+} END_TEST
+
+
+START_TEST(test_generated_code) {
+  size_t i, j;
+  double inputs[2], outputs[2], result;
+  double *state;
+  bg_graph_t *g;
+  char path[MAX_STRING_SIZE];
+  bg_initialize();
+  bg_graph_alloc(&g, "codegen");
+  strncpy(path, base_dir, MAX_STRING_SIZE);
+  strncat(path, "/test_graphs/codegenTest.yml", MAX_STRING_SIZE);
+  bg_graph_from_yaml_file(path, g);
+  bg_graph_create_edge(g, 0, 0, 1, 0, 1., 1000);
+  bg_graph_create_edge(g, 0, 0, 2, 0, 1., 1001);
+  ck_assert_int_eq(bg_error_get(), bg_SUCCESS);
+  state = (double*)malloc(sizeof(double) * (codegen_state_size() + 1));
+  codegen_init(state);
+  for(i = 0; i < 200; ++i) {
+    inputs[0] = -2.5 + 0.025 * i;
+    inputs[1] = 1.5 - 0.0175 * i;
+    bg_edge_set_value(g, 1000, inputs[0]);
+    bg_edge_set_value(g, 1001, inputs[1]);
+    bg_graph_evaluate(g);
+    codegen_evaluate(state, inputs, outputs);
+    for(j = 0; j < 2; ++j) {
+      bg_graph_get_output(g, j, &result);
+      if(isnan(result)) {
+        ck_assert_flt_nan(outputs[j]);
+      } else {
+        ck_assert_flt_almost_eq(result, outputs[j]);
+      }
+    }
+  }
+  ck_assert_int_eq(bg_error_get(), bg_SUCCESS);
+  free(state);
+  bg_graph_free(g);
+  bg_terminate();
+} END_TEST
+
 Suite* bg_yaml_suite() {
   Suite *s = suite_create("c_bagel - YAML Loader");
   TCase *tc_general;
 
   tc_general = tcase_create("General");
   tcase_add_test(tc_general, test_simple_graph);
+  tcase_add_test(tc_general, test_ignore_for_sort);
+  tcase_add_test(tc_general, test_generated_code);
   suite_add_tcase(s, tc_general);
 
   return s;